@@ -34,7 +34,7 @@ action_t *constant_on = NULL;
 action_input_prop_t *led_on_duration;
 double constant_on_duration_min = 1; //seconds
 double constant_on_duration_max = 600;
-at_type_t blinking_led_type, prop_led_on_type, prop_led_freq_type;
+at_type_t blinking_led_type;
 at_type_t constant_on_input_attype;
 action_input_prop_t *constant_on_duration;
 
@@ -153,8 +153,8 @@ int16_t led_set_frequency(char *new_value_str){
 	
 	prev_freq = led_freq;
 	new_freq = atoi(new_value_str);
-	fmin = prop_led_freq -> min_value.int_val;
-	fmax = prop_led_freq -> max_value.int_val;
+	fmin = prop_led_freq -> desc -> min_value.int_val;
+	fmax = prop_led_freq -> desc -> max_value.int_val;
 	if (new_freq != prev_freq){
 		if ((new_freq >= fmin) && (new_freq <= fmax)){
 			int new_dt_max = (int)(1000/new_freq);
@@ -175,73 +175,89 @@ int16_t led_set_frequency(char *new_value_str){
 
 /******************************************************
  *
- * Stop constant ON and back to blinking
+ * back to blinking, called with led_mux taken
  *
  * *****************************************************/
-void constant_on_timer_fun(TimerHandle_t xTimer){
-	
-	complete_action(1, "constant_on", ACT_COMPLETED);
-	
-	xSemaphoreTake(led_mux, portMAX_DELAY);
+static void led_blinking_restore(void){
+
 	led_blinking = true;
 	gpio_set_level(GPIO_LED, 0);
 	led_state = 0;
 	dt_counter = 0;
+}
+
+
+/******************************************************
+ *
+ * Stop constant ON and back to blinking, timer ID is
+ * the index of the request
+ *
+ * *****************************************************/
+void constant_on_timer_fun(TimerHandle_t xTimer){
+	int request_index = (int)(intptr_t)pvTimerGetTimerID(xTimer);
+	
+	xSemaphoreTake(led_mux, portMAX_DELAY);
+	if (constant_on_timer != xTimer){
+		//request cancelled, timer deleted by cancel function
+		xSemaphoreGive(led_mux);
+		return;
+	}
+	constant_on_timer = NULL;
+	led_blinking_restore();
 	xSemaphoreGive(led_mux);
 	
+	//the next queued request is run now, led must be blinking already
+	complete_action_request(blinking_led -> thing_nr, "constant_on",
+							request_index, ACT_COMPLETED);
+	
 	xTimerDelete(xTimer, 100);
 }
 
 
-
 /**********************************************************
  *
  * constant_on action
  * inputs:
- * 		- seconds of turn ON in json format, e.g.: "duration":10
+ * 		- seconds of turn ON, "duration" (required, 1..600),
+ * 		  validated by the server against the action model
+ * output:
+ * 		0 - led is on, the request is completed by the timer
+ * 		-1 - request failed (the server doesn't wait for completion)
  *
  * *******************************************************/
-int8_t constant_on_run(char *inputs){
-	int duration = 0, len;
-	char *p1, buff[6];
-
-	if (led_blinking == true){
-		//get duration value
-		p1 = strstr(inputs, "duration");
-		if (p1 == NULL){
-			goto inputs_error;
-		}
-		p1 = strchr(p1, ':');
-		if (p1 == NULL){
-			goto inputs_error;
-		}
-		len = strlen(inputs) - (p1 + 1 - inputs);
-		if (len > 5){
-			goto inputs_error;
-		}
-		memset(buff, 0, 6);
-		memcpy(buff, p1 + 1, len);
-		duration = atoi(buff);
-		if ((duration > 600) || (duration == 0)){
-			goto inputs_error;
+int8_t constant_on_run(action_inputs_t *inputs){
+	request_value_t *duration;
+
+	if (led_blinking == false){
+		printf("constant ON: led is already on\n");
+		return -1;
+	}
+	duration = get_action_input(inputs, "duration");
+	if (duration == NULL){
+		goto inputs_error;
+	}
+
+	xSemaphoreTake(led_mux, portMAX_DELAY);
+	gpio_set_level(GPIO_LED, 1);
+	led_blinking = false;
+	
+	//start timer
+	constant_on_timer = xTimerCreate("constant_on_timer",
+								pdMS_TO_TICKS(duration -> value.int_val * 1000),
+								pdFALSE,
+								(void *)(intptr_t)inputs -> request_index,
+								constant_on_timer_fun);
+	if ((constant_on_timer == NULL) || (xTimerStart(constant_on_timer, 5) == pdFAIL)){
+		printf("action timer failed\n");
+		if (constant_on_timer != NULL){
+			xTimerDelete(constant_on_timer, 5);
+			constant_on_timer = NULL;
 		}
-		
-		xSemaphoreTake(led_mux, portMAX_DELAY);
-		gpio_set_level(GPIO_LED, 1);
-		led_blinking = false;
-		
-		//start timer
-		constant_on_timer = xTimerCreate("constant_on_timer",
-									pdMS_TO_TICKS(duration * 1000),
-									pdFALSE,
-									pdFALSE,
-									constant_on_timer_fun);
+		led_blinking_restore();
 		xSemaphoreGive(led_mux);
-		
-		if (xTimerStart(constant_on_timer, 5) == pdFAIL){
-			printf("action timer failed\n");
-		}
+		return -1;
 	}
+	xSemaphoreGive(led_mux);
 
 	return 0;
 
@@ -251,6 +267,56 @@ int8_t constant_on_run(char *inputs){
 }
 
 
+/**********************************************************
+ *
+ * cancel constant_on request (DELETE of the running request)
+ * output:
+ * 		0 - timer stopped, led is blinking again
+ * 		-1 - the request is not running (timer has expired already)
+ *
+ * *******************************************************/
+int8_t constant_on_cancel(int request_index){
+	int8_t res = -1;
+
+	xSemaphoreTake(led_mux, portMAX_DELAY);
+	if ((constant_on_timer != NULL) &&
+		((int)(intptr_t)pvTimerGetTimerID(constant_on_timer) == request_index)){
+		xTimerDelete(constant_on_timer, 5);
+		constant_on_timer = NULL;
+		led_blinking_restore();
+		res = 0;
+	}
+	xSemaphoreGive(led_mux);
+
+	return res;
+}
+
+
+//static description of properties (kept in flash)
+static const property_desc_t led_on_desc = {
+	.id = "led_on",
+	.title = "ON/OFF",
+	.description = "led ON/OFF state",
+	.at_type = "OnOffProperty",
+	.type = VAL_BOOLEAN,
+	.read_only = false,
+	.set = led_set_on_off,
+};
+
+static const property_desc_t led_freq_desc = {
+	.id = "frequency",
+	.title = "Frequency x 10",
+	.description = "led blinking frequency",
+	.at_type = "LevelProperty",
+	.type = VAL_INTEGER,
+	.unit = "hertz",
+	.min_value.int_val = 1,
+	.max_value.int_val = 300,
+	.read_only = false,
+	.set = led_set_frequency,
+};
+
+
 /*****************************************************************
  *
  * Initialization termostat thing and all it's properties
@@ -274,39 +340,12 @@ thing_t *init_blinking_led(void){
 	blinking_led -> description = "Internet connected blinking LED";
 	
 	//create ON/OFF property
-	prop_led_on = property_init(NULL, NULL);
-	prop_led_on -> id = "led_on";
-	prop_led_on -> description = "led ON/OFF state";
-	prop_led_on_type.at_type = "OnOffProperty";
-	prop_led_on_type.next = NULL;
-	prop_led_on -> at_type = &prop_led_on_type;
-	prop_led_on -> type = VAL_BOOLEAN;
-	prop_led_on -> value = &led_is_on;
-	prop_led_on -> title = "ON/OFF";
-	prop_led_on -> read_only = false;
-	prop_led_on -> set = led_set_on_off;
-	prop_led_on -> mux = led_mux;
-
+	prop_led_on = property_init(&led_on_desc, &led_is_on, led_mux);
 	add_property(blinking_led, prop_led_on); //add property to thing
 	
 	//create "frequency" property
 	dt_max = (int)(1000/led_freq);
-	prop_led_freq = property_init(NULL, NULL);
-	prop_led_freq -> id = "frequency";
-	prop_led_freq -> description = "led blinking frequency";
-	prop_led_freq_type.at_type = "LevelProperty";
-	prop_led_freq_type.next = NULL;
-	prop_led_freq -> at_type = &prop_led_freq_type;
-	prop_led_freq -> type = VAL_INTEGER;
-	prop_led_freq -> value = &led_freq;
-	prop_led_freq -> max_value.int_val = 300;
-	prop_led_freq -> min_value.int_val = 1;
-	prop_led_freq -> unit = "hertz";
-	prop_led_freq -> title = "Frequency x 10";
-	prop_led_freq -> read_only = false;
-	prop_led_freq -> set = led_set_frequency;
-	prop_led_freq -> mux = led_mux;
-
+	prop_led_freq = property_init(&led_freq_desc, &led_freq, led_mux);
 	add_property(blinking_led, prop_led_freq); //add property to thing
 	
 	//create action "led_on", turn on led for specified seconds
@@ -314,7 +353,8 @@ thing_t *init_blinking_led(void){
 	constant_on -> id = "constant_on";
 	constant_on -> title = "Constant ON";
 	constant_on -> description = "Set led ON for some seconds";
-	constant_on -> run = constant_on_run;
+	constant_on -> run_typed = constant_on_run;
+	constant_on -> cancel = constant_on_cancel;
 	constant_on_input_attype.at_type = "ToggleAction";
 	constant_on_input_attype.next = NULL;
 	constant_on -> input_at_type = &constant_on_input_attype;
@@ -1 +1,17 @@
-# Use defaults
+#
+# thing code and description generated from thing_button.json
+# (web_thing_server/tools/td_gen.py)
+#
+COMPONENT_OBJS := thing_button.o thing_button_td.o
+CFLAGS += -I$(COMPONENT_BUILD_DIR)
+
+thing_button.o: thing_button_td.h
+
+thing_button_td.c thing_button_td.h: $(COMPONENT_PATH)/thing_button.json $(WEB_THING_TD_GEN)
+	$(PYTHON) $(WEB_THING_TD_GEN) --out-dir $(COMPONENT_BUILD_DIR) $<
+
+thing_button_td.o: thing_button_td.c
+	$(summary) CC $(patsubst $(PWD)/%,%,$(CURDIR))/$@
+	$(CC) $(CFLAGS) $(CPPFLAGS) $(addprefix -I ,$(COMPONENT_INCLUDES)) $(addprefix -I ,$(COMPONENT_EXTRA_INCLUDES)) -c $< -o $@
+
+COMPONENT_EXTRA_CLEAN := thing_button_td.c thing_button_td.h
@@ -19,6 +19,7 @@
 
 #include "simple_web_thing_server.h"
 #include "thing_button.h"
+#include "thing_button_td.h"
 
 //button GPIO
 #define GPIO_BUTTON		       	(CONFIG_BUTTON_GPIO)
@@ -29,10 +30,9 @@ xSemaphoreHandle DRAM_ATTR button_mux;
 static int irq_counter = 0, irq_counter_1 = 0;
 static bool DRAM_ATTR button_ready = false;
 
+//thing, property descriptors and its description are generated
+//from thing_button.json (web_thing_server/tools/td_gen.py)
 thing_t *iot_button = NULL;
-property_t *prop_pushed, *prop_push_counter;
-event_t *ten_times_event;
-at_type_t iot_button_type, pushed_prop_type, push_counter_prop_type;
 static bool pushed = false;
 
 /* ************************************************************
@@ -78,37 +78,26 @@ void button_fun(void *pvParameter){
 
 		if (button_value == 0){
 			//button pressed
-			pushed = true;
-			irq_counter++;
+			button_counter_set(iot_button, irq_counter + 1);
+			button_pushed_set(iot_button, true);
 			if (irq_counter%10 == 0){
-				int *c = malloc(sizeof(int));
-				*c = 10;
-				emit_event(iot_button -> thing_nr, "10times", (void *)c);
+				int c = 10;
+				emit_event(iot_button -> thing_nr, "10times", &c);
 			}
 		}
 		else{
 			//button released
-			pushed = false;
+			button_pushed_set(iot_button, false);
 		}
 
-		inform_all_subscribers_prop(prop_pushed);
-		inform_all_subscribers_prop(prop_push_counter);
-
 		//wait a bit to avoid button vibration
 		vTaskDelay(200 / portTICK_PERIOD_MS);
 		
 		//check if button is released meanwhile
 		int button_value_1 = gpio_get_level(GPIO_BUTTON);
 		if (button_value_1 != button_value){
-			if (button_value_1 == 0){
-				//button pressed
-				pushed = true;
-			}
-			else{
-				//button released
-				pushed = false;
-			}
-			inform_all_subscribers_prop(prop_pushed);
+			//button pressed (0) or released meanwhile
+			button_pushed_set(iot_button, button_value_1 == 0);
 		}
 		
 		if (button_ready == false){
@@ -155,63 +144,8 @@ thing_t *init_button(void){
 	init_button_io();
 	
 	button_mux = xSemaphoreCreateMutex();
-	//create button thing
-	iot_button = thing_init();
-	
-	iot_button -> id = "Button";
-	iot_button -> at_context = things_context;
-	iot_button -> model_len = 1500;
-	//set @type
-	iot_button_type.at_type = "PushButton";
-	iot_button_type.next = NULL;
-	set_thing_type(iot_button, &iot_button_type);
-	iot_button -> description = "Internet connected button";
-	
-	//create pushed property
-	prop_pushed = property_init(NULL, NULL);
-	prop_pushed -> id = "pushed";
-	prop_pushed -> description = "button state";
-	pushed_prop_type.at_type = "PushedProperty";
-	pushed_prop_type.next = NULL;
-	prop_pushed -> at_type = &pushed_prop_type;
-	prop_pushed -> type = VAL_BOOLEAN;
-	prop_pushed -> value = &pushed;
-	prop_pushed -> title = "Pushed";
-	prop_pushed -> read_only = true;
-	prop_pushed -> set = NULL;
-	prop_pushed -> mux = button_mux;
-
-	add_property(iot_button, prop_pushed); //add property to thing
-	
-	//create push counter property
-	prop_push_counter = property_init(NULL, NULL);
-	prop_push_counter -> id = "counter";
-	prop_push_counter -> description = "button push counter";
-	push_counter_prop_type.at_type = "LevelProperty";
-	push_counter_prop_type.next = NULL;
-	prop_push_counter -> at_type = &push_counter_prop_type;
-	prop_push_counter -> type = VAL_INTEGER;
-	prop_push_counter -> value = &irq_counter;
-	prop_push_counter -> max_value.int_val = INT_MAX;
-	prop_push_counter -> min_value.int_val = 0;
-	prop_push_counter -> unit = "pcs";
-	prop_push_counter -> title = "Counter";
-	prop_push_counter -> read_only = true;
-	prop_push_counter -> set = NULL;
-	prop_push_counter -> mux = button_mux;
-
-	add_property(iot_button, prop_push_counter); //add property to thing
-	
-	//event "button pushed 10 times"
-	ten_times_event = event_init();
-	ten_times_event -> id = "10times";
-	ten_times_event -> title = "10 times";
-	ten_times_event -> description = "button pushed 10 times";
-	ten_times_event -> type = VAL_INTEGER;
-	ten_times_event -> at_type = "AlarmEvent";
-	ten_times_event -> unit = "pcs";
-
-	add_event(iot_button, ten_times_event); //add event to thing
+	//create button thing with its properties and event
+	iot_button = button_thing_init(button_mux, &pushed, &irq_counter);
 	
 	if (button_sem != NULL){
 		xTaskCreate(&button_fun, "button_task",
@@ -47,16 +47,54 @@ xSemaphoreHandle therm_mux;
 xTaskHandle thermometer_task; //task for reading temperature
 
 //THINGS AND PROPERTIES
-static double temperature = 0.0, last_sent_temperature = 0.0;
+static double temperature = 0.0;
 //5 readings without errors mean 100% correctness
-static int temp_correctness = 0, old_temp_correctness = 0;
-static int temp_errors = 0, old_temp_errors = 0;
+static int temp_correctness = 0;
+static int temp_errors = 0;
 thing_t *thermometer = NULL;
 property_t *prop_temperature, *prop_errors, *prop_correctness;
 at_type_t therm_type;
-at_type_t temp_prop_type;
-at_type_t corr_prop_type;
-at_type_t errors_prop_type;
+
+//static description of properties (kept in flash)
+static const property_desc_t temperature_desc = {
+	.id = "temperature",
+	.title = "Temperature",
+	.description = "temperature sensor DS18B20",
+	.at_type = "TemperatureProperty",
+	.type = VAL_NUMBER,
+	.unit = "degree celsius",
+	.min_value.float_val = -55.0,
+	.max_value.float_val = 125.0,
+	.read_only = true,
+	//send if temperature changes by 0.1 deg or at least every 30 sec.
+	.notify = {.dead_band = 0.1, .max_silence_ms = 30000},
+};
+
+static const property_desc_t correctness_desc = {
+	.id = "correctness",
+	.title = "Correctness",
+	.description = "temperature correctness",
+	.at_type = "LevelProperty",
+	.type = VAL_INTEGER,
+	.unit = "percent",
+	.min_value.int_val = 0,
+	.max_value.int_val = 100,
+	.read_only = true,
+	.notify = {.on_change_only = true},
+};
+
+static const property_desc_t errors_desc = {
+	.id = "errors",
+	.title = "Errors",
+	.description = "temperature reading errors",
+	.at_type = "LevelProperty",
+	.type = VAL_INTEGER,
+	.unit = "",
+	.min_value.int_val = 0,
+	.max_value.int_val = 1000000,
+	.read_only = true,
+	.notify = {.on_change_only = true},
+};
 
 //thermometer thread functions
 void thermometer_fun(void *param); //thread function
@@ -161,13 +199,10 @@ void thermometer_fun(void *param){
 	double temp_sum = 0;
 	int correct_samples = 0;
 	int num_devices = 0;
-	time_t time_now, time_prev;
 
 	printf("thermometer task is starting\n");
 	num_devices = init_ds18b20();
 	vTaskDelay(500 / portTICK_PERIOD_MS);
-	time(&time_now);
-	time_prev = time_now;
 
 	if (num_devices > 0){
 		printf("DS18B20 sensors are found\n");
@@ -195,36 +230,18 @@ void thermometer_fun(void *param){
 			//TODO: sensor's error signaling
 			sample_nr++;
 			if (sample_nr%TEMP_SAMPLES == 0){
-				//set new temperature
+				//set new temperature, server sends it according to
+				//notification policy (dead-band and heartbeat)
 				temperature = temp_sum / correct_samples;
-				time(&time_now);
-				int dt = abs((int)((temperature - last_sent_temperature)*100)); 
-				//printf("dT = %i, dt = %i\n", dt, (int)(time_now - time_prev));
-				if ((dt >= 10) || ((time_now - time_prev) >= 30)){
-					int8_t s = inform_all_subscribers_prop(prop_temperature);
-					if (s == 0){
-						last_sent_temperature = temperature;
-						time_prev = time_now;
-						//printf("temperature sent, T = %f\n", temperature);
-					}
-					else{
-						//printf("temperature NOT sent, T = %f\n", temperature);
-					}
-				}
+				inform_all_subscribers_prop(prop_temperature);
 				//set new correctness
 #ifdef CONFIG_ENABLE_OTA_UPDATE
 				if (ota_update_block() == OTA_BLOCK_OK){
 #endif
 					temp_correctness = (100 * correct_samples)/TEMP_SAMPLES;
-					if (temp_correctness != old_temp_correctness){
-						inform_all_subscribers_prop(prop_correctness);
-						old_temp_correctness = temp_correctness;
-					}
+					inform_all_subscribers_prop(prop_correctness);
 					//set new errors
-					if (temp_errors != old_temp_errors){
-						inform_all_subscribers_prop(prop_errors);
-						old_temp_errors = temp_errors;
-					}
+					inform_all_subscribers_prop(prop_errors);
 #ifdef CONFIG_ENABLE_OTA_UPDATE
 				}
 				ota_update_unblock();
@@ -272,60 +289,16 @@ thing_t *init_thermometer(char *_thing_id){
 	thermometer -> description = "Indoor thermometer";
 
 	//create temperature property
-	prop_temperature = property_init(NULL, NULL);
-	prop_temperature -> id = "temperature";
-	prop_temperature -> description = "temperature sensor DS18B20";
-	temp_prop_type.at_type = "TemperatureProperty";
-	temp_prop_type.next = NULL;
-	prop_temperature -> at_type = &temp_prop_type;
-	prop_temperature -> type = VAL_NUMBER;
-	prop_temperature -> value = &temperature;
-	prop_temperature -> max_value.float_val = 125.0;
-	prop_temperature -> min_value.float_val = -55.0;
-	prop_temperature -> unit = "degree celsius";
-	prop_temperature -> title = "Temperature";
-	prop_temperature -> read_only = true;
-	prop_temperature -> set = NULL;
-	prop_temperature -> mux = therm_mux;
-
+	prop_temperature = property_init(&temperature_desc, &temperature, therm_mux);
 	add_property(thermometer, prop_temperature); //add property to thing
+	property_history_init(prop_temperature, 0); //record temperature history
 
 	//create correctness property
-	prop_correctness = property_init(NULL, NULL);
-	prop_correctness -> id = "correctness";
-	prop_correctness -> description = "temperature correctness";
-	corr_prop_type.at_type = "LevelProperty";
-	corr_prop_type.next = NULL;
-	prop_correctness -> at_type = &corr_prop_type;
-	prop_correctness -> type = VAL_INTEGER;
-	prop_correctness -> value = &temp_correctness;
-	prop_correctness -> max_value.int_val = 100;
-	prop_correctness -> min_value.int_val = 0;
-	prop_correctness -> unit = "percent";
-	prop_correctness -> title = "Correctness";
-	prop_correctness -> read_only = true;
-	prop_correctness -> set = NULL;
-	prop_correctness -> mux = therm_mux;
-
+	prop_correctness = property_init(&correctness_desc, &temp_correctness, therm_mux);
 	add_property(thermometer, prop_correctness); //add property to thing
 
 	//create errors property
-	prop_errors = property_init(NULL, NULL);
-	prop_errors -> id = "errors";
-	prop_errors -> description = "temperature reading errors";
-	errors_prop_type.at_type = "LevelProperty";
-	errors_prop_type.next = NULL;
-	prop_errors -> at_type = &errors_prop_type;
-	prop_errors -> type = VAL_INTEGER;
-	prop_errors -> value = &temp_errors;
-	prop_errors -> max_value.int_val = 1000000;
-	prop_errors -> min_value.int_val = 0;
-	prop_errors -> unit = "";
-	prop_errors -> title = "Errors";
-	prop_errors -> read_only = true;
-	prop_errors -> set = NULL;
-	prop_errors -> mux = therm_mux;
-
+	prop_errors = property_init(&errors_desc, &temp_errors, therm_mux);
 	add_property(thermometer, prop_errors); //add property to thing
 
 	xTaskCreate(&thermometer_fun, "thermometer", configMINIMAL_STACK_SIZE * 4, NULL, 5, &thermometer_task);
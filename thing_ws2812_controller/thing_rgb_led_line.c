@@ -54,35 +54,102 @@ at_type_t led_line_type;
 static uint8_t on_off_state;
 static int8_t standby_counter = 0;
 property_t *prop_on;
-at_type_t on_prop_type;
+static const property_desc_t on_desc = {
+	.id = "on",
+	.title = "ON/OFF",
+	.description = "ON/OFF",
+	.at_type = "OnOffProperty",
+	.type = VAL_BOOLEAN,
+	.read_only = false,
+	.set = on_off_set,
+};
 
 //------  property "diodes" - number of diodes
 int32_t diodes;
 property_t *prop_diodes;
-at_type_t diodes_prop_type;
+static const property_desc_t diodes_desc = {
+	.id = "diodes",
+	.title = "diodes",
+	.description = "number of controlled diodes",
+	.at_type = "LevelProperty",
+	.type = VAL_INTEGER,
+	.unit = "pcs",
+	.min_value.int_val = 3,
+	.max_value.int_val = LEDS_MAX,
+	.read_only = false,
+	.set = diodes_set,
+};
 
 //------  property "pattern" - current pattern
 property_t *prop_pattern;
 static int32_t old_pattern;
-at_type_t pattern_prop_type;
-
-enum_item_t enum_run_point, enum_rgb_palette, enum_tetris, enum_static;
-enum_item_t enum_float_ends, enum_new_year, enum_christmas;
+static const char *const pattern_enum[] = {patterns_name_tab[1],
+								patterns_name_tab[2], patterns_name_tab[3],
+								patterns_name_tab[4], patterns_name_tab[5],
+								patterns_name_tab[6], patterns_name_tab[7], NULL};
+static const property_desc_t pattern_desc = {
+	.id = "pattern",
+	.title = "pattern",
+	.description = "current color pattern",
+	.at_type = "PatternProperty",
+	.type = VAL_STRING,
+	.enum_list = pattern_enum,
+	.read_only = false,
+	.set = pattern_set,
+};
 
 //-------- property color
 static char color[] = "#00ff00"; //current color
 property_t *prop_color;
-at_type_t color_prop_type;
+static const property_desc_t color_desc = {
+	.id = "color",
+	.title = "color",
+	.description = "color set for some patterns",
+	.at_type = "ColorProperty",
+	.type = VAL_STRING,
+	.unit = "color RGB",
+	.min_value.int_val = 0,
+	.max_value.int_val = 0xffffff,
+	.read_only = false,
+	.set = color_set,
+	.value_jsonize = color_value_jsonize,
+	.model_jsonize = color_model_jsonize,
+	.notify = {.on_change_only = true},
+};
 
 //-------- property speed
 static int32_t speed; //0..100 in percent
 property_t *prop_speed;
-at_type_t speed_prop_type;
+static const property_desc_t speed_desc = {
+	.id = "speed",
+	.title = "speed",
+	.description = "led refreshment speed",
+	.at_type = "LevelProperty",
+	.type = VAL_INTEGER,
+	.unit = "percent",
+	.min_value.int_val = 1,
+	.max_value.int_val = 100,
+	.read_only = false,
+	.set = speed_set,
+	.notify = {.on_change_only = true},
+};
 
 //-------- property brightness
 static int32_t brightness; //0..100 in percent
 property_t *prop_brgh;
-at_type_t brgh_prop_type;
+static const property_desc_t brgh_desc = {
+	.id = "brgh",
+	.title = "brightness",
+	.description = "led line brightness",
+	.at_type = "BrightnessProperty",
+	.type = VAL_INTEGER,
+	.unit = "percent",
+	.min_value.int_val = 0,
+	.max_value.int_val = 100,
+	.read_only = false,
+	.set = brightness_set,
+	.notify = {.on_change_only = true},
+};
 
 //SPI variables
 //extern uint8_t *spi_buff;
@@ -215,16 +282,16 @@ int16_t pattern_set(char *new_value_str){
 	
 	//set pattern
 	//prev_patt = (char *)prop_pattern -> value;
-	if (prop_pattern -> enum_list != NULL){
-		enum_item_t *enum_item = prop_pattern -> enum_list;
-		while (enum_item != NULL){
-			if (strcmp(buff, enum_item -> value.str_addr) == 0){
-				prop_pattern -> value = enum_item -> value.str_addr;
+	if (prop_pattern -> desc -> enum_list != NULL){
+		const char *const *enum_item = prop_pattern -> desc -> enum_list;
+		while (*enum_item != NULL){
+			if (strcmp(buff, *enum_item) == 0){
+				prop_pattern -> value = (char *)*enum_item;
 				res = 1;
 				break;
 			}
 			else{
-				enum_item = enum_item -> next;
+				enum_item++;
 			}
 			p++;
 		}
@@ -426,8 +493,8 @@ char *color_model_jsonize(property_t *p){
 	char *buff;
 
 	//only unit printed in model, is it enough?
-	buff = malloc(12 + strlen(p -> unit));
-	sprintf(buff, "\"unit\":\"%s\",", p -> unit);
+	buff = malloc(12 + strlen(p -> desc -> unit));
+	sprintf(buff, "\"unit\":\"%s\",", p -> desc -> unit);
 
 	return buff;
 }
@@ -740,125 +807,29 @@ thing_t *init_rgb_led_line(){
 	led_line -> description = "web connected color leds";
 
 	//property: ON/OFF
-	prop_on = property_init(NULL, NULL);
-	prop_on -> id = "on";
-	prop_on -> description = "ON/OFF";
-	on_prop_type.at_type = "OnOffProperty";
-	on_prop_type.next = NULL;
-	prop_on -> at_type = &on_prop_type;
-	prop_on -> type = VAL_BOOLEAN;
-	prop_on -> value = &on_off_state;
-	prop_on -> title = "ON/OFF";
-	prop_on -> read_only = false;
-	prop_on -> set = on_off_set;
-	prop_on -> mux = led_line_mux;
+	prop_on = property_init(&on_desc, &on_off_state, led_line_mux);
 	add_property(led_line, prop_on); //add property to thing
 
 	//property: diodes
-	prop_diodes = property_init(NULL, NULL);
-	prop_diodes -> id = "diodes";
-	prop_diodes -> description = "number of controlled diodes";
-	diodes_prop_type.at_type = "LevelProperty";
-	diodes_prop_type.next = NULL;
-	prop_diodes -> at_type = &diodes_prop_type;
-	prop_diodes -> type = VAL_INTEGER;
-	prop_diodes -> value = &diodes;
-	prop_diodes -> max_value.int_val = LEDS_MAX;
-	prop_diodes -> min_value.int_val = 3;
-	prop_diodes -> unit = "pcs";
-	prop_diodes -> title = "diodes";
-	prop_diodes -> read_only = false;
-	prop_diodes -> set = diodes_set;
-	prop_diodes -> mux = led_line_mux;
+	prop_diodes = property_init(&diodes_desc, &diodes, led_line_mux);
 	add_property(led_line, prop_diodes); //add property to thing
 
 	//property: pattern
-	prop_pattern = property_init(NULL, NULL);
-	prop_pattern -> id = "pattern";
-	prop_pattern -> description = "current color pattern";
-	pattern_prop_type.at_type = "PatternProperty";
-	pattern_prop_type.next = NULL;
-	prop_pattern -> at_type = &pattern_prop_type;
-	prop_pattern -> type = VAL_STRING;
-	
-	prop_pattern -> enum_prop = true;
-	prop_pattern -> enum_list = &enum_run_point;
-	enum_run_point.value.str_addr = patterns_name_tab[1];
-	enum_run_point.next = &enum_rgb_palette;
-	enum_rgb_palette.value.str_addr = patterns_name_tab[2];
-	enum_rgb_palette.next = &enum_tetris;
-	enum_tetris.value.str_addr = patterns_name_tab[3];
-	enum_tetris.next = &enum_static;
-	enum_static.value.str_addr = patterns_name_tab[4];
-	enum_static.next = &enum_float_ends;
-	enum_float_ends.value.str_addr = patterns_name_tab[5];
-	enum_float_ends.next = &enum_new_year;
-	enum_new_year.value.str_addr = patterns_name_tab[6];
-	enum_new_year.next = &enum_christmas;
-	enum_christmas.value.str_addr = patterns_name_tab[7];
-	enum_christmas.next = NULL;
-	
-	prop_pattern -> value = patterns_name_tab[led_line_param.runningPattern];
-	prop_pattern -> title = "pattern";
-	prop_pattern -> read_only = false;
-	prop_pattern -> set = pattern_set;
-	prop_pattern -> mux = led_line_mux;
+	prop_pattern = property_init(&pattern_desc,
+								patterns_name_tab[led_line_param.runningPattern],
+								led_line_mux);
 	add_property(led_line, prop_pattern);
 
 	//property: color
-	prop_color = property_init(NULL, NULL);
-	prop_color -> id = "color";
-	prop_color -> description = "color set for some patterns";
-	color_prop_type.at_type = "ColorProperty";
-	color_prop_type.next = NULL;
-	prop_color -> at_type = &color_prop_type;
-	prop_color -> type = VAL_STRING;
-	prop_color -> value = &color;
-	prop_color -> max_value.int_val = 0xffffff;
-	prop_color -> min_value.int_val = 0;
-	prop_color -> unit = "color RGB";
-	prop_color -> title = "color";
-	prop_color -> read_only = false;
-	prop_color -> set = color_set;
-	prop_color -> model_jsonize = color_model_jsonize;
-	prop_color -> value_jsonize = color_value_jsonize;
-	prop_color -> mux = led_line_mux;
+	prop_color = property_init(&color_desc, &color, led_line_mux);
 	add_property(led_line, prop_color);
 
 	//property: speed
-	prop_speed = property_init(NULL, NULL);
-	prop_speed -> id = "speed";
-	prop_speed -> description = "led refreshment speed";
-	speed_prop_type.at_type = "LevelProperty";
-	speed_prop_type.next = NULL;
-	prop_speed -> at_type = &speed_prop_type;
-	prop_speed -> type = VAL_INTEGER;
-	prop_speed -> value = &speed;
-	prop_speed -> max_value.int_val = 100;
-	prop_speed -> min_value.int_val = 1;
-	prop_speed -> unit = "percent";
-	prop_speed -> title = "speed";
-	prop_speed -> read_only = false;
-	prop_speed -> set = speed_set;
-	prop_speed -> mux = led_line_mux;
+	prop_speed = property_init(&speed_desc, &speed, led_line_mux);
 	add_property(led_line, prop_speed);
 
 	//property: brightness
-	prop_brgh = property_init(NULL, NULL);
-	prop_brgh -> id = "brgh";
-	prop_brgh -> description = "led line brightness";
-	brgh_prop_type.at_type = "BrightnessProperty";
-	brgh_prop_type.next = NULL;
-	prop_brgh -> at_type = &brgh_prop_type;
-	prop_brgh -> type = VAL_INTEGER;
-	prop_brgh -> value = &brightness;
-	prop_brgh -> max_value.int_val = 100;
-	prop_brgh -> min_value.int_val = 0;
-	prop_brgh -> unit = "percent";
-	prop_brgh -> title = "brightness";
-	prop_brgh -> read_only = false;
-	prop_brgh -> set = brightness_set;
-	prop_brgh -> mux = led_line_mux;
+	prop_brgh = property_init(&brgh_desc, &brightness, led_line_mux);
 	add_property(led_line, prop_brgh);
 
 	return led_line;
@@ -9,16 +9,36 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #include "common.h"
 #include "http_parser.h"
 #include "simple_web_thing_server.h"
+#include "web_thing_cbor.h"
+#include "web_thing_event_log.h"
+#include "web_thing_arena.h"
 
 extern root_node_t root_node;
 
-int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len);
-int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t len);
-int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len);
+int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len,
+					connection_desc_t *conn_desc);
+int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t len,
+					connection_desc_t *conn_desc);
+int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len,
+					connection_desc_t *conn_desc);
+int16_t delete_parser(char *rq, uint16_t things);
+static bool http_header_has(char *rq, const char *header, const char *value);
+static bool http_cbor_response(char *rq);
+static uint8_t *http_body(char *rq, uint16_t tcp_len, int *body_len);
+static int16_t http_send_cbor(connection_desc_t *conn_desc, int16_t status,
+								uint8_t *data, int len);
+static uint32_t http_request_len(const char *rq, uint32_t len);
+
+#ifdef CONFIG_STATIC_ALLOC
+//buffer of request received in many segments (websocket message after
+//upgrade), for every connection slot
+static char rx_storage[MAX_OPEN_CONN][HTTP_RX_STORAGE_LEN] __attribute__((aligned(4)));
+#endif
 
 char http_head[] = "HTTP/1.1 ";
 char http_status_200[] = "200 OK\r\n";
@@ -26,6 +46,7 @@ char http_status_201[] = "201 Created\r\n";
 char http_status_204[] = "204 No Content\r\n";
 char http_status_500[] = "500 Internal Server Error\r\n";
 char http_status_400[] = "400 Bad Request\r\n";
+char http_status_503[] = "503 Service Unavailable\r\n";
 
 char keep_alive_resp[] = "Connection: Keep-Alive\r\n";
 char keep_alive_resp_param[] = "Keep-Alive: timeout=2, max=100\r\n";
@@ -37,12 +58,23 @@ char h1_201[] = "Access-Control-Allow-Origin: *\r\n"\
 				"Content-Type: application/json; charset=utf-8\r\n\r\n";
 
 char h1_204[] = "Access-Control-Allow-Origin: *\r\n"\
-				"Access-Control-Allow-Methods: GET, POST, PUT, OPTIONS\r\n"\
+				"Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"\
 				"Access-Control-Allow-Headers: content-type\r\n"\
 				"Access-Control-Max-Age: 86400\r\n\r\n";
 
 char h1_500[] = "Access-Control-Allow-Origin: *\r\n"\
 				"Content-Type: text/html; charset=utf-8\r\n\r\n";
+
+char h1_503[] = "Access-Control-Allow-Origin: *\r\n"\
+				"Retry-After: " RETRY_AFTER_S "\r\n\r\n";
+
+char h1_cbor[] = "Access-Control-Allow-Origin: *\r\n"\
+				"Content-Type: "CBOR_CONTENT_TYPE"\r\n"\
+				"Content-Length: %i\r\n\r\n";
+
+char h1_chunked[] = "Access-Control-Allow-Origin: *\r\n"\
+				"Content-Type: application/json; charset=utf-8\r\n"\
+				"Transfer-Encoding: chunked\r\n\r\n";
 				
 
 //*********************************
@@ -67,6 +99,10 @@ uint8_t http_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc){
 	//printf("rq:\n%s\n", rq); //test
 
 	parse_http_request(rq, &rs, tcp_len, conn_desc);
+	if (rs == NULL){
+		//response was streamed by the resource handler
+		return res;
+	}
 	
 	//printf("resp:\n%s\n", rs); //test
 
@@ -80,7 +116,7 @@ uint8_t http_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc){
 		printf("data not sent\n------\n%s\n-----------\n", rs);
 	}
 
-	free(rs);
+	req_free(rs);
 	//conn_desc -> run = CONN_STOP; //close http connection
 
 	return res;
@@ -107,15 +143,19 @@ int16_t parse_http_request(char *rq,
 
 	if(rq[0] == 'G' && rq[1] == 'E' && rq[2] == 'T'){
 		//GET request
-		status = get_parser(rq, &buff, root_node.things_quantity, len);
+		status = get_parser(rq, &buff, root_node.things_quantity, len, conn_desc);
 	}
 	else if (rq[0] == 'P' && rq[1] == 'U' && rq[2] == 'T'){
 		//PUT request
-		status = put_parser(rq, &buff, root_node.things_quantity, len);
+		status = put_parser(rq, &buff, root_node.things_quantity, len, conn_desc);
 	}
 	else if (rq[0] == 'P' && rq[1] == 'O' && rq[2] == 'S' && rq[3] == 'T'){
 		//POST request
-		status = post_parser(rq, &buff, root_node.things_quantity, len);
+		status = post_parser(rq, &buff, root_node.things_quantity, len, conn_desc);
+	}
+	else if (strncmp(rq, "DELETE", 6) == 0){
+		//DELETE request (action request)
+		status = delete_parser(rq, root_node.things_quantity);
 	}
 	else if (rq[0] == 'O' && rq[1] == 'P' && rq[2] == 'T' && rq[3] == 'I' && rq[4] == 'O' &&
 			rq[5] == 'N' && rq[6] == 'S'){
@@ -127,6 +167,12 @@ int16_t parse_http_request(char *rq,
 		status = 500;
 	}
 
+	if (status == HTTP_STREAMED){
+		//response is already sent
+		*res = NULL;
+		return status;
+	}
+
 	if (buff != NULL){
 		res_len = strlen(buff);
 	}
@@ -153,16 +199,16 @@ int16_t parse_http_request(char *rq,
 	}
 	http_header = prepare_http_header(status, keep_alive);
 	
-	res_buff = malloc(strlen(http_header) + res_len + 10);
+	res_buff = req_malloc(strlen(http_header) + res_len + 10);
 	res_buff[0] = 0;
 	//memset(res_buff, 0, strlen(http_header) + res_len + 10);
 	strcat(res_buff, http_header);
 	
-	free(http_header);
+	req_free(http_header);
 
 	if (buff != NULL){
 		strcat(res_buff, buff);
-		free(buff);
+		req_free(buff);
 	}
 
 	*res = res_buff;
@@ -171,6 +217,354 @@ int16_t parse_http_request(char *rq,
 }
 
 
+/**************************************************
+*
+* start chunked HTTP response (200 OK), body is sent
+* in parts by http_stream_write
+*
+***************************************************/
+int8_t http_stream_begin(connection_desc_t *conn_desc){
+	char buff[256];
+	err_t err;
+
+	strcpy(buff, http_head);
+	strcat(buff, http_status_200);
+	if ((conn_desc -> connection == CONN_HTTP_KEEP_ALIVE) ||
+		(conn_desc -> connection == CONN_HTTP_RUNNING)){
+		strcat(buff, keep_alive_resp);
+		strcat(buff, keep_alive_resp_param);
+	}
+	strcat(buff, h1_chunked);
+	err = netconn_write(conn_desc -> netconn_ptr, buff, strlen(buff), NETCONN_COPY);
+
+	return (err == ERR_OK) ? 0 : -1;
+}
+
+
+/**************************************************
+*
+* send one chunk of the HTTP response body
+*
+***************************************************/
+int8_t http_stream_write(connection_desc_t *conn_desc, char *data, int len){
+	char chunk_head[10];
+	err_t err;
+
+	if (len <= 0){
+		return 0;
+	}
+	sprintf(chunk_head, "%X\r\n", len);
+	err = netconn_write(conn_desc -> netconn_ptr, chunk_head, strlen(chunk_head),
+						NETCONN_COPY | NETCONN_MORE);
+	if (err == ERR_OK){
+		err = netconn_write(conn_desc -> netconn_ptr, data, len,
+							NETCONN_COPY | NETCONN_MORE);
+	}
+	if (err == ERR_OK){
+		err = netconn_write(conn_desc -> netconn_ptr, "\r\n", 2, NETCONN_COPY);
+	}
+
+	return (err == ERR_OK) ? 0 : -1;
+}
+
+
+/**************************************************
+*
+* finish chunked HTTP response
+*
+***************************************************/
+int8_t http_stream_end(connection_desc_t *conn_desc){
+	err_t err;
+
+	err = netconn_write(conn_desc -> netconn_ptr, "0\r\n\r\n", 5, NETCONN_COPY);
+
+	return (err == ERR_OK) ? 0 : -1;
+}
+
+
+/**************************************************
+*
+* get numeric parameter from URL query, e.g. "?since=10&step=5"
+*
+***************************************************/
+uint32_t http_query_param(char *url, char *name, uint32_t default_value){
+	char *q, *p;
+	int name_len = strlen(name);
+
+	q = strchr(url, '?');
+	while (q != NULL){
+		p = q + 1;
+		if ((strncmp(p, name, name_len) == 0) && (p[name_len] == '=')){
+			return strtoul(p + name_len + 1, NULL, 10);
+		}
+		q = strchr(p, '&');
+	}
+
+	return default_value;
+}
+
+
+/**************************************************
+*
+* check if request header (name is case insensitive) contains
+* given value, e.g. "Accept:" and "application/cbor"
+*
+***************************************************/
+static bool http_header_has(char *rq, const char *header, const char *value){
+	char *line, *end;
+	int h_len = strlen(header), v_len = strlen(value);
+
+	line = strstr(rq, "\r\n");
+	while (line != NULL){
+		line += 2;
+		end = strstr(line, "\r\n");
+		if ((end == NULL) || (end == line)){
+			//end of header
+			break;
+		}
+		if (strncasecmp(line, header, h_len) == 0){
+			for (char *v = line + h_len; v + v_len <= end; v++){
+				if (strncasecmp(v, value, v_len) == 0){
+					return true;
+				}
+			}
+		}
+		line = end;
+	}
+
+	return false;
+}
+
+
+/**************************************************
+*
+* response in CBOR if client accepts it or sends CBOR
+* without asking for json
+*
+***************************************************/
+static bool http_cbor_response(char *rq){
+
+	if (http_header_has(rq, "Accept:", CBOR_CONTENT_TYPE) == true){
+		return true;
+	}
+	return (http_header_has(rq, "Content-Type:", CBOR_CONTENT_TYPE) == true) &&
+			(http_header_has(rq, "Accept:", "application/json") == false);
+}
+
+
+/**************************************************
+*
+* find '}' closing json object which starts at p ('{'),
+* braces inside strings are skipped
+* output: pointer to '}' or NULL
+*
+***************************************************/
+char *json_object_end(char *p){
+	int level = 0;
+	bool in_string = false;
+
+	for (; *p != 0; p++){
+		if (in_string == true){
+			if ((*p == '\\') && (*(p + 1) != 0)){
+				p++;
+			}
+			else if (*p == '"'){
+				in_string = false;
+			}
+		}
+		else if (*p == '"'){
+			in_string = true;
+		}
+		else if (*p == '{'){
+			level++;
+		}
+		else if ((*p == '}') && (--level == 0)){
+			return p;
+		}
+	}
+
+	return NULL;
+}
+
+
+/**************************************************
+*
+* length of the whole request (headers and Content-Length
+* body) or 0 if headers are not complete yet,
+* data doesn't have to end with 0, Content-Length longer than
+* HTTP_MAX_REQUEST_LEN is cut to HTTP_MAX_REQUEST_LEN + 1 (the sum
+* doesn't overflow)
+*
+***************************************************/
+static uint32_t http_request_len(const char *rq, uint32_t len){
+	const char *line = rq, *p;
+	unsigned long body = 0;
+
+	for (p = rq; p + 1 < rq + len; p++){
+		if ((p[0] != '\r') || (p[1] != '\n')){
+			continue;
+		}
+		if (p == line){
+			//empty line, end of headers
+			return (p + 2 - rq) + body;
+		}
+		if ((p - line > 15) && (strncasecmp(line, "Content-Length:", 15) == 0)){
+			//line ends with '\r', so strtoul stops inside of the data
+			body = strtoul(line + 15, NULL, 10);
+			if (body > HTTP_MAX_REQUEST_LEN){
+				body = HTTP_MAX_REQUEST_LEN + 1;
+			}
+		}
+		line = p + 2;
+	}
+
+	return 0;
+}
+
+
+/**************************************************
+*
+* collect request from TCP segments, request which comes
+* in one segment (usual case) is not copied
+* output: 1 - request is complete (*rq, *len),
+*		  0 - more data needed (conn_desc -> rx_need is 0
+*			  until all headers are received),
+*		 -1 - request is too long
+*
+***************************************************/
+int8_t http_collect(connection_desc_t *conn_desc, struct netbuf *inbuf,
+					char **rq, uint16_t *len){
+	char *data;
+	uint16_t data_len;
+	uint32_t total = netbuf_len(inbuf);
+
+	if (conn_desc -> rx_len == 0){
+		netbuf_first(inbuf);
+		if ((netbuf_data(inbuf, (void **)&data, &data_len) == ERR_OK) &&
+				(data_len == total)){
+			conn_desc -> rx_need = http_request_len(data, data_len);
+			if ((conn_desc -> rx_need > 0) && (conn_desc -> rx_need <= HTTP_MAX_REQUEST_LEN) &&
+					(data_len >= conn_desc -> rx_need)){
+				*rq = data;
+				*len = data_len;
+				return 1;
+			}
+		}
+	}
+
+	if (conn_desc -> rx_len + total > HTTP_MAX_REQUEST_LEN){
+		return -1;
+	}
+	if (conn_desc -> rx_buff == NULL){
+#ifdef CONFIG_STATIC_ALLOC
+		conn_desc -> rx_buff = rx_storage[conn_desc -> index];
+#else
+		conn_desc -> rx_buff = malloc(HTTP_MAX_REQUEST_LEN + 1);
+		if (conn_desc -> rx_buff == NULL){
+			return -1;
+		}
+#endif
+	}
+	netbuf_copy(inbuf, conn_desc -> rx_buff + conn_desc -> rx_len, total);
+	conn_desc -> rx_len += total;
+	conn_desc -> rx_buff[conn_desc -> rx_len] = 0;
+
+	conn_desc -> rx_need = http_request_len(conn_desc -> rx_buff, conn_desc -> rx_len);
+	if (conn_desc -> rx_need > HTTP_MAX_REQUEST_LEN){
+		return -1;
+	}
+	if ((conn_desc -> rx_need == 0) || (conn_desc -> rx_len < conn_desc -> rx_need)){
+		return 0;
+	}
+	*rq = conn_desc -> rx_buff;
+	*len = conn_desc -> rx_len;
+
+	return 1;
+}
+
+
+/**************************************************
+*
+* request is processed, release collected data
+*
+***************************************************/
+void http_collect_done(connection_desc_t *conn_desc){
+
+	if (conn_desc -> rx_buff != NULL){
+#ifndef CONFIG_STATIC_ALLOC
+		free(conn_desc -> rx_buff);
+#endif
+		conn_desc -> rx_buff = NULL;
+	}
+	conn_desc -> rx_len = 0;
+	conn_desc -> rx_need = 0;
+}
+
+
+#ifdef CONFIG_STATIC_ALLOC
+/**************************************************
+*
+* receive buffer of the connection slot (HTTP_RX_STORAGE_LEN bytes)
+*
+***************************************************/
+char *http_rx_storage(connection_desc_t *conn_desc){
+
+	return rx_storage[conn_desc -> index];
+}
+#endif
+
+
+/**************************************************
+*
+* body of the request (binary data)
+*
+***************************************************/
+static uint8_t *http_body(char *rq, uint16_t tcp_len, int *body_len){
+	char *ptr = strstr(rq, "\r\n\r\n");
+
+	if ((ptr == NULL) || (ptr + 4 > rq + tcp_len)){
+		*body_len = 0;
+		return NULL;
+	}
+	ptr += 4;
+	*body_len = rq + tcp_len - ptr;
+
+	return (uint8_t *)ptr;
+}
+
+
+/**************************************************
+*
+* send CBOR response (200 or 201), data is released
+*
+***************************************************/
+static int16_t http_send_cbor(connection_desc_t *conn_desc, int16_t status,
+								uint8_t *data, int len){
+	char buff[300];
+	err_t err;
+
+	strcpy(buff, http_head);
+	strcat(buff, (status == 201) ? http_status_201 : http_status_200);
+	if ((conn_desc -> connection == CONN_HTTP_KEEP_ALIVE) ||
+		(conn_desc -> connection == CONN_HTTP_RUNNING)){
+		strcat(buff, keep_alive_resp);
+		strcat(buff, keep_alive_resp_param);
+	}
+	sprintf(buff + strlen(buff), h1_cbor, len);
+	err = netconn_write(conn_desc -> netconn_ptr, buff, strlen(buff),
+						NETCONN_COPY | NETCONN_MORE);
+	if (err == ERR_OK){
+		err = netconn_write(conn_desc -> netconn_ptr, data, len, NETCONN_COPY);
+	}
+	if (err != ERR_OK){
+		printf("CBOR data not sent\n");
+	}
+	req_free(data);
+
+	return HTTP_STREAMED;
+}
+
+
 /**************************************************
 *
 * prepare HTTP header for HTTP response
@@ -186,7 +580,7 @@ char *prepare_http_header(int16_t status, bool keep_alive){
 		if (keep_alive == true){
 			len += strlen(keep_alive_resp) + strlen(keep_alive_resp_param);
 		}
-		http_header = malloc(len);
+		http_header = req_malloc(len);
 		memset(http_header, 0, len);
 		strcat(http_header, http_head);
 		strcat(http_header, http_status_200);
@@ -202,7 +596,7 @@ char *prepare_http_header(int16_t status, bool keep_alive){
 		if (keep_alive == true){
 			len += strlen(keep_alive_resp) + strlen(keep_alive_resp_param);
 		}
-		http_header = malloc(len);
+		http_header = req_malloc(len);
 		memset(http_header, 0, len);
 		strcat(http_header, http_head);
 		strcat(http_header, http_status_201);
@@ -218,7 +612,7 @@ char *prepare_http_header(int16_t status, bool keep_alive){
 		if (keep_alive == true){
 			len += strlen(keep_alive_resp) + strlen(keep_alive_resp_param);
 		}
-		http_header = malloc(len);
+		http_header = req_malloc(len);
 		memset(http_header, 0, len);
 		strcat(http_header, http_head);
 		strcat(http_header, http_status_204);
@@ -231,20 +625,36 @@ char *prepare_http_header(int16_t status, bool keep_alive){
 
 	case 500:
 		len = 20 + strlen(http_status_500) + strlen(h1_500);
-		http_header = malloc(len);
+		http_header = req_malloc(len);
 		memset(http_header, 0, len);
 		strcat(http_header, http_head);
 		strcat(http_header, http_status_500);
 		strcat(http_header, h1_500);
 		break;
 
+	case 503:
+		len = 20 + strlen(http_status_503) + strlen(h1_503);
+		if (keep_alive == true){
+			len += strlen(keep_alive_resp) + strlen(keep_alive_resp_param);
+		}
+		http_header = req_malloc(len);
+		memset(http_header, 0, len);
+		strcat(http_header, http_head);
+		strcat(http_header, http_status_503);
+		if (keep_alive == true){
+			strcat(http_header, keep_alive_resp);
+			strcat(http_header, keep_alive_resp_param);
+		}
+		strcat(http_header, h1_503);
+		break;
+
 	case 400:
 	default:
 		len = 20 + strlen(http_status_400);
 		if (keep_alive == true){
 			len += strlen(keep_alive_resp) + strlen(keep_alive_resp_param);
 		}
-		http_header = malloc(len);
+		http_header = req_malloc(len);
 		memset(http_header, 0, len);
 		strcat(http_header, http_head);
 		strcat(http_header, http_status_400);
@@ -267,12 +677,17 @@ char *prepare_http_header(int16_t status, bool keep_alive){
  *  	0 - OK
  *     -400 - client error
  *     -500 - server error
+ *      503 - queue of the action is full
  ***********************************************************************/
-int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len){
+int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len,
+					connection_desc_t *conn_desc){
 	int16_t result = 201;
 	char *ptr_1 = NULL, *ptr_2 = NULL;
 	int16_t url_level_len;
 	char *res_buff = NULL;
+	uint8_t *cbor_buff = NULL;
+	int cbor_len = 0;
+	bool cbor = http_cbor_response(rq);
 	uint8_t url_level = 0;
 	char url_level_body[30];
 	char *url = NULL, *org_url = NULL;
@@ -294,11 +709,11 @@ int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len){
 		bool url_end = false;
 		char *ptr_3 = NULL;
 		bool is_number = true;
-		uint16_t len = 0;
+		uint16_t nr_len = 0;
 		uint8_t thing_nr = 0;
 
 		//copy url into dedicated buffer
-		url = malloc(url_level_len + 1);
+		url = req_malloc(url_level_len + 1);
 		if (org_url == NULL){
 			org_url = url;
 		}
@@ -317,20 +732,24 @@ int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len){
 			case 1:
 				//thing number
 				if (ptr_3 == NULL){
-					len = strlen(url) - 1;
+					nr_len = strlen(url) - 1;
 				}
 				else{
-					len = ptr_3 - url - 1;
+					nr_len = ptr_3 - url - 1;
 				}
-				for (int i = 0; i < len; i++){
+				if (nr_len >= sizeof(url_level_body)){
+					is_number = false;
+					url_end = true;
+				}
+				for (int i = 0; i < nr_len; i++){
 					if ((url[i+1] > 0x39) && (url[i+1] < 0x30)){
 						is_number = false;
 						break;
 					}
 				}
 				if (is_number == true){
-					memcpy(url_level_body, url + 1, len);
-					url_level_body[len] = 0;
+					memcpy(url_level_body, url + 1, nr_len);
+					url_level_body[nr_len] = 0;
 					thing_nr = atoi(url_level_body);
 					if (thing_nr < things){
 						if (url_end == true){
@@ -347,7 +766,30 @@ int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len){
 			case 2:
 				//resource type {properties, actions, events}
 				//e.g. POST /0/actions
-				if (strstr(url, "actions") != NULL){
+				if ((strstr(url, "actions") != NULL) &&
+					(http_header_has(rq, "Content-Type:", CBOR_CONTENT_TYPE) == true)){
+					//CBOR message: {"action id":{"input":{...}}}
+					char *action_id = NULL;
+					uint8_t *body;
+					int body_len;
+
+					body = http_body(rq, len, &body_len);
+					int res = request_action_cbor(thing_nr, body, body_len, &action_id);
+					if (res == ACTION_QUEUE_FULL){
+						result = 503;
+					}
+					else if (res >= 0){
+						if (cbor == true){
+							cbor_buff = get_resource_cbor(thing_nr, ACTION, action_id, res,
+															&cbor_len);
+						}
+						else{
+							res_buff = action_request_jsonize(thing_nr, action_id, res);
+						}
+					}
+					req_free(action_id);
+				}
+				else if (strstr(url, "actions") != NULL){
 					//get input values from message body
 					char *inputs = NULL, *action_id = NULL;
 					char *ptr_4 = NULL, *ptr_5 = NULL;
@@ -368,7 +810,7 @@ int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len){
 						len = ptr_5 - ptr_4 - 2;
 						p1 = ptr_4 + 2;
 						//get action ID
-						action_id = malloc(len + 1);
+						action_id = req_malloc(len + 1);
 						memset(action_id, 0, len + 1);
 						memcpy(action_id, p1, len);
 						//get action inputs
@@ -380,23 +822,32 @@ int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len){
 						if (ptr_5 == NULL){
 							goto case_2_end;
 						}
-						ptr_4 = strchr(ptr_5, '}');
-						if (ptr_5 == NULL){
+						ptr_4 = json_object_end(ptr_5);
+						if (ptr_4 == NULL){
 							goto case_2_end;
 						}
 						len = ptr_4 - ptr_5;
-						inputs = malloc(len); //null ended string
+						inputs = req_malloc(len); //null ended string
 						memset(inputs, 0, len);
 						memcpy(inputs, ptr_5 + 1, len - 1);
 
 						int res = request_action(thing_nr, action_id, inputs);
-						if (res >= 0){
+						if (res == ACTION_QUEUE_FULL){
+							result = 503;
+						}
+						else if (res >= 0){
 							//prepare http response body
-							res_buff = action_request_jsonize(thing_nr, action_id, res);
+							if (cbor == true){
+								cbor_buff = get_resource_cbor(thing_nr, ACTION, action_id,
+																res, &cbor_len);
+							}
+							else{
+								res_buff = action_request_jsonize(thing_nr, action_id, res);
+							}
 						}
 
-						free(inputs);
-						free(action_id);
+						req_free(inputs);
+						req_free(action_id);
 					}
 				}
 				case_2_end:
@@ -411,16 +862,53 @@ int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len){
 		}
 	}
 
-	if (res_buff == NULL){
+	req_free(org_url);
+	if (cbor_buff != NULL){
+		*res = NULL;
+		return http_send_cbor(conn_desc, result, cbor_buff, cbor_len);
+	}
+	if ((res_buff == NULL) && (result != 503)){
 		result = 400;
 	}
-	free(org_url);
 	*res = res_buff;
 
 	return result;
 }
 
 
+/************************************************************************
+ * DELETE REQUEST PARSER, e.g. DELETE /0/actions/fade/3
+ *
+ * inputs:
+ * 		rq		- request content
+ *  	things	- things quantity in the node
+ * output:
+ *  	204		- action request deleted
+ *      400		- client error
+ ***********************************************************************/
+int16_t delete_parser(char *rq, uint16_t things){
+	char *ptr_1, action_id[30];
+	int thing_nr, index;
+
+	//check if URI is absolute or not
+	ptr_1 = strstr(rq, "http://");
+	if (ptr_1 != NULL){
+		//URI is absolute
+		ptr_1 = strchr(ptr_1 + 7, '/');
+	}
+	else{
+		ptr_1 = strchr(rq, '/');
+	}
+	if ((ptr_1 == NULL) ||
+		(sscanf(ptr_1, "/%d/actions/%29[^/ ]/%d", &thing_nr, action_id, &index) != 3) ||
+		(thing_nr < 0) || (thing_nr >= things)){
+		return 400;
+	}
+
+	return delete_action_request(thing_nr, action_id, index);
+}
+
+
 /************************************************************************
  * inputs:
  * 		rq		- request content
@@ -432,11 +920,15 @@ int16_t post_parser(char *rq, char **res, uint16_t things, uint16_t len){
  *      400		- client error
  *      500		- server error
  ***********************************************************************/
-int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t tcp_len){
+int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t tcp_len,
+					connection_desc_t *conn_desc){
 	int16_t result = 500;
 	char *ptr_1 = NULL, *ptr_2 = NULL;
 	int16_t url_level_len;
 	char *res_buff = NULL;
+	uint8_t *cbor_buff = NULL;
+	int cbor_len = 0;
+	bool cbor = http_cbor_response(rq);
 	uint8_t url_level = 0;
 	char url_level_body[30];
 	char *url = NULL, *org_url = NULL;
@@ -463,7 +955,7 @@ int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t tcp_len){
 		RESOURCE_TYPE resource = UNKNOWN;
 
 		//copy url into dedicated buffer
-		url = malloc(url_level_len + 1);
+		url = req_malloc(url_level_len + 1);
 		if (org_url == NULL){
 			org_url = url;
 		}
@@ -487,6 +979,11 @@ int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t tcp_len){
 				else{
 					len = ptr_3 - url - 1;
 				}
+				if (len >= sizeof(url_level_body)){
+					is_number = false;
+					url_end = true;
+					result = 400;
+				}
 				for (int i = 0; i < len; i++){
 					if ((url[i+1] > 0x39) && (url[i+1] < 0x30)){
 						is_number = false;
@@ -524,8 +1021,33 @@ int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t tcp_len){
 			case 3:
 				//resource name
 				//e.g. PUT /0/properties/state
+				if (strlen(url + 1) >= sizeof(url_level_body)){
+					url_end = true;
+					result = 400;
+					break;
+				}
 				strcpy(url_level_body, url + 1);
 
+				if (http_header_has(rq, "Content-Type:", CBOR_CONTENT_TYPE) == true){
+					//CBOR message: {"name":value}
+					uint8_t *body;
+					int body_len;
+
+					result = 400;
+					if (resource == PROPERTY){
+						body = http_body(rq, tcp_len, &body_len);
+						result = set_resource_cbor(thing_nr, url_level_body, body, body_len);
+						if ((result == 200) && (cbor == true)){
+							cbor_buff = get_resource_cbor(thing_nr, PROPERTY, url_level_body,
+															-1, &cbor_len);
+						}
+						else if (result == 200){
+							res_buff = get_resource_value(thing_nr, PROPERTY, url_level_body, -1);
+						}
+					}
+					break;
+				}
+
 				//get new value from message body
 				char *new_value = NULL, *ptr_4 = NULL;//, *ptr_5 = NULL;
 				char start_char, end_char;
@@ -575,14 +1097,18 @@ int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t tcp_len){
 					buff_len = &rq[i] - ptr_4;
 					p1 = ptr_4 + 1;
 
-					new_value = malloc(buff_len + 1);
+					new_value = req_malloc(buff_len + 1);
 					memset(new_value, 0, buff_len + 1);
 					memcpy(new_value, p1, buff_len);
 
 					if (resource == PROPERTY){
 						//call set function for this property
 						result = set_resource_value(thing_nr, url_level_body, new_value);
-						if (result == 200){
+						if ((result == 200) && (cbor == true)){
+							cbor_buff = get_resource_cbor(thing_nr, PROPERTY, url_level_body,
+															-1, &cbor_len);
+						}
+						else if (result == 200){
 							res_buff = get_resource_value(thing_nr, PROPERTY, url_level_body, -1);
 						}
 						else if (result == 400){
@@ -590,7 +1116,7 @@ int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t tcp_len){
 						}
 					}
 
-					free(new_value);
+					req_free(new_value);
 				}
 				break;
 
@@ -602,7 +1128,11 @@ int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t tcp_len){
 			url = ptr_3;
 		}
 	}
-	free(org_url);
+	req_free(org_url);
+	if (cbor_buff != NULL){
+		*res = NULL;
+		return http_send_cbor(conn_desc, result, cbor_buff, cbor_len);
+	}
 	*res = res_buff;
 
 	return result;
@@ -620,11 +1150,15 @@ int16_t put_parser(char *rq, char **res, uint16_t things, uint16_t tcp_len){
  *  	0 - OK
  *     -1 - error
  ***********************************************************************/
-int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len){
+int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len,
+					connection_desc_t *conn_desc){
 	int16_t result = 200;
 	char *ptr_1 = NULL, *url_end_ptr = NULL;
 	int16_t url_level_len;
 	char *res_buff = NULL;
+	uint8_t *cbor_buff = NULL;
+	int cbor_len = 0;
+	bool cbor = http_cbor_response(rq);
 	uint8_t url_level = 0;
 	char url_level_body[30];
 	char *url = NULL, *org_url = NULL;
@@ -647,6 +1181,21 @@ int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len){
 			//GET /
 			res_buff = get_root_dir();
 		}
+		else if (strncmp(ptr_1, "/metrics", 8) == 0){
+			//statistics of connections
+			res_buff = get_server_metrics();
+		}
+		else if (strncmp(ptr_1, "/changes", 8) == 0){
+			//changes after given sequence number, e.g. GET /changes?since=120
+			char *q = strchr(ptr_1, '?');
+			uint32_t since = 0;
+
+			if ((q != NULL) && (q < url_end_ptr)){
+				since = http_query_param(ptr_1, "since", 0);
+			}
+			*res = NULL;
+			return change_log_stream(conn_desc, since);
+		}
 		else{
 			//get something more then the node model
 			bool url_end = false;
@@ -658,7 +1207,7 @@ int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len){
 			char index_buff[10];
 
 			//copy url into dedicated buffer
-			url = malloc(url_level_len + 1);
+			url = req_malloc(url_level_len + 1);
 			memset(url, 0, url_level_len + 1);
 			if (org_url == NULL){
 				org_url = url;
@@ -694,6 +1243,10 @@ int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len){
 					else{
 						len = ptr_3 - url - 1;
 					}
+					if (len >= sizeof(url_level_body)){
+						is_number = false;
+						url_end = true;
+					}
 					for (int i = 0; i < len; i++){
 						if ((url[i+1] > 0x39) || (url[i+1] < 0x30)){
 							is_number = false;
@@ -736,7 +1289,21 @@ int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len){
 						resource = UNKNOWN;
 					}
 
-					if (url_end == true){
+					if ((resource == EVENT) && (url_end == true) && (strchr(url, '?') != NULL)){
+						//events from persistent log, e.g. GET /0/events?log_seq=120
+						result = event_log_stream(conn_desc, get_thing_ptr(thing_nr), NULL,
+											http_query_param(url, "log_seq", 0),
+											http_query_param(url, "from", 0));
+						if (result == HTTP_STREAMED){
+							*res = NULL;
+							req_free(org_url);
+							return result;
+						}
+					}
+					else if ((url_end == true) && (cbor == true)){
+						cbor_buff = get_resource_cbor(thing_nr, resource, NULL, -1, &cbor_len);
+					}
+					else if (url_end == true){
 						res_buff = get_resource_value(thing_nr, resource, NULL, -1);
 					}
 					break;
@@ -744,25 +1311,86 @@ int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len){
 				case 3:
 					//resource name
 					//e.g. GET /0/properties/temperature
-					if ((resource == ACTION) && (url_end != true)){
+					if (((resource == ACTION) || (resource == PROPERTY)) && (url_end != true)){
 						char *b = strchr(url + 1, '/');
+
+						if (b - url - 1 >= sizeof(url_level_body)){
+							url_end = true;
+							break;
+						}
 						memcpy(url_level_body, url + 1, b - url - 1);
+						url_level_body[b - url - 1] = 0;
 					}
 					else{
-						strcpy(url_level_body, url + 1);
+						//name without query, it is parsed from url
+						char *q = strchr(url + 1, '?');
+						int name_len = (q != NULL) ? (q - url - 1) : strlen(url + 1);
+
+						if (name_len >= sizeof(url_level_body)){
+							url_end = true;
+							break;
+						}
+						memcpy(url_level_body, url + 1, name_len);
+						url_level_body[name_len] = 0;
+					}
+					if ((resource == EVENT) && (url_end == true) &&
+						(strchr(url, '?') != NULL)){
+						//one event from persistent log, e.g. GET /0/events/overheated?log_seq=120
+						thing_t *t = get_thing_ptr(thing_nr);
+						event_t *e;
+
+						e = get_event_ptr(t, url_level_body);
+						if (e != NULL){
+							result = event_log_stream(conn_desc, t, e,
+												http_query_param(url, "log_seq", 0),
+												http_query_param(url, "from", 0));
+							if (result == HTTP_STREAMED){
+								*res = NULL;
+								req_free(org_url);
+								return result;
+							}
+						}
+					}
+					else if ((url_end == true) && (cbor == true)){
+						cbor_buff = get_resource_cbor(thing_nr, resource, url_level_body, -1,
+														&cbor_len);
 					}
-					if (url_end == true){
+					else if (url_end == true){
 						res_buff = get_resource_value(thing_nr, resource, url_level_body, -1);
 					}
 					break;
 
 				case 4:
+					if ((resource == PROPERTY) && (strncmp(url + 1, "history", 7) == 0)){
+						//property history
+						//e.g. GET /0/properties/temperature/history?since=0&step=60
+						property_t *p = get_property_ptr(get_thing_ptr(thing_nr),
+														url_level_body);
+						if (p != NULL){
+							result = property_history_stream(p, conn_desc,
+										http_query_param(url, "since", 0),
+										http_query_param(url, "until", UINT32_MAX),
+										http_query_param(url, "step", 0));
+							if (result == HTTP_STREAMED){
+								*res = NULL;
+								req_free(org_url);
+								return result;
+							}
+						}
+						break;
+					}
 					//resource id (used for action ID)
 					memset(index_buff, 0, 10);
-					strcpy(index_buff, url + 1);
+					strncpy(index_buff, url + 1, sizeof(index_buff) - 1);
 					int index = atoi(index_buff);
 
-					res_buff = get_resource_value(thing_nr, resource, url_level_body, index);
+					if (cbor == true){
+						cbor_buff = get_resource_cbor(thing_nr, resource, url_level_body, index,
+														&cbor_len);
+					}
+					else{
+						res_buff = get_resource_value(thing_nr, resource, url_level_body, index);
+					}
 					break;
 
 				default:
@@ -774,12 +1402,17 @@ int16_t get_parser(char *rq, char **res, uint16_t things, uint16_t len){
 		}
 	}
 
+	if (cbor_buff != NULL){
+		req_free(org_url);
+		*res = NULL;
+		return http_send_cbor(conn_desc, result, cbor_buff, cbor_len);
+	}
 	if (res_buff == NULL){
 		//TODO: correct error description
 		//res_buff = get_error(org_url);
 		result = 400;
 	}
-	free(org_url);
+	req_free(org_url);
 	*res = res_buff;
 
 	return result;
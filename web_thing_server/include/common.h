@@ -10,9 +10,12 @@
 #ifndef COMMON_H_
 #define COMMON_H_
 
+#include <stdbool.h>
+
 #include "freertos/FreeRTOS.h"
 #include "lwip/api.h"
 #include "freertos/timers.h"
+#include "web_thing_timer.h"
 #include "freertos/semphr.h"
 
 #define MAX_OPEN_CONN 10	//max number of open connections
@@ -71,7 +74,20 @@ typedef enum{
 	CONN_WS = 2
 } CONN_TYPE; //connection type
 
+//deadline of data receiving, closed connection is counted by stage
+typedef enum{
+	RX_NONE = 0,		//no deadline
+	RX_FIRST_BYTE = 1,	//the first byte after connection is accepted
+	RX_HEADERS = 2,		//all headers of request
+	RX_BODY = 3,		//request body, extended by received data
+	RX_KEEP_ALIVE = 4,	//the next request on keep-alive connection
+	RX_WS_IDLE = 5,		//any websocket frame
+	RX_TOO_LONG = 6,	//not a deadline, request longer than buffer
+	RX_STAGE_QUANT = 7
+} RX_STAGE;
+
 typedef struct thing_t thing_t;
+typedef struct ws_decoder_t ws_decoder_t;
 typedef struct property_t property_t;
 typedef struct at_type_t at_type_t;
 
@@ -80,14 +96,30 @@ struct at_type_t{
 	at_type_t *next;
 };
 
+//request arena, memory for buffers living during one request
+typedef struct{
+	uint8_t				*buff;		//allocated once for connection slot
+	uint32_t			size;
+	uint32_t			used;
+	uint32_t			last;		//offset of the last allocation
+	uint32_t			peak;		//max used memory
+	uint32_t			fallbacks;	//allocations done on heap (arena full)
+	xTaskHandle			task;		//task serving the request, NULL - not active
+} req_arena_t;
+
 typedef struct{
 	int8_t				index;
 	CONN_TYPE			type;
 	struct netconn 		*netconn_ptr;
-	xTaskHandle 		task_handl;
-	TimerHandle_t 		timer;
-	uint32_t			ws_pings;
-	uint32_t			ws_pongs;
+	xTaskHandle 		task_handl;	//worker serving connection, NULL - slot released
+	wheel_timer_t		timer;		//websocket close handshake
+	wheel_timer_t		ping_timer;	//websocket heartbeat
+	uint32_t			ws_pings;		//pings sent by server
+	uint32_t			ws_pongs;		//pongs received
+	uint8_t				ws_missed_pongs; //pings without answer
+	uint32_t			ws_rtt_us;		//the last round trip time
+	uint32_t			ws_rtt_avg_us;	//smoothed round trip time
+	uint32_t			ws_jitter_us;	//round trip time variation
 	uint8_t				ws_close_initiator;
 	uint16_t			ws_status_code;
 	uint8_t				ws_state;
@@ -95,9 +127,22 @@ typedef struct{
 	uint32_t			bytes;
 	uint32_t			send_errors;
 	int8_t				msg_to_send;
-	thing_t				*thing;
+	thing_t				*thing;		//NULL for node websocket (ws_node)
+	bool				ws_node;	//websocket multiplexing all things
+	bool				ws_deflate;	//permessage-deflate negotiated
+	bool				ws_binary;	//"webthing-bin" subprotocol
+	uint8_t				ws_window_bits; //server_max_window_bits
+	ws_decoder_t		*ws_dec;	//websocket frame decoder
 	CONN_STATE			connection;
 	uint32_t			requests;
+	RX_STAGE			rx_stage;
+	TickType_t			rx_deadline;
+	char				*rx_buff;	//request received in many segments
+	uint16_t			rx_len;
+	uint32_t			rx_need;	//request length, 0 - headers not complete
+	volatile bool		close_req;	//worker should close connection
+	struct netconn		*next_conn;	//new connection served next by the worker (eviction)
+	req_arena_t			arena;
 	xSemaphoreHandle	mutex;
 } connection_desc_t;
 
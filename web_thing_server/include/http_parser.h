@@ -9,11 +9,28 @@
 #define HTTP_PARSER_H_
 
 #include <stdint.h>
+#include <sys/param.h>
 #include "lwip/api.h"
 
 #include "web_thing.h"
 #include "common.h"
 
+//status returned by resource handlers which send the response by themselves
+#define HTTP_STREAMED 1
+#define HTTP_MAX_REQUEST_LEN CONFIG_HTTP_MAX_REQUEST_LEN
+//receive buffer of connection slot (STATIC_ALLOC), HTTP requests are
+//collected in it, websocket messages after upgrade
+#define HTTP_RX_STORAGE_LEN (MAX(HTTP_MAX_REQUEST_LEN, CONFIG_WS_MAX_MESSAGE_LEN) + 1)
+
 uint8_t http_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc);
+int8_t http_collect(connection_desc_t *conn_desc, struct netbuf *inbuf,
+					char **rq, uint16_t *len);
+void http_collect_done(connection_desc_t *conn_desc);
+char *http_rx_storage(connection_desc_t *conn_desc);
+int8_t http_stream_begin(connection_desc_t *conn_desc);
+int8_t http_stream_write(connection_desc_t *conn_desc, char *data, int len);
+int8_t http_stream_end(connection_desc_t *conn_desc);
+uint32_t http_query_param(char *url, char *name, uint32_t default_value);
+char *json_object_end(char *p);
 
 #endif /* HTTP_PARSER_H_ */
@@ -17,9 +17,13 @@
 #include "web_thing_property.h"
 #include "web_thing_event.h"
 #include "web_thing_action.h"
+#include "web_thing_history.h"
+#include "web_thing_changes.h"
 #include "websocket.h"
 #include "web_thing_mdns.h"
 
+#define RETRY_AFTER_S "1"	//Retry-After of 503 responses, seconds
+
 typedef struct {
 	thing_t *things;
 	thing_t *last_thing;
@@ -38,18 +42,23 @@ typedef struct server_cfg{
 int8_t start_web_thing_server(uint16_t port, char *host_name, char *domain);
 int8_t root_node_init(void);
 char *get_root_dir(void);
+char *get_server_metrics(void);
 
 //thing functions
 int8_t add_thing_to_server(thing_t *t);
 
 char *get_resource_value(int8_t thing_id, RESOURCE_TYPE resource, char *name, int index);
-int16_t set_resource_value(int8_t thing_id, char *name, char *new_value_str);
+int16_t set_resource_value(int8_t thing_id, const char *name, char *new_value_str);
 thing_t *get_thing_ptr(uint8_t thing_nr);
+int8_t subscribe_connection(connection_desc_t *conn_desc);
+int8_t unsubscribe_connection(connection_desc_t *conn_desc);
 int8_t inform_all_subscribers_prop(property_t *_p);
-int8_t inform_all_subscribers_action(action_t *_a, char *data, int len);
-int8_t inform_all_subscribers_event(event_t *_e, char *data, int len);
+int8_t inform_all_subscribers_action(action_t *_a, char *data, int len, uint32_t seq);
+int8_t inform_all_subscribers_event(event_t *_e, char *data, int len, uint32_t seq);
+int8_t send_thing_snapshot(connection_desc_t *conn_desc);
 int request_action(int8_t thing_nr, char *action_id, char *inputs);
 int8_t close_thing_connection(connection_desc_t *conn_desc, char *tag);
+void conn_close_request(connection_desc_t *conn_desc);
 //variables
 
 
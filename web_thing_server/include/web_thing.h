@@ -16,10 +16,23 @@
 #define THING_MODEL_LEN 3000
 #define things_context "https://webthings.io/schemas"
 
+//markers in generated thing description (tools/td_gen.py), replaced by
+//thing number and "host.domain:port" while the description is sent
+#define TD_MARK_THING_NR	'\001'
+#define TD_MARK_HOST		'\002'
+#define TD_HOST_LEN			40
+
 typedef struct subscriber_t subscriber_t;
 
+//subscription bit for resource index, resources with index >= 32 are always sent
+#define SUBSCR_BIT(index) (((index) < 32) ? (1UL << (index)) : 0)
+
 struct subscriber_t{
 	connection_desc_t *conn_desc;
+	uint32_t prop_mask;		//subscribed properties (bit = property index)
+	uint32_t event_mask;	//subscribed events (bit = event index)
+	bool prop_filter;		//false - all properties are sent
+	bool event_filter;		//false - all events are sent
 	subscriber_t *prev;
 	subscriber_t *next;
 };
@@ -32,12 +45,14 @@ struct thing_t{
 	int8_t type_quantity;
 	char *description;
 	char *links;			//fill during server start
-	property_t *properties;
+	property_t **properties;	//table of properties, index = property index
 	action_t *actions;
 	event_t *events;
 	uint8_t prop_quant;		//properties quantity
-	property_t *last_property;
+	uint8_t event_quant;	//events quantity
 	uint16_t model_len;		//length of json model
+	const char *td;			//generated description, NULL - built from resources
+	uint16_t td_len;
 	subscriber_t *subscribers;
 	subscriber_t *last_subscriber;
 	thing_t *next;
@@ -47,6 +62,8 @@ thing_t	*
 	thing_init(void);
 int8_t
 	set_thing_type(thing_t *t, at_type_t *at);
+void
+	thing_set_td(thing_t *t, const char *td, uint16_t td_len);
 int
 	thing_jsonize(thing_t *t, char *host, char * domain, uint16_t port, char *buff);
 int8_t
@@ -57,9 +74,17 @@ int8_t
 	add_event(thing_t *t, event_t *a);
 char *
 	get_thing(thing_t *t, int16_t thing_index, char *host, char *domain, uint16_t port);
+void
+	subscriber_pool_init(void);
 int8_t
-	add_subscriber(connection_desc_t *_c);
+	add_subscriber(thing_t *_t, connection_desc_t *_c);
 int8_t
-	delete_subscriber(connection_desc_t *_c);
+	delete_subscriber(thing_t *_t, connection_desc_t *_c);
+subscriber_t *
+	get_subscriber(thing_t *t, connection_desc_t *_c);
+bool
+	subscriber_property_on(subscriber_t *s, property_t *p);
+bool
+	subscriber_event_on(subscriber_t *s, event_t *e);
 
 #endif /* WEB_THING_H_ */
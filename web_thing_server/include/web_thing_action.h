@@ -13,11 +13,27 @@
 #include "common.h"
 #include "web_thing.h"
 
+#define ACTION_QUEUE_SIZE CONFIG_ACTION_QUEUE_SIZE	//pending requests per action
+#define ACTION_WORKERS CONFIG_ACTION_WORKERS		//tasks running actions
+#define ACTION_JOBS_LEN 16							//requests sent to workers
+#define ACTION_QUEUE_FULL -2		//request rejected, queue of the action is full (503)
+//ring of requests: finished requests (history) and queued ones
+#define ACTION_RING_SIZE (MAX_ACTION_REQUESTS + ACTION_QUEUE_SIZE)
+#define ACTION_MAX_INPUTS 4			//stored values of one request
+#define ACTION_INPUTS_LEN 80		//inputs as received, passed to run function
+#define ACTION_STR_LEN 24			//max length of string input + 1
+
 typedef struct action_t action_t;
 typedef struct action_input_prop_t action_input_prop_t;
 typedef struct action_request_t action_request_t;
 typedef struct request_value_t request_value_t;
+typedef struct action_inputs_t action_inputs_t;
 typedef int8_t (action_run_callback_t)(char *new_value);
+typedef int8_t (action_run_typed_callback_t)(action_inputs_t *inputs);
+//cancel is synchronous: after it returns 0 the thing doesn't complete
+//the request (complete_action_request for it is ignored), its run function
+//can still be running, the next request is started after it returns
+typedef int8_t (action_cancel_callback_t)(int request_index);
 typedef char *(jsonize_t)(property_t *p);
 
 //thing action
@@ -28,10 +44,13 @@ struct action_t {
 	at_type_t *input_at_type;
 	int inputs_qua;
 	action_input_prop_t *input_properties;
-	action_request_t *requests_list;
+	action_request_t *requests;		//ring of ACTION_RING_SIZE requests
 	action_run_callback_t *run;
+	action_run_typed_callback_t *run_typed;	//used instead of run if set
+	action_cancel_callback_t *cancel;	//stop running request (optional)
 	struct thing_t *t;
-	int running_request_index;
+	int running_request_index;	//request run by worker, -1 if idle
+	int run_index;				//request which run function is executing, 0 - none
 	int last_request_index;
 	action_t *next;
 };
@@ -48,21 +67,35 @@ struct action_input_prop_t{
 	action_input_prop_t *next;
 };
 
+//values set by client during action request
+struct request_value_t{
+	int input_prop_index;
+	union{
+		int int_val;		//VAL_INTEGER
+		double num_val;		//VAL_NUMBER
+		bool bool_val;		//VAL_BOOLEAN
+		char str_val[ACTION_STR_LEN];	//VAL_STRING
+	} value;
+};
+
+//validated inputs of the request, passed to run_typed function
+struct action_inputs_t{
+	action_t *a;
+	int request_index;		//request which is run, see complete_action_request
+	uint8_t values_qua;
+	request_value_t values[ACTION_MAX_INPUTS];
+};
+
 //action requested
 struct action_request_t{
-	int index;
+	int index;				//0 - empty slot in the ring
 	time_t time_requested;
 	time_t time_completed;
-	ACTION_STATUS status;
-	request_value_t *values;
-	action_request_t *next;
-};
-
-//values set by client during action request
-struct request_value_t{
-	int input_prop_index;
-	void *value;
-	request_value_t *next;
+	ACTION_STATUS status;	//pending (queued), executed (running), completed...
+	uint32_t seq;			//sequence number of the last status change
+	uint8_t values_qua;
+	request_value_t values[ACTION_MAX_INPUTS];
+	char inputs[ACTION_INPUTS_LEN];	//inputs passed to run function
 };
 
 action_t *
@@ -83,7 +116,26 @@ char *
 	action_request_jsonize(int thing_nr, char *action_id, int action_index);
 int8_t
 	complete_action(int thing_nr, char *action_id, ACTION_STATUS status);
+int8_t
+	complete_action_request(int thing_nr, char *action_id, int request_index,
+							ACTION_STATUS status);
 uint16_t
 	get_action_request_queue(action_t *a, char *buff);
+action_request_t *
+	get_request_ptr(action_t *a, int request_index);
+action_request_t *
+	get_first_request(action_t *a);
+action_request_t *
+	get_next_request(action_t *a, action_request_t *ar);
+int16_t
+	delete_action_request(int thing_nr, char *action_id, int request_index);
+request_value_t *
+	get_action_input(action_inputs_t *inputs, char *input_id);
+int8_t
+	action_executor_init(void);
+void
+	action_list_lock(void);
+void
+	action_list_unlock(void);
 
 #endif /* WEB_THING_ACTION_H_ */
@@ -0,0 +1,37 @@
+/*
+ * web_thing_arena.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WEB_THING_ARENA_H_
+#define WEB_THING_ARENA_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "common.h"
+
+#define REQ_ARENA_SIZE CONFIG_REQ_ARENA_SIZE
+#define REQ_ARENA_ALIGN 8
+#define REQ_SPARE_LEN 512		//spare buffers with STATIC_ALLOC, json texts
+#define REQ_SPARE_COUNT 8		//built outside of requests
+
+void
+	req_arena_init(void);
+void
+	req_arena_begin(req_arena_t *a);
+void
+	req_arena_end(req_arena_t *a);
+void *
+	req_malloc(size_t size);
+void *
+	req_realloc(void *ptr, size_t old_size, size_t size);
+void
+	req_free(void *ptr);
+void
+	req_arena_stats(uint32_t *peak, uint32_t *fallbacks);
+
+#endif /* WEB_THING_ARENA_H_ */
@@ -0,0 +1,27 @@
+/*
+ * web_thing_cbor.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WEB_THING_CBOR_H_
+#define WEB_THING_CBOR_H_
+
+#include <stdint.h>
+
+#include "common.h"
+#include "web_thing.h"
+
+#define CBOR_CONTENT_TYPE "application/cbor"
+
+uint8_t *
+	get_resource_cbor(int8_t thing_nr, RESOURCE_TYPE resource, char *name, int index,
+						int *len);
+int16_t
+	set_resource_cbor(int8_t thing_nr, char *name, uint8_t *body, int len);
+int
+	request_action_cbor(int8_t thing_nr, uint8_t *body, int len, char **action_id);
+
+#endif /* WEB_THING_CBOR_H_ */
@@ -0,0 +1,41 @@
+/*
+ * web_thing_changes.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WEB_THING_CHANGES_H_
+#define WEB_THING_CHANGES_H_
+
+#include <stdint.h>
+
+#include "common.h"
+#include "web_thing.h"
+
+#define CHANGE_LOG_SIZE CONFIG_CHANGE_LOG_SIZE
+
+//one record of the change log
+typedef struct{
+	uint32_t seq;				//change sequence number
+	RESOURCE_TYPE type;			//PROPERTY, ACTION or EVENT
+	thing_t *t;
+	void *resource;				//property_t, action_t or event_t
+	int index;					//action request index
+} change_item_t;
+
+void
+	change_log_init(void);
+uint32_t
+	change_log_add(RESOURCE_TYPE type, thing_t *t, void *resource, int index);
+uint32_t
+	change_log_seq(void);
+char *
+	change_msg_jsonize(change_item_t *ci, bool with_thing);
+int16_t
+	change_log_stream(connection_desc_t *conn_desc, uint32_t since);
+int8_t
+	change_log_replay(connection_desc_t *conn_desc, uint32_t since);
+
+#endif /* WEB_THING_CHANGES_H_ */
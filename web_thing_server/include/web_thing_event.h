@@ -14,17 +14,22 @@
 #include "common.h"
 //#include "web_thing.h"
 
-#define MAX_EVENTS 5
+#define MAX_EVENTS 5			//emitted events kept in the ring of every event
+#define EVENT_STR_LEN 24		//max length of string value + 1
 
 typedef struct event_t event_t;
 typedef struct event_item_t event_item_t;
-//typedef struct connection_desc_t connection_desc_t;
-typedef struct event_subscriber_t event_subscriber_t;
 
-struct event_subscriber_t{
-	connection_desc_t *conn_desc;
-	event_subscriber_t *prev;
-	event_subscriber_t *next;
+//emitted event, value is stored inline
+struct event_item_t{
+	time_t timestamp;
+	uint32_t seq;			//change sequence number, 0 - not sent yet
+	union{
+		int int_val;		//VAL_INTEGER
+		double num_val;		//VAL_NUMBER
+		bool bool_val;		//VAL_BOOLEAN
+		char str_val[EVENT_STR_LEN];	//VAL_STRING
+	} value;
 };
 
 //thing event
@@ -35,27 +40,34 @@ struct event_t {
 	VAL_TYPE type;
 	char *at_type;
 	char *unit;
-	event_item_t *event_list;
-	event_subscriber_t *subscribers;
-	event_subscriber_t *last_subscriber;
+	event_item_t items[MAX_EVENTS];	//ring of the last emitted events
+	uint32_t emitted;		//events written into the ring
+	uint32_t sent;			//events sent to subscribers
+	uint8_t index;			//position in thing's events list
 	struct thing_t *t;
 	event_t *next;
 };
 
-struct event_item_t{
-	time_t timestamp;
-	void *value;
-	event_item_t *next;
-};
-
 event_t *
 	event_init(void);
 int8_t
 	emit_event(int thing_nr, char *event_id, void *value);
+int8_t
+	emit_event_from_isr(event_t *e, void *value);
+void
+	send_events(thing_t *t);
+int
+	get_event_items(event_t *e, event_item_t *items);
 char *
 	get_events_model(thing_t *t);
 char *
 	event_list_jsonize(int thing_nr, char *event_id);
+char *
+	event_item_jsonize(event_t *e, event_item_t *ei);
+int
+	event_item_print(event_t *e, event_item_t *ei, char *buff, int size);
+event_t *
+	get_event_ptr(struct thing_t *t, char *event_id);
 int8_t
 	add_event_subscriber(event_t *_t, connection_desc_t *_c);
 int8_t
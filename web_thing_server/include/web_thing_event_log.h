@@ -0,0 +1,49 @@
+/*
+ * web_thing_event_log.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WEB_THING_EVENT_LOG_H_
+#define WEB_THING_EVENT_LOG_H_
+
+#include <stdint.h>
+
+#include "common.h"
+#include "web_thing_event.h"
+
+#ifdef CONFIG_EVENT_LOG
+#define EVENT_LOG_PARTITION CONFIG_EVENT_LOG_PARTITION
+#define EVENT_LOG_FLUSH_MS CONFIG_EVENT_LOG_FLUSH_MS
+#else
+#define EVENT_LOG_PARTITION "eventlog"
+#define EVENT_LOG_FLUSH_MS 5000
+#endif
+#define EVENT_LOG_VALUE_LEN 20
+#define EVENT_LOG_EMPTY 0xFFFFFFFF	//erased flash
+#define EVENT_LOG_MAX_SECTORS 64	//STATIC_ALLOC: sectors used at most (256 KB)
+
+//one log record in flash, 32 bytes
+typedef struct{
+	uint32_t seq;			//log sequence number, kept across reboots
+	uint32_t timestamp;		//seconds (unix time)
+	uint8_t thing_nr;
+	uint8_t event_index;	//position in thing's events list
+	uint8_t type;			//VAL_TYPE of the value
+	uint8_t crc;			//crc8 of the record (with crc = 0)
+	uint8_t value[EVENT_LOG_VALUE_LEN];	//int32, double, bool or string
+} event_log_rec_t;
+
+int8_t
+	event_log_init(void);
+void
+	event_log_add(event_t *e, event_item_t *ei);
+int16_t
+	event_log_stream(connection_desc_t *conn_desc, thing_t *t, event_t *e,
+					uint32_t after_seq, uint32_t from);
+uint32_t
+	event_log_dropped(void);
+
+#endif /* WEB_THING_EVENT_LOG_H_ */
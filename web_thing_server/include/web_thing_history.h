@@ -0,0 +1,40 @@
+/*
+ * web_thing_history.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WEB_THING_HISTORY_H_
+#define WEB_THING_HISTORY_H_
+
+#include <stdint.h>
+
+#include "common.h"
+#include "web_thing_property.h"
+
+#define PROP_HISTORY_SIZE CONFIG_PROP_HISTORY_SIZE
+
+//one history record, 8 bytes
+typedef struct{
+	uint32_t timestamp;		//seconds (unix time)
+	float value;
+} history_item_t;
+
+//history ring buffer of one property
+struct prop_history_t{
+	history_item_t *items;
+	uint16_t size;			//ring capacity
+	uint32_t total;			//number of items written since start
+};
+
+int8_t
+	property_history_init(property_t *p, uint16_t size);
+void
+	property_history_add(property_t *p);
+int16_t
+	property_history_stream(property_t *p, connection_desc_t *conn_desc,
+							uint32_t since, uint32_t until, uint32_t step);
+
+#endif /* WEB_THING_HISTORY_H_ */
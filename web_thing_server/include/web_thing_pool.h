@@ -0,0 +1,46 @@
+/*
+ * web_thing_pool.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WEB_THING_POOL_H_
+#define WEB_THING_POOL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+
+#define SLAB_MAX_POOLS 5
+
+//pool of fixed-size items in static storage, free items are kept in a list
+typedef struct{
+	const char *name;
+	uint8_t *buff;			//storage, count * item_size bytes
+	uint16_t item_size;
+	uint16_t count;
+	void *free_list;		//released items, next pointer in the item itself
+	uint16_t unused;		//items never allocated yet (at the end of buff)
+	uint16_t used;
+	uint16_t peak;
+	uint32_t exhausted;		//allocations when the pool was empty
+	uint32_t fallbacks;		//of them served by heap
+	portMUX_TYPE lock;
+} slab_pool_t;
+
+void
+	slab_pool_init(slab_pool_t *p, const char *name, void *storage,
+					uint16_t item_size, uint16_t count);
+void *
+	slab_alloc(slab_pool_t *p);
+void
+	slab_free(slab_pool_t *p, void *item);
+bool
+	slab_owns(slab_pool_t *p, void *item);
+int
+	slab_pools_jsonize(char *buff);
+
+#endif /* WEB_THING_POOL_H_ */
@@ -17,8 +17,7 @@
 
 #define PROP_VAL_LEN 50
 
-typedef struct link_t link_t;
-typedef struct enum_item_t enum_item_t;
+typedef struct prop_history_t prop_history_t;
 /*
  * if new value is different then the old one set_callback_t must return "1" (one)
  */
@@ -31,54 +30,79 @@ typedef int16_t (set_callback_t)(char *new_value);
  */
 typedef char *(jsonize_t)(property_t *p);
 
-struct link_t{
-	char *rel;
-	char *href;
-};
-
 typedef union max_min_val{
 	int32_t int_val;
 	float float_val;
 } min_max_t;
 
-struct property_t{
-	char *id;
-	at_type_t *at_type;
-	char *title;
+/*
+ * notification policy, all zeros means "send on every call"
+ * (inform_all_subscribers_prop), fields are independent of each other
+ */
+typedef struct{
+	uint32_t min_interval_ms;	//minimum time between two notifications
+	uint32_t max_silence_ms;	//heartbeat, send current value after this time
+	float dead_band;			//absolute dead-band (VAL_NUMBER, VAL_INTEGER)
+	float dead_band_rel;		//relative dead-band, e.g. 0.05 is 5%
+	bool on_change_only;		//don't send the same value twice
+} notify_policy_t;
+
+//notification runtime state, used by the server only
+typedef struct{
+	TickType_t last_tick;		//time of the last notification
+	double last_value;			//last sent value (numbers only)
+	uint32_t last_hash;			//hash of the last sent json value
+	bool sent;					//at least one notification was sent
+	bool pending;				//notification held back by min_interval_ms
+} notify_state_t;
+
+/*
+ * static description of the property, doesn't change while the server
+ * runs and can be a const table (kept in flash), e.g.
+ * static const property_desc_t temp_desc = {
+ * 		.id = "temperature", .type = VAL_NUMBER, ...};
+ */
+typedef struct{
+	const char *id;
+	const char *title;
+	const char *description;
+	const char *at_type;		//semantic @type, e.g. "TemperatureProperty"
 	VAL_TYPE type;
-	char *description;
-	void *value;
-	min_max_t min_value;
+	const char *unit;			//NULL - no unit
+	min_max_t min_value;		//min == max - no limits
 	min_max_t max_value;
-	char *unit;
-	bool enum_prop;
-	enum_item_t *enum_list;
+	const char *const *enum_list; //NULL terminated list of strings, NULL - not enum
 	bool read_only;
-	link_t *links;
-	link_t *last_link;
-	property_t *next;
-	property_t *last;
-	set_callback_t *set;
-	jsonize_t *value_jsonize;
-	jsonize_t *model_jsonize;  //builds model for type OBJECT and ARRAY
+	set_callback_t *set;		//NULL for read only property
+	jsonize_t *value_jsonize;	//NULL - default jsonization
+	jsonize_t *model_jsonize;	//builds model for type OBJECT and ARRAY
+	notify_policy_t notify;
+} property_desc_t;
+
+//runtime state of the property
+struct property_t{
+	const property_desc_t *desc;
+	void *value;
 	struct thing_t *t;
 	xSemaphoreHandle mux;
+	prop_history_t *history;	//NULL if history is not recorded
+	uint32_t change_seq;		//sequence number of the last change
+	notify_state_t notify_state;
+	uint8_t index;				//position in thing's properties table
 };
 
-union enum_value_t{
-	int int_val;
-	float float_val;
-	char *str_addr;
-};
-
-struct enum_item_t{
-	union enum_value_t value;
-	bool current;
-	enum_item_t *next;
-};
-
-property_t *property_init(jsonize_t *vj, jsonize_t *mj);
+property_t *property_init(const property_desc_t *d, void *value, xSemaphoreHandle mux);
 char *property_model_jsonize(property_t *t, int16_t thing_id);
 char *get_properties_model(thing_t *t);
+char *property_value_jsonize(property_t *p);
+property_t *get_property_ptr(thing_t *t, const char *property_id);
+property_t *get_property_by_index(thing_t *t, uint8_t index);
+bool property_value_num(property_t *p, double *val);
+int8_t add_property_subscriber(property_t *p, connection_desc_t *_c);
+int8_t delete_property_subscriber(property_t *p, connection_desc_t *_c);
+bool property_notify_check(property_t *p, char *json_value, bool flush);
+void property_notify_sent(property_t *p, char *json_value);
+bool property_notify_due(property_t *p);
+bool property_notify_changed(property_t *p, char *json_value);
 
 #endif /* WEB_THING_PROPERTY_H_ */
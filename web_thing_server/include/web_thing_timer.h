@@ -0,0 +1,46 @@
+/*
+ * web_thing_timer.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WEB_THING_TIMER_H_
+#define WEB_THING_TIMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMER_WHEEL_TICK_MS CONFIG_TIMER_WHEEL_TICK_MS
+
+typedef struct wheel_timer_t wheel_timer_t;
+
+//function called when timer expires (in the timer wheel task),
+//it mustn't close connections, only ask their workers to do it
+typedef void (wheel_fun_t)(void *arg);
+
+/*
+ * one shot timer, kept in the structure of its owner (e.g. connection),
+ * so arming doesn't allocate memory
+ */
+struct wheel_timer_t{
+	wheel_timer_t *next;
+	wheel_timer_t **pprev;	//NULL - timer is not armed
+	uint32_t expires;		//wheel tick of expiration
+	wheel_fun_t *fun;
+	void *arg;
+};
+
+void
+	timer_wheel_init(void);
+void
+	timer_wheel_arm(wheel_timer_t *t, uint32_t ms, wheel_fun_t *fun, void *arg);
+void
+	timer_wheel_cancel(wheel_timer_t *t);
+bool
+	timer_wheel_armed(wheel_timer_t *t);
+int
+	timer_wheel_jsonize(char *buff);
+
+#endif /* WEB_THING_TIMER_H_ */
@@ -13,18 +13,11 @@
 #include "lwip/api.h"
 #include "freertos/queue.h"
 #include "common.h"
+#include "ws_decoder.h"
 
 typedef void *ws_handler_t;
 
-/** \brief Opcode according to RFC 6455*/
-typedef enum {
-	WS_OP_CON = 0x0, 				/*!< Continuation Frame*/
-	WS_OP_TXT = 0x1, 				/*!< Text Frame*/
-	WS_OP_BIN = 0x2, 				/*!< Binary Frame*/
-	WS_OP_CLS = 0x8, 				/*!< Connection Close Frame*/
-	WS_OP_PIN = 0x9, 				/*!< Ping Frame*/
-	WS_OP_PON = 0xa 				/*!< Pong Frame*/
-} WS_OPCODES;
+#define WS_PAYLOAD_LEN	1024	//max payload of frame sent by server
 
 typedef struct{
 	WS_OPCODES opcode:4;
@@ -54,18 +47,6 @@ typedef enum {
 	WS_CLOSE_BY_CLIENT = 2
 } WS_CLOSE_INITIATOR;
 
-typedef enum {
-	NORMAL_CLOSE	= 1000,
-	GOING_AWAY		= 1001,
-	PROTOCOL_ERR	= 1002,
-	INCORRECT_DATA	= 1003,
-	ABNORMAL_CLS	= 1006,
-	DATA_INCONSIST	= 1007,
-	POLICY_ERR		= 1008,
-	DATA_TO_BIG		= 1009,
-	SERVER_ERR		= 1011
-} WS_STATUS_CODE;
-
 typedef struct{
 	uint8_t *payload;
 	uint16_t len;
@@ -73,6 +54,7 @@ typedef struct{
 	WS_OPCODES opcode:4;
 	uint8_t ws_frame:1; //ws - 1, non ws - 0
 	uint8_t text:1; //1 - text frame, 0 - binary frame
+	uint8_t compressed:1; //set by sending task (permessage-deflate)
 }ws_queue_item_t;
 
 typedef struct{
@@ -83,7 +65,16 @@ typedef struct{
 int8_t ws_server_init(uint16_t port);
 int8_t ws_server_stop(void);
 int8_t ws_send(ws_queue_item_t *item, int32_t wait_ms);
+ws_queue_item_t *ws_item_alloc(void);
+void ws_item_free(ws_queue_item_t *item);
+void *ws_payload_alloc(uint16_t size);
+void ws_payload_free(void *payload);
+int8_t ws_queue_text(connection_desc_t *conn_desc, char *payload);
+int8_t ws_queue_frame(connection_desc_t *conn_desc, uint8_t *payload, uint16_t len,
+					WS_OPCODES opcode);
 int8_t ws_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc);
+void ws_decoder_free(connection_desc_t *conn_desc);
+uint32_t ws_get_evictions(void);
 xQueueHandle ws_get_recv_queue(void);
 
 #endif /* MAIN_WEBSOCKET_H_ */
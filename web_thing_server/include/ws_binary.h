@@ -0,0 +1,42 @@
+/*
+ * ws_binary.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WS_BINARY_H_
+#define WS_BINARY_H_
+
+#include <stdint.h>
+
+#include "common.h"
+#include "web_thing_property.h"
+
+/*
+ * "webthing-bin" websocket subprotocol, binary frames (little endian):
+ * 		header:  u8 message type, u8 thing number, u32 sequence number
+ * 		records: u8 property index, u8 value type, value
+ */
+#define WS_BIN_PROTOCOL		"webthing-bin"
+#define WS_BIN_HEADER_LEN	6
+
+//message types
+#define WS_BIN_PROP_STATUS	0x01	//server -> client
+#define WS_BIN_SET_PROP		0x02	//client -> server
+
+//value types
+#define WS_BIN_BOOL			0x01	//u8, 0 or 1
+#define WS_BIN_INT32		0x02	//int32
+#define WS_BIN_FLOAT32		0x03	//float
+#define WS_BIN_JSON			0x04	//u16 length + json text (strings, objects, arrays)
+
+uint8_t *
+	ws_bin_prop_msg(property_t *p, uint32_t seq, int *len);
+uint8_t *
+	ws_bin_props_msg(thing_t *t, uint32_t seq, int *first, int *len);
+int8_t
+	ws_bin_receive(connection_desc_t *conn_desc, uint8_t *msg, uint32_t len);
+
+#endif /* WS_BINARY_H_ */
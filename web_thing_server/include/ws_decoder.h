@@ -0,0 +1,106 @@
+/*
+ * ws_decoder.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WS_DECODER_H_
+#define WS_DECODER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** \brief Opcode according to RFC 6455*/
+typedef enum {
+	WS_OP_CON = 0x0, 				/*!< Continuation Frame*/
+	WS_OP_TXT = 0x1, 				/*!< Text Frame*/
+	WS_OP_BIN = 0x2, 				/*!< Binary Frame*/
+	WS_OP_CLS = 0x8, 				/*!< Connection Close Frame*/
+	WS_OP_PIN = 0x9, 				/*!< Ping Frame*/
+	WS_OP_PON = 0xa 				/*!< Pong Frame*/
+} WS_OPCODES;
+
+typedef enum {
+	NORMAL_CLOSE	= 1000,
+	GOING_AWAY		= 1001,
+	PROTOCOL_ERR	= 1002,
+	INCORRECT_DATA	= 1003,
+	ABNORMAL_CLS	= 1006,
+	DATA_INCONSIST	= 1007,
+	POLICY_ERR		= 1008,
+	DATA_TO_BIG		= 1009,
+	SERVER_ERR		= 1011
+} WS_STATUS_CODE;
+
+#define WS_CTRL_MAX_LEN 125 //max payload of control frame
+#define WS_RSV1			0x4	//"reserved" field bit of RSV1 (compressed message)
+
+// state of frame decoder
+typedef enum {
+	WS_DEC_HEAD = 0,	//collecting frame header
+	WS_DEC_PAYLOAD = 1,	//collecting frame payload
+	WS_DEC_ERROR = 2	//incorrect data, connection is closing
+} WS_DEC_STATE;
+
+/*
+ * decoder callbacks, ctx is given in ws_decoder_init()
+ * 		control - control frame received (close, ping, pong)
+ * 		message - whole data message received (fragments are joined),
+ * 				msg[len] is 0, buffer belongs to decoder and is valid
+ * 				only during the call
+ * 		error - incorrect data, code is websocket close status
+ */
+typedef void (ws_dec_control_fun)(void *ctx, uint8_t opcode, uint8_t *payload, uint8_t len);
+typedef void (ws_dec_message_fun)(void *ctx, uint8_t opcode, uint8_t rsv,
+								uint8_t *msg, uint32_t len);
+typedef void (ws_dec_error_fun)(void *ctx, uint16_t code, const char *info);
+
+//streaming frame decoder, one per websocket connection
+struct ws_decoder_t{
+	WS_DEC_STATE state;
+	uint8_t head[14];		//frame header
+	uint8_t head_len;		//received header bytes
+	uint8_t head_need;		//header length (known after 2 bytes)
+	uint8_t fin:1;
+	uint8_t masked:1;
+	uint8_t rsv:3;
+	uint8_t opcode:4;
+	uint8_t mask[4];
+	uint64_t frame_len;
+	uint64_t frame_pos;		//received payload bytes of the frame
+	//data message, fragments are joined
+	bool msg_active;		//fragmented message started
+	uint8_t msg_opcode;
+	uint8_t msg_rsv;
+	uint8_t *msg;
+	uint32_t msg_len;
+	uint32_t msg_size;		//size of fixed message buffer, 0 - buffer from heap
+	uint32_t max_len;		//longer messages are rejected (1009)
+	bool rsv1_allowed;		//compressed messages accepted (permessage-deflate)
+	//control frame
+	uint8_t ctrl[WS_CTRL_MAX_LEN];
+	uint8_t ctrl_len;
+	//callbacks
+	void *ctx;
+	ws_dec_control_fun *control_fun;
+	ws_dec_message_fun *message_fun;
+	ws_dec_error_fun *error_fun;
+};
+typedef struct ws_decoder_t ws_decoder_t;
+
+void
+	ws_decoder_init(ws_decoder_t *d, uint32_t max_len, bool rsv1_allowed, void *ctx,
+					ws_dec_control_fun *control_fun, ws_dec_message_fun *message_fun,
+					ws_dec_error_fun *error_fun);
+void
+	ws_decoder_set_buffer(ws_decoder_t *d, uint8_t *buff, uint32_t size);
+int8_t
+	ws_decode(ws_decoder_t *d, uint8_t *data, uint32_t len);
+int8_t
+	ws_decoder_fail(ws_decoder_t *d, uint16_t code, const char *info);
+void
+	ws_decoder_release(ws_decoder_t *d);
+
+#endif /* WS_DECODER_H_ */
@@ -0,0 +1,23 @@
+/*
+ * ws_deflate.h
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WS_DEFLATE_H_
+#define WS_DEFLATE_H_
+
+#include <stdint.h>
+
+#define WS_DEFLATE_MIN_LEN	32		//shorter messages are sent uncompressed
+#define WS_INFLATE_WORK_LEN	2048	//work area of ws_inflate (Huffman tables)
+
+int
+	ws_deflate(const uint8_t *in, int in_len, uint8_t *out, int out_size,
+				uint8_t window_bits);
+int
+	ws_inflate(const uint8_t *in, int in_len, uint8_t *out, int out_size, void *work);
+
+#endif /* WS_DEFLATE_H_ */
@@ -0,0 +1,29 @@
+# Thing Description generator (tools/td_gen.py)
+#
+# Call in CMakeLists.txt of the thing component, after idf_component_register:
+#	web_thing_td_generate(SPEC "thing_button.json")
+# Code generated from <spec>.json (or .yaml) is built into the component,
+# the component includes "<spec>_td.h".
+
+set(WEB_THING_TD_GEN "${CMAKE_CURRENT_LIST_DIR}/tools/td_gen.py" CACHE INTERNAL "")
+
+function(web_thing_td_generate)
+	cmake_parse_arguments(TD "" "SPEC" "" ${ARGN})
+	if(NOT TD_SPEC)
+		message(FATAL_ERROR "web_thing_td_generate: SPEC is missing")
+	endif()
+
+	get_filename_component(spec "${TD_SPEC}" ABSOLUTE BASE_DIR "${CMAKE_CURRENT_SOURCE_DIR}")
+	get_filename_component(base "${spec}" NAME_WE)
+	set(out_dir "${CMAKE_CURRENT_BINARY_DIR}/td_gen")
+	idf_build_get_property(python PYTHON)
+
+	add_custom_command(OUTPUT "${out_dir}/${base}_td.c" "${out_dir}/${base}_td.h"
+		COMMAND ${python} "${WEB_THING_TD_GEN}" --out-dir "${out_dir}" "${spec}"
+		DEPENDS "${spec}" "${WEB_THING_TD_GEN}"
+		COMMENT "Generating Thing Description from ${TD_SPEC}"
+		VERBATIM)
+
+	target_sources(${COMPONENT_LIB} PRIVATE "${out_dir}/${base}_td.c")
+	target_include_directories(${COMPONENT_LIB} PRIVATE "${out_dir}")
+endfunction()
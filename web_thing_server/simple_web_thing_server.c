@@ -28,14 +28,29 @@
 
 #include "lwip/api.h"
 #include "mdns.h"
+#include "esp_system.h"
 
 #include "simple_web_thing_server.h"
 #include "websocket.h"
 #include "http_parser.h"
+#include "ws_binary.h"
+#include "web_thing_event_log.h"
+#include "web_thing_arena.h"
+#include "web_thing_pool.h"
 #include "common.h"
 
 #define WS_UPGRADE "Upgrade: websocket"
 #define KEEP_ALIVE_TIMEOUT 2000
+#define HTTP_FIRST_BYTE_MS CONFIG_HTTP_FIRST_BYTE_MS
+#define HTTP_HEADERS_MS CONFIG_HTTP_HEADERS_MS
+#define HTTP_BODY_MS CONFIG_HTTP_BODY_MS
+#define HTTP_BODY_MIN_RATE CONFIG_HTTP_BODY_MIN_RATE
+#define WS_IDLE_MS CONFIG_WS_IDLE_MS
+#define NOTIFY_PERIOD_MS CONFIG_NOTIFY_PERIOD_MS
+#define CONN_TASK_STACK (1024*6)
+#define SERVER_TASK_STACK (1024*10)
+#define NOTIFY_TASK_STACK (1024*3)
+#define REJECT_SEND_MS 100	//the longest write of 503 answer (server task)
 
 //global server variables
 static xTaskHandle server_task_handle;
@@ -44,10 +59,30 @@ root_node_t root_node; //http parser uses it
 connection_desc_t connection_tab[MAX_OPEN_CONN];
 static xSemaphoreHandle connection_mux = NULL;
 static xSemaphoreHandle server_mux = NULL;
+static xSemaphoreHandle notify_mux = NULL;
+static uint32_t rx_reclaims[RX_STAGE_QUANT]; //connections closed by deadlines
+static uint32_t conn_evictions = 0;	//idle keep-alive connections evicted
+static uint32_t conn_rejections = 0; //new connections rejected (503)
+static xQueueHandle conn_queue = NULL; //slots of accepted connections for workers
+#ifdef CONFIG_STATIC_ALLOC
+//connection workers and their queue
+static StackType_t conn_stack[MAX_OPEN_CONN][CONN_TASK_STACK];
+static StaticTask_t conn_tcb[MAX_OPEN_CONN];
+static StaticQueue_t conn_queue_buff;
+static uint8_t conn_queue_storage[MAX_OPEN_CONN * sizeof(int8_t)];
+static StaticSemaphore_t connection_mux_buff, server_mux_buff, notify_mux_buff;
+//server and notification tasks
+static StackType_t server_stack[SERVER_TASK_STACK], notify_stack[NOTIFY_TASK_STACK];
+static StaticTask_t server_tcb, notify_tcb;
+#endif
 
 //functions
 int8_t send_websocket_msg(thing_t *t, char *buff, int len);
-void http_timer_fun(TimerHandle_t xTimer);
+static int8_t send_prop_notification(property_t *_p, bool flush);
+static int8_t send_snapshot_of_thing(connection_desc_t *conn_desc, thing_t *t);
+static void send_snapshot_props(connection_desc_t *conn_desc, thing_t *t, char *thing_str,
+								uint32_t seq);
+static int8_t conn_workers_init(void);
 
 /*****************************************************
 *
@@ -66,7 +101,39 @@ void get_server_time(char *time_buff, uint32_t buff_len){
 
 /*********************************************************
 *
-* close TCP connection and clear connection resources
+* ask the worker of connection to close it, server_mux must be taken;
+* only receiving is shut down, the worker wakes up in netconn_recv
+* and closes the connection by itself
+*
+*********************************************************/
+static void conn_shutdown_rx(connection_desc_t *conn_desc){
+
+	if ((conn_desc -> netconn_ptr != NULL) && (conn_desc -> close_req == false)){
+		conn_desc -> close_req = true;
+		netconn_shutdown(conn_desc -> netconn_ptr, 1, 0);
+	}
+}
+
+
+/*********************************************************
+*
+* close connection from other task than its worker (timers,
+* server task), netconn is deleted only by the worker which
+* can be blocked in netconn_recv on it
+*
+*********************************************************/
+void conn_close_request(connection_desc_t *conn_desc){
+
+	xSemaphoreTake(server_mux, portMAX_DELAY);
+	conn_shutdown_rx(conn_desc);
+	xSemaphoreGive(server_mux);
+}
+
+
+/*********************************************************
+*
+* close TCP connection and clear connection resources,
+* called only by the worker of connection
 *
 *********************************************************/
 int8_t close_thing_connection(connection_desc_t *conn_desc, char *tag){
@@ -81,18 +148,16 @@ int8_t close_thing_connection(connection_desc_t *conn_desc, char *tag){
 		
 		//delete subscriber
 		if (conn_desc -> type == CONN_WS){
-			delete_subscriber(conn_desc);
-		}
-		//delete timer
-		if (conn_desc -> timer != NULL){
-			xTimerDelete(conn_desc -> timer, 0);
-			conn_desc -> timer = NULL;
-			//printf("timer deleted\n");
+			unsubscribe_connection(conn_desc);
 		}
 		conn_ptr = conn_desc -> netconn_ptr;
 		conn_desc -> netconn_ptr = NULL;
 		
 		xSemaphoreGive(server_mux);
+		//stop timers, waits for timer function which is running now
+		//(it can take server_mux)
+		timer_wheel_cancel(&conn_desc -> timer);
+		timer_wheel_cancel(&conn_desc -> ping_timer);
 	
 		if (conn_ptr != NULL){
 			get_server_time(time_buffer, sizeof(time_buffer));
@@ -113,33 +178,126 @@ int8_t close_thing_connection(connection_desc_t *conn_desc, char *tag){
 
 /***************************************************************************
  *
- * task where data is received and processed (both http and websocket)
+ * set receive deadline of connection
+ *
+ * ************************************************************************/
+static void rx_deadline_set(connection_desc_t *conn_desc, RX_STAGE stage,
+							uint32_t ms){
+
+	conn_desc -> rx_stage = stage;
+	conn_desc -> rx_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(ms);
+}
+
+
+/***************************************************************************
+ *
+ * part of request received, headers deadline is counted from the first
+ * byte of request, body deadline is extended by received data
+ *
+ * ************************************************************************/
+static void rx_progress(connection_desc_t *conn_desc, uint32_t bytes){
+
+	if (conn_desc -> rx_need == 0){
+		if (conn_desc -> rx_stage != RX_HEADERS){
+			rx_deadline_set(conn_desc, RX_HEADERS, HTTP_HEADERS_MS);
+		}
+	}
+	else if (conn_desc -> rx_stage != RX_BODY){
+		rx_deadline_set(conn_desc, RX_BODY, HTTP_BODY_MS);
+	}
+	else{
+#if HTTP_BODY_MIN_RATE > 0
+		conn_desc -> rx_deadline += pdMS_TO_TICKS(bytes * 1000 / HTTP_BODY_MIN_RATE);
+#endif
+	}
+}
+
+
+/***************************************************************************
+ *
+ * time to the deadline in ms (receive timeout),
+ * 0 - no deadline, -1 - deadline has passed
+ *
+ * ************************************************************************/
+static int32_t rx_timeout(connection_desc_t *conn_desc){
+	int32_t left;
+
+	if (conn_desc -> rx_stage == RX_NONE){
+		return 0;
+	}
+	left = (int32_t)(conn_desc -> rx_deadline - xTaskGetTickCount());
+	if (left <= 0){
+		return -1;
+	}
+
+	return left * portTICK_PERIOD_MS;
+}
+
+
+/***************************************************************************
+ *
+ * connection is closed by its deadline (or too long request),
+ * the slot is reclaimed
+ *
+ * ************************************************************************/
+static void rx_reclaim(connection_desc_t *conn_desc){
+	const char *names[] = {"", "first byte", "headers", "body", "keep-alive",
+							"websocket idle", "too long request"};
+
+	rx_reclaims[conn_desc -> rx_stage]++;
+	if (conn_desc -> rx_stage != RX_KEEP_ALIVE){
+		printf("connection %i closed: %s\n", conn_desc -> index,
+				names[conn_desc -> rx_stage]);
+	}
+}
+
+
+/***************************************************************************
+ *
+ * connection is served here, data is received and processed (both http
+ * and websocket), netconn_recv waits not longer than to the deadline
+ * of connection, so connection is always closed by its own worker
  *
  * ************************************************************************/
-static void connection_task(void *arg){
+static void connection_serve(connection_desc_t *conn_desc){
 	err_t net_err = ERR_OK;
 	struct netconn *conn_ptr;
 	struct netbuf *inbuf;
 	uint16_t tcp_len = 0;
 	char *rq = NULL;
-	connection_desc_t *conn_desc;
 	bool run = true;
-
-	conn_desc = (connection_desc_t *)arg;
+	int32_t timeout;
+	int8_t res;
 
 	//printf("start connection, ID: %i\n", conn_desc -> index);
 	conn_ptr = conn_desc -> netconn_ptr;
 
-	while(run){
+	while(run && (conn_desc -> close_req == false)){
+		timeout = rx_timeout(conn_desc);
+		if (timeout < 0){
+			rx_reclaim(conn_desc);
+			break;
+		}
+		netconn_set_recvtimeout(conn_ptr, timeout);
+		inbuf = NULL;
 		net_err = netconn_recv(conn_ptr, &inbuf);
-		if (net_err == ERR_OK){
-			conn_desc -> requests++;
-			//read data from input buffer
-			net_err = netbuf_data(inbuf, (void**) &rq, &tcp_len);
-
-			if (net_err == ERR_OK){
-				//printf("tcp_len: %i\n", tcp_len); //TEST
-				
+		if (net_err == ERR_TIMEOUT){
+			//deadline is checked at the beginning of the loop
+			continue;
+		}
+		else if ((net_err == ERR_OK) && (conn_desc -> type != CONN_WS)){
+			//HTTP request or websocket handshake, can come in many segments
+			res = http_collect(conn_desc, inbuf, &rq, &tcp_len);
+			if (res < 0){
+				conn_desc -> rx_stage = RX_TOO_LONG;
+				rx_reclaim(conn_desc);
+				run = false;
+			}
+			else if (res == 0){
+				rx_progress(conn_desc, netbuf_len(inbuf));
+			}
+			else{
+				conn_desc -> requests++;
 				if (conn_desc -> type == CONN_UNKNOWN){
 					//check connection type: HTTP or websocket
 					if (strstr(rq, WS_UPGRADE) != NULL){
@@ -176,43 +334,62 @@ static void connection_task(void *arg){
 					}
 				}
 
+				//request is processed, connection is not idle any more
+				//(it isn't evicted before the answer is sent)
+				xSemaphoreTake(server_mux, portMAX_DELAY);
+				conn_desc -> rx_stage = RX_NONE;
+				xSemaphoreGive(server_mux);
+
+				//buffers of this request are taken from connection's arena
+				req_arena_begin(&conn_desc -> arena);
 				if (conn_desc -> type == CONN_HTTP){
 					//parse http connection
 					http_receive(rq, tcp_len, conn_desc);
 				}
 				else{
-					//parse websocket connection
+					//websocket handshake
 					ws_receive(rq, tcp_len, conn_desc);
 				}
-					
-				
-				if (conn_desc -> connection == CONN_HTTP_KEEP_ALIVE){
-					conn_desc -> connection = CONN_HTTP_RUNNING;
-					//start timer
-					conn_desc -> timer = xTimerCreate("http_timer",
-								pdMS_TO_TICKS(KEEP_ALIVE_TIMEOUT),
-								pdFALSE,
-								(void *)&conn_desc -> index,
-								http_timer_fun);
-					if (conn_desc -> timer != NULL){
-						BaseType_t res = xTimerStart(conn_desc -> timer, 5);
-						if (res != pdPASS) {
-							printf("HTTP timer start failed\n");
-							run = false;
-							xTimerDelete(conn_desc -> timer, 10);
-						}
-					}
-				}
-				else if (conn_desc -> connection == CONN_HTTP_CLOSE){
+				req_arena_end(&conn_desc -> arena);
+				http_collect_done(conn_desc);
+
+				if ((conn_desc -> connection == CONN_HTTP_CLOSE) ||
+						(conn_desc -> connection == CONN_WS_CLOSE)){
 					run = false;
 				}
-				else if (conn_desc -> connection == CONN_WS_CLOSE){
-					run = false;
+				else if (conn_desc -> type == CONN_WS){
+#if WS_IDLE_MS > 0
+					rx_deadline_set(conn_desc, RX_WS_IDLE, WS_IDLE_MS);
+#else
+					conn_desc -> rx_stage = RX_NONE;
+#endif
 				}
+				else{
+					//the next request on the same connection
+					rx_deadline_set(conn_desc, RX_KEEP_ALIVE, KEEP_ALIVE_TIMEOUT);
+				}
+			}
+		}
+		else if (net_err == ERR_OK){
+			conn_desc -> requests++;
+			//parse websocket connection, data can be in many netbuf parts
+			req_arena_begin(&conn_desc -> arena);
+			do{
+				if (netbuf_data(inbuf, (void**) &rq, &tcp_len) == ERR_OK){
+					ws_receive(rq, tcp_len, conn_desc);
+				}
+			}while ((conn_desc -> ws_state != WS_CLOSED) &&
+					(netbuf_next(inbuf) >= 0));
+			req_arena_end(&conn_desc -> arena);
+
+			if (conn_desc -> connection == CONN_WS_CLOSE){
+				run = false;
 			}
+#if WS_IDLE_MS > 0
 			else{
-				printf("netbuff data ERROR\n");
+				rx_deadline_set(conn_desc, RX_WS_IDLE, WS_IDLE_MS);
 			}
+#endif
 		}
 		else{
 			//connection is closed
@@ -240,29 +417,242 @@ static void connection_task(void *arg){
 		}
 	}//while
 
+	http_collect_done(conn_desc);
 	if (conn_desc -> netconn_ptr != NULL){
 		close_thing_connection(conn_desc, "CONN_TASK");
 	}
+	ws_decoder_free(conn_desc);
+}
+
 
-	vTaskDelete(NULL);
+/***************************************************************************
+ *
+ * new connection in the slot, called with server_mux taken
+ *
+ * ************************************************************************/
+static void conn_slot_init(int8_t index, struct netconn *newconn){
+	connection_desc_t *c = &connection_tab[index];
+
+	c -> type = CONN_UNKNOWN;
+	c -> netconn_ptr = newconn;
+	c -> ws_state = WS_CLOSED;
+	c -> index = index;
+	c -> ws_pings = 0;
+	c -> ws_pongs = 0;
+	c -> ws_missed_pongs = 0;
+	c -> ws_rtt_us = 0;
+	c -> ws_rtt_avg_us = 0;
+	c -> ws_jitter_us = 0;
+	c -> packets = 0;
+	c -> send_errors = 0;
+	c -> connection = CONN_STATE_UNKNOWN;
+	c -> thing = NULL;
+	c -> ws_node = false;
+	c -> ws_deflate = false;
+	c -> ws_binary = false;
+	c -> ws_dec = NULL;
+	c -> bytes = 0;
+	c -> requests = 0;
+	c -> rx_buff = NULL;
+	c -> rx_len = 0;
+	c -> rx_need = 0;
+	c -> close_req = false;
+	c -> next_conn = NULL;
+	rx_deadline_set(c, RX_FIRST_BYTE, HTTP_FIRST_BYTE_MS);
+	c -> mutex = connection_mux;
 }
 
 
-/*****************************************
+/***************************************************************************
  *
- * HTTP timer function
+ * connection of the slot is closed, take the new connection waiting
+ * for this slot (set by eviction), false - no connection waits
  *
- ******************************************/
-void http_timer_fun(TimerHandle_t xTimer){
-	uint32_t id;
-	connection_desc_t *conn_desc;
-	
-	id = *(uint32_t *)pvTimerGetTimerID(xTimer); 
-	
-	conn_desc = &connection_tab[id];
-	if (conn_desc -> netconn_ptr != NULL){
-		close_thing_connection(conn_desc, "TIMER_TASK");
+ * ************************************************************************/
+static bool conn_slot_takeover(connection_desc_t *conn_desc){
+	struct netconn *newconn;
+
+	//timers armed after the connection was closed,
+	//not under server_mux (timer functions can take it)
+	timer_wheel_cancel(&conn_desc -> timer);
+	timer_wheel_cancel(&conn_desc -> ping_timer);
+
+	xSemaphoreTake(server_mux, portMAX_DELAY);
+	newconn = conn_desc -> next_conn;
+	if (newconn != NULL){
+		conn_slot_init(conn_desc -> index, newconn);
 	}
+	xSemaphoreGive(server_mux);
+
+	return (newconn != NULL);
+}
+
+
+/***************************************************************************
+ *
+ * connection worker, serves connections of slots taken from the queue,
+ * one connection at a time
+ *
+ * ************************************************************************/
+static void conn_worker_task(void *arg){
+	int8_t index;
+
+	for (;;){
+		if (xQueueReceive(conn_queue, &index, portMAX_DELAY) == pdTRUE){
+			connection_tab[index].task_handl = xTaskGetCurrentTaskHandle();
+			do{
+				connection_serve(&connection_tab[index]);
+				//new connection which evicted this one is served by this worker
+			}while (conn_slot_takeover(&connection_tab[index]) == true);
+			//slot can be used again
+			connection_tab[index].task_handl = NULL;
+		}
+	}
+}
+
+
+/***************************************************************************
+ *
+ * create queue and MAX_OPEN_CONN connection workers, so connection
+ * doesn't create and delete its task, every open connection has
+ * its worker
+ *
+ * ************************************************************************/
+static int8_t conn_workers_init(void){
+	int8_t workers = 0;
+
+#ifdef CONFIG_STATIC_ALLOC
+	conn_queue = xQueueCreateStatic(MAX_OPEN_CONN, sizeof(int8_t),
+									conn_queue_storage, &conn_queue_buff);
+#else
+	conn_queue = xQueueCreate(MAX_OPEN_CONN, sizeof(int8_t));
+#endif
+	if (conn_queue == NULL){
+		printf("connection queue not created\n");
+		return -1;
+	}
+
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+#ifdef CONFIG_STATIC_ALLOC
+		if (xTaskCreateStatic(conn_worker_task, "conn_worker", CONN_TASK_STACK,
+							NULL, 1, conn_stack[i], &conn_tcb[i]) != NULL){
+			workers++;
+		}
+#else
+		if (xTaskCreate(conn_worker_task, "conn_worker", CONN_TASK_STACK,
+							NULL, 1, NULL) == pdPASS){
+			workers++;
+		}
+#endif
+	}
+	if (workers < MAX_OPEN_CONN){
+		printf("connection workers: %i of %i created\n", workers, MAX_OPEN_CONN);
+	}
+
+	return workers;
+}
+
+
+/*****************************************************************************
+ *
+ * property notification task, sends held back notifications (min interval)
+ * and heartbeats (max silence) of all properties
+ *
+ * ***************************************************************************/
+static void notify_task(void *arg){
+	thing_t *t;
+	property_t *p;
+
+	for (;;){
+		vTaskDelay(NOTIFY_PERIOD_MS / portTICK_PERIOD_MS);
+
+		t = root_node.things;
+		while (t != NULL){
+			for (int i = 0; i < t -> prop_quant; i++){
+				p = t -> properties[i];
+				if (property_notify_due(p) == true){
+					send_prop_notification(p, true);
+				}
+			}
+			//events emitted from interrupts
+			send_events(t);
+			t = t -> next;
+		}
+	}
+}
+
+
+/****************************************************************************
+ *
+ * free connection slot (closed and released by its worker),
+ * -1 - all slots are used
+ * (only server_main_task takes slots, so free slot stays free)
+ *
+ * ***************************************************************************/
+static int8_t conn_slot_free(void){
+
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+		if ((connection_tab[i].netconn_ptr == NULL) &&
+				(connection_tab[i].task_handl == NULL)){
+			return i;
+		}
+	}
+	return -1;
+}
+
+
+#ifdef CONFIG_CONN_EVICT_IDLE
+/****************************************************************************
+ *
+ * all slots are used, close the least recently active idle keep-alive
+ * HTTP connection (it has the earliest keep-alive deadline), websocket
+ * is never evicted; only receiving is shut down here, the worker
+ * of connection wakes up, closes it and serves the new connection
+ * in the same slot, so server task doesn't wait for the slot
+ *
+ * ***************************************************************************/
+static bool conn_evict_idle(struct netconn *newconn){
+	connection_desc_t *c, *victim = NULL;
+
+	xSemaphoreTake(server_mux, portMAX_DELAY);
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+		c = &connection_tab[i];
+		if ((c -> netconn_ptr != NULL) && (c -> type == CONN_HTTP) &&
+				(c -> rx_stage == RX_KEEP_ALIVE) && (c -> close_req == false) &&
+				((victim == NULL) ||
+				((int32_t)(c -> rx_deadline - victim -> rx_deadline) < 0))){
+			victim = c;
+		}
+	}
+	if (victim != NULL){
+		victim -> next_conn = newconn;
+		conn_shutdown_rx(victim);
+		conn_evictions++;
+	}
+	xSemaphoreGive(server_mux);
+
+	return (victim != NULL);
+}
+#endif
+
+
+/****************************************************************************
+ *
+ * no place for new client, answer 503 and close connection; the client
+ * which doesn't read can't block server task longer than REJECT_SEND_MS
+ *
+ * ***************************************************************************/
+static void conn_reject(struct netconn *conn){
+	char resp[] = "HTTP/1.1 503 Service Unavailable\r\n"\
+					"Retry-After: " RETRY_AFTER_S "\r\n"\
+					"Content-Length: 0\r\nConnection: close\r\n\r\n";
+
+	conn_rejections++;
+	printf("no space for new clients\n");
+	netconn_set_sendtimeout(conn, REJECT_SEND_MS);
+	netconn_write(conn, resp, strlen(resp), NETCONN_COPY);
+	netconn_close(conn);
+	netconn_delete(conn);
 }
 
 
@@ -281,8 +671,14 @@ static void server_main_task(void* arg){
 	port = cfg -> port;
 	
 	//cennection mutex
+#ifdef CONFIG_STATIC_ALLOC
+	connection_mux = xSemaphoreCreateMutexStatic(&connection_mux_buff);
+	server_mux = xSemaphoreCreateMutexStatic(&server_mux_buff);
+#else
 	connection_mux = xSemaphoreCreateMutex();
 	server_mux = xSemaphoreCreateMutex();
+#endif
+	conn_workers_init();
 
 	//set up new TCP listener
 	server_conn = netconn_new(NETCONN_TCP);
@@ -294,52 +690,33 @@ static void server_main_task(void* arg){
 	for (;;){
 		if (netconn_accept(server_conn, &newconn) == ERR_OK){
 			//check if there is a place for next client
-			index = -1;
-			xSemaphoreTake(server_mux, portMAX_DELAY);
-			
-			for (int i = 0; i < MAX_OPEN_CONN; i++){
-				if (connection_tab[i].netconn_ptr == NULL){
-					index = i;
-					break;
-				}
-			}
-			
+			index = conn_slot_free();
 			if (index > -1){
-				connection_tab[index].type = CONN_UNKNOWN;
-				connection_tab[index].netconn_ptr = newconn;
+				//timers armed after the previous connection was closed,
+				//not under server_mux (timer functions can take it)
+				timer_wheel_cancel(&connection_tab[index].timer);
+				timer_wheel_cancel(&connection_tab[index].ping_timer);
+
+				xSemaphoreTake(server_mux, portMAX_DELAY);
+				conn_slot_init(index, newconn);
 				connection_tab[index].task_handl = NULL;
-				connection_tab[index].ws_state = WS_CLOSED;
-				connection_tab[index].timer = NULL;
-				connection_tab[index].index = index;
-				connection_tab[index].ws_pings = 0;
-				connection_tab[index].ws_pongs = 0;
-				connection_tab[index].connection = CONN_STATE_UNKNOWN;
-				connection_tab[index].thing = NULL;
-				connection_tab[index].bytes = 0;
-				connection_tab[index].requests = 0;
-				connection_tab[index].mutex = connection_mux;
-				
 				xSemaphoreGive(server_mux);
 				
-				BaseType_t xret;
-				xret = xTaskCreate(connection_task, "conn_task",
-									1024*6,
-									&connection_tab[index],
-									1,
-									&connection_tab[index].task_handl);
-				if (xret != pdPASS){
+				if (xQueueSend(conn_queue, &index, 0) != pdTRUE){
 					printf("new connection failed\n");
 					connection_tab[index].netconn_ptr = NULL;
 					netconn_close(newconn);
 					netconn_delete(newconn);
 				}
 			}
+#ifdef CONFIG_CONN_EVICT_IDLE
+			else if (conn_evict_idle(newconn) == true){
+				//new connection is served by the worker of evicted one
+			}
+#endif
 			else{
-				xSemaphoreGive(server_mux);
 				//too much clients, send error info and close connection
-				printf("no space for new clients\n");
-				netconn_close(newconn);
-				netconn_delete(newconn);
+				conn_reject(newconn);
 			}
 			
 			//TEST
@@ -370,6 +747,57 @@ thing_t *get_thing_ptr(uint8_t thing_nr){
 	return t;
 }
 
+
+/*************************************************************************
+ *
+ * add websocket connection to subscribers of it's thing
+ * or of all things (node websocket)
+ *
+ * ***********************************************************************/
+int8_t subscribe_connection(connection_desc_t *conn_desc){
+	int8_t res = 0;
+	thing_t *t;
+
+	if (conn_desc -> ws_node == false){
+		if (conn_desc -> thing == NULL){
+			return -1;
+		}
+		return add_subscriber(conn_desc -> thing, conn_desc);
+	}
+
+	t = root_node.things;
+	while (t != NULL){
+		if (add_subscriber(t, conn_desc) < 0){
+			res = -1;
+		}
+		t = t -> next;
+	}
+
+	return res;
+}
+
+
+/*************************************************************************
+ *
+ * delete websocket connection from subscribers
+ *
+ * ***********************************************************************/
+int8_t unsubscribe_connection(connection_desc_t *conn_desc){
+	thing_t *t;
+
+	if (conn_desc -> ws_node == false){
+		return delete_subscriber(conn_desc -> thing, conn_desc);
+	}
+
+	t = root_node.things;
+	while (t != NULL){
+		delete_subscriber(t, conn_desc);
+		t = t -> next;
+	}
+
+	return 0;
+}
+
 /*************************************************************************
 *
 * request action
@@ -380,7 +808,6 @@ int request_action(int8_t thing_nr, char *action_id, char *inputs){
 	thing_t *t = NULL;
 	action_t *a = NULL;
 	int out_index = -1;
-	int8_t run_result = -1;
 
 	//find thing
 	t = get_thing_ptr(thing_nr);
@@ -388,15 +815,9 @@ int request_action(int8_t thing_nr, char *action_id, char *inputs){
 	if (t != NULL){
 		a = get_action_ptr(t, action_id);
 
-		//run action
+		//put request into action's queue, it is run by action worker
 		if (a != NULL){
-			if (a -> running_request_index == -1){
-				run_result = a -> run(inputs);
-				if (run_result >= 0){
-					//add request to the list
-					out_index = add_request_to_list(a, inputs);
-				}
-			}
+			out_index = add_request_to_list(a, inputs);
 		}
 
 	}
@@ -409,7 +830,7 @@ int request_action(int8_t thing_nr, char *action_id, char *inputs){
 * set resource value
 *
 * ************************************************************************/
-int16_t set_resource_value(int8_t thing_nr, char *name, char *new_value_str){
+int16_t set_resource_value(int8_t thing_nr, const char *name, char *new_value_str){
 	thing_t *t = NULL;
 	property_t *p = NULL;
 	int16_t set_result = 0;
@@ -420,17 +841,12 @@ int16_t set_resource_value(int8_t thing_nr, char *name, char *new_value_str){
 	
 	//find property
 	if (t != NULL){
-		p = t -> properties;
-		while (p != NULL){
-			if (strcmp(p -> id, name) == 0){
-				break;
-			}
-			p = p -> next;
-		}
+		p = get_property_ptr(t, name);
 
 		//set new value for this property
-		if ((p != NULL) && (p -> read_only == false)){
-			set_result = p -> set(new_value_str);
+		if ((p != NULL) && (p -> desc -> read_only == false) &&
+			(p -> desc -> set != NULL)){
+			set_result = p -> desc -> set(new_value_str);
 		}
 
 		if (set_result == 1){
@@ -474,59 +890,52 @@ char *get_resource_value(int8_t thing_nr, RESOURCE_TYPE resource, char *name, in
 				//send values of all properties
 				n = t -> prop_quant;
 				len = PROP_VAL_LEN * n;
-				buff = malloc(PROP_VAL_LEN * n);
+				buff = req_malloc(PROP_VAL_LEN * n);
 				memset(buff, 0, PROP_VAL_LEN * n);
 				buff[0] = '{';
-				p = t -> properties;
 				for (int i = 0; i < n; i++){
-					buff1 = p -> value_jsonize(p);
+					p = t -> properties[i];
+					buff1 = property_value_jsonize(p);
 					temp_len = strlen(buff1);
 					if (curr_len + temp_len >= (len - 5)){
 						//allocate new buffer
 						len = curr_len + temp_len + 10;
-						char *new_buff = malloc(len);
+						char *new_buff = req_malloc(len);
 						memset(new_buff, 0, len);
 						strcpy(new_buff, buff);
-						free(buff);
+						req_free(buff);
 						buff = new_buff;
 					}
 					curr_len += temp_len;
 					strcat(buff, buff1);
-					free(buff1);
+					req_free(buff1);
 					if (i < (n - 1)){
 						//comma before the next property
 						strcat(buff, ",");
-						p = p -> next;
 					}
 				}
 				strcat(buff, "}");
 			}
 			else{
 				//send value of one particular property
-				p = t -> properties;
-				while (p != NULL){
-					if (strcmp(name, p -> id) == 0){
-						break;
-					}
-					p = p -> next;
-				}
+				p = get_property_ptr(t, name);
 				if (p != NULL){
-					buff = malloc(PROP_VAL_LEN);
+					buff = req_malloc(PROP_VAL_LEN);
 					memset(buff, 0, PROP_VAL_LEN);
 					buff[0] = '{';
-					buff1 = p -> value_jsonize(p);
+					buff1 = property_value_jsonize(p);
 					temp_len = strlen(buff1);
 					if (temp_len >= (PROP_VAL_LEN - 5)){
 						//allocate new buffer
 						len = curr_len + temp_len + 10;
-						char *new_buff = malloc(len);
+						char *new_buff = req_malloc(len);
 						memset(new_buff, 0, len);
 						strcpy(new_buff, buff);
-						free(buff);
+						req_free(buff);
 						buff = new_buff;
 					}
 					strcpy(buff + 1, buff1);
-					free(buff1);
+					req_free(buff1);
 					buff[strlen(buff)] = '}';
 				}
 			}
@@ -534,6 +943,7 @@ char *get_resource_value(int8_t thing_nr, RESOURCE_TYPE resource, char *name, in
 
 		//-------------------------------------------------------------
 		case ACTION:
+			action_list_lock();
 			if (name == NULL){
 				//list all action requests for this thing
 				action_t *a = t -> actions;
@@ -543,26 +953,20 @@ char *get_resource_value(int8_t thing_nr, RESOURCE_TYPE resource, char *name, in
 					action_t *a1 = t -> actions;
 
 					while (a1 != NULL){
-						action_request_t *ar = a1 -> requests_list;
+						action_request_t *ar = get_first_request(a1);
 						while (ar != NULL){
 							ar_cnt++;
-							ar = ar -> next;
+							ar = get_next_request(a1, ar);
 						}
 						a1 = a1 -> next;
 					}
 
-					buff = malloc(300 * ar_cnt + 3);
+					buff = req_malloc(300 * ar_cnt + 3);
 					memset(buff, 0, 300 * ar_cnt + 3);
 					strcat(buff, "[");
 
-					int m;
-					if (ar_cnt < 5){
-						m = ar_cnt;
-					}
-					else{
-						m = 5;
-					}
-					char *buff_temp = malloc(m * 300);
+					int m = ar_cnt + 1;
+					char *buff_temp = req_malloc(m * 300);
 					memset(buff_temp, 0, m * 300);
 					int first_item = 0;
 					uint16_t b = 0;
@@ -580,11 +984,11 @@ char *get_resource_value(int8_t thing_nr, RESOURCE_TYPE resource, char *name, in
 							memset(buff_temp, 0, m * 300);
 						}
 					}
-					free(buff_temp);
+					req_free(buff_temp);
 					strcat(buff, "]");
 				}
 				else{
-					buff = malloc(3);
+					buff = req_malloc(3);
 					buff[0] = '[';
 					buff[1] = ']';
 					buff[2] = 0;
@@ -595,8 +999,14 @@ char *get_resource_value(int8_t thing_nr, RESOURCE_TYPE resource, char *name, in
 				if (a != NULL){
 					if (index < 0){
 						//prepare list of all requests for particular action
-						buff = malloc(300 * MAX_ACTION_REQUESTS);
-						memset(buff, 0, 300 * MAX_ACTION_REQUESTS);
+						int ar_cnt = 1;
+
+						for (action_request_t *ar = get_first_request(a); ar != NULL;
+								ar = get_next_request(a, ar)){
+							ar_cnt++;
+						}
+						buff = req_malloc(300 * ar_cnt);
+						memset(buff, 0, 300 * ar_cnt);
 						strcat(buff, "[");
 						get_action_request_queue(a, buff + 1);
 						strcat(buff, "]");
@@ -607,6 +1017,7 @@ char *get_resource_value(int8_t thing_nr, RESOURCE_TYPE resource, char *name, in
 					}
 				}
 			}
+			action_list_unlock();
 			break;
 
 		//-------------------------------------------------------------
@@ -651,13 +1062,13 @@ char *get_root_dir(){
 	//create model of the whole node ----------------------------------
 	t = root_node.things;
 	if (root_node.things_quantity == 0){
-		res_buff = malloc(6);
+		res_buff = req_malloc(6);
 		memset(res_buff, 0, 6);
 		strcat(res_buff, "[{}]");
 	}
 	else if (root_node.things_quantity == 1){
 		//single thing node
-		res_buff = malloc(t -> model_len + 5);
+		res_buff = req_malloc(t -> model_len + 5);
 		res_buff[0] = '[';
 		res_buff[1] = '{';
 		res_buff[2] = 0;
@@ -675,7 +1086,7 @@ char *get_root_dir(){
 			t = t -> next;
 		}
 		uint16_t things = root_node.things_quantity;
-		res_buff = malloc(len + things * 5);
+		res_buff = req_malloc(len + things * 5);
 		res_buff[0] = '[';
 		res_buff[1] = '{';
 		res_buff[2] = 0;
@@ -702,6 +1113,70 @@ char *get_root_dir(){
 }
 
 
+/*************************************************************************
+ *
+ * server metrics (GET /metrics): statistics of open connections
+ *
+ * ***********************************************************************/
+char *get_server_metrics(void){
+	char conn_str[] = "%s{\"index\":%i,\"type\":\"%s\",\"requests\":%u,"\
+					"\"packets\":%u,\"bytes\":%u,\"send_errors\":%u,"\
+					"\"pings\":%u,\"pongs\":%u,\"missed_pongs\":%u,"\
+					"\"rtt_us\":%u,\"rtt_avg_us\":%u,\"jitter_us\":%u}";
+	char *buff;
+	int len;
+	bool first = true;
+	uint32_t arena_peak, arena_fallbacks;
+
+	buff = req_malloc(512 + SLAB_MAX_POOLS * 128 +
+					MAX_OPEN_CONN * (strlen(conn_str) + 100));
+	if (buff == NULL){
+		return NULL;
+	}
+	req_arena_stats(&arena_peak, &arena_fallbacks);
+	len = sprintf(buff, "{\"heap_free\":%u,\"heap_min_free\":%u,"\
+					"\"ws_evictions\":%u,\"http_evictions\":%u,"\
+					"\"rejections\":%u,\"event_log_dropped\":%u,\"arena_peak\":%u,"\
+					"\"arena_fallbacks\":%u,\"pools\":",
+					(unsigned int)esp_get_free_heap_size(),
+					(unsigned int)esp_get_minimum_free_heap_size(),
+					(unsigned int)ws_get_evictions(), (unsigned int)conn_evictions,
+					(unsigned int)conn_rejections, (unsigned int)event_log_dropped(),
+					(unsigned int)arena_peak,
+					(unsigned int)arena_fallbacks);
+	len += slab_pools_jsonize(buff + len);
+	len += sprintf(buff + len, ",\"timers\":");
+	len += timer_wheel_jsonize(buff + len);
+	len += sprintf(buff + len, ",\"deadlines\":{\"first_byte\":%u,\"headers\":%u,"\
+					"\"body\":%u,\"keep_alive\":%u,\"ws_idle\":%u,\"too_long\":%u}",
+					(unsigned int)rx_reclaims[RX_FIRST_BYTE],
+					(unsigned int)rx_reclaims[RX_HEADERS],
+					(unsigned int)rx_reclaims[RX_BODY],
+					(unsigned int)rx_reclaims[RX_KEEP_ALIVE],
+					(unsigned int)rx_reclaims[RX_WS_IDLE],
+					(unsigned int)rx_reclaims[RX_TOO_LONG]);
+	len += sprintf(buff + len, ",\"connections\":[");
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+		connection_desc_t *c = &connection_tab[i];
+
+		if (c -> netconn_ptr == NULL){
+			continue;
+		}
+		len += sprintf(buff + len, conn_str, first ? "" : ",", i,
+				(c -> type == CONN_WS) ? "ws" : "http",
+				(unsigned int)c -> requests, (unsigned int)c -> packets,
+				(unsigned int)c -> bytes, (unsigned int)c -> send_errors,
+				(unsigned int)c -> ws_pings, (unsigned int)c -> ws_pongs,
+				(unsigned int)c -> ws_missed_pongs, (unsigned int)c -> ws_rtt_us,
+				(unsigned int)c -> ws_rtt_avg_us, (unsigned int)c -> ws_jitter_us);
+		first = false;
+	}
+	sprintf(buff + len, "]}");
+
+	return buff;
+}
+
+
 // ***************************************************************************
 int8_t root_node_init(void){
 	int res = 0;
@@ -709,6 +1184,9 @@ int8_t root_node_init(void){
 	root_node.last_thing = NULL;
 	root_node.things = NULL;
 	root_node.things_quantity = 0;
+	change_log_init();
+	subscriber_pool_init();
+	req_arena_init();
 
 	return res;
 }
@@ -728,7 +1206,26 @@ int8_t start_web_thing_server(uint16_t port, char *host_name, char *domain){
 	strcpy(root_node.domain, domain);
 
 	cfg.port = port;
-	xTaskCreate(server_main_task, "server_main_task", 1024*10, &cfg, 1, &server_task_handle);
+#ifdef CONFIG_STATIC_ALLOC
+	notify_mux = xSemaphoreCreateMutexStatic(&notify_mux_buff);
+#else
+	notify_mux = xSemaphoreCreateMutex();
+#endif
+	timer_wheel_init();
+	action_executor_init();
+#ifdef CONFIG_EVENT_LOG
+	event_log_init();
+#endif
+#ifdef CONFIG_STATIC_ALLOC
+	server_task_handle = xTaskCreateStatic(server_main_task, "server_main_task",
+								SERVER_TASK_STACK, &cfg, 1, server_stack, &server_tcb);
+	xTaskCreateStatic(notify_task, "notify_task", NOTIFY_TASK_STACK, NULL, 1,
+								notify_stack, &notify_tcb);
+#else
+	xTaskCreate(server_main_task, "server_main_task", SERVER_TASK_STACK, &cfg, 1,
+								&server_task_handle);
+	xTaskCreate(notify_task, "notify_task", NOTIFY_TASK_STACK, NULL, 1, NULL);
+#endif
 
 	//initialize websocket server
 	ws_server_init(port);
@@ -741,38 +1238,126 @@ int8_t start_web_thing_server(uint16_t port, char *host_name, char *domain){
 /*****************************************************************************
  *
  * inform all websocket clients (subscribers) about new value of property
+ * notification is sent in accordance with property's notification policy
+ * output:
+ * 		0 - notification sent
+ * 		1 - notification held back by policy (dead-band, min interval, etc.)
+ * 	   -1 - no subscribers
  *
  * ***************************************************************************/
 int8_t inform_all_subscribers_prop(property_t *_p){
+
+	return send_prop_notification(_p, false);
+}
+
+
+/*****************************************************************************
+ *
+ * check notification policy and send property value to all subscribers
+ * 		flush - true for heartbeat and held back notifications
+ * messages are prepared under notify_mux, they are put into the sending
+ * queue (which can wait) after it is released
+ *
+ * ***************************************************************************/
+static int8_t send_prop_notification(property_t *_p, bool flush){
 	int8_t res = -1;
 	int len;
 	char *json_value, *buff;
-	char msg[] = "{\"messageType\":\"propertyStatus\",\"data\":{%s}}";
+	char msg[] = "{\"messageType\":\"propertyStatus\",%s\"seq\":%u,\"data\":{%s}}";
+	char thing_str[16];
+	uint8_t *bin_msg = NULL;
+	int bin_len = 0;
 	subscriber_t *s;
-	ws_queue_item_t *queue_data;
+	ws_queue_item_t *queue_data, *items[MAX_OPEN_CONN];
+	int items_nr = 0;
+
+	if (flush == false){
+		property_history_add(_p);
+	}
 
 	//prepare message
-	json_value = _p -> value_jsonize(_p);
-	len = strlen(json_value) + strlen(msg);
+	json_value = property_value_jsonize(_p);
+
+	xSemaphoreTake(notify_mux, portMAX_DELAY);
+	if (property_notify_check(_p, json_value, flush) == false){
+		xSemaphoreGive(notify_mux);
+		req_free(json_value);
+		return 1;
+	}
+
+	if ((flush == false) || (property_notify_changed(_p, json_value) == true)){
+		//new value, also the held back one sent by notify_task,
+		//heartbeat of unchanged value keeps its seq
+		_p -> change_seq = change_log_add(PROPERTY, _p -> t, _p, 0);
+	}
+	len = strlen(json_value) + strlen(msg) + sizeof(thing_str) + 10;
+	sprintf(thing_str, "\"thing\":%i,", _p -> t -> thing_nr);
 
 	s = _p -> t -> subscribers;
-	while (s != NULL){
-		buff = malloc(len + 1);
-		sprintf(buff, msg, json_value);
-		
-		queue_data = malloc(sizeof(ws_queue_item_t));
-		queue_data -> payload = (uint8_t *)buff;
-		queue_data -> len = strlen(buff);
-		queue_data -> opcode = WS_OP_TXT;
+	while ((s != NULL) && (items_nr < MAX_OPEN_CONN)){
+		if (subscriber_property_on(s, _p) == false){
+			s = s -> next;
+			continue;
+		}
+		if ((s -> conn_desc -> ws_binary == true) && (bin_msg == NULL)){
+			//"webthing-bin" subprotocol, binary message is prepared once
+			bin_msg = ws_bin_prop_msg(_p, _p -> change_seq, &bin_len);
+			if (bin_msg == NULL){
+				s = s -> next;
+				continue;
+			}
+		}
+		queue_data = ws_item_alloc();
+		if (queue_data == NULL){
+			s = s -> next;
+			continue;
+		}
+		if (s -> conn_desc -> ws_binary == true){
+			buff = ws_payload_alloc(bin_len);
+			if (buff == NULL){
+				ws_item_free(queue_data);
+				s = s -> next;
+				continue;
+			}
+			memcpy(buff, bin_msg, bin_len);
+			queue_data -> payload = (uint8_t *)buff;
+			queue_data -> len = bin_len;
+			queue_data -> opcode = WS_OP_BIN;
+			queue_data -> text = 0x0;
+		}
+		else{
+			buff = ws_payload_alloc(len + 1);
+			if (buff == NULL){
+				ws_item_free(queue_data);
+				s = s -> next;
+				continue;
+			}
+			sprintf(buff, msg, s -> conn_desc -> ws_node ? thing_str : "",
+					(unsigned int)_p -> change_seq, json_value);
+			queue_data -> payload = (uint8_t *)buff;
+			queue_data -> len = strlen(buff);
+			queue_data -> opcode = WS_OP_TXT;
+			queue_data -> text = 0x1;
+		}
 		queue_data -> ws_frame = 0x1;
-		queue_data -> text = 0x1;
 		queue_data -> conn_desc = s -> conn_desc;
-		ws_send(queue_data, 1000);
+		items[items_nr++] = queue_data;
 		s = s -> next;
 		res = 0;
 	}
-	
-	free(json_value);
+
+	//the change is logged even if nobody is listening now
+	property_notify_sent(_p, json_value);
+	xSemaphoreGive(notify_mux);
+
+	for (int i = 0; i < items_nr; i++){
+		if (ws_send(items[i], 1000) < 0){
+			ws_payload_free(items[i] -> payload);
+			ws_item_free(items[i]);
+		}
+	}
+	req_free(json_value);
+	ws_payload_free(bin_msg);
 
 	return res;
 }
@@ -785,30 +1370,46 @@ int8_t inform_all_subscribers_prop(property_t *_p){
  * 		a - action
  * 		data - data to be send (with curly bracket)
  * 		len - length of data
+ * 		seq - change sequence number
  *
  * ***************************************************************************/
-int8_t inform_all_subscribers_action(action_t *_a, char *data, int len){
+int8_t inform_all_subscribers_action(action_t *_a, char *data, int len, uint32_t seq){
 	int8_t res = -1;
 	//int len;
 	char *buff;
-	char msg[] = "{\"messageType\":\"actionStatus\",\"data\":%s}";
+	char msg[] = "{\"messageType\":\"actionStatus\",%s\"seq\":%u,\"data\":%s}";
+	char thing_str[16];
 	subscriber_t *s;
 	ws_queue_item_t *queue_data;
 
+	sprintf(thing_str, "\"thing\":%i,", _a -> t -> thing_nr);
 	s = _a -> t -> subscribers;
 	while (s != NULL){
+		queue_data = ws_item_alloc();
+		if (queue_data == NULL){
+			s = s -> next;
+			continue;
+		}
 		//prepare message
-		buff = malloc(len + strlen(msg) + 1);
-		sprintf(buff, msg, data);
+		buff = ws_payload_alloc(len + strlen(msg) + sizeof(thing_str) + 11);
+		if (buff == NULL){
+			ws_item_free(queue_data);
+			s = s -> next;
+			continue;
+		}
+		sprintf(buff, msg, s -> conn_desc -> ws_node ? thing_str : "",
+				(unsigned int)seq, data);
 		
-		queue_data = malloc(sizeof(ws_queue_item_t));
 		queue_data -> payload = (uint8_t *)buff;
 		queue_data -> len = strlen(buff);
 		queue_data -> opcode = WS_OP_TXT;
 		queue_data -> ws_frame = 0x1;
 		queue_data -> text = 0x1;
 		queue_data -> conn_desc = s -> conn_desc;
-		ws_send(queue_data, 1000);
+		if (ws_send(queue_data, 1000) < 0){
+			ws_payload_free(buff);
+			ws_item_free(queue_data);
+		}
 		s = s -> next;
 		res = 0;
 	}
@@ -824,31 +1425,191 @@ int8_t inform_all_subscribers_action(action_t *_a, char *data, int len){
  * 		e - event
  * 		data - data to be send (with curly bracket)
  * 		len - length of data
+ * 		seq - change sequence number
  *
  * ***************************************************************************/
-int8_t inform_all_subscribers_event(event_t *_e, char *data, int len){
+int8_t inform_all_subscribers_event(event_t *_e, char *data, int len, uint32_t seq){
 	int8_t res = -1;
 	char *buff;
-	char msg[] = "{\"messageType\":\"event\",\"data\":{%s}}";
+	char msg[] = "{\"messageType\":\"event\",%s\"seq\":%u,\"data\":{%s}}";
+	char thing_str[16];
 	subscriber_t *s;
 	ws_queue_item_t *queue_data;
 
+	sprintf(thing_str, "\"thing\":%i,", _e -> t -> thing_nr);
 	s = _e -> t -> subscribers;
 	while (s != NULL){
+		if (subscriber_event_on(s, _e) == false){
+			s = s -> next;
+			continue;
+		}
+		queue_data = ws_item_alloc();
+		if (queue_data == NULL){
+			s = s -> next;
+			continue;
+		}
 		//prepare message
-		buff = malloc(len + strlen(msg) + 1);
-		sprintf(buff, msg, data);
-		queue_data = malloc(sizeof(ws_queue_item_t));
+		buff = ws_payload_alloc(len + strlen(msg) + sizeof(thing_str) + 11);
+		if (buff == NULL){
+			ws_item_free(queue_data);
+			s = s -> next;
+			continue;
+		}
+		sprintf(buff, msg, s -> conn_desc -> ws_node ? thing_str : "",
+				(unsigned int)seq, data);
 		queue_data -> payload = (uint8_t *)buff;
 		queue_data -> len = strlen(buff);
 		queue_data -> opcode = WS_OP_TXT;
 		queue_data -> ws_frame = 0x1;
 		queue_data -> text = 0x1;
 		queue_data -> conn_desc = s -> conn_desc;
-		ws_send(queue_data, 1000);
+		if (ws_send(queue_data, 1000) < 0){
+			ws_payload_free(buff);
+			ws_item_free(queue_data);
+		}
 		s = s -> next;
 		res = 0;
 	}
 
 	return res;
 }
+
+
+/*****************************************************************************
+ *
+ * send to the new websocket client current values of all thing's
+ * properties (in one message) and recent events,
+ * node websocket gets it for every thing
+ *
+ * ***************************************************************************/
+int8_t send_thing_snapshot(connection_desc_t *conn_desc){
+	thing_t *t;
+
+	if (conn_desc -> ws_node == false){
+		return send_snapshot_of_thing(conn_desc, conn_desc -> thing);
+	}
+
+	t = root_node.things;
+	while (t != NULL){
+		send_snapshot_of_thing(conn_desc, t);
+		t = t -> next;
+	}
+
+	return 0;
+}
+
+
+/*****************************************************************************
+ *
+ * send snapshot of one thing
+ *
+ * ***************************************************************************/
+static int8_t send_snapshot_of_thing(connection_desc_t *conn_desc, thing_t *t){
+	char msg_event[] = "{\"messageType\":\"event\",%s\"seq\":%u,\"data\":{%s}}";
+	char thing_str[16];
+	char *values, *buff;
+	uint32_t seq;
+
+	if (t == NULL){
+		return -1;
+	}
+
+	thing_str[0] = 0;
+	if (conn_desc -> ws_node == true){
+		sprintf(thing_str, "\"thing\":%i,", t -> thing_nr);
+	}
+
+	//values are read after seq, so client can drop older messages
+	seq = change_log_seq();
+	if ((t -> prop_quant > 0) && (conn_desc -> ws_binary == true)){
+		//properties in binary messages, as many as fit in one frame
+		int bin_len, first = 0;
+		uint8_t *bin_msg;
+
+		while ((bin_msg = ws_bin_props_msg(t, seq, &first, &bin_len)) != NULL){
+			ws_queue_frame(conn_desc, bin_msg, bin_len, WS_OP_BIN);
+		}
+	}
+	else if (t -> prop_quant > 0){
+		send_snapshot_props(conn_desc, t, thing_str, seq);
+	}
+
+	event_t *e = t -> events;
+	event_item_t items[MAX_EVENTS];
+	while (e != NULL){
+		int n = get_event_items(e, items);
+		for (int i = 0; i < n; i++){
+			values = event_item_jsonize(e, &items[i]);
+			buff = ws_payload_alloc(strlen(msg_event) + strlen(thing_str) + strlen(values) + 10);
+			if (buff != NULL){
+				sprintf(buff, msg_event, thing_str, (unsigned int)items[i].seq, values);
+				ws_queue_text(conn_desc, buff);
+			}
+			req_free(values);
+		}
+		e = e -> next;
+	}
+
+	return 0;
+}
+
+
+/*****************************************************************************
+ *
+ * propertyStatus messages of the snapshot, properties are split into
+ * as many messages as needed to fit in websocket payload,
+ * property longer than payload is skipped
+ *
+ * ***************************************************************************/
+static void send_snapshot_props(connection_desc_t *conn_desc, thing_t *t, char *thing_str,
+								uint32_t seq){
+	char msg_head[] = "{\"messageType\":\"propertyStatus\",%s\"seq\":%u,\"data\":{";
+	char *buff = NULL, *value;
+	int len = 0, head_len = 0, value_len;
+
+	for (int i = 0; i < t -> prop_quant; i++){
+		value = property_value_jsonize(t -> properties[i]);
+		if (value == NULL){
+			continue;
+		}
+		//comma, "}}" and 0 are added to the value
+		value_len = strlen(value);
+		if ((buff != NULL) && (len > head_len) && (len + value_len + 4 > WS_PAYLOAD_LEN)){
+			//message is full, the rest goes in the next one
+			strcpy(buff + len, "}}");
+			ws_queue_text(conn_desc, buff);
+			buff = NULL;
+		}
+		if (buff == NULL){
+			buff = ws_payload_alloc(WS_PAYLOAD_LEN);
+			if (buff == NULL){
+				req_free(value);
+				return;
+			}
+			len = sprintf(buff, msg_head, thing_str, (unsigned int)seq);
+			head_len = len;
+		}
+		if (len + value_len + 4 > WS_PAYLOAD_LEN){
+			printf("snapshot: property %s not sent, too long\n",
+					t -> properties[i] -> desc -> id);
+		}
+		else{
+			if (len > head_len){
+				buff[len++] = ',';
+			}
+			memcpy(buff + len, value, value_len);
+			len += value_len;
+		}
+		req_free(value);
+	}
+
+	if (buff != NULL){
+		if (len > head_len){
+			strcpy(buff + len, "}}");
+			ws_queue_text(conn_desc, buff);
+		}
+		else{
+			ws_payload_free(buff);
+		}
+	}
+}
@@ -0,0 +1,388 @@
+/*
+ * alloc_check.c
+ *
+ *  Host test of STATIC_ALLOC steady state: after the "ready" point
+ *  receiving websocket messages (fragmented, compressed, control frames
+ *  between fragments) and taking payloads of answers from the pools must
+ *  not call malloc, calloc or realloc. Then the server (built with
+ *  STATIC_ALLOC, running on host port) serves whole websocket sessions:
+ *  handshake with snapshot, property change with notification, action
+ *  request run by the worker, ping and close. Calls are counted by
+ *  wrappers (linker option --wrap, test/Makefile), any call after ready
+ *  fails the test.
+ *
+ *  usage: alloc_check [iterations] [sessions]
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "simple_web_thing_server.h"
+#include "ws_decoder.h"
+#include "ws_deflate.h"
+#include "web_thing_pool.h"
+#include "ws_frame_gen.h"
+#include "host_port.h"
+#include "ws_client.h"
+
+#define MAX_LEN				4096	//WS_MAX_MESSAGE_LEN
+#define RX_STORAGE_LEN		(MAX_LEN + 1)
+#define SMALL_LEN			128		//as websocket.c
+#define SMALL_COUNT			(2 * MAX_OPEN_CONN)
+#define PAYLOAD_LEN			1024
+#define PAYLOAD_COUNT		8
+#define CHUNK_LEN			1460
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static bool ready = false;
+static uint32_t allocs = 0;		//heap allocations after ready
+
+//memory reserved at start, as with STATIC_ALLOC
+static uint8_t rx_storage[RX_STORAGE_LEN] __attribute__((aligned(4)));
+static uint8_t inflate_buff[MAX_LEN + 1];
+static uint8_t inflate_work[WS_INFLATE_WORK_LEN] __attribute__((aligned(sizeof(void *))));
+static uint8_t small_storage[SMALL_COUNT][SMALL_LEN] __attribute__((aligned(sizeof(void *))));
+static uint8_t payload_storage[PAYLOAD_COUNT][PAYLOAD_LEN] __attribute__((aligned(sizeof(void *))));
+static slab_pool_t small_pool, payload_pool;
+static ws_decoder_t dec;
+
+static uint8_t stream[4 * (MAX_LEN + 256)];
+static uint8_t text[MAX_LEN], packed[MAX_LEN];
+static uint32_t text_len;
+static uint32_t messages = 0, sent_messages = 0, controls = 0, errors = 0;
+
+//thing served in sessions
+static thing_t *thing;
+static at_type_t thing_type = {.at_type = "Light"};
+static int level = 0;
+static double duration_min = 1, duration_max = 600;
+static char msg[2048];
+static int16_t level_set(char *new_value);
+static const property_desc_t level_desc = {
+	.id = "level",
+	.title = "Level",
+	.type = VAL_INTEGER,
+	.min_value.int_val = 0,
+	.max_value.int_val = 100,
+	.read_only = false,
+	.set = level_set,
+};
+
+
+/*************************************************************************
+ *
+ * heap wrappers
+ *
+ * ***********************************************************************/
+void *__wrap_malloc(size_t size){
+
+	if (ready == true){
+		allocs++;
+	}
+	return __real_malloc(size);
+}
+
+
+void *__wrap_calloc(size_t n, size_t size){
+
+	if (ready == true){
+		allocs++;
+	}
+	return __real_calloc(n, size);
+}
+
+
+void *__wrap_realloc(void *ptr, size_t size){
+
+	if (ready == true){
+		allocs++;
+	}
+	return __real_realloc(ptr, size);
+}
+
+
+/*************************************************************************
+ *
+ * answer is queued as websocket server does it: payload from the pools
+ *
+ * ***********************************************************************/
+static void answer(uint32_t len){
+	void *p = NULL;
+
+	if (len <= SMALL_LEN){
+		p = slab_alloc(&small_pool);
+	}
+	if ((p == NULL) && (len <= PAYLOAD_LEN)){
+		p = slab_alloc(&payload_pool);
+	}
+	if (p == NULL){
+		errors++;
+		return;
+	}
+	memset(p, 'x', len);
+	if (slab_owns(&small_pool, p) == true){
+		slab_free(&small_pool, p);
+	}
+	else{
+		slab_free(&payload_pool, p);
+	}
+}
+
+
+static void control_cb(void *ctx, uint8_t opcode, uint8_t *data, uint8_t len){
+
+	controls++;
+	if (opcode == WS_OP_PIN){
+		answer(len); //pong
+	}
+}
+
+
+static void message_cb(void *ctx, uint8_t opcode, uint8_t rsv, uint8_t *msg, uint32_t len){
+
+	messages++;
+	if (rsv == WS_RSV1){
+		int plain_len = ws_inflate(msg, len, inflate_buff, MAX_LEN, inflate_work);
+
+		if ((plain_len != text_len) || (memcmp(inflate_buff, text, text_len) != 0)){
+			errors++;
+			return;
+		}
+		len = plain_len;
+	}
+	else if ((len != text_len) || (memcmp(msg, text, text_len) != 0)){
+		errors++;
+		return;
+	}
+	//notification after the change, as long as the message
+	answer(MIN(len, PAYLOAD_LEN));
+}
+
+
+static void error_cb(void *ctx, uint16_t code, const char *info){
+
+	printf("decoder error %u: %s\n", code, info);
+	errors++;
+}
+
+
+/*************************************************************************
+ *
+ * one round of client traffic: fragmented message with ping between
+ * fragments, compressed message, pong
+ *
+ * ***********************************************************************/
+static void client_round(uint32_t i){
+	uint32_t len = 0, part;
+	int packed_len;
+	uint8_t ping[8];
+
+	text_len = 1 + (i * 97) % 1200;
+	for (uint32_t k = 0; k < text_len; k++){
+		text[k] = 'a' + (k + i) % 26;
+	}
+	part = text_len / 3;
+	memset(ping, i, sizeof(ping));
+
+	len += ws_gen_frame(stream + len, 0, 0, WS_OP_TXT, true, false, text, part);
+	len += ws_gen_frame(stream + len, 1, 0, WS_OP_PIN, true, false, ping, sizeof(ping));
+	len += ws_gen_frame(stream + len, 0, 0, WS_OP_CON, true, false, text + part, part);
+	len += ws_gen_frame(stream + len, 1, 0, WS_OP_CON, true, false, text + 2 * part,
+						text_len - 2 * part);
+	sent_messages++;
+	packed_len = ws_deflate(text, text_len, packed, sizeof(packed), 15);
+	if (packed_len > 0){
+		len += ws_gen_frame(stream + len, 1, WS_RSV1, WS_OP_TXT, true, false, packed,
+							packed_len);
+		sent_messages++;
+	}
+	len += ws_gen_frame(stream + len, 1, 0, WS_OP_PON, true, false, ping, sizeof(ping));
+
+	for (uint32_t pos = 0; pos < len; pos += CHUNK_LEN){
+		ws_decode(&dec, stream + pos, MIN(len - pos, CHUNK_LEN));
+	}
+}
+
+
+/*************************************************************************
+ *
+ * thing of the server
+ *
+ * ***********************************************************************/
+static int16_t level_set(char *new_value){
+
+	level = atoi(new_value);
+	return 1;
+}
+
+
+static int8_t constant_on_run(action_inputs_t *inputs){
+
+	//done at once, the completion is sent by the worker
+	complete_action_request(thing -> thing_nr, "constant_on", inputs -> request_index,
+							ACT_COMPLETED);
+	return 0;
+}
+
+
+static void thing_create(void){
+	action_t *a;
+
+	thing = thing_init();
+	thing -> id = "Led";
+	thing -> at_context = things_context;
+	thing -> model_len = 1500;
+	set_thing_type(thing, &thing_type);
+	thing -> description = "alloc check";
+	add_property(thing, property_init(&level_desc, &level, xSemaphoreCreateMutex()));
+
+	a = action_init();
+	a -> id = "constant_on";
+	a -> title = "Constant ON";
+	a -> description = "Set led ON for some seconds";
+	a -> run_typed = constant_on_run;
+	add_action_input_prop(a, action_input_prop_init("duration", VAL_INTEGER, true,
+							&duration_min, &duration_max, "seconds"));
+	add_action(thing, a);
+	add_thing_to_server(thing);
+}
+
+
+/*************************************************************************
+ *
+ * one websocket session: handshake (snapshot is sent), property change
+ * and its notification, action request and its completion, ping, close
+ *
+ * ***********************************************************************/
+static void session(uint32_t i){
+	struct netconn *conn;
+	char text[160];
+	uint8_t ping[8], op;
+
+	conn = ws_client_open("/0", "");
+	if (conn == NULL){
+		errors++;
+		return;
+	}
+	if (ws_client_wait_for(conn, "\"level\"", msg, sizeof(msg)) < 0){
+		errors++;
+	}
+	snprintf(text, sizeof(text), "{\"messageType\":\"setProperty\","\
+			"\"data\":{\"level\":%u}}", (unsigned int)(i % 100));
+	ws_client_send_text(conn, text);
+	snprintf(text, sizeof(text), "\"level\":%u", (unsigned int)(i % 100));
+	if (ws_client_wait_for(conn, text, msg, sizeof(msg)) < 0){
+		errors++;
+	}
+	ws_client_send_text(conn, "{\"messageType\":\"requestAction\","\
+						"\"data\":{\"constant_on\":{\"input\":{\"duration\":5}}}}");
+	if (ws_client_wait_for(conn, "\"status\":\"completed\"", msg, sizeof(msg)) < 0){
+		errors++;
+	}
+	memset(ping, i, sizeof(ping));
+	ws_client_send(conn, WS_OP_PIN, ping, sizeof(ping));
+	ws_client_send(conn, WS_OP_CLS, "\x03\xE8", 2);
+	//close handshake: pong and close frame of the server
+	op = 0;
+	while ((op != WS_OP_CLS) &&
+			(ws_client_recv(conn, &op, msg, sizeof(msg), CLIENT_WAIT_MS) >= 0));
+	if (op != WS_OP_CLS){
+		errors++;
+	}
+	host_net_client_close(conn);
+	if (host_net_wait_closed(conn, CLIENT_WAIT_MS) == false){
+		errors++;
+	}
+	host_net_release(conn);
+	messages++;
+}
+
+
+int main(int argc, char *argv[]){
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+	uint32_t sessions = (argc > 2) ? strtoul(argv[2], NULL, 0) : 100;
+	uint32_t len;
+	ws_decoder_t heap_dec;
+
+	//start: everything is reserved
+	slab_pool_init(&small_pool, "ws_small", small_storage, SMALL_LEN, SMALL_COUNT);
+	slab_pool_init(&payload_pool, "ws_payloads", payload_storage, PAYLOAD_LEN, PAYLOAD_COUNT);
+	ws_decoder_init(&dec, MAX_LEN, true, NULL, control_cb, message_cb, error_cb);
+	ws_decoder_set_buffer(&dec, rx_storage, sizeof(rx_storage));
+	test_srand(1);
+	printf("alloc_check: ready\n"); //stdout buffer is allocated before ready
+
+	ready = true;
+	for (uint32_t i = 0; i < iterations; i++){
+		client_round(i);
+	}
+	ready = false;
+	ws_decoder_release(&dec);
+
+	printf("alloc_check: %u rounds, %u messages, %u control frames, %u errors, "\
+			"%u heap allocations after ready\n",
+			iterations, messages, controls, errors, allocs);
+
+	if ((errors > 0) || (messages != sent_messages)){
+		printf("FAIL: decoding errors\n");
+		return 1;
+	}
+	if (allocs > 0){
+		printf("FAIL: heap used after ready\n");
+		return 1;
+	}
+
+	//server: things and tasks are created at start, the first session
+	//takes lazily allocated memory of C library (time zone, stdio)
+	root_node_init();
+	thing_create();
+	start_web_thing_server(8080, "test", "local");
+	session(0);
+	messages = errors = 0;
+	printf("alloc_check: server ready\n");
+
+	ready = true;
+	for (uint32_t i = 1; i <= sessions; i++){
+		session(i);
+	}
+	ready = false;
+
+	printf("alloc_check: %u websocket sessions, %u errors, %u heap allocations "\
+			"after ready\n", messages, errors, allocs);
+	if ((errors > 0) || (messages != sessions)){
+		printf("FAIL: sessions not served\n");
+		return 1;
+	}
+	if (allocs > 0){
+		printf("FAIL: heap used by server after ready\n");
+		return 1;
+	}
+
+	//the check works: decoder with heap buffer allocates
+	ws_decoder_init(&heap_dec, MAX_LEN, false, NULL, control_cb, message_cb, error_cb);
+	text_len = 10;
+	memset(text, 'h', text_len);
+	len = ws_gen_frame(stream, 1, 0, WS_OP_TXT, true, false, text, text_len);
+	ready = true;
+	ws_decode(&heap_dec, stream, len);
+	ready = false;
+	ws_decoder_release(&heap_dec);
+	if (allocs == 0){
+		printf("FAIL: allocation of heap decoder not counted\n");
+		return 1;
+	}
+
+	return 0;
+}
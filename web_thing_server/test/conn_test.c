@@ -0,0 +1,156 @@
+/*
+ * conn_test.c
+ *
+ *  Host test of connection slots: a new client takes the slot of idle
+ *  keep-alive connection (served by the worker of evicted connection,
+ *  server task doesn't wait), a client which doesn't read its 503 answer
+ *  doesn't stop the server task accepting the next clients
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "simple_web_thing_server.h"
+#include "host_port.h"
+#include "ws_client.h"
+
+#define HEAD_LEN		1024
+#define REJECT_WAIT_MS	1000	//503 answers of two clients, one doesn't read
+
+static thing_t *thing;
+static at_type_t thing_type = {.at_type = "Light"};
+static bool led_on = false;
+static const property_desc_t led_on_desc = {
+	.id = "led_on",
+	.title = "ON/OFF",
+	.type = VAL_BOOLEAN,
+	.read_only = true,
+};
+static int failures = 0;
+static char head[HEAD_LEN];
+static char body[4096];
+static struct netconn *clients[MAX_OPEN_CONN];
+
+
+static void check(bool ok, const char *what){
+
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (ok == false){
+		failures++;
+	}
+}
+
+
+//keep-alive request, true if the answer is 200 OK (body is read)
+static bool http_get(struct netconn *conn){
+	char *p;
+	int len;
+	const char *rq = "GET /0 HTTP/1.1\r\nHost: test\r\nConnection: keep-alive\r\n\r\n";
+
+	host_net_send(conn, rq, strlen(rq));
+	if (client_read_head(conn, head, HEAD_LEN) < 0){
+		return false;
+	}
+	p = strstr(head, "Content-Length:");
+	len = (p != NULL) ? atoi(p + 15) : 0;
+	if ((len > 0) && (host_net_read(conn, body, len, CLIENT_WAIT_MS) <= 0)){
+		return false;
+	}
+	return (strstr(head, "200 OK") != NULL);
+}
+
+
+static void client_close(struct netconn *conn){
+
+	host_net_client_close(conn);
+	host_net_wait_closed(conn, CLIENT_WAIT_MS);
+	host_net_release(conn);
+}
+
+
+static void thing_create(void){
+
+	thing = thing_init();
+	thing -> id = "Led";
+	thing -> at_context = things_context;
+	thing -> model_len = 1500;
+	set_thing_type(thing, &thing_type);
+	thing -> description = "test thing";
+	add_property(thing, property_init(&led_on_desc, &led_on, xSemaphoreCreateMutex()));
+	add_thing_to_server(thing);
+}
+
+
+int main(void){
+	struct netconn *conn, *stalled;
+	TickType_t start;
+	bool ok;
+
+	root_node_init();
+	thing_create();
+	start_web_thing_server(8080, "test", "local");
+
+	//all slots taken by idle keep-alive connections, the first
+	//one is the least recently active
+	ok = true;
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+		clients[i] = host_net_connect(CLIENT_WAIT_MS);
+		ok = ok && (clients[i] != NULL) && http_get(clients[i]);
+		vTaskDelay(pdMS_TO_TICKS(10));
+	}
+	check(ok, "all slots used by keep-alive connections");
+
+	//two new clients evict two different connections
+	conn = host_net_connect(CLIENT_WAIT_MS);
+	check(http_get(conn), "new client served in slot of idle connection");
+	check(host_net_wait_closed(clients[0], CLIENT_WAIT_MS), "the oldest idle connection evicted");
+	client_close(clients[0]);
+	clients[0] = conn;
+	check(http_get(clients[1]), "other idle connections kept");
+
+	conn = host_net_connect(CLIENT_WAIT_MS);
+	check(http_get(conn), "the second new client served");
+	check(host_net_wait_closed(clients[2], CLIENT_WAIT_MS), "the next least recently active evicted");
+	check(http_get(clients[1]), "recently active connection kept");
+	client_close(clients[2]);
+	clients[2] = conn;
+
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+		client_close(clients[i]);
+	}
+
+	//websockets are never evicted, new clients get 503
+	ok = true;
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+		clients[i] = ws_client_open("/0", "");
+		ok = ok && (clients[i] != NULL);
+	}
+	check(ok, "all slots used by websockets");
+
+	start = xTaskGetTickCount();
+	stalled = host_net_connect_stalled(CLIENT_WAIT_MS);
+	conn = host_net_connect(CLIENT_WAIT_MS);
+	check((client_read_head(conn, head, HEAD_LEN) > 0) &&
+			(strstr(head, "503 Service Unavailable") != NULL),
+			"client rejected with 503");
+	check((xTaskGetTickCount() - start) < pdMS_TO_TICKS(REJECT_WAIT_MS),
+			"client which doesn't read doesn't hold server task");
+	check(host_net_wait_closed(stalled, CLIENT_WAIT_MS), "not reading client closed");
+	host_net_release(stalled);
+	host_net_release(conn);
+
+	if (failures > 0){
+		printf("conn_test: %i FAILED\n", failures);
+		return 1;
+	}
+	printf("conn_test: all passed\n");
+	return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * event_log_test.c
+ *
+ *  Host test of the persistent event log on the partition in a file:
+ *  every boot is a child process, records are appended, the log wraps,
+ *  GET /N/events?log_seq=&from= returns the right records and the log
+ *  is recovered after power cut in the middle of a write (at the start
+ *  of a sector and inside of it)
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_partition.h"
+
+#include "simple_web_thing_server.h"
+#include "web_thing_event_log.h"
+#include "host_port.h"
+#include "ws_client.h"
+
+#define LOG_FILE		"event_log_test.bin"
+#define LOG_SECTORS		3
+#define LOG_RECS		(SPI_FLASH_SEC_SIZE / sizeof(event_log_rec_t))	//in one sector
+#define BATCH			8		//events emitted at once, one write of the log
+#define RESP_LEN		(64*1024)
+#define MAX_RECS		(LOG_SECTORS * LOG_RECS)
+
+static thing_t *thing;
+static event_t *overheated;
+static at_type_t thing_type = {.at_type = "TemperatureSensor"};
+static int failures = 0;
+static int next_value = 1;		//value of the event is its expected log_seq
+static char resp[RESP_LEN];
+static uint32_t seqs[MAX_RECS];
+static int recs_nr;
+
+
+static void check(bool ok, const char *what){
+
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (ok == false){
+		failures++;
+	}
+}
+
+
+static void thing_create(void){
+
+	thing = thing_init();
+	thing -> id = "Sensor";
+	thing -> at_context = things_context;
+	thing -> model_len = 1500;
+	set_thing_type(thing, &thing_type);
+	thing -> description = "test thing";
+
+	overheated = event_init();
+	overheated -> id = "overheated";
+	overheated -> title = "Overheated";
+	overheated -> type = VAL_INTEGER;
+	add_event(thing, overheated);
+	add_thing_to_server(thing);
+}
+
+
+//one boot of the device, the log continues in the file
+static void boot(int value){
+
+	host_flash_open(EVENT_LOG_PARTITION, LOG_FILE, LOG_SECTORS * SPI_FLASH_SEC_SIZE);
+	root_node_init();
+	thing_create();
+	start_web_thing_server(8080, "test", "local");
+	next_value = value;
+}
+
+
+//emit events in batches, every batch is written at once
+static void emit(int n){
+
+	for (int i = 0; i < n; i++){
+		emit_event(thing -> thing_nr, "overheated", &next_value);
+		next_value++;
+		if (i % BATCH == BATCH - 1){
+			vTaskDelay(pdMS_TO_TICKS(10));
+		}
+	}
+	vTaskDelay(pdMS_TO_TICKS(50));
+}
+
+
+/****************************************************************
+ *
+ * GET logged events, seqs[] gets log_seq of the records in the
+ * response
+ * output: false - no complete response or data of a record is not
+ * its log_seq
+ *
+ * **************************************************************/
+static bool get_log(const char *query){
+	struct netconn *conn;
+	char rq[128];
+	int len = 0, n;
+	char *p;
+	bool ok = true;
+
+	recs_nr = 0;
+	conn = host_net_connect(CLIENT_WAIT_MS);
+	if (conn == NULL){
+		return false;
+	}
+	sprintf(rq, "GET /0/events?%s HTTP/1.1\r\nHost: test\r\n\r\n", query);
+	host_net_send(conn, rq, strlen(rq));
+	do{
+		n = host_net_read(conn, resp + len, RESP_LEN - 1 - len, CLIENT_WAIT_MS);
+		len += n;
+		resp[len] = 0;
+	}while ((n > 0) && (strstr(resp, "\r\n0\r\n\r\n") == NULL));
+	host_net_client_close(conn);
+	host_net_wait_closed(conn, CLIENT_WAIT_MS);
+	host_net_release(conn);
+
+	if ((strstr(resp, "200 OK") == NULL) || (strstr(resp, "\r\n0\r\n\r\n") == NULL)){
+		return false;
+	}
+	//records are not split between chunks
+	p = resp;
+	while ((p = strstr(p, "\"data\":")) != NULL){
+		uint32_t data = strtoul(p + 7, NULL, 10);
+
+		p = strstr(p, "\"log_seq\":");
+		if ((p == NULL) || (recs_nr == MAX_RECS)){
+			return false;
+		}
+		seqs[recs_nr] = strtoul(p + 10, NULL, 10);
+		ok = ok && (seqs[recs_nr] == data);
+		recs_nr++;
+	}
+
+	return ok;
+}
+
+
+//records first..last in order
+static bool log_is(uint32_t first, uint32_t last){
+
+	if (recs_nr != last - first + 1){
+		printf("      %i records, expected %u..%u\n", recs_nr, first, last);
+		return false;
+	}
+	for (int i = 0; i < recs_nr; i++){
+		if (seqs[i] != first + i){
+			printf("      record %i: log_seq %u, expected %u\n", i, seqs[i], first + i);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+/****************************************************************
+ *
+ * boots of the device
+ *
+ * **************************************************************/
+//the first boot with erased partition
+static void boot_new(void){
+	char query[64];
+	time_t t1;
+
+	boot(1);
+	emit(BATCH);
+	vTaskDelay(pdMS_TO_TICKS(1100));
+	t1 = time(NULL);
+	emit(BATCH);
+
+	check(get_log("log_seq=0") && log_is(1, 16), "records appended");
+	check(get_log("log_seq=10") && log_is(11, 16), "records after log_seq");
+	sprintf(query, "from=%u", (unsigned int)t1);
+	check(get_log(query) && log_is(9, 16), "records from time");
+	sprintf(query, "from=%u", (unsigned int)t1 + 3600);
+	check(get_log(query) && (recs_nr == 0), "no records from future");
+}
+
+
+//seq continues after reboot, the log wraps: the first sector is
+//written again, sector 1 is the oldest one
+static void boot_wrap(void){
+
+	boot(17);
+	check(get_log("log_seq=0") && log_is(1, 16), "records kept after reboot");
+	emit(MAX_RECS + LOG_RECS - 16);		//the head at the start of sector 1
+	check(get_log("log_seq=0") && log_is(LOG_RECS + 1, MAX_RECS + LOG_RECS),
+			"the oldest sector overwritten");
+	check(get_log("log_seq=400") && log_is(401, MAX_RECS + LOG_RECS),
+			"records after log_seq in wrapped log");
+	check(event_log_dropped() == 0, "no records dropped");
+	if (failures > 0){
+		return;
+	}
+
+	//power cut in the first record of erased sector
+	host_flash_power_cut(10);
+	emit(BATCH);
+}
+
+
+//sector with torn record only, then power cut inside of a sector
+static void boot_torn_sector(void){
+	uint32_t last = MAX_RECS + LOG_RECS;
+
+	boot(last + 1);
+	check(get_log("log_seq=0") && log_is(2 * LOG_RECS + 1, last),
+			"torn sector skipped after power cut");
+	emit(BATCH);
+	check(get_log("log_seq=0") && log_is(2 * LOG_RECS + 1, last + BATCH),
+			"torn sector erased by the next write");
+	if (failures > 0){
+		return;
+	}
+
+	//3 records written, the 4th one torn
+	host_flash_power_cut(3 * sizeof(event_log_rec_t) + 10);
+	emit(BATCH);
+}
+
+
+//the torn record is not used, seq continues after the last valid one
+static void boot_torn_record(void){
+	uint32_t last = MAX_RECS + LOG_RECS + BATCH + 3;
+	char query[64];
+
+	boot(last + 1);
+	sprintf(query, "log_seq=%u", last - 11);
+	check(get_log(query) && log_is(last - 10, last), "torn record skipped after power cut");
+	emit(BATCH);
+	check(get_log(query) && log_is(last - 10, last + BATCH), "seq continues after torn record");
+}
+
+
+//run one boot in a child process, output: its exit status
+static int run(void (*boot_fun)(void)){
+	int status;
+	pid_t pid;
+
+	fflush(stdout);
+	pid = fork();
+	if (pid == 0){
+		failures = 0;
+		boot_fun();
+		fflush(stdout);
+		_exit((failures > 0) ? 1 : 0);
+	}
+	waitpid(pid, &status, 0);
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+
+int main(void){
+	int res[4];
+
+	//boots stopped by power cut don't flush their output
+	setvbuf(stdout, NULL, _IOLBF, 0);
+	unlink(LOG_FILE);
+	res[0] = run(boot_new);
+	res[1] = run(boot_wrap);
+	res[2] = run(boot_torn_sector);
+	res[3] = run(boot_torn_record);
+	unlink(LOG_FILE);
+
+	check(res[0] == 0, "boot with new partition");
+	check(res[1] == HOST_POWER_CUT_EXIT, "boot with log wrap, stopped by power cut");
+	check(res[2] == HOST_POWER_CUT_EXIT, "boot after torn sector, stopped by power cut");
+	check(res[3] == 0, "boot after torn record");
+
+	if (failures > 0){
+		printf("event_log_test: %i FAILED\n", failures);
+		return 1;
+	}
+	printf("event_log_test: all passed\n");
+	return 0;
+}
@@ -0,0 +1,1149 @@
+/*
+ * host_port.c
+ *
+ *  Host tests: FreeRTOS, lwIP netconn, flash partition, mbedtls and
+ *  esp_timer functions used by the server, implemented on POSIX threads
+ *  and files, so the server sources run unchanged on the host
+ *
+ *  - tasks are detached threads, ticks are milliseconds
+ *  - queues, semaphores and mutexes are FreeRTOS queues on one lock
+ *  - critical sections of all spinlocks are one recursive lock
+ *  - connections are in memory, the test is the client (host_port.h)
+ *  - partition is a file, writing clears bits only (NOR flash), power
+ *    can be cut in the middle of a write
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/param.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "lwip/api.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "mbedtls/sha1.h"
+#include "mbedtls/base64.h"
+
+#include "host_port.h"
+
+#define HOST_NET_CONNS		(2 * 10 + 4)	//MAX_OPEN_CONN clients, rejected ones, listener
+#define HOST_NETBUFS		64
+#define HOST_OUT_LEN		(64 * 1024)		//data written by server, not read by client
+#define HOST_BACKLOG		8
+
+struct netbuf{
+	struct netbuf *next;
+	bool used;
+	uint16_t len;
+	uint8_t data[HOST_SEGMENT_LEN];
+};
+
+struct netconn{
+	bool used;
+	bool listener;
+	bool accepted;			//given to the server by netconn_accept
+	bool deleted;			//netconn_delete called by server
+	bool released;			//the test doesn't use it any more
+	bool closed;			//netconn_close called by server
+	bool rx_shut;			//receiving shut down by server
+	bool fin;				//closed by client
+	bool stall;				//client doesn't read, writing waits
+	int recv_timeout;		//ms, 0 - no timeout
+	int send_timeout;
+	struct netbuf *rx_head, *rx_tail;
+	struct netconn *backlog[HOST_BACKLOG];
+	int backlog_len;
+	uint32_t out_len;
+	uint8_t out[HOST_OUT_LEN];
+};
+
+static __thread StaticTask_t *current_task = NULL;
+static StaticTask_t main_task = {.name = "main"};
+static pthread_mutex_t crit_lock;
+static struct timespec start_time;
+
+static pthread_mutex_t net_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t net_cond;
+static struct netconn conns[HOST_NET_CONNS];
+static struct netbuf netbufs[HOST_NETBUFS];
+
+static int flash_fd = -1;
+static int32_t flash_cut = -1;
+static esp_partition_t flash_part = {
+	.type = ESP_PARTITION_TYPE_DATA,
+	.subtype = ESP_PARTITION_SUBTYPE_ANY
+};
+
+
+/****************************************************************
+ *
+ * time and locks
+ *
+ * **************************************************************/
+__attribute__((constructor)) static void host_port_init(void){
+	pthread_condattr_t attr;
+	pthread_mutexattr_t mattr;
+
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	pthread_mutexattr_init(&mattr);
+	pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&crit_lock, &mattr);
+	pthread_mutexattr_destroy(&mattr);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&net_cond, &attr);
+	pthread_condattr_destroy(&attr);
+}
+
+
+static uint64_t now_us(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)(ts.tv_sec - start_time.tv_sec) * 1000000 +
+			(ts.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+
+//absolute time for pthread_cond_timedwait
+static struct timespec deadline(uint32_t ms){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec += ms / 1000;
+	ts.tv_nsec += (ms % 1000) * 1000000L;
+	if (ts.tv_nsec >= 1000000000L){
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	return ts;
+}
+
+
+//wait for condition change, false - time is over
+static bool cond_wait(pthread_cond_t *cond, pthread_mutex_t *lock, TickType_t wait,
+						struct timespec *end){
+
+	if (wait == portMAX_DELAY){
+		pthread_cond_wait(cond, lock);
+		return true;
+	}
+	return (pthread_cond_timedwait(cond, lock, end) != ETIMEDOUT);
+}
+
+
+int64_t esp_timer_get_time(void){
+
+	return now_us();
+}
+
+
+TickType_t xTaskGetTickCount(void){
+
+	return (TickType_t)(now_us() / 1000 / portTICK_PERIOD_MS);
+}
+
+
+uint32_t esp_get_free_heap_size(void){
+
+	return 100000;
+}
+
+
+uint32_t esp_get_minimum_free_heap_size(void){
+
+	return 100000;
+}
+
+
+/****************************************************************
+ *
+ * tasks
+ *
+ * **************************************************************/
+static void *task_thread(void *arg){
+	StaticTask_t *t = arg;
+
+	current_task = t;
+	t -> fun(t -> arg);
+	return NULL;
+}
+
+
+static bool task_start(StaticTask_t *t, TaskFunction_t fun, const char *name, void *arg){
+	pthread_attr_t attr;
+	bool ok;
+
+	t -> fun = fun;
+	t -> arg = arg;
+	t -> name = name;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	ok = (pthread_create(&t -> thread, &attr, task_thread, t) == 0);
+	pthread_attr_destroy(&attr);
+
+	return ok;
+}
+
+
+BaseType_t xTaskCreate(TaskFunction_t fun, const char *name, uint32_t stack_depth,
+						void *arg, UBaseType_t priority, TaskHandle_t *handle){
+	StaticTask_t *t = calloc(1, sizeof(StaticTask_t));
+
+	if ((t == NULL) || (task_start(t, fun, name, arg) == false)){
+		free(t);
+		return pdFAIL;
+	}
+	if (handle != NULL){
+		*handle = t;
+	}
+	return pdPASS;
+}
+
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fun, const char *name, uint32_t stack_depth,
+						void *arg, UBaseType_t priority, StackType_t *stack,
+						StaticTask_t *tcb){
+
+	memset(tcb, 0, sizeof(StaticTask_t));
+	tcb -> is_static = true;
+	if (task_start(tcb, fun, name, arg) == false){
+		return NULL;
+	}
+	return tcb;
+}
+
+
+void vTaskDelete(TaskHandle_t task){
+
+	if ((task == NULL) || (task == current_task)){
+		pthread_exit(NULL);
+	}
+	fprintf(stderr, "host port: vTaskDelete of other task is not supported\n");
+	abort();
+}
+
+
+void vTaskDelay(TickType_t ticks){
+	struct timespec ts;
+
+	if (ticks == 0){
+		sched_yield();
+		return;
+	}
+	ts.tv_sec = ticks * portTICK_PERIOD_MS / 1000;
+	ts.tv_nsec = (ticks * portTICK_PERIOD_MS % 1000) * 1000000L;
+	while (nanosleep(&ts, &ts) != 0);
+}
+
+
+void vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment){
+	int32_t left;
+
+	*prev_wake += increment;
+	left = (int32_t)(*prev_wake - xTaskGetTickCount());
+	if (left > 0){
+		vTaskDelay(left);
+	}
+}
+
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void){
+
+	return (current_task != NULL) ? current_task : &main_task;
+}
+
+
+/****************************************************************
+ *
+ * critical sections
+ *
+ * **************************************************************/
+void vPortEnterCritical(portMUX_TYPE *mux){
+
+	pthread_mutex_lock(&crit_lock);
+}
+
+
+void vPortExitCritical(portMUX_TYPE *mux){
+
+	pthread_mutex_unlock(&crit_lock);
+}
+
+
+/****************************************************************
+ *
+ * queues, semaphores (item_size = 0) and mutexes
+ *
+ * **************************************************************/
+static void queue_init(StaticQueue_t *q, UBaseType_t len, UBaseType_t item_size,
+						uint8_t *storage, UBaseType_t count){
+	pthread_condattr_t attr;
+
+	memset(q, 0, sizeof(StaticQueue_t));
+	pthread_mutex_init(&q -> lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&q -> cond, &attr);
+	pthread_condattr_destroy(&attr);
+	q -> len = len;
+	q -> item_size = item_size;
+	q -> storage = storage;
+	q -> count = count;
+}
+
+
+static QueueHandle_t queue_new(UBaseType_t len, UBaseType_t item_size, UBaseType_t count){
+	StaticQueue_t *q = malloc(sizeof(StaticQueue_t));
+	uint8_t *storage = NULL;
+
+	if ((q != NULL) && (item_size > 0)){
+		storage = malloc(len * item_size);
+		if (storage == NULL){
+			free(q);
+			return NULL;
+		}
+	}
+	if (q != NULL){
+		queue_init(q, len, item_size, storage, count);
+	}
+	return q;
+}
+
+
+static BaseType_t queue_put(QueueHandle_t q, const void *item, TickType_t wait, bool front){
+	struct timespec end = deadline(wait);
+	BaseType_t res = pdTRUE;
+
+	pthread_mutex_lock(&q -> lock);
+	while (q -> count == q -> len){
+		if ((wait == 0) || (cond_wait(&q -> cond, &q -> lock, wait, &end) == false)){
+			res = pdFALSE;
+			break;
+		}
+	}
+	if (res == pdTRUE){
+		if ((q -> item_size > 0) && (item != NULL)){
+			UBaseType_t pos;
+
+			if (front == true){
+				q -> head = (q -> head + q -> len - 1) % q -> len;
+				pos = q -> head;
+			}
+			else{
+				pos = (q -> head + q -> count) % q -> len;
+			}
+			memcpy(q -> storage + pos * q -> item_size, item, q -> item_size);
+		}
+		q -> count++;
+		pthread_cond_broadcast(&q -> cond);
+	}
+	pthread_mutex_unlock(&q -> lock);
+
+	return res;
+}
+
+
+static BaseType_t queue_get(QueueHandle_t q, void *item, TickType_t wait){
+	struct timespec end = deadline(wait);
+	BaseType_t res = pdTRUE;
+
+	pthread_mutex_lock(&q -> lock);
+	while (q -> count == 0){
+		if ((wait == 0) || (cond_wait(&q -> cond, &q -> lock, wait, &end) == false)){
+			res = pdFALSE;
+			break;
+		}
+	}
+	if (res == pdTRUE){
+		if ((q -> item_size > 0) && (item != NULL)){
+			memcpy(item, q -> storage + q -> head * q -> item_size, q -> item_size);
+			q -> head = (q -> head + 1) % q -> len;
+		}
+		q -> count--;
+		pthread_cond_broadcast(&q -> cond);
+	}
+	pthread_mutex_unlock(&q -> lock);
+
+	return res;
+}
+
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size){
+
+	return queue_new(len, item_size, 0);
+}
+
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t len, UBaseType_t item_size, uint8_t *storage,
+								StaticQueue_t *buff){
+
+	queue_init(buff, len, item_size, storage, 0);
+	buff -> is_static = true;
+	return buff;
+}
+
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait){
+
+	return queue_put(q, item, wait, false);
+}
+
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t wait){
+
+	return queue_put(q, item, wait, true);
+}
+
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait){
+
+	return queue_get(q, item, wait);
+}
+
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q){
+	UBaseType_t count;
+
+	pthread_mutex_lock(&q -> lock);
+	count = q -> count;
+	pthread_mutex_unlock(&q -> lock);
+
+	return count;
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void){
+
+	return queue_new(1, 0, 1);
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buff){
+
+	queue_init(buff, 1, 0, NULL, 1);
+	buff -> is_static = true;
+	return buff;
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void){
+
+	return queue_new(1, 0, 1);
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t *buff){
+
+	return xSemaphoreCreateMutexStatic(buff);
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void){
+
+	return queue_new(1, 0, 0);
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buff){
+
+	queue_init(buff, 1, 0, NULL, 0);
+	buff -> is_static = true;
+	return buff;
+}
+
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait){
+
+	if (queue_get(s, NULL, wait) != pdTRUE){
+		return pdFALSE;
+	}
+	s -> holder = xTaskGetCurrentTaskHandle();
+	return pdTRUE;
+}
+
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s){
+
+	s -> holder = NULL;
+	return queue_put(s, NULL, 0, false);
+}
+
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t s, BaseType_t *woken){
+
+	if (woken != NULL){
+		*woken = pdFALSE;
+	}
+	return xSemaphoreGive(s);
+}
+
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t wait){
+
+	//only the holder reads its own handle here
+	if (s -> holder == xTaskGetCurrentTaskHandle()){
+		s -> depth++;
+		return pdTRUE;
+	}
+	if (xSemaphoreTake(s, wait) != pdTRUE){
+		return pdFALSE;
+	}
+	s -> depth = 1;
+	return pdTRUE;
+}
+
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s){
+
+	if (s -> holder != xTaskGetCurrentTaskHandle()){
+		return pdFALSE;
+	}
+	if (--s -> depth > 0){
+		return pdTRUE;
+	}
+	return xSemaphoreGive(s);
+}
+
+
+/****************************************************************
+ *
+ * netconn, server side
+ *
+ * **************************************************************/
+static struct netconn *conn_take(void){
+
+	for (int i = 0; i < HOST_NET_CONNS; i++){
+		if (conns[i].used == false){
+			struct netconn *c = &conns[i];
+
+			memset(c, 0, offsetof(struct netconn, out));
+			c -> used = true;
+			return c;
+		}
+	}
+	fprintf(stderr, "host port: no free connection\n");
+	abort();
+}
+
+
+//netconn_lock must be taken
+static void conn_put(struct netconn *c){
+	struct netbuf *b = c -> rx_head;
+
+	while (b != NULL){
+		struct netbuf *next = b -> next;
+
+		b -> used = false;
+		b = next;
+	}
+	c -> used = false;
+}
+
+
+static struct netbuf *netbuf_take(void){
+
+	for (int i = 0; i < HOST_NETBUFS; i++){
+		if (netbufs[i].used == false){
+			netbufs[i].used = true;
+			netbufs[i].next = NULL;
+			return &netbufs[i];
+		}
+	}
+	fprintf(stderr, "host port: no free netbuf\n");
+	abort();
+}
+
+
+struct netconn *netconn_new(int type){
+	struct netconn *c;
+
+	pthread_mutex_lock(&net_lock);
+	c = conn_take();
+	c -> accepted = true;
+	c -> released = true;
+	pthread_mutex_unlock(&net_lock);
+
+	return c;
+}
+
+
+err_t netconn_bind(struct netconn *conn, const ip_addr_t *addr, uint16_t port){
+
+	return ERR_OK;
+}
+
+
+err_t netconn_listen(struct netconn *conn){
+
+	pthread_mutex_lock(&net_lock);
+	conn -> listener = true;
+	pthread_cond_broadcast(&net_cond);
+	pthread_mutex_unlock(&net_lock);
+
+	return ERR_OK;
+}
+
+
+err_t netconn_accept(struct netconn *conn, struct netconn **new_conn){
+
+	pthread_mutex_lock(&net_lock);
+	while (conn -> backlog_len == 0){
+		pthread_cond_wait(&net_cond, &net_lock);
+	}
+	*new_conn = conn -> backlog[0];
+	conn -> backlog_len--;
+	memmove(conn -> backlog, conn -> backlog + 1, conn -> backlog_len * sizeof(void *));
+	(*new_conn) -> accepted = true;
+	pthread_mutex_unlock(&net_lock);
+
+	return ERR_OK;
+}
+
+
+err_t netconn_recv(struct netconn *conn, struct netbuf **buf){
+	struct timespec end = deadline(conn -> recv_timeout);
+	TickType_t wait = (conn -> recv_timeout > 0) ? conn -> recv_timeout : portMAX_DELAY;
+	err_t err = ERR_OK;
+
+	*buf = NULL;
+	pthread_mutex_lock(&net_lock);
+	while ((conn -> rx_head == NULL) && (conn -> rx_shut == false) && (conn -> fin == false)){
+		if (cond_wait(&net_cond, &net_lock, wait, &end) == false){
+			err = ERR_TIMEOUT;
+			break;
+		}
+	}
+	if (err == ERR_OK){
+		if (conn -> rx_shut == true){
+			err = ERR_CLSD;
+		}
+		else if (conn -> rx_head != NULL){
+			*buf = conn -> rx_head;
+			conn -> rx_head = (*buf) -> next;
+			if (conn -> rx_head == NULL){
+				conn -> rx_tail = NULL;
+			}
+			(*buf) -> next = NULL;
+		}
+		else{
+			err = ERR_CLSD;
+		}
+	}
+	pthread_mutex_unlock(&net_lock);
+
+	return err;
+}
+
+
+err_t netconn_write(struct netconn *conn, const void *data, size_t len, uint8_t flags){
+	struct timespec end = deadline(conn -> send_timeout);
+	TickType_t wait = (conn -> send_timeout > 0) ? conn -> send_timeout : portMAX_DELAY;
+	err_t err = ERR_OK;
+
+	pthread_mutex_lock(&net_lock);
+	while ((conn -> stall == true) && (conn -> closed == false)){
+		if (cond_wait(&net_cond, &net_lock, wait, &end) == false){
+			err = ERR_WOULDBLOCK;
+			break;
+		}
+	}
+	if (err == ERR_OK){
+		if ((conn -> closed == true) || (conn -> fin == true)){
+			err = ERR_CLSD;
+		}
+		else if (conn -> out_len + len > HOST_OUT_LEN){
+			err = ERR_MEM;
+		}
+		else{
+			memcpy(conn -> out + conn -> out_len, data, len);
+			conn -> out_len += len;
+			pthread_cond_broadcast(&net_cond);
+		}
+	}
+	pthread_mutex_unlock(&net_lock);
+
+	return err;
+}
+
+
+err_t netconn_close(struct netconn *conn){
+
+	pthread_mutex_lock(&net_lock);
+	conn -> closed = true;
+	conn -> rx_shut = true;
+	pthread_cond_broadcast(&net_cond);
+	pthread_mutex_unlock(&net_lock);
+
+	return ERR_OK;
+}
+
+
+err_t netconn_delete(struct netconn *conn){
+
+	pthread_mutex_lock(&net_lock);
+	conn -> closed = true;
+	conn -> rx_shut = true;
+	conn -> deleted = true;
+	if (conn -> released == true){
+		conn_put(conn);
+	}
+	pthread_cond_broadcast(&net_cond);
+	pthread_mutex_unlock(&net_lock);
+
+	return ERR_OK;
+}
+
+
+err_t netconn_shutdown(struct netconn *conn, uint8_t shut_rx, uint8_t shut_tx){
+
+	pthread_mutex_lock(&net_lock);
+	if (shut_rx != 0){
+		conn -> rx_shut = true;
+	}
+	pthread_cond_broadcast(&net_cond);
+	pthread_mutex_unlock(&net_lock);
+
+	return ERR_OK;
+}
+
+
+void netconn_set_recvtimeout(struct netconn *conn, int timeout){
+
+	conn -> recv_timeout = timeout;
+}
+
+
+void netconn_set_sendtimeout(struct netconn *conn, int timeout){
+
+	conn -> send_timeout = timeout;
+}
+
+
+/****************************************************************
+ *
+ * netbuf, one segment
+ *
+ * **************************************************************/
+err_t netbuf_data(struct netbuf *buf, void **data, uint16_t *len){
+
+	*data = buf -> data;
+	*len = buf -> len;
+	return ERR_OK;
+}
+
+
+int8_t netbuf_next(struct netbuf *buf){
+
+	return -1;
+}
+
+
+void netbuf_first(struct netbuf *buf){
+}
+
+
+uint16_t netbuf_len(struct netbuf *buf){
+
+	return buf -> len;
+}
+
+
+uint16_t netbuf_copy(struct netbuf *buf, void *data, uint16_t len){
+
+	len = MIN(len, buf -> len);
+	memcpy(data, buf -> data, len);
+	return len;
+}
+
+
+void netbuf_free(struct netbuf *buf){
+}
+
+
+void netbuf_delete(struct netbuf *buf){
+
+	pthread_mutex_lock(&net_lock);
+	buf -> used = false;
+	pthread_mutex_unlock(&net_lock);
+}
+
+
+/****************************************************************
+ *
+ * netconn, client side (test)
+ *
+ * **************************************************************/
+static struct netconn *net_connect(uint32_t wait_ms, bool stall){
+	struct timespec end = deadline(wait_ms);
+	struct netconn *listener = NULL, *c = NULL;
+
+	pthread_mutex_lock(&net_lock);
+	while (listener == NULL){
+		for (int i = 0; i < HOST_NET_CONNS; i++){
+			if ((conns[i].used == true) && (conns[i].listener == true)){
+				listener = &conns[i];
+			}
+		}
+		if ((listener == NULL) &&
+			(cond_wait(&net_cond, &net_lock, wait_ms, &end) == false)){
+			break;
+		}
+	}
+	if ((listener != NULL) && (listener -> backlog_len < HOST_BACKLOG)){
+		c = conn_take();
+		c -> stall = stall;
+		listener -> backlog[listener -> backlog_len++] = c;
+		pthread_cond_broadcast(&net_cond);
+	}
+	pthread_mutex_unlock(&net_lock);
+
+	return c;
+}
+
+
+struct netconn *host_net_connect(uint32_t wait_ms){
+
+	return net_connect(wait_ms, false);
+}
+
+
+//client which doesn't read from the first byte
+struct netconn *host_net_connect_stalled(uint32_t wait_ms){
+
+	return net_connect(wait_ms, true);
+}
+
+
+struct netconn *host_net_pair(void){
+	struct netconn *c;
+
+	pthread_mutex_lock(&net_lock);
+	c = conn_take();
+	c -> accepted = true;
+	pthread_mutex_unlock(&net_lock);
+
+	return c;
+}
+
+
+void host_net_send(struct netconn *conn, const void *data, uint32_t len){
+	const uint8_t *p = data;
+
+	pthread_mutex_lock(&net_lock);
+	while (len > 0){
+		struct netbuf *b = netbuf_take();
+
+		b -> len = MIN(len, HOST_SEGMENT_LEN);
+		memcpy(b -> data, p, b -> len);
+		p += b -> len;
+		len -= b -> len;
+		if (conn -> rx_tail != NULL){
+			conn -> rx_tail -> next = b;
+		}
+		else{
+			conn -> rx_head = b;
+		}
+		conn -> rx_tail = b;
+	}
+	pthread_cond_broadcast(&net_cond);
+	pthread_mutex_unlock(&net_lock);
+}
+
+
+int host_net_read(struct netconn *conn, void *buff, int size, uint32_t wait_ms){
+	struct timespec end = deadline(wait_ms);
+	int len;
+
+	pthread_mutex_lock(&net_lock);
+	while ((conn -> out_len == 0) && (conn -> closed == false)){
+		if (cond_wait(&net_cond, &net_lock, wait_ms, &end) == false){
+			break;
+		}
+	}
+	len = MIN((uint32_t)size, conn -> out_len);
+	memcpy(buff, conn -> out, len);
+	conn -> out_len -= len;
+	memmove(conn -> out, conn -> out + len, conn -> out_len);
+	pthread_mutex_unlock(&net_lock);
+
+	return len;
+}
+
+
+bool host_net_wait_closed(struct netconn *conn, uint32_t wait_ms){
+	struct timespec end = deadline(wait_ms);
+	bool closed;
+
+	pthread_mutex_lock(&net_lock);
+	while (conn -> closed == false){
+		if (cond_wait(&net_cond, &net_lock, wait_ms, &end) == false){
+			break;
+		}
+	}
+	closed = conn -> closed;
+	pthread_mutex_unlock(&net_lock);
+
+	return closed;
+}
+
+
+void host_net_client_close(struct netconn *conn){
+
+	pthread_mutex_lock(&net_lock);
+	conn -> fin = true;
+	pthread_cond_broadcast(&net_cond);
+	pthread_mutex_unlock(&net_lock);
+}
+
+
+void host_net_stall(struct netconn *conn, bool stall){
+
+	pthread_mutex_lock(&net_lock);
+	conn -> stall = stall;
+	pthread_cond_broadcast(&net_cond);
+	pthread_mutex_unlock(&net_lock);
+}
+
+
+void host_net_release(struct netconn *conn){
+
+	pthread_mutex_lock(&net_lock);
+	conn -> released = true;
+	conn -> fin = true;
+	if ((conn -> deleted == true) || (conn -> accepted == false)){
+		conn_put(conn);
+	}
+	pthread_cond_broadcast(&net_cond);
+	pthread_mutex_unlock(&net_lock);
+}
+
+
+struct netbuf *host_netbuf(const void *data, uint16_t len){
+	struct netbuf *b;
+
+	pthread_mutex_lock(&net_lock);
+	b = netbuf_take();
+	pthread_mutex_unlock(&net_lock);
+	b -> len = MIN(len, HOST_SEGMENT_LEN);
+	memcpy(b -> data, data, b -> len);
+
+	return b;
+}
+
+
+/****************************************************************
+ *
+ * data partition in file
+ *
+ * **************************************************************/
+int host_flash_open(const char *label, const char *path, uint32_t size){
+	uint8_t erased[SPI_FLASH_SEC_SIZE];
+	off_t file_size;
+
+	if (flash_fd >= 0){
+		close(flash_fd);
+	}
+	flash_fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (flash_fd < 0){
+		return -1;
+	}
+	//new partition is erased
+	memset(erased, 0xFF, sizeof(erased));
+	file_size = lseek(flash_fd, 0, SEEK_END);
+	for (off_t pos = file_size; pos < size; pos += sizeof(erased)){
+		if (pwrite(flash_fd, erased, MIN(sizeof(erased), size - pos), pos) < 0){
+			return -1;
+		}
+	}
+	strncpy(flash_part.label, label, sizeof(flash_part.label) - 1);
+	flash_part.size = size;
+
+	return 0;
+}
+
+
+//the next write stores only bytes, then the process is stopped
+void host_flash_power_cut(int32_t bytes){
+
+	flash_cut = bytes;
+}
+
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+								esp_partition_subtype_t subtype, const char *label){
+
+	if ((flash_fd < 0) || (type != flash_part.type) ||
+		((label != NULL) && (strcmp(label, flash_part.label) != 0))){
+		return NULL;
+	}
+	return &flash_part;
+}
+
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst,
+							size_t size){
+
+	if ((offset + size > part -> size) ||
+		(pread(flash_fd, dst, size, offset) != (ssize_t)size)){
+		return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src,
+							size_t size){
+	const uint8_t *s = src;
+	uint8_t cell[64];
+	bool cut = false;
+
+	if (offset + size > part -> size){
+		return ESP_FAIL;
+	}
+	if ((flash_cut >= 0) && (flash_cut < size)){
+		size = flash_cut;
+		cut = true;
+	}
+	//programming clears bits only
+	for (size_t pos = 0; pos < size; pos += sizeof(cell)){
+		size_t n = MIN(sizeof(cell), size - pos);
+
+		if (pread(flash_fd, cell, n, offset + pos) != (ssize_t)n){
+			return ESP_FAIL;
+		}
+		for (size_t i = 0; i < n; i++){
+			cell[i] &= s[pos + i];
+		}
+		if (pwrite(flash_fd, cell, n, offset + pos) != (ssize_t)n){
+			return ESP_FAIL;
+		}
+	}
+	if (cut == true){
+		_exit(HOST_POWER_CUT_EXIT);
+	}
+	return ESP_OK;
+}
+
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size){
+	uint8_t erased[SPI_FLASH_SEC_SIZE];
+
+	if ((offset % SPI_FLASH_SEC_SIZE != 0) || (size % SPI_FLASH_SEC_SIZE != 0) ||
+		(offset + size > part -> size)){
+		return ESP_FAIL;
+	}
+	memset(erased, 0xFF, sizeof(erased));
+	for (size_t pos = 0; pos < size; pos += sizeof(erased)){
+		if (pwrite(flash_fd, erased, sizeof(erased), offset + pos) != sizeof(erased)){
+			return ESP_FAIL;
+		}
+	}
+	return ESP_OK;
+}
+
+
+/****************************************************************
+ *
+ * SHA-1 (FIPS 180-1) and base64 of websocket handshake
+ *
+ * **************************************************************/
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_block(uint32_t h[5], const uint8_t *b){
+	uint32_t w[80], a, bb, c, d, e, f, k, t;
+
+	for (int i = 0; i < 16; i++){
+		w[i] = (b[4 * i] << 24) | (b[4 * i + 1] << 16) | (b[4 * i + 2] << 8) | b[4 * i + 3];
+	}
+	for (int i = 16; i < 80; i++){
+		w[i] = ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+	a = h[0]; bb = h[1]; c = h[2]; d = h[3]; e = h[4];
+	for (int i = 0; i < 80; i++){
+		if (i < 20){
+			f = (bb & c) | (~bb & d);
+			k = 0x5A827999;
+		}
+		else if (i < 40){
+			f = bb ^ c ^ d;
+			k = 0x6ED9EBA1;
+		}
+		else if (i < 60){
+			f = (bb & c) | (bb & d) | (c & d);
+			k = 0x8F1BBCDC;
+		}
+		else{
+			f = bb ^ c ^ d;
+			k = 0xCA62C1D6;
+		}
+		t = ROL(a, 5) + f + e + k + w[i];
+		e = d; d = c; c = ROL(bb, 30); bb = a; a = t;
+	}
+	h[0] += a; h[1] += bb; h[2] += c; h[3] += d; h[4] += e;
+}
+
+
+int mbedtls_sha1_ret(const unsigned char *input, size_t len, unsigned char output[20]){
+	uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+	uint8_t last[128];
+	size_t full = len / 64 * 64, rest = len - full, last_len;
+	uint64_t bits = (uint64_t)len * 8;
+
+	for (size_t pos = 0; pos < full; pos += 64){
+		sha1_block(h, input + pos);
+	}
+	memset(last, 0, sizeof(last));
+	memcpy(last, input + full, rest);
+	last[rest] = 0x80;
+	last_len = (rest < 56) ? 64 : 128;
+	for (int i = 0; i < 8; i++){
+		last[last_len - 1 - i] = bits >> (8 * i);
+	}
+	for (size_t pos = 0; pos < last_len; pos += 64){
+		sha1_block(h, last + pos);
+	}
+	for (int i = 0; i < 20; i++){
+		output[i] = h[i / 4] >> (24 - 8 * (i % 4));
+	}
+	return 0;
+}
+
+
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
+						const unsigned char *src, size_t slen){
+	const char abc[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	size_t n = (slen + 2) / 3 * 4, o = 0;
+
+	*olen = n + 1;
+	if (dlen < n + 1){
+		return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+	}
+	for (size_t i = 0; i < slen; i += 3){
+		uint32_t v = src[i] << 16;
+
+		v |= (i + 1 < slen) ? src[i + 1] << 8 : 0;
+		v |= (i + 2 < slen) ? src[i + 2] : 0;
+		dst[o++] = abc[(v >> 18) & 0x3F];
+		dst[o++] = abc[(v >> 12) & 0x3F];
+		dst[o++] = (i + 1 < slen) ? abc[(v >> 6) & 0x3F] : '=';
+		dst[o++] = (i + 2 < slen) ? abc[v & 0x3F] : '=';
+	}
+	dst[o] = 0;
+	*olen = o;
+
+	return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * host_port.h
+ *
+ *  Host tests: the server runs on FreeRTOS, lwIP and flash partition
+ *  stand-ins (host_port.c), tests are the clients of its connections
+ *  and the owners of the partition file
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef HOST_PORT_H_
+#define HOST_PORT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lwip/api.h"
+
+#define HOST_SEGMENT_LEN	2048	//the longest segment received by netconn_recv
+#define HOST_POWER_CUT_EXIT	3		//exit status of process stopped by power cut
+
+//network, client side of connections
+struct netconn *
+	host_net_connect(uint32_t wait_ms);
+struct netconn *
+	host_net_connect_stalled(uint32_t wait_ms);
+struct netconn *
+	host_net_pair(void);
+void
+	host_net_send(struct netconn *conn, const void *data, uint32_t len);
+int
+	host_net_read(struct netconn *conn, void *buff, int size, uint32_t wait_ms);
+bool
+	host_net_wait_closed(struct netconn *conn, uint32_t wait_ms);
+void
+	host_net_client_close(struct netconn *conn);
+void
+	host_net_stall(struct netconn *conn, bool stall);
+void
+	host_net_release(struct netconn *conn);
+struct netbuf *
+	host_netbuf(const void *data, uint16_t len);
+
+//data partition in file
+int
+	host_flash_open(const char *label, const char *path, uint32_t size);
+void
+	host_flash_power_cut(int32_t bytes);
+
+#endif /* HOST_PORT_H_ */
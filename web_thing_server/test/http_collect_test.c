@@ -0,0 +1,173 @@
+/*
+ * http_collect_test.c
+ *
+ *  Host test of collecting HTTP requests from TCP segments
+ *  (http_collect): requests in one or many segments, Content-Length
+ *  of the body and the HTTP_MAX_REQUEST_LEN limit (RX_TOO_LONG)
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lwip/api.h"
+
+#include "common.h"
+#include "http_parser.h"
+#include "host_port.h"
+
+#define HEAD		"POST /0/properties/level HTTP/1.1\r\nHost: test\r\n"
+
+static connection_desc_t conn;
+static char rq_buff[HTTP_MAX_REQUEST_LEN + 2];
+static int failures = 0;
+
+
+static void check(bool ok, const char *what){
+
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (ok == false){
+		failures++;
+	}
+}
+
+
+/****************************************************************
+ *
+ * give request to http_collect in segments of seg_len bytes
+ * output: result of the last http_collect, *segs - number of
+ * segments given (collecting stops at the first non 0 result)
+ *
+ * **************************************************************/
+static int collect(const char *rq, int len, int seg_len, char **out, uint16_t *out_len,
+				int *segs){
+	struct netbuf *b;
+	int res = 0, pos = 0;
+
+	http_collect_done(&conn);
+	*segs = 0;
+	while ((res == 0) && (pos < len)){
+		int n = (len - pos < seg_len) ? len - pos : seg_len;
+
+		b = host_netbuf(rq + pos, n);
+		res = http_collect(&conn, b, out, out_len);
+		netbuf_delete(b);
+		pos += n;
+		(*segs)++;
+	}
+
+	return res;
+}
+
+
+//request with body of body_len bytes and its Content-Length header
+static int request(const char *content_length, int body_len){
+	int len;
+
+	len = sprintf(rq_buff, "%sContent-Length: %s\r\n\r\n", HEAD, content_length);
+	memset(rq_buff + len, 'x', body_len);
+	len += body_len;
+	rq_buff[len] = 0;
+
+	return len;
+}
+
+
+//headers padded by a long header to len bytes
+static int long_request(int len){
+	int n;
+
+	n = sprintf(rq_buff, "GET /0 HTTP/1.1\r\nX-Pad: ");
+	memset(rq_buff + n, 'p', len - n - 4);
+	memcpy(rq_buff + len - 4, "\r\n\r\n", 4);
+	rq_buff[len] = 0;
+
+	return len;
+}
+
+
+int main(void){
+	const char *get = "GET /0/properties HTTP/1.1\r\nHost: test\r\n\r\n";
+	char *rq;
+	uint16_t len;
+	int res, segs, rq_len;
+
+	conn.index = 0;
+
+	//one segment, not copied
+	res = collect(get, strlen(get), HOST_SEGMENT_LEN, &rq, &len, &segs);
+	check((res == 1) && (rq != conn.rx_buff) && (len == strlen(get)) &&
+			(memcmp(rq, get, len) == 0), "request in one segment");
+
+	//split inside of the empty line
+	res = collect(get, strlen(get), strlen(get) - 3, &rq, &len, &segs);
+	check((res == 1) && (segs == 2) && (rq == conn.rx_buff) && (strcmp(rq, get) == 0),
+			"request split inside of the last CRLF");
+
+	//segments of 1 byte, headers are not complete until the last one
+	res = collect(get, strlen(get) - 1, 1, &rq, &len, &segs);
+	check((res == 0) && (conn.rx_need == 0), "headers not complete");
+	res = collect(get, strlen(get), 1, &rq, &len, &segs);
+	check((res == 1) && (segs == strlen(get)) && (strcmp(rq, get) == 0),
+			"request in 1 byte segments");
+
+	//body in other segments than headers
+	rq_len = request("10", 10);
+	res = collect(rq_buff, rq_len - 10, HOST_SEGMENT_LEN, &rq, &len, &segs);
+	check((res == 0) && (conn.rx_need == rq_len), "headers complete, waiting for body");
+	res = collect(rq_buff, rq_len, rq_len - 7, &rq, &len, &segs);
+	check((res == 1) && (segs == 2) && (len == rq_len) && (memcmp(rq, rq_buff, len) == 0),
+			"body split between segments");
+	res = collect(rq_buff, rq_len, rq_len - 5, &rq, &len, &segs);
+	check((res == 1) && (segs == 2), "body split in the middle");
+
+	//name of the header in lower case, spaces before the value
+	rq_len = sprintf(rq_buff, "%scontent-length:   4\r\n\r\nabcd", HEAD);
+	res = collect(rq_buff, rq_len - 1, HOST_SEGMENT_LEN, &rq, &len, &segs);
+	check((res == 0) && (conn.rx_need == rq_len), "Content-Length case insensitive");
+
+	//empty body
+	rq_len = request("0", 0);
+	res = collect(rq_buff, rq_len, 16, &rq, &len, &segs);
+	check((res == 1) && (len == rq_len), "Content-Length: 0");
+
+	//longest request, then one byte more
+	rq_len = long_request(HTTP_MAX_REQUEST_LEN);
+	res = collect(rq_buff, rq_len, 1000, &rq, &len, &segs);
+	check((res == 1) && (len == HTTP_MAX_REQUEST_LEN), "request of HTTP_MAX_REQUEST_LEN");
+	rq_len = long_request(HTTP_MAX_REQUEST_LEN + 1);
+	res = collect(rq_buff, rq_len, 1000, &rq, &len, &segs);
+	check((res == -1) && (segs == 5), "longer request refused (RX_TOO_LONG)");
+
+	//headers never complete
+	rq_len = long_request(HTTP_MAX_REQUEST_LEN + 1);
+	rq_buff[rq_len - 2] = 'p';
+	res = collect(rq_buff, rq_len, HOST_SEGMENT_LEN, &rq, &len, &segs);
+	check(res == -1, "headers without end refused");
+
+	//too long body refused with the headers, before it is received
+	rq_len = request("5000", 0);
+	res = collect(rq_buff, rq_len, HOST_SEGMENT_LEN, &rq, &len, &segs);
+	check((res == -1) && (segs == 1), "Content-Length over the limit refused");
+	rq_len = request("4294967290", 10);
+	res = collect(rq_buff, rq_len, HOST_SEGMENT_LEN, &rq, &len, &segs);
+	check((res == -1) && (segs == 1), "Content-Length overflowing 32 bits refused");
+	rq_len = request("18446744073709551616", 10);
+	res = collect(rq_buff, rq_len, HOST_SEGMENT_LEN, &rq, &len, &segs);
+	check((res == -1) && (segs == 1), "Content-Length overflowing 64 bits refused");
+
+	//buffer released
+	http_collect_done(&conn);
+	check((conn.rx_buff == NULL) && (conn.rx_len == 0) && (conn.rx_need == 0),
+			"collected data released");
+
+	if (failures > 0){
+		printf("http_collect_test: %i FAILED\n", failures);
+		return 1;
+	}
+	printf("http_collect_test: all passed\n");
+	return 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * esp_partition.h
+ *
+ *  Host tests: data partition kept in a file (test/host_port.h),
+ *  writing only clears bits as in NOR flash
+ */
+
+#ifndef TEST_STUBS_ESP_PARTITION_H_
+#define TEST_STUBS_ESP_PARTITION_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK		0
+#define ESP_FAIL	-1
+
+#define SPI_FLASH_SEC_SIZE	4096
+
+typedef enum{
+	ESP_PARTITION_TYPE_APP = 0x00,
+	ESP_PARTITION_TYPE_DATA = 0x01
+} esp_partition_type_t;
+
+typedef enum{
+	ESP_PARTITION_SUBTYPE_ANY = 0xff
+} esp_partition_subtype_t;
+
+typedef struct{
+	esp_partition_type_t type;
+	esp_partition_subtype_t subtype;
+	uint32_t address;
+	uint32_t size;
+	char label[17];
+} esp_partition_t;
+
+const esp_partition_t *
+	esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+				const char *label);
+esp_err_t
+	esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size);
+esp_err_t
+	esp_partition_write(const esp_partition_t *part, size_t offset, const void *src,
+				size_t size);
+esp_err_t
+	esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size);
+
+#endif /* TEST_STUBS_ESP_PARTITION_H_ */
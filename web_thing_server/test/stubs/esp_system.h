@@ -0,0 +1,17 @@
+/*
+ * esp_system.h
+ *
+ *  Host tests: heap statistics for GET /metrics (test/host_port.c)
+ */
+
+#ifndef TEST_STUBS_ESP_SYSTEM_H_
+#define TEST_STUBS_ESP_SYSTEM_H_
+
+#include <stdint.h>
+
+uint32_t
+	esp_get_free_heap_size(void);
+uint32_t
+	esp_get_minimum_free_heap_size(void);
+
+#endif /* TEST_STUBS_ESP_SYSTEM_H_ */
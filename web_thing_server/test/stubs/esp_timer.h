@@ -0,0 +1,15 @@
+/*
+ * esp_timer.h
+ *
+ *  Host tests: time since start, microseconds (test/host_port.c)
+ */
+
+#ifndef TEST_STUBS_ESP_TIMER_H_
+#define TEST_STUBS_ESP_TIMER_H_
+
+#include <stdint.h>
+
+int64_t
+	esp_timer_get_time(void);
+
+#endif /* TEST_STUBS_ESP_TIMER_H_ */
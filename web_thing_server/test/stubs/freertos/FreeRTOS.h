@@ -0,0 +1,88 @@
+/*
+ * FreeRTOS.h
+ *
+ *  Host tests: the part of FreeRTOS used by the server, tasks are
+ *  threads, ticks are milliseconds (test/host_port.c)
+ */
+
+#ifndef TEST_STUBS_FREERTOS_H_
+#define TEST_STUBS_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "sdkconfig.h"
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;	//stack depth is given in bytes, as on ESP32
+
+#define pdTRUE					1
+#define pdFALSE					0
+#define pdPASS					pdTRUE
+#define pdFAIL					pdFALSE
+#define portMAX_DELAY			((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ		1000
+#define portTICK_PERIOD_MS		(1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS		portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms)		((TickType_t)(ms) / portTICK_PERIOD_MS)
+#define configMINIMAL_STACK_SIZE 768
+#define portYIELD_FROM_ISR()
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+typedef void (*TaskFunction_t)(void *);
+
+//task, a detached thread (stack of the task is not used)
+typedef struct host_task{
+	pthread_t thread;
+	TaskFunction_t fun;
+	void *arg;
+	const char *name;
+	bool is_static;
+} StaticTask_t;
+
+//queue, semaphores and mutexes are queues too
+typedef struct host_queue{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	uint8_t *storage;
+	UBaseType_t len;
+	UBaseType_t item_size;		//0 - semaphore
+	UBaseType_t count;
+	UBaseType_t head;
+	struct host_task *holder;	//mutex holder
+	UBaseType_t depth;			//recursive mutex
+	bool is_static;
+} StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+typedef struct host_task *TaskHandle_t;
+typedef TaskHandle_t xTaskHandle;
+typedef struct host_queue *QueueHandle_t;
+typedef QueueHandle_t xQueueHandle;
+typedef QueueHandle_t SemaphoreHandle_t;
+typedef QueueHandle_t xSemaphoreHandle;
+
+//critical sections of all spinlocks are one recursive lock
+typedef struct{
+	int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED	{0}
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)			vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)			vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux)		vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)		vPortExitCritical(mux)
+#define portENTER_CRITICAL_SAFE(mux)	vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_SAFE(mux)		vPortExitCritical(mux)
+
+#endif /* TEST_STUBS_FREERTOS_H_ */
@@ -0,0 +1,28 @@
+/*
+ * queue.h
+ *
+ *  Host tests: FreeRTOS queues (test/host_port.c)
+ */
+
+#ifndef TEST_STUBS_QUEUE_H_
+#define TEST_STUBS_QUEUE_H_
+
+#include "FreeRTOS.h"
+
+QueueHandle_t
+	xQueueCreate(UBaseType_t len, UBaseType_t item_size);
+QueueHandle_t
+	xQueueCreateStatic(UBaseType_t len, UBaseType_t item_size, uint8_t *storage,
+				StaticQueue_t *buff);
+BaseType_t
+	xQueueSend(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t
+	xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t
+	xQueueReceive(QueueHandle_t q, void *item, TickType_t wait);
+UBaseType_t
+	uxQueueMessagesWaiting(QueueHandle_t q);
+
+#define xQueueSendToBack(q, item, wait)	xQueueSend(q, item, wait)
+
+#endif /* TEST_STUBS_QUEUE_H_ */
@@ -0,0 +1,36 @@
+/*
+ * semphr.h
+ *
+ *  Host tests: FreeRTOS semaphores and mutexes (test/host_port.c)
+ */
+
+#ifndef TEST_STUBS_SEMPHR_H_
+#define TEST_STUBS_SEMPHR_H_
+
+#include "FreeRTOS.h"
+#include "queue.h"
+
+SemaphoreHandle_t
+	xSemaphoreCreateMutex(void);
+SemaphoreHandle_t
+	xSemaphoreCreateMutexStatic(StaticSemaphore_t *buff);
+SemaphoreHandle_t
+	xSemaphoreCreateRecursiveMutex(void);
+SemaphoreHandle_t
+	xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t *buff);
+SemaphoreHandle_t
+	xSemaphoreCreateBinary(void);
+SemaphoreHandle_t
+	xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buff);
+BaseType_t
+	xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait);
+BaseType_t
+	xSemaphoreGive(SemaphoreHandle_t s);
+BaseType_t
+	xSemaphoreGiveFromISR(SemaphoreHandle_t s, BaseType_t *woken);
+BaseType_t
+	xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t wait);
+BaseType_t
+	xSemaphoreGiveRecursive(SemaphoreHandle_t s);
+
+#endif /* TEST_STUBS_SEMPHR_H_ */
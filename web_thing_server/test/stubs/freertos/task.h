@@ -0,0 +1,29 @@
+/*
+ * task.h
+ *
+ *  Host tests: FreeRTOS tasks (test/host_port.c)
+ */
+
+#ifndef TEST_STUBS_TASK_H_
+#define TEST_STUBS_TASK_H_
+
+#include "FreeRTOS.h"
+
+BaseType_t
+	xTaskCreate(TaskFunction_t fun, const char *name, uint32_t stack_depth,
+				void *arg, UBaseType_t priority, TaskHandle_t *handle);
+TaskHandle_t
+	xTaskCreateStatic(TaskFunction_t fun, const char *name, uint32_t stack_depth,
+				void *arg, UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb);
+void
+	vTaskDelete(TaskHandle_t task);
+void
+	vTaskDelay(TickType_t ticks);
+void
+	vTaskDelayUntil(TickType_t *prev_wake, TickType_t increment);
+TickType_t
+	xTaskGetTickCount(void);
+TaskHandle_t
+	xTaskGetCurrentTaskHandle(void);
+
+#endif /* TEST_STUBS_TASK_H_ */
@@ -0,0 +1,15 @@
+/*
+ * timers.h
+ *
+ *  Host tests: the server uses its own timer wheel, only the type
+ *  of FreeRTOS timers is needed
+ */
+
+#ifndef TEST_STUBS_TIMERS_H_
+#define TEST_STUBS_TIMERS_H_
+
+#include "FreeRTOS.h"
+
+typedef struct host_timer *TimerHandle_t;
+
+#endif /* TEST_STUBS_TIMERS_H_ */
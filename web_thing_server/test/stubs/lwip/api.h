@@ -0,0 +1,76 @@
+/*
+ * api.h
+ *
+ *  Host tests: netconn API of lwIP, connections are made by the test
+ *  (test/host_port.h), data is kept in memory
+ */
+
+#ifndef TEST_STUBS_LWIP_API_H_
+#define TEST_STUBS_LWIP_API_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int8_t err_t;
+
+#define ERR_OK			0
+#define ERR_MEM			-1
+#define ERR_TIMEOUT		-3
+#define ERR_WOULDBLOCK	-7
+#define ERR_CONN		-11
+#define ERR_ABRT		-13
+#define ERR_RST			-14
+#define ERR_CLSD		-15
+#define ERR_ARG			-16
+
+#define NETCONN_NOFLAG	0x00
+#define NETCONN_COPY	0x01
+#define NETCONN_MORE	0x02
+#define NETCONN_TCP		0x10
+
+typedef struct ip_addr{
+	uint32_t addr;
+} ip_addr_t;
+
+struct netconn;
+struct netbuf;
+
+struct netconn *
+	netconn_new(int type);
+err_t
+	netconn_bind(struct netconn *conn, const ip_addr_t *addr, uint16_t port);
+err_t
+	netconn_listen(struct netconn *conn);
+err_t
+	netconn_accept(struct netconn *conn, struct netconn **new_conn);
+err_t
+	netconn_recv(struct netconn *conn, struct netbuf **buf);
+err_t
+	netconn_write(struct netconn *conn, const void *data, size_t len, uint8_t flags);
+err_t
+	netconn_close(struct netconn *conn);
+err_t
+	netconn_delete(struct netconn *conn);
+err_t
+	netconn_shutdown(struct netconn *conn, uint8_t shut_rx, uint8_t shut_tx);
+void
+	netconn_set_recvtimeout(struct netconn *conn, int timeout);
+void
+	netconn_set_sendtimeout(struct netconn *conn, int timeout);
+
+err_t
+	netbuf_data(struct netbuf *buf, void **data, uint16_t *len);
+int8_t
+	netbuf_next(struct netbuf *buf);
+void
+	netbuf_first(struct netbuf *buf);
+uint16_t
+	netbuf_len(struct netbuf *buf);
+uint16_t
+	netbuf_copy(struct netbuf *buf, void *data, uint16_t len);
+void
+	netbuf_free(struct netbuf *buf);
+void
+	netbuf_delete(struct netbuf *buf);
+
+#endif /* TEST_STUBS_LWIP_API_H_ */
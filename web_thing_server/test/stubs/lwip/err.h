@@ -0,0 +1,12 @@
+/*
+ * err.h
+ *
+ *  Host tests: see api.h
+ */
+
+#ifndef TEST_STUBS_LWIP_ERR_H_
+#define TEST_STUBS_LWIP_ERR_H_
+
+#include "api.h"
+
+#endif /* TEST_STUBS_LWIP_ERR_H_ */
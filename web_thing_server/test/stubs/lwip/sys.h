@@ -0,0 +1,12 @@
+/*
+ * sys.h
+ *
+ *  Host tests: see api.h
+ */
+
+#ifndef TEST_STUBS_LWIP_SYS_H_
+#define TEST_STUBS_LWIP_SYS_H_
+
+#include "api.h"
+
+#endif /* TEST_STUBS_LWIP_SYS_H_ */
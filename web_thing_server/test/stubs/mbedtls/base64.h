@@ -0,0 +1,18 @@
+/*
+ * base64.h
+ *
+ *  Host tests: base64 of websocket handshake (test/host_port.c)
+ */
+
+#ifndef TEST_STUBS_MBEDTLS_BASE64_H_
+#define TEST_STUBS_MBEDTLS_BASE64_H_
+
+#include <stddef.h>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL	-0x002A
+
+int
+	mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
+				const unsigned char *src, size_t slen);
+
+#endif /* TEST_STUBS_MBEDTLS_BASE64_H_ */
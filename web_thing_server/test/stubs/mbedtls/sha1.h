@@ -0,0 +1,15 @@
+/*
+ * sha1.h
+ *
+ *  Host tests: SHA-1 of websocket handshake (test/host_port.c)
+ */
+
+#ifndef TEST_STUBS_MBEDTLS_SHA1_H_
+#define TEST_STUBS_MBEDTLS_SHA1_H_
+
+#include <stddef.h>
+
+int
+	mbedtls_sha1_ret(const unsigned char *input, size_t len, unsigned char output[20]);
+
+#endif /* TEST_STUBS_MBEDTLS_SHA1_H_ */
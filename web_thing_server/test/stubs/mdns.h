@@ -0,0 +1,10 @@
+/*
+ * mdns.h
+ *
+ *  Host tests: mDNS is not used by the core of the server
+ */
+
+#ifndef TEST_STUBS_MDNS_H_
+#define TEST_STUBS_MDNS_H_
+
+#endif /* TEST_STUBS_MDNS_H_ */
@@ -0,0 +1,40 @@
+/*
+ * sdkconfig.h
+ *
+ *  Host tests: configuration of the server, defaults of Kconfig.projbuild
+ *  with the event log on, STATIC_ALLOC is set by test/Makefile
+ */
+
+#ifndef TEST_STUBS_SDKCONFIG_H_
+#define TEST_STUBS_SDKCONFIG_H_
+
+#define CONFIG_NOTIFY_PERIOD_MS			100
+#define CONFIG_PROP_HISTORY_SIZE		360
+#define CONFIG_CHANGE_LOG_SIZE			64
+#define CONFIG_WS_SNAPSHOT_ON_SUBSCRIBE	1
+#define CONFIG_WS_DEFLATE				1
+#define CONFIG_WS_MAX_MESSAGE_LEN		4096
+#define CONFIG_WS_PING_PERIOD_MS		10000
+#define CONFIG_WS_PING_MAX_MISSED		3
+#define CONFIG_ACTION_QUEUE_SIZE		4
+#define CONFIG_ACTION_WORKERS			1
+#define CONFIG_EVENT_LOG				1
+#define CONFIG_EVENT_LOG_PARTITION		"eventlog"
+#define CONFIG_EVENT_LOG_FLUSH_MS		5000
+#define CONFIG_REQ_ARENA_SIZE			4096
+#define CONFIG_WS_ITEM_POOL_SIZE		32
+#define CONFIG_SUBSCRIBER_POOL_SIZE		16
+#ifndef CONFIG_STATIC_ALLOC
+#define CONFIG_POOL_HEAP_FALLBACK		1
+#endif
+#define CONFIG_TIMER_WHEEL_TICK_MS		50
+#define CONFIG_HTTP_FIRST_BYTE_MS		5000
+#define CONFIG_HTTP_HEADERS_MS			10000
+#define CONFIG_HTTP_BODY_MS				10000
+#define CONFIG_HTTP_BODY_MIN_RATE		500
+#define CONFIG_HTTP_MAX_REQUEST_LEN		4096
+#define CONFIG_WS_IDLE_MS				0
+#define CONFIG_CONN_EVICT_IDLE			1
+#define CONFIG_WS_PAYLOAD_POOL_SIZE		8
+
+#endif /* TEST_STUBS_SDKCONFIG_H_ */
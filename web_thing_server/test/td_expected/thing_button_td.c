@@ -0,0 +1,130 @@
+/*
+ * thing_button_td.c
+ *
+ * generated by td_gen.py from thing_button.json, do not edit
+ */
+#include <string.h>
+
+#include "simple_web_thing_server.h"
+#include "thing_button_td.h"
+
+//description of the thing
+const char button_td[] =
+	"\"name\":\"Button\",\"href\":\"/\001\",\"@context\":\"https://webthings.io/schemas\","
+	"\"@type\":[\"PushButton\"],\"properties\":{\"pushed\":{\"@type\":\"PushedProperty\","
+	"\"title\":\"Pushed\",\"type\":\"boolean\",\"description\":\"button state\","
+	"\"readOnly\":true,\"links\":[{\"rel\":\"property\","
+	"\"href\":\"/\001/properties/pushed\"}]},\"counter\":{\"@type\":\"LevelProperty\","
+	"\"title\":\"Counter\",\"type\":\"integer\",\"description\":\"button push counter\","
+	"\"minimum\":0,\"maximum\":2147483647,\"unit\":\"pcs\",\"readOnly\":true,"
+	"\"links\":[{\"rel\":\"property\",\"href\":\"/\001/properties/counter\"}]}},"
+	"\"actions\":{},\"events\":{\"10times\":{\"title\":\"10 times\","
+	"\"description\":\"button pushed 10 times\",\"@type\":\"AlarmEvent\","
+	"\"type\":\"integer\",\"unit\":\"pcs\",\"links\":[{\"rel\":\"event\","
+	"\"href\":\"/\001/events/10times\"}]}},\"links\":[{\"rel\":\"properties\","
+	"\"href\":\"/\001/properties\"},{\"rel\":\"actions\",\"href\":\"/\001/actions\"},"
+	"{\"rel\":\"events\",\"href\":\"/\001/events\"},{\"rel\":\"alternate\","
+	"\"href\":\"ws://\002/\001\"}],\"description\":\"Internet connected button\"";
+
+const property_desc_t button_pushed_desc = {
+	.id = "pushed",
+	.title = "Pushed",
+	.description = "button state",
+	.at_type = "PushedProperty",
+	.type = VAL_BOOLEAN,
+	.read_only = true,
+};
+
+const property_desc_t button_counter_desc = {
+	.id = "counter",
+	.title = "Counter",
+	.description = "button push counter",
+	.at_type = "LevelProperty",
+	.type = VAL_INTEGER,
+	.unit = "pcs",
+	.min_value.int_val = 0,
+	.max_value.int_val = 2147483647,
+	.read_only = true,
+	.notify = {.on_change_only = true},
+};
+
+static at_type_t button_type[] = {
+	{"PushButton", NULL},
+};
+
+bool button_pushed_get(thing_t *t){
+	property_t *p = t -> properties[BUTTON_PUSHED];
+	bool value;
+
+	xSemaphoreTake(p -> mux, portMAX_DELAY);
+	value = *(bool *)(p -> value);
+	xSemaphoreGive(p -> mux);
+
+	return value;
+}
+
+
+//set new value and inform subscribers (notification policy is applied)
+void button_pushed_set(thing_t *t, bool value){
+	property_t *p = t -> properties[BUTTON_PUSHED];
+
+	xSemaphoreTake(p -> mux, portMAX_DELAY);
+	*(bool *)(p -> value) = value;
+	xSemaphoreGive(p -> mux);
+	inform_all_subscribers_prop(p);
+}
+
+
+int button_counter_get(thing_t *t){
+	property_t *p = t -> properties[BUTTON_COUNTER];
+	int value;
+
+	xSemaphoreTake(p -> mux, portMAX_DELAY);
+	value = *(int *)(p -> value);
+	xSemaphoreGive(p -> mux);
+
+	return value;
+}
+
+
+//set new value and inform subscribers (notification policy is applied)
+void button_counter_set(thing_t *t, int value){
+	property_t *p = t -> properties[BUTTON_COUNTER];
+
+	xSemaphoreTake(p -> mux, portMAX_DELAY);
+	*(int *)(p -> value) = value;
+	xSemaphoreGive(p -> mux);
+	inform_all_subscribers_prop(p);
+}
+
+
+/*****************************************************************
+ *
+ * create thing "Button" with all its resources
+ *
+ * ****************************************************************/
+thing_t *button_thing_init(xSemaphoreHandle mux, bool *pushed, int *counter){
+	thing_t *t;
+	event_t *e;
+
+	t = thing_init();
+	t -> id = "Button";
+	t -> at_context = "https://webthings.io/schemas";
+	t -> description = "Internet connected button";
+	set_thing_type(t, &button_type[0]);
+	thing_set_td(t, button_td, BUTTON_TD_LEN);
+
+	add_property(t, property_init(&button_pushed_desc, pushed, mux));
+	add_property(t, property_init(&button_counter_desc, counter, mux));
+
+	e = event_init();
+	e -> id = "10times";
+	e -> title = "10 times";
+	e -> description = "button pushed 10 times";
+	e -> type = VAL_INTEGER;
+	e -> at_type = "AlarmEvent";
+	e -> unit = "pcs";
+	add_event(t, e);
+
+	return t;
+}
@@ -0,0 +1,46 @@
+/*
+ * thing_button_td.h
+ *
+ * generated by td_gen.py from thing_button.json, do not edit
+ */
+
+#ifndef BUTTON_TD_H_
+#define BUTTON_TD_H_
+
+#include <stdbool.h>
+#include "simple_web_thing_server.h"
+
+//thing description, see thing_set_td()
+#define BUTTON_TD_LEN 916
+extern const char button_td[];
+
+//indexes of properties in thing's table
+enum{
+	BUTTON_PUSHED = 0,
+	BUTTON_COUNTER = 1,
+	BUTTON_PROP_QUANT
+};
+
+extern const property_desc_t button_pushed_desc;
+extern const property_desc_t button_counter_desc;
+
+thing_t *
+	button_thing_init(xSemaphoreHandle mux, bool *pushed, int *counter);
+
+static inline property_t *button_pushed(thing_t *t){
+	return t -> properties[BUTTON_PUSHED];
+}
+bool
+	button_pushed_get(thing_t *t);
+void
+	button_pushed_set(thing_t *t, bool value);
+
+static inline property_t *button_counter(thing_t *t){
+	return t -> properties[BUTTON_COUNTER];
+}
+int
+	button_counter_get(thing_t *t);
+void
+	button_counter_set(thing_t *t, int value);
+
+#endif /* BUTTON_TD_H_ */
@@ -0,0 +1,159 @@
+/*
+ * timer_wheel_test.c
+ *
+ *  Host test of the timer wheel: the wheel is advanced tick by tick
+ *  (tw_advance) by the test, every timer must expire exactly at its
+ *  tick, also timers beyond the second level (64 x 64 ticks), timers
+ *  armed at every position in a block and across wrap of now; then
+ *  with the timer task running, cancel from other task waits for
+ *  the running function
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+//static functions and the wheel are tested directly
+#include "../web_thing_timer.c"
+
+#define DELTAS			(sizeof(deltas) / sizeof(deltas[0]))
+#define FUN_RUN_MS		200		//function running when it is cancelled
+
+//expiration in ticks from now, around the ends of blocks and levels
+static const uint32_t deltas[] = {1, 2, 63, 64, 65, 127, 128, 129,
+		TW_L0_SIZE * TW_L1_SIZE - TW_L0_SIZE - 1, TW_L0_SIZE * TW_L1_SIZE - TW_L0_SIZE,
+		TW_L0_SIZE * TW_L1_SIZE - 1, TW_L0_SIZE * TW_L1_SIZE, TW_L0_SIZE * TW_L1_SIZE + 1,
+		2 * TW_L0_SIZE * TW_L1_SIZE + 17, 5 * TW_L0_SIZE * TW_L1_SIZE + 100};
+static wheel_timer_t timers[DELTAS];
+static uint32_t fired[DELTAS];
+static int failures = 0;
+
+static volatile bool fun_in = false, fun_out = false;
+static volatile int fun_runs = 0;
+static wheel_timer_t slow_timer;
+
+
+static void check(bool ok, const char *what){
+
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (ok == false){
+		failures++;
+	}
+}
+
+
+//expired timer writes the tick
+static void fire(void *arg){
+	int i = (wheel_timer_t *)arg - timers;
+
+	fired[i] = wheel.now;
+}
+
+
+/****************************************************************
+ *
+ * arm all timers at tick start, advance the wheel until the last
+ * one expires
+ * output: false - a timer expired at other tick than its delta
+ *
+ * **************************************************************/
+static bool run_wheel(uint32_t start){
+	uint32_t end = 0;
+	bool ok = true;
+
+	wheel.now = start;
+	for (int i = 0; i < DELTAS; i++){
+		//arm adds one tick to the rounded up time
+		timer_wheel_arm(&timers[i], (deltas[i] - 1) * TIMER_WHEEL_TICK_MS, fire, &timers[i]);
+		fired[i] = start;
+		if (deltas[i] > end){
+			end = deltas[i];
+		}
+	}
+	for (uint32_t n = 0; n <= end + 1; n++){
+		tw_advance();
+		tw_run_expired();
+	}
+	for (int i = 0; i < DELTAS; i++){
+		if (fired[i] - start != deltas[i]){
+			printf("      start %u, delta %u: expired after %u ticks\n",
+					start, deltas[i], fired[i] - start);
+			ok = false;
+		}
+	}
+
+	return ok && (wheel.armed == 0);
+}
+
+
+//runs until cancelled, arms itself again
+static void slow_fun(void *arg){
+
+	fun_in = true;
+	vTaskDelay(pdMS_TO_TICKS(FUN_RUN_MS));
+	fun_runs++;
+	timer_wheel_arm(&slow_timer, 0, slow_fun, NULL);
+	fun_out = true;
+}
+
+
+//cancels its own timer, mustn't wait for itself
+static void self_cancel_fun(void *arg){
+
+	timer_wheel_cancel(&slow_timer);
+	fun_runs++;
+}
+
+
+int main(void){
+	bool ok;
+	int runs;
+
+	//timers armed at every tick of a block
+	ok = true;
+	for (uint32_t s = 0; s < TW_L0_SIZE; s++){
+		ok = run_wheel(1000 * TW_L0_SIZE + s) && ok;
+	}
+	check(ok, "timers expire at their tick from every position in a block");
+
+	check(run_wheel(TW_L0_SIZE * TW_L1_SIZE * 7 - 1), "far timers moved from the farthest slot");
+
+	//now wraps while timers are armed
+	ok = true;
+	for (uint32_t s = 0; s < TW_L0_SIZE; s += 7){
+		ok = run_wheel(0xFFFFFFFF - TW_L0_SIZE * TW_L1_SIZE - s) && ok;
+		ok = run_wheel(0xFFFFFFFF - s) && ok;
+	}
+	check(ok, "timers expire across wrap of now");
+
+	//timer task: cancel from this task waits until the function returns
+	timer_wheel_init();
+	timer_wheel_arm(&slow_timer, 0, slow_fun, NULL);
+	while (fun_in == false){
+		vTaskDelay(1);
+	}
+	timer_wheel_cancel(&slow_timer);
+	check(fun_out == true, "cancel waits for the running function");
+	check(timer_wheel_armed(&slow_timer) == false, "timer armed by the function stopped");
+	runs = fun_runs;
+	vTaskDelay(pdMS_TO_TICKS(FUN_RUN_MS + 5 * TIMER_WHEEL_TICK_MS));
+	check(fun_runs == runs, "function doesn't run after cancel");
+
+	//cancel in a timer function doesn't wait for itself
+	timer_wheel_arm(&slow_timer, 0, self_cancel_fun, NULL);
+	vTaskDelay(pdMS_TO_TICKS(5 * TIMER_WHEEL_TICK_MS));
+	check(fun_runs == runs + 1, "cancel in the timer function returns");
+
+	if (failures > 0){
+		printf("timer_wheel_test: %i FAILED\n", failures);
+		return 1;
+	}
+	printf("timer_wheel_test: all passed\n");
+	return 0;
+}
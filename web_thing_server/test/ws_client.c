@@ -0,0 +1,180 @@
+/*
+ * ws_client.c
+ *
+ *  Host tests: HTTP and websocket client of the server running
+ *  on host port (host_port.h)
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mbedtls/sha1.h"
+#include "mbedtls/base64.h"
+
+#include "host_port.h"
+#include "ws_frame_gen.h"
+#include "ws_client.h"
+
+#define WS_KEY		"dGhlIHNhbXBsZSBub25jZQ=="
+#define WS_GUID		"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+static uint8_t frame[WS_GEN_HEAD_MAX + 8192];
+
+
+/*************************************************************************
+ *
+ * read exactly len bytes, false if connection is closed or time is over
+ *
+ * ***********************************************************************/
+static bool read_exact(struct netconn *conn, void *buff, int len, uint32_t wait_ms){
+	uint8_t *b = buff;
+	int n;
+
+	while (len > 0){
+		n = host_net_read(conn, b, len, wait_ms);
+		if (n <= 0){
+			return false;
+		}
+		b += n;
+		len -= n;
+	}
+	return true;
+}
+
+
+/*************************************************************************
+ *
+ * read HTTP response head (up to empty line), output: length or -1
+ *
+ * ***********************************************************************/
+int client_read_head(struct netconn *conn, char *buff, int size){
+	int len = 0;
+
+	while (len < size - 1){
+		if (read_exact(conn, buff + len, 1, CLIENT_WAIT_MS) == false){
+			return -1;
+		}
+		len++;
+		buff[len] = 0;
+		if ((len >= 4) && (strcmp(buff + len - 4, "\r\n\r\n") == 0)){
+			return len;
+		}
+	}
+	return -1;
+}
+
+
+/*************************************************************************
+ *
+ * connect and open websocket, accept key of the answer is checked
+ * 		path - e.g. "/0" or "/things"
+ * 		headers - additional request headers ("" or lines ended by \r\n)
+ * output: connection or NULL
+ *
+ * ***********************************************************************/
+struct netconn *ws_client_open(const char *path, const char *headers){
+	struct netconn *conn;
+	char rq[512], head[512], key[64], accept[40];
+	unsigned char sha[20];
+	size_t olen;
+
+	conn = host_net_connect(CLIENT_WAIT_MS);
+	if (conn == NULL){
+		printf("ws client: no listener\n");
+		return NULL;
+	}
+	snprintf(rq, sizeof(rq), "GET %s HTTP/1.1\r\nHost: test\r\n"\
+			"Upgrade: websocket\r\nConnection: Upgrade\r\n"\
+			"Sec-WebSocket-Key: " WS_KEY "\r\nSec-WebSocket-Version: 13\r\n"\
+			"%s\r\n", path, headers);
+	host_net_send(conn, rq, strlen(rq));
+
+	snprintf(key, sizeof(key), "%s%s", WS_KEY, WS_GUID);
+	mbedtls_sha1_ret((unsigned char *)key, strlen(key), sha);
+	mbedtls_base64_encode((unsigned char *)accept, sizeof(accept), &olen, sha, sizeof(sha));
+	if ((client_read_head(conn, head, sizeof(head)) < 0) ||
+		(strncmp(head, "HTTP/1.1 101", 12) != 0) ||
+		(strstr(head, accept) == NULL)){
+		printf("ws client: handshake failed\n%s\n", head);
+		host_net_release(conn);
+		return NULL;
+	}
+
+	return conn;
+}
+
+
+/*************************************************************************
+ *
+ * send one masked frame
+ *
+ * ***********************************************************************/
+void ws_client_send(struct netconn *conn, uint8_t opcode, const void *data, uint32_t len){
+	uint32_t frame_len;
+
+	frame_len = ws_gen_frame(frame, 1, 0, opcode, true, false, data, len);
+	host_net_send(conn, frame, frame_len);
+}
+
+
+void ws_client_send_text(struct netconn *conn, const char *text){
+
+	ws_client_send(conn, 0x1, text, strlen(text));
+}
+
+
+/*************************************************************************
+ *
+ * receive one frame of the server, payload is ended by 0
+ * output: payload length, -1 - no frame
+ *
+ * ***********************************************************************/
+int ws_client_recv(struct netconn *conn, uint8_t *opcode, char *buff, int size,
+					uint32_t wait_ms){
+	uint8_t head[4];
+	uint32_t len;
+
+	if (read_exact(conn, head, 2, wait_ms) == false){
+		return -1;
+	}
+	*opcode = head[0] & 0x0F;
+	len = head[1] & 0x7F;
+	if (len == 126){
+		if (read_exact(conn, head + 2, 2, wait_ms) == false){
+			return -1;
+		}
+		len = (head[2] << 8) | head[3];
+	}
+	if ((len >= size) || (read_exact(conn, buff, len, wait_ms) == false)){
+		return -1;
+	}
+	buff[len] = 0;
+
+	return len;
+}
+
+
+/*************************************************************************
+ *
+ * receive frames until text frame which contains text
+ * output: length of the frame, -1 - not received
+ *
+ * ***********************************************************************/
+int ws_client_wait_for(struct netconn *conn, const char *text, char *buff, int size){
+	uint8_t opcode;
+	int len;
+
+	for (;;){
+		len = ws_client_recv(conn, &opcode, buff, size, CLIENT_WAIT_MS);
+		if (len < 0){
+			return -1;
+		}
+		if ((opcode == 0x1) && (strstr(buff, text) != NULL)){
+			return len;
+		}
+	}
+}
@@ -0,0 +1,36 @@
+/*
+ * ws_client.h
+ *
+ *  Host tests: HTTP and websocket client of the server running
+ *  on host port (host_port.h)
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WS_CLIENT_H_
+#define WS_CLIENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lwip/api.h"
+
+#define CLIENT_WAIT_MS		3000	//the longest wait for an answer
+
+int
+	client_read_head(struct netconn *conn, char *buff, int size);
+struct netconn *
+	ws_client_open(const char *path, const char *headers);
+void
+	ws_client_send(struct netconn *conn, uint8_t opcode, const void *data, uint32_t len);
+void
+	ws_client_send_text(struct netconn *conn, const char *text);
+int
+	ws_client_recv(struct netconn *conn, uint8_t *opcode, char *buff, int size,
+				uint32_t wait_ms);
+int
+	ws_client_wait_for(struct netconn *conn, const char *text, char *buff, int size);
+
+#endif /* WS_CLIENT_H_ */
@@ -0,0 +1,109 @@
+/*
+ * ws_decoder_bench.c
+ *
+ *  Host throughput of websocket frame decoder (ws_decoder.c). Masked
+ *  frames of several sizes are decoded from TCP sized chunks, result is
+ *  given in MB/s of frame data and in frames/s.
+ *
+ *  usage: ws_decoder_bench [MB per frame size]
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ws_decoder.h"
+#include "ws_frame_gen.h"
+
+#define CHUNK_LEN		1460	//TCP segment (MSS)
+#define STREAM_SIZE		(1 << 20)
+#define MAX_LEN			65535
+
+static uint8_t stream[STREAM_SIZE + WS_GEN_HEAD_MAX + MAX_LEN];
+static uint8_t payload[MAX_LEN];
+static uint32_t frames = 0;
+static uint32_t errors = 0;
+
+
+static void control_cb(void *ctx, uint8_t opcode, uint8_t *data, uint8_t len){
+
+	frames++;
+}
+
+
+static void message_cb(void *ctx, uint8_t opcode, uint8_t rsv, uint8_t *msg, uint32_t len){
+
+	frames++;
+}
+
+
+static void error_cb(void *ctx, uint16_t code, const char *info){
+
+	errors++;
+}
+
+
+static double now_s(void){
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/*************************************************************************
+ *
+ * decode about total_mb MB of frames with frame_len payload
+ *
+ * ***********************************************************************/
+static void bench(uint32_t frame_len, uint8_t opcode, uint32_t total_mb){
+	ws_decoder_t d;
+	uint32_t len = 0, stream_frames = 0, rounds;
+	double t0, t;
+
+	for (uint32_t i = 0; i < frame_len; i++){
+		payload[i] = 'a' + (i % 26);
+	}
+	while (len < STREAM_SIZE){
+		len += ws_gen_frame(stream + len, 1, 0, opcode, true, false, payload, frame_len);
+		stream_frames++;
+	}
+	rounds = (total_mb * (1 << 20)) / len + 1;
+
+	ws_decoder_init(&d, MAX_LEN, false, NULL, control_cb, message_cb, error_cb);
+	frames = 0;
+	t0 = now_s();
+	for (uint32_t r = 0; r < rounds; r++){
+		for (uint32_t pos = 0; pos < len; pos += CHUNK_LEN){
+			ws_decode(&d, stream + pos, (len - pos < CHUNK_LEN) ? len - pos : CHUNK_LEN);
+		}
+	}
+	t = now_s() - t0;
+	ws_decoder_release(&d);
+
+	if ((errors > 0) || (frames != rounds * stream_frames)){
+		printf("%-6s %6u B: decoder error\n", (opcode == WS_OP_PIN) ? "ping" : "text", frame_len);
+		return;
+	}
+	printf("%-6s %6u B: %8.1f MB/s %10.0f frames/s\n",
+			(opcode == WS_OP_PIN) ? "ping" : "text", frame_len,
+			(double)len * rounds / t / (1 << 20), frames / t);
+}
+
+
+int main(int argc, char *argv[]){
+	uint32_t total_mb = (argc > 1) ? strtoul(argv[1], NULL, 0) : 256;
+	const uint32_t sizes[] = {16, 125, 1024, 4096, 16384};
+
+	test_srand(1);
+	bench(8, WS_OP_PIN, total_mb);
+	for (int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++){
+		bench(sizes[i], WS_OP_TXT, total_mb);
+	}
+
+	return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,364 @@
+/*
+ * ws_decoder_fuzz.c
+ *
+ *  Host test of websocket frame decoder (ws_decoder.c), built with
+ *  address and undefined behaviour sanitizers by test/Makefile.
+ *  	- protocol errors close connection with proper status code
+ *  	- random valid messages (fragmented, with control frames between
+ *  	  fragments) fed in random chunks are decoded without changes,
+ *  	  with message buffer from heap and fixed one (STATIC_ALLOC)
+ *  	- mutated and random streams don't crash decoder, callbacks get
+ *  	  only correct data and nothing is called after error
+ *
+ *  usage: ws_decoder_fuzz [iterations] [seed]
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ws_decoder.h"
+#include "ws_frame_gen.h"
+
+#define MAX_LEN			4096	//max message length, as default Kconfig
+#define MAX_EVENTS		64
+#define STREAM_SIZE		(4 * (MAX_LEN + 64 * (WS_GEN_HEAD_MAX + WS_CTRL_MAX_LEN)))
+
+typedef struct{
+	uint8_t opcode;
+	uint8_t rsv;
+	uint32_t len;
+	uint8_t *data;
+}event_t;
+
+typedef struct{
+	event_t ev[MAX_EVENTS];
+	int n;
+	int errors;
+	uint16_t code;
+	int bad;			//callback called with incorrect data
+}record_t;
+
+static record_t got, exp;
+static uint8_t stream[STREAM_SIZE];
+static uint8_t payload[MAX_LEN + 1];
+static uint8_t fixed_buff[MAX_LEN + 1];	//message buffer with STATIC_ALLOC
+static int failures = 0;
+
+
+/*************************************************************************
+ *
+ * record of decoder callbacks
+ *
+ * ***********************************************************************/
+static void event_add(record_t *r, uint8_t opcode, uint8_t rsv, const uint8_t *data, uint32_t len){
+
+	if (r -> n == MAX_EVENTS){
+		r -> bad++;
+		return;
+	}
+	event_t *e = &r -> ev[r -> n++];
+	e -> opcode = opcode;
+	e -> rsv = rsv;
+	e -> len = len;
+	e -> data = malloc(len + 1);
+	memcpy(e -> data, data, len);
+}
+
+
+static void record_clear(record_t *r){
+
+	for (int i = 0; i < r -> n; i++){
+		free(r -> ev[i].data);
+	}
+	memset(r, 0, sizeof(record_t));
+}
+
+
+static void control_cb(void *ctx, uint8_t opcode, uint8_t *data, uint8_t len){
+	record_t *r = ctx;
+
+	if ((r -> errors > 0) || (len > WS_CTRL_MAX_LEN) ||
+		((opcode != WS_OP_CLS) && (opcode != WS_OP_PIN) && (opcode != WS_OP_PON))){
+		r -> bad++;
+	}
+	event_add(r, opcode, 0, data, len);
+}
+
+
+static void message_cb(void *ctx, uint8_t opcode, uint8_t rsv, uint8_t *msg, uint32_t len){
+	record_t *r = ctx;
+
+	if ((r -> errors > 0) || (len > MAX_LEN) || (msg[len] != 0) ||
+		((opcode != WS_OP_TXT) && (opcode != WS_OP_BIN)) || (rsv & ~WS_RSV1)){
+		r -> bad++;
+	}
+	event_add(r, opcode, rsv, msg, len);
+}
+
+
+static void error_cb(void *ctx, uint16_t code, const char *info){
+	record_t *r = ctx;
+
+	r -> errors++;
+	r -> code = code;
+}
+
+
+/*************************************************************************
+ *
+ * feed stream to the decoder in random chunks, every chunk in own
+ * buffer, so sanitizer finds reads outside of data
+ *
+ * ***********************************************************************/
+static int8_t feed(ws_decoder_t *d, const uint8_t *data, uint32_t len){
+	int8_t res = 0;
+
+	while (len > 0){
+		uint32_t n = 1 + test_rand() % ((test_rand() & 1) ? len : 16);
+		uint8_t *chunk;
+
+		n = (n > len) ? len : n;
+		chunk = malloc(n);
+		memcpy(chunk, data, n);
+		if (ws_decode(d, chunk, n) < 0){
+			res = -1;
+		}
+		free(chunk);
+		data += n;
+		len -= n;
+	}
+
+	return res;
+}
+
+
+static void check(int ok, const char *name, uint32_t iter){
+
+	if (!ok){
+		failures++;
+		if (failures < 20){
+			printf("FAIL: %s (iteration %u)\n", name, iter);
+		}
+	}
+}
+
+
+/*************************************************************************
+ *
+ * one incorrect frame, decoder closes with code
+ *
+ * ***********************************************************************/
+static void protocol_case(const char *name, uint8_t fin, uint8_t rsv, uint8_t opcode,
+						bool masked, uint32_t len, bool rsv1_allowed, uint16_t code){
+	ws_decoder_t d;
+	uint32_t n;
+
+	record_clear(&got);
+	ws_decoder_init(&d, MAX_LEN, rsv1_allowed, &got, control_cb, message_cb, error_cb);
+	memset(payload, 'a', len);
+	n = ws_gen_frame(stream, fin, rsv, opcode, masked, false, payload, len);
+	check((ws_decode(&d, stream, n) == -1) && (got.errors == 1) && (got.code == code) &&
+			(got.n == 0), name, 0);
+	//next data is ignored
+	n = ws_gen_frame(stream, 1, 0, WS_OP_TXT, true, false, payload, 4);
+	check((ws_decode(&d, stream, n) == -1) && (got.errors == 1) && (got.n == 0), name, 1);
+	ws_decoder_release(&d);
+}
+
+
+static void protocol_cases(void){
+	ws_decoder_t d;
+	uint32_t n;
+
+	protocol_case("unmasked text frame", 1, 0, WS_OP_TXT, false, 5, false, PROTOCOL_ERR);
+	protocol_case("unmasked ping", 1, 0, WS_OP_PIN, false, 0, false, PROTOCOL_ERR);
+	protocol_case("RSV1 without deflate", 1, WS_RSV1, WS_OP_TXT, true, 5, false, PROTOCOL_ERR);
+	protocol_case("RSV2", 1, 0x2, WS_OP_TXT, true, 5, true, PROTOCOL_ERR);
+	protocol_case("long control frame", 1, 0, WS_OP_PIN, true, 126, false, PROTOCOL_ERR);
+	protocol_case("fragmented control frame", 0, 0, WS_OP_PIN, true, 2, false, PROTOCOL_ERR);
+	protocol_case("reserved opcode", 1, 0, 0x3, true, 2, false, PROTOCOL_ERR);
+	protocol_case("reserved control opcode", 1, 0, 0xB, true, 2, false, PROTOCOL_ERR);
+	protocol_case("continuation first", 1, 0, WS_OP_CON, true, 2, false, PROTOCOL_ERR);
+	protocol_case("message too long", 1, 0, WS_OP_BIN, true, MAX_LEN + 1, false, DATA_TO_BIG);
+
+	//fragments longer than limit together
+	record_clear(&got);
+	ws_decoder_init(&d, MAX_LEN, false, &got, control_cb, message_cb, error_cb);
+	n = ws_gen_frame(stream, 0, 0, WS_OP_TXT, true, false, payload, MAX_LEN);
+	n += ws_gen_frame(stream + n, 1, 0, WS_OP_CON, true, false, payload, 1);
+	check((ws_decode(&d, stream, n) == -1) && (got.code == DATA_TO_BIG), "joined fragments too long", 0);
+	ws_decoder_release(&d);
+
+	//new message before the last fragment
+	record_clear(&got);
+	ws_decoder_init(&d, MAX_LEN, false, &got, control_cb, message_cb, error_cb);
+	n = ws_gen_frame(stream, 0, 0, WS_OP_TXT, true, false, payload, 3);
+	n += ws_gen_frame(stream + n, 1, 0, WS_OP_TXT, true, false, payload, 3);
+	check((ws_decode(&d, stream, n) == -1) && (got.code == PROTOCOL_ERR), "message not finished", 0);
+	ws_decoder_release(&d);
+}
+
+
+/*************************************************************************
+ *
+ * random valid stream, expected callbacks are written into exp
+ *
+ * ***********************************************************************/
+static uint32_t gen_stream(bool rsv1_allowed){
+	uint32_t pos = 0;
+	int msgs = 1 + test_rand() % 6;
+
+	for (int m = 0; m < msgs; m++){
+		uint8_t opcode = (test_rand() & 1) ? WS_OP_TXT : WS_OP_BIN;
+		uint8_t rsv = ((rsv1_allowed == true) && (test_rand() & 1)) ? WS_RSV1 : 0;
+		uint32_t len = test_rand() % ((test_rand() % 4 == 0) ? (MAX_LEN + 1) : 200);
+		int frags = 1 + test_rand() % 4;
+		uint32_t done = 0;
+
+		for (uint32_t i = 0; i < len; i++){
+			payload[i] = test_rand();
+		}
+		for (int f = 0; f < frags; f++){
+			uint32_t n = (f == frags - 1) ? len - done : test_rand() % (len - done + 1);
+
+			pos += ws_gen_frame(stream + pos, (f == frags - 1), (f == 0) ? rsv : 0,
+								(f == 0) ? opcode : WS_OP_CON, true, (test_rand() % 8 == 0),
+								payload + done, n);
+			done += n;
+			if (f == frags - 1){
+				event_add(&exp, opcode, rsv, payload, len);
+			}
+			if ((test_rand() % 3 == 0) && (exp.n < MAX_EVENTS - 8)){
+				//control frame between fragments or messages
+				uint8_t ctrl[WS_CTRL_MAX_LEN];
+				uint8_t ctrl_op = (test_rand() & 1) ? WS_OP_PIN : WS_OP_PON;
+				uint8_t ctrl_len = test_rand() % (WS_CTRL_MAX_LEN + 1);
+
+				for (int i = 0; i < ctrl_len; i++){
+					ctrl[i] = test_rand();
+				}
+				pos += ws_gen_frame(stream + pos, 1, 0, ctrl_op, true, false, ctrl, ctrl_len);
+				event_add(&exp, ctrl_op, 0, ctrl, ctrl_len);
+			}
+		}
+	}
+
+	return pos;
+}
+
+
+static bool records_equal(record_t *a, record_t *b){
+
+	if (a -> n != b -> n){
+		return false;
+	}
+	for (int i = 0; i < a -> n; i++){
+		event_t *x = &a -> ev[i], *y = &b -> ev[i];
+
+		if ((x -> opcode != y -> opcode) || (x -> rsv != y -> rsv) || (x -> len != y -> len) ||
+			(memcmp(x -> data, y -> data, x -> len) != 0)){
+			return false;
+		}
+	}
+	return true;
+}
+
+
+static void roundtrip_case(uint32_t iter){
+	ws_decoder_t d;
+	bool rsv1_allowed = test_rand() & 1;
+	uint32_t len;
+
+	record_clear(&got);
+	record_clear(&exp);
+	ws_decoder_init(&d, MAX_LEN, rsv1_allowed, &got, control_cb, message_cb, error_cb);
+	if (test_rand() & 1){
+		ws_decoder_set_buffer(&d, fixed_buff, sizeof(fixed_buff));
+	}
+	len = gen_stream(rsv1_allowed);
+	check(feed(&d, stream, len) == 0, "valid stream rejected", iter);
+	check((got.errors == 0) && (got.bad == 0), "callback data", iter);
+	check(records_equal(&got, &exp), "decoded data differs", iter);
+	check(d.state == WS_DEC_HEAD, "decoder not at frame boundary", iter);
+	ws_decoder_release(&d);
+}
+
+
+/*************************************************************************
+ *
+ * mutated valid stream or random bytes
+ *
+ * ***********************************************************************/
+static void mutation_case(uint32_t iter){
+	ws_decoder_t d;
+	uint32_t len;
+	int8_t res;
+
+	record_clear(&got);
+	record_clear(&exp);
+	ws_decoder_init(&d, MAX_LEN, test_rand() & 1, &got, control_cb, message_cb, error_cb);
+	if (test_rand() & 1){
+		ws_decoder_set_buffer(&d, fixed_buff, sizeof(fixed_buff));
+	}
+	if (test_rand() % 4 == 0){
+		len = test_rand() % 512;
+		for (uint32_t i = 0; i < len; i++){
+			stream[i] = test_rand();
+		}
+		//most of random frames are unmasked, so also try with mask bit
+		if ((len > 1) && (test_rand() & 1)){
+			stream[1] |= 0x80;
+		}
+	}
+	else{
+		len = gen_stream(true);
+		for (int k = 1 + test_rand() % 4; k > 0; k--){
+			uint32_t pos = test_rand() % len;
+
+			switch (test_rand() % 4){
+			case 0:
+				stream[pos] ^= 1 << (test_rand() % 8);
+				break;
+			case 1:
+				stream[pos] = test_rand();
+				break;
+			case 2:
+				len = pos + 1; //truncated stream
+				break;
+			default:
+				//random header byte at frame start is most interesting
+				stream[pos] = (test_rand() & 1) ? 0xFF : 0x7F;
+				break;
+			}
+		}
+	}
+	res = feed(&d, stream, len);
+	check(got.bad == 0, "callback data after mutation", iter);
+	check(got.errors <= 1, "error reported twice", iter);
+	check((res == 0) == (got.errors == 0), "result and error callback differ", iter);
+	ws_decoder_release(&d);
+}
+
+
+int main(int argc, char *argv[]){
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 20000;
+	uint32_t seed = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1;
+
+	test_srand(seed);
+	protocol_cases();
+	for (uint32_t i = 0; i < iterations; i++){
+		roundtrip_case(i);
+		mutation_case(i);
+	}
+	record_clear(&got);
+	record_clear(&exp);
+
+	printf("ws_decoder_fuzz: %u iterations, seed %u, %d failures\n",
+			iterations, seed, failures);
+
+	return (failures == 0) ? 0 : 1;
+}
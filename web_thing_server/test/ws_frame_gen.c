@@ -0,0 +1,80 @@
+/*
+ * ws_frame_gen.c
+ *
+ *  Host tests: client frames for websocket decoder
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <string.h>
+
+#include "ws_frame_gen.h"
+
+static uint32_t rand_state = 1;
+
+
+/*************************************************************************
+ *
+ * xorshift generator, runs are repeatable for given seed
+ *
+ * ***********************************************************************/
+void test_srand(uint32_t seed){
+
+	rand_state = (seed == 0) ? 1 : seed;
+}
+
+
+uint32_t test_rand(void){
+	uint32_t x = rand_state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	rand_state = x;
+
+	return x;
+}
+
+
+/*************************************************************************
+ *
+ * write frame into out (WS_GEN_HEAD_MAX + len bytes needed)
+ * 		wide_len - 64-bit length field also for short payload
+ * returns frame length
+ *
+ * ***********************************************************************/
+uint32_t ws_gen_frame(uint8_t *out, uint8_t fin, uint8_t rsv, uint8_t opcode, bool masked,
+					bool wide_len, const uint8_t *payload, uint32_t len){
+	uint32_t pos = 2;
+	uint8_t mask[4];
+
+	out[0] = (fin << 7) | ((rsv & 0x7) << 4) | (opcode & 0xF);
+	out[1] = (masked == true) ? 0x80 : 0;
+	if ((wide_len == false) && (len < 126)){
+		out[1] |= len;
+	}
+	else if ((wide_len == false) && (len <= 0xFFFF)){
+		out[1] |= 126;
+		out[pos++] = len >> 8;
+		out[pos++] = len & 0xFF;
+	}
+	else{
+		out[1] |= 127;
+		for (int i = 7; i >= 0; i--){
+			out[pos++] = (i >= 4) ? 0 : (len >> (8 * i)) & 0xFF;
+		}
+	}
+	if (masked == true){
+		uint32_t r = test_rand();
+
+		memcpy(mask, &r, 4);
+		memcpy(out + pos, mask, 4);
+		pos += 4;
+	}
+	for (uint32_t i = 0; i < len; i++){
+		out[pos + i] = (masked == true) ? payload[i] ^ mask[i & 0x3] : payload[i];
+	}
+
+	return pos + len;
+}
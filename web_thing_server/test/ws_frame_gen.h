@@ -0,0 +1,27 @@
+/*
+ * ws_frame_gen.h
+ *
+ *  Host tests: client frames for websocket decoder
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+
+#ifndef WS_FRAME_GEN_H_
+#define WS_FRAME_GEN_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define WS_GEN_HEAD_MAX		14
+
+void
+	test_srand(uint32_t seed);
+uint32_t
+	test_rand(void);
+uint32_t
+	ws_gen_frame(uint8_t *out, uint8_t fin, uint8_t rsv, uint8_t opcode, bool masked,
+				bool wide_len, const uint8_t *payload, uint32_t len);
+
+#endif /* WS_FRAME_GEN_H_ */
@@ -0,0 +1,242 @@
+/*
+ * ws_server_test.c
+ *
+ *  Host test of websocket API: the server runs on host port, the test
+ *  is its websocket client, requests of the messages must reach the thing
+ *  and refused requests must be answered by error message; the late
+ *  completion of a cancelled request must not complete the next one;
+ *  dead-band and on_change_only of notification policy apply together
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "simple_web_thing_server.h"
+#include "host_port.h"
+#include "ws_client.h"
+
+#define MSG_LEN		2048
+
+static thing_t *thing;
+static action_t *constant_on, *hold;
+static property_t *power;
+static double power_w = 0;
+static const property_desc_t power_desc = {
+	.id = "power",
+	.title = "Power",
+	.type = VAL_NUMBER,
+	.read_only = true,
+	.notify = {.dead_band_rel = 0.1, .on_change_only = true},
+};
+static double duration_min = 1, duration_max = 600;
+static at_type_t thing_type = {.at_type = "Light"};
+static volatile int runs = 0, run_duration = 0;
+static volatile int hold_runs = 0, hold_index = 0, hold_cancelled = 0;
+static int failures = 0;
+static char msg[MSG_LEN];
+
+
+static int8_t constant_on_run(action_inputs_t *inputs){
+	request_value_t *duration = get_action_input(inputs, "duration");
+
+	run_duration = (duration != NULL) ? duration -> value.int_val : -1;
+	runs++;
+	complete_action(thing -> thing_nr, "constant_on", ACT_COMPLETED);
+
+	return 0;
+}
+
+
+//"hold" is completed by the test, not by run function
+static int8_t hold_run(action_inputs_t *inputs){
+
+	hold_index = inputs -> request_index;
+	hold_runs++;
+
+	return 0;
+}
+
+
+static int8_t hold_cancel(int request_index){
+
+	hold_cancelled = request_index;
+	return 0;
+}
+
+
+static ACTION_STATUS request_status(action_t *a, int index){
+	action_request_t *ar;
+	ACTION_STATUS status = ACT_DELETED;
+
+	action_list_lock();
+	ar = get_request_ptr(a, index);
+	if (ar != NULL){
+		status = ar -> status;
+	}
+	action_list_unlock();
+
+	return status;
+}
+
+
+static void check(bool ok, const char *what){
+
+	printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+	if (ok == false){
+		failures++;
+	}
+}
+
+
+//wait for the next run of action, false - no run
+static bool wait_run(int prev_runs){
+
+	for (int i = 0; (i < CLIENT_WAIT_MS) && (runs == prev_runs); i++){
+		vTaskDelay(1);
+	}
+	return (runs != prev_runs);
+}
+
+
+static void thing_create(void){
+
+	thing = thing_init();
+	thing -> id = "Led";
+	thing -> at_context = things_context;
+	thing -> model_len = 1500;
+	set_thing_type(thing, &thing_type);
+	thing -> description = "test thing";
+
+	constant_on = action_init();
+	constant_on -> id = "constant_on";
+	constant_on -> title = "Constant ON";
+	constant_on -> description = "Set led ON for some seconds";
+	constant_on -> run_typed = constant_on_run;
+	add_action_input_prop(constant_on, action_input_prop_init("duration", VAL_INTEGER, true,
+							&duration_min, &duration_max, "seconds"));
+	add_action(thing, constant_on);
+
+	hold = action_init();
+	hold -> id = "hold";
+	hold -> title = "Hold";
+	hold -> description = "Running until completed by the test";
+	hold -> run_typed = hold_run;
+	hold -> cancel = hold_cancel;
+	add_action(thing, hold);
+
+	power = property_init(&power_desc, &power_w, xSemaphoreCreateMutex());
+	add_property(thing, power);
+	add_thing_to_server(thing);
+}
+
+
+int main(void){
+	struct netconn *conn;
+	int prev;
+
+	root_node_init();
+	thing_create();
+	start_web_thing_server(8080, "test", "local");
+
+	conn = ws_client_open("/0", "");
+	check(conn != NULL, "websocket opened");
+	if (conn == NULL){
+		return 1;
+	}
+
+	//input object nested in the action object
+	prev = runs;
+	ws_client_send_text(conn, "{\"messageType\":\"requestAction\","\
+						"\"data\":{\"constant_on\":{\"input\":{\"duration\":5}}}}");
+	check(wait_run(prev) && (run_duration == 5), "nested requestAction runs with input");
+	check(ws_client_wait_for(conn, "\"status\":\"completed\"", msg, MSG_LEN) > 0,
+			"actionStatus completed received");
+
+	//spaces and the input which is not the first key
+	prev = runs;
+	ws_client_send_text(conn, "{\"messageType\": \"requestAction\", \"data\": "\
+						"{\"constant_on\": {\"href\": \"/0/actions/constant_on\", "\
+						"\"input\": {\"duration\": 7}}}}");
+	check(wait_run(prev) && (run_duration == 7), "requestAction with href and spaces");
+
+	//refused requests
+	prev = runs;
+	ws_client_send_text(conn, "{\"messageType\":\"requestAction\","\
+						"\"data\":{\"constant_on\":{\"input\":{\"duration\":0}}}}");
+	check(ws_client_wait_for(conn, "\"messageType\":\"error\"", msg, MSG_LEN) > 0 &&
+			(strstr(msg, "400 Bad Request") != NULL), "input out of range: error message");
+	ws_client_send_text(conn, "{\"messageType\":\"requestAction\","\
+						"\"data\":{\"blink\":{\"input\":{}}}}");
+	check(ws_client_wait_for(conn, "\"messageType\":\"error\"", msg, MSG_LEN) > 0,
+			"unknown action: error message");
+	ws_client_send_text(conn, "{\"messageType\":\"requestAction\","\
+						"\"data\":{\"constant_on\":{\"input\":{\"duration\":5");
+	check(ws_client_wait_for(conn, "\"messageType\":\"error\"", msg, MSG_LEN) > 0,
+			"input object not closed: error message");
+	check(runs == prev, "refused requests not run");
+
+	//completion of request by index
+	int first, second;
+	ws_client_send_text(conn, "{\"messageType\":\"requestAction\","\
+						"\"data\":{\"hold\":{\"input\":{}}}}");
+	for (int i = 0; (i < CLIENT_WAIT_MS) && (hold_runs == 0); i++){
+		vTaskDelay(1);
+	}
+	first = hold_index;
+	check((hold_runs == 1) && (first > 0), "hold request runs with its index");
+	check(complete_action_request(thing -> thing_nr, "hold", first + 1, ACT_COMPLETED) < 0,
+			"completion of other request ignored");
+	check(request_status(hold, first) == ACT_EXECUTED, "running request not completed");
+	ws_client_send_text(conn, "{\"messageType\":\"requestAction\","\
+						"\"data\":{\"hold\":{\"input\":{}}}}");
+	for (int i = 0; (i < CLIENT_WAIT_MS) && (hold -> last_request_index == first); i++){
+		vTaskDelay(1);
+	}
+	second = hold -> last_request_index;
+	check((second != first) && (request_status(hold, second) == ACT_PENDING),
+			"next request waits");
+
+	//cancel the first one, the second is started, then the thing
+	//completes the first one late
+	delete_action_request(thing -> thing_nr, "hold", first);
+	check(hold_cancelled == first, "running request cancelled");
+	for (int i = 0; (i < CLIENT_WAIT_MS) && (hold_runs == 1); i++){
+		vTaskDelay(1);
+	}
+	check((hold_runs == 2) && (hold_index == second), "next request started");
+	check(complete_action_request(thing -> thing_nr, "hold", first, ACT_COMPLETED) < 0,
+			"late completion of cancelled request ignored");
+	check(request_status(hold, second) == ACT_EXECUTED, "next request still running");
+	check(complete_action_request(thing -> thing_nr, "hold", second, ACT_COMPLETED) == 0,
+			"next request completed by its index");
+	check(request_status(hold, second) == ACT_COMPLETED, "next request status completed");
+
+	//relative dead-band of 0 is 0, the same value is held back by
+	//on_change_only
+	check(inform_all_subscribers_prop(power) == 0, "the first value sent");
+	check(inform_all_subscribers_prop(power) == 1, "the same value held back");
+	power_w = 0.5;
+	check(inform_all_subscribers_prop(power) == 0, "value out of dead-band sent");
+	power_w = 0.52;
+	check(inform_all_subscribers_prop(power) == 1, "value in dead-band held back");
+	check(ws_client_wait_for(conn, "\"power\":0.5", msg, MSG_LEN) > 0,
+			"notification received");
+
+	host_net_client_close(conn);
+	host_net_release(conn);
+
+	if (failures > 0){
+		printf("ws_server_test: %i FAILED\n", failures);
+		return 1;
+	}
+	printf("ws_server_test: all passed\n");
+	return 0;
+}
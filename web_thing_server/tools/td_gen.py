@@ -0,0 +1,450 @@
+#!/usr/bin/env python
+#
+# td_gen.py
+#
+#  Created on: Oct 18, 2026
+#      Author: Krzysztof Zurek
+#      e-mail: krzzurek@gmail.com
+#
+# This file is a part of the "Simple Web Thing Server" project.
+# Build time generator of the thing code from a declarative spec (JSON or
+# YAML). For <spec>.json it writes <spec>_td.h and <spec>_td.c with:
+#  - const property descriptors (kept in flash),
+#  - property indexes and typed accessors,
+#  - the thing's description (TD) as one const string, the server only
+#    puts the thing number and host into it while sending,
+#  - <name>_thing_init(), which builds the thing at boot,
+# <name> is the "name" field of the spec (prefix of all C symbols).
+#
+# usage: td_gen.py --out-dir <dir> <spec.json|spec.yaml>
+#
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+# markers replaced by the server, must be the same as in web_thing.h
+TD_MARK_THING_NR = '\x01'
+TD_MARK_HOST = '\x02'
+
+VAL_TYPES = {
+    'null': 'VAL_NULL',
+    'boolean': 'VAL_BOOLEAN',
+    'object': 'VAL_OBJECT',
+    'array': 'VAL_ARRAY',
+    'number': 'VAL_NUMBER',
+    'integer': 'VAL_INTEGER',
+    'string': 'VAL_STRING',
+}
+
+# C type of the value pointer given to property_init()
+C_TYPES = {
+    'boolean': 'bool',
+    'integer': 'int',
+    'number': 'double',
+    'string': 'char',
+    'object': 'void',
+    'array': 'void',
+}
+
+
+class SpecError(Exception):
+    pass
+
+
+def load_spec(path):
+    with open(path, 'r') as f:
+        text = f.read()
+    if path.endswith(('.yaml', '.yml')):
+        try:
+            import yaml
+        except ImportError:
+            raise SpecError('PyYAML is needed for %s, use JSON spec instead' % path)
+        return yaml.safe_load(text)
+    return json.loads(text)
+
+
+def c_ident(s):
+    s = re.sub(r'[^0-9A-Za-z_]', '_', s)
+    if s[0].isdigit():
+        s = '_' + s
+    return s
+
+
+def c_str(s):
+    """C string literal, markers and non ASCII bytes as octal escapes"""
+    out = ['"']
+    for ch in s.encode('utf-8'):
+        c = chr(ch)
+        if c == '"' or c == '\\':
+            out.append('\\' + c)
+        elif 32 <= ch < 127:
+            out.append(c)
+        else:
+            out.append('\\%03o' % ch)
+    out.append('"')
+    return ''.join(out)
+
+
+def c_str_lines(s, width=72):
+    """long string split into lines, breaks are placed after commas"""
+    lines = []
+    while len(s) > width:
+        cut = s.rfind(',', 0, width)
+        if cut <= 0:
+            cut = width - 1
+        lines.append(c_str(s[:cut + 1]))
+        s = s[cut + 1:]
+    lines.append(c_str(s))
+    return lines
+
+
+def js(s):
+    """json string as the server writes it (no escaping of spec texts)"""
+    return '"%s"' % s
+
+
+def f32(v):
+    """float as stored in min_max_t"""
+    return struct.unpack('f', struct.pack('f', float(v)))[0]
+
+
+def th_lk():
+    return '/' + TD_MARK_THING_NR + '/'
+
+
+# ---------------------------------------------------------------------------
+# TD fragments, the same format as *_model_jsonize() functions in the server
+def property_model(pid, p):
+    ptype = p['type']
+    if ptype == 'null':
+        return None
+    unit = p.get('unit')
+    extra = ''
+    enum = ''
+    if ptype in ('integer', 'number'):
+        vmin = p.get('minimum', 0)
+        vmax = p.get('maximum', 0)
+        if ptype == 'integer':
+            smin, smax = '%i' % int(vmin), '%i' % int(vmax)
+            limits = int(vmin) != int(vmax)
+        else:
+            smin, smax = '%5.3f' % f32(vmin), '%5.3f' % f32(vmax)
+            limits = f32(vmin) != f32(vmax)
+        if limits:
+            extra = '"minimum":%s,"maximum":%s,"unit":"%s",' % (
+                smin, smax, unit if unit is not None else '(null)')
+        elif unit is not None:
+            extra = '"unit":"%s",' % unit
+    elif ptype == 'string' and 'enum' in p:
+        enum = '"enum":[%s],' % ','.join(js(e) for e in p['enum'])
+    elif ptype != 'boolean':
+        if 'model' not in p:
+            raise SpecError('property "%s": type %s needs "model"' % (pid, ptype))
+        extra = ''.join('"%s":%s,' % (k, json.dumps(v, separators=(',', ':')))
+                        for k, v in p['model'].items())
+    return ('"%s":{"@type":"%s","title":"%s","type":"%s",%s"description":"%s",%s'
+            '"readOnly":%s,"links":[{"rel":"property","href":"%sproperties/%s"}]}') % (
+        pid, p.get('@type', ''), p.get('title', pid), ptype, enum,
+        p.get('description', ''), extra,
+        'true' if p.get('readOnly', False) else 'false', th_lk(), pid)
+
+
+def input_prop_model(iid, ip):
+    itype = ip['type']
+    if itype == 'integer':
+        return '"%s":{"type":"%s","minimum":%i,"maximum":%i,"unit":"%s"}' % (
+            iid, itype, int(ip.get('minimum', 0)), int(ip.get('maximum', 0)),
+            ip.get('unit', ''))
+    if itype == 'number':
+        return '"%s":{"type":"%s","minimum":%4.2f,"maximum":%4.2f,"unit":"%s"}' % (
+            iid, itype, ip.get('minimum', 0), ip.get('maximum', 0),
+            ip.get('unit', ''))
+    return '"%s":{"type":"%s"}' % (iid, itype)
+
+
+def action_model(aid, a):
+    inputs = a.get('input', {})
+    props = inputs.get('properties', {})
+    required = [js(i) for i, ip in props.items() if ip.get('required', False)]
+    return ('"%s":{"title":"%s","description":"%s","input":{"@type":"%s",'
+            '"type":"object","required":[%s],"properties":{%s}},'
+            '"links":[{"rel":"action","href":"%sactions/%s"}]}') % (
+        aid, a.get('title', aid), a.get('description', ''),
+        inputs.get('@type', ''), ','.join(required),
+        ','.join(input_prop_model(i, ip) for i, ip in props.items()),
+        th_lk(), aid)
+
+
+def event_model(eid, e):
+    return ('"%s":{"title":"%s","description":"%s","@type":"%s","type":"%s",'
+            '"unit":"%s","links":[{"rel":"event","href":"%sevents/%s"}]}') % (
+        eid, e.get('title', eid), e.get('description', ''), e.get('@type', ''),
+        e['type'], e.get('unit', ''), th_lk(), eid)
+
+
+def thing_model(spec):
+    lk = '/' + TD_MARK_THING_NR
+    props = [property_model(i, p) for i, p in spec.get('properties', {}).items()]
+    links = ('{"rel":"properties","href":"%s/properties"},'
+             '{"rel":"actions","href":"%s/actions"},'
+             '{"rel":"events","href":"%s/events"},'
+             '{"rel":"alternate","href":"ws://%s%s"}') % (lk, lk, lk, TD_MARK_HOST, lk)
+    return ('"name":"%s","href":"%s","@context":"%s","@type":[%s],'
+            '"properties":{%s},"actions":{%s},"events":{%s},"links":[%s],'
+            '"description":"%s"') % (
+        spec['id'], lk, spec.get('@context', 'https://webthings.io/schemas'),
+        ','.join(js(t) for t in spec.get('@type', [])),
+        ','.join(p for p in props if p is not None),
+        ','.join(action_model(i, a) for i, a in spec.get('actions', {}).items()),
+        ','.join(event_model(i, e) for i, e in spec.get('events', {}).items()),
+        links, spec.get('description', ''))
+
+
+# ---------------------------------------------------------------------------
+# C code
+def desc_lines(name, pid, p):
+    ptype = p['type']
+    d = ['\t.id = %s,' % c_str(pid),
+         '\t.title = %s,' % c_str(p.get('title', pid)),
+         '\t.description = %s,' % c_str(p.get('description', '')),
+         '\t.at_type = %s,' % c_str(p.get('@type', '')),
+         '\t.type = %s,' % VAL_TYPES[ptype]]
+    if 'unit' in p:
+        d.append('\t.unit = %s,' % c_str(p['unit']))
+    field = 'int_val' if ptype != 'number' else 'float_val'
+    if 'minimum' in p:
+        d.append('\t.min_value.%s = %s,' % (field, p['minimum']))
+    if 'maximum' in p:
+        d.append('\t.max_value.%s = %s,' % (field, p['maximum']))
+    if 'enum' in p:
+        d.append('\t.enum_list = %s_%s_enum,' % (name, c_ident(pid)))
+    d.append('\t.read_only = %s,' % ('true' if p.get('readOnly', False) else 'false'))
+    for key, field in (('set', 'set'), ('value_jsonize', 'value_jsonize'),
+                       ('model_jsonize', 'model_jsonize')):
+        if key in p:
+            d.append('\t.%s = %s,' % (field, p[key]))
+    notify = p.get('notify')
+    if notify:
+        d.append('\t.notify = {%s},' % ', '.join(
+            '.%s = %s' % (k, ('true' if v else 'false') if isinstance(v, bool) else v)
+            for k, v in notify.items()))
+    return d
+
+
+def generate(spec, spec_name, base):
+    name = c_ident(spec['name'])
+    NAME = name.upper()
+    props = spec.get('properties', {})
+    actions = spec.get('actions', {})
+    events = spec.get('events', {})
+    for pid, p in props.items():
+        if p.get('type') not in VAL_TYPES:
+            raise SpecError('property "%s": unknown type' % pid)
+        if not p.get('readOnly', False) and 'set' not in p:
+            raise SpecError('property "%s": writable property needs "set"' % pid)
+    td = thing_model(spec)
+    td_len = len(td.encode('utf-8'))
+
+    def head(ext):
+        return ['/*', ' * %s_td.%s' % (base, ext), ' *',
+                ' * generated by td_gen.py from %s, do not edit' % spec_name,
+                ' */']
+
+    # header ---------------------------------------------------------------
+    h = head('h')
+    h += ['', '#ifndef %s_TD_H_' % NAME, '#define %s_TD_H_' % NAME, '',
+          '#include <stdbool.h>', '#include "simple_web_thing_server.h"', '',
+          '//thing description, see thing_set_td()',
+          '#define %s_TD_LEN %i' % (NAME, td_len),
+          'extern const char %s_td[];' % name, '',
+          '//indexes of properties in thing\'s table', 'enum{']
+    for i, pid in enumerate(props):
+        h.append('\t%s_%s = %i,' % (NAME, c_ident(pid).upper(), i))
+    h += ['\t%s_PROP_QUANT' % NAME, '};', '']
+    for pid in props:
+        h.append('extern const property_desc_t %s_%s_desc;' % (name, c_ident(pid)))
+    h.append('')
+
+    init_args = ['xSemaphoreHandle mux']
+    for pid, p in props.items():
+        init_args.append('%s *%s' % (C_TYPES.get(p['type'], 'void'), c_ident(pid)))
+    h += ['thing_t *',
+          '\t%s_thing_init(%s);' % (name, ', '.join(init_args)), '']
+
+    # typed accessors, simple values only
+    for pid, p in props.items():
+        ct = C_TYPES.get(p['type'])
+        pi = c_ident(pid)
+        h += ['static inline property_t *%s_%s(thing_t *t){' % (name, pi),
+              '\treturn t -> properties[%s_%s];' % (NAME, pi.upper()), '}']
+        if p['type'] in ('boolean', 'integer', 'number'):
+            h += ['%s' % ct,
+                  '\t%s_%s_get(thing_t *t);' % (name, pi),
+                  'void',
+                  '\t%s_%s_set(thing_t *t, %s value);' % (name, pi, ct)]
+        h.append('')
+    h.append('#endif /* %s_TD_H_ */' % NAME)
+
+    # source ---------------------------------------------------------------
+    c = head('c')
+    c += ['#include <string.h>', '',
+          '#include "simple_web_thing_server.h"',
+          '#include "%s_td.h"' % base, '']
+
+    # prototypes of the functions named in the spec
+    protos = []
+    for p in props.values():
+        if 'set' in p:
+            protos.append('int16_t %s(char *new_value_str);' % p['set'])
+        for key in ('value_jsonize', 'model_jsonize'):
+            if key in p:
+                protos.append('char *%s(property_t *p);' % p[key])
+    for a in actions.values():
+        if 'run' in a:
+            protos.append('int8_t %s(action_inputs_t *inputs);' % a['run'])
+        if 'cancel' in a:
+            protos.append('int8_t %s(int request_index);' % a['cancel'])
+    if protos:
+        c += ['//functions of the thing'] + list(dict.fromkeys(protos)) + ['']
+
+    c += ['//description of the thing'] + \
+         ['const char %s_td[] =' % name] + \
+         ['\t' + l for l in c_str_lines(td)]
+    c[-1] += ';'
+    c.append('')
+
+    for pid, p in props.items():
+        if 'enum' in p:
+            c += ['static const char *const %s_%s_enum[] = {' % (name, c_ident(pid)),
+                  '\t' + ', '.join(c_str(e) for e in p['enum']) + ', NULL};', '']
+        c += ['const property_desc_t %s_%s_desc = {' % (name, c_ident(pid))] + \
+             desc_lines(name, pid, p) + ['};', '']
+
+    types = spec.get('@type', [])
+    if types:
+        c.append('static at_type_t %s_type[] = {' % name)
+        for t in types:
+            c.append('\t{%s, NULL},' % c_str(t))
+        c += ['};', '']
+    for aid, a in actions.items():
+        ai = c_ident(aid)
+        at = a.get('input', {}).get('@type', '')
+        c.append('static at_type_t %s_%s_input_type = {%s, NULL};' % (name, ai, c_str(at)))
+        for iid, ip in a.get('input', {}).get('properties', {}).items():
+            c.append('static double %s_%s_%s_lim[2] = {%s, %s};' % (
+                name, ai, c_ident(iid), ip.get('minimum', 0), ip.get('maximum', 0)))
+        c.append('')
+
+    # accessors
+    for pid, p in props.items():
+        if p['type'] not in ('boolean', 'integer', 'number'):
+            continue
+        ct = C_TYPES[p['type']]
+        pi = c_ident(pid)
+        c += ['%s %s_%s_get(thing_t *t){' % (ct, name, pi),
+              '\tproperty_t *p = t -> properties[%s_%s];' % (NAME, pi.upper()),
+              '\t%s value;' % ct, '',
+              '\txSemaphoreTake(p -> mux, portMAX_DELAY);',
+              '\tvalue = *(%s *)(p -> value);' % ct,
+              '\txSemaphoreGive(p -> mux);', '',
+              '\treturn value;', '}', '', '',
+              '//set new value and inform subscribers (notification policy is applied)',
+              'void %s_%s_set(thing_t *t, %s value){' % (name, pi, ct),
+              '\tproperty_t *p = t -> properties[%s_%s];' % (NAME, pi.upper()), '',
+              '\txSemaphoreTake(p -> mux, portMAX_DELAY);',
+              '\t*(%s *)(p -> value) = value;' % ct,
+              '\txSemaphoreGive(p -> mux);',
+              '\tinform_all_subscribers_prop(p);', '}', '', '']
+
+    # init function
+    c += ['/*****************************************************************',
+          ' *',
+          ' * create thing "%s" with all its resources' % spec['id'],
+          ' *',
+          ' * ****************************************************************/',
+          'thing_t *%s_thing_init(%s){' % (name, ', '.join(init_args)),
+          '\tthing_t *t;']
+    if actions:
+        c.append('\taction_t *a;')
+    if events:
+        c.append('\tevent_t *e;')
+    c += ['', '\tt = thing_init();',
+          '\tt -> id = %s;' % c_str(spec['id']),
+          '\tt -> at_context = %s;' % c_str(spec.get('@context', 'https://webthings.io/schemas')),
+          '\tt -> description = %s;' % c_str(spec.get('description', ''))]
+    for i in range(len(types)):
+        c.append('\tset_thing_type(t, &%s_type[%i]);' % (name, i))
+    c.append('\tthing_set_td(t, %s_td, %s_TD_LEN);' % (name, NAME))
+    c.append('')
+    for pid in props:
+        pi = c_ident(pid)
+        c.append('\tadd_property(t, property_init(&%s_%s_desc, %s, mux));' % (name, pi, pi))
+    for aid, a in actions.items():
+        ai = c_ident(aid)
+        c += ['', '\ta = action_init();',
+              '\ta -> id = %s;' % c_str(aid),
+              '\ta -> title = %s;' % c_str(a.get('title', aid)),
+              '\ta -> description = %s;' % c_str(a.get('description', '')),
+              '\ta -> input_at_type = &%s_%s_input_type;' % (name, ai)]
+        if 'run' in a:
+            c.append('\ta -> run_typed = %s;' % a['run'])
+        if 'cancel' in a:
+            c.append('\ta -> cancel = %s;' % a['cancel'])
+        for iid, ip in a.get('input', {}).get('properties', {}).items():
+            lim = '%s_%s_%s_lim' % (name, ai, c_ident(iid))
+            c += ['\tadd_action_input_prop(a, action_input_prop_init(%s,' % c_str(iid),
+                  '\t\t\t%s, %s, &%s[0], &%s[1], %s));' % (
+                      VAL_TYPES[ip['type']], 'true' if ip.get('required', False) else 'false',
+                      lim, lim, c_str(ip.get('unit', '')))]
+        c.append('\tadd_action(t, a);')
+    for eid, e in events.items():
+        c += ['', '\te = event_init();',
+              '\te -> id = %s;' % c_str(eid),
+              '\te -> title = %s;' % c_str(e.get('title', eid)),
+              '\te -> description = %s;' % c_str(e.get('description', '')),
+              '\te -> type = %s;' % VAL_TYPES[e['type']],
+              '\te -> at_type = %s;' % c_str(e.get('@type', '')),
+              '\te -> unit = %s;' % c_str(e.get('unit', '')),
+              '\tadd_event(t, e);']
+    c += ['', '\treturn t;', '}']
+
+    return '\n'.join(h) + '\n', '\n'.join(c) + '\n'
+
+
+def write_if_changed(path, text):
+    # keep timestamps of unchanged files, nothing is rebuilt then
+    if os.path.exists(path):
+        with open(path, 'r') as f:
+            if f.read() == text:
+                return
+    with open(path, 'w') as f:
+        f.write(text)
+
+
+def main():
+    ap = argparse.ArgumentParser(description='Web Thing description generator')
+    ap.add_argument('--out-dir', required=True)
+    ap.add_argument('spec')
+    args = ap.parse_args()
+
+    try:
+        spec = load_spec(args.spec)
+        spec_name = os.path.basename(args.spec)
+        base = os.path.splitext(spec_name)[0]
+        h, c = generate(spec, spec_name, base)
+    except (SpecError, KeyError, ValueError) as e:
+        sys.stderr.write('td_gen: %s: %s\n' % (args.spec, e))
+        return 1
+
+    if not os.path.isdir(args.out_dir):
+        os.makedirs(args.out_dir)
+    write_if_changed(os.path.join(args.out_dir, base + '_td.h'), h)
+    write_if_changed(os.path.join(args.out_dir, base + '_td.c'), c)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -9,6 +9,23 @@
 #include <string.h>
 
 #include "web_thing.h"
+#include "web_thing_arena.h"
+#include "web_thing_pool.h"
+
+#define SUBSCRIBER_POOL_SIZE CONFIG_SUBSCRIBER_POOL_SIZE
+
+//subscribers of all things
+static subscriber_t subscriber_storage[SUBSCRIBER_POOL_SIZE];
+static slab_pool_t subscriber_pool;
+
+
+//**********************************************************************
+//initialize pool of subscribers
+void subscriber_pool_init(void){
+
+	slab_pool_init(&subscriber_pool, "subscribers", subscriber_storage,
+					sizeof(subscriber_t), SUBSCRIBER_POOL_SIZE);
+}
 
 
 //**********************************************************************
@@ -28,14 +45,17 @@ thing_t *thing_init(void){
 int8_t add_property(thing_t *_t, property_t *_p){
 	int res = 0;
 
-	if (_t -> last_property == NULL){
-		_t -> properties = _p;
-	}
-	else{
-		_t -> last_property -> next = _p;
+	property_t **tab;
+
+	//table grows only while things are built (before server start)
+	tab = realloc(_t -> properties, (_t -> prop_quant + 1) * sizeof(property_t *));
+	if (tab == NULL){
+		return -1;
 	}
-	_t -> last_property = _p;
+	tab[_t -> prop_quant] = _p;
+	_t -> properties = tab;
 
+	_p -> index = _t -> prop_quant;
 	_t -> prop_quant++;
 	_p -> t = _t;
 
@@ -74,6 +94,8 @@ int8_t add_event(thing_t *_t, event_t *_e){
 
 	*e = _e;
 	_e -> t = _t;
+	_e -> index = _t -> event_quant;
+	_t -> event_quant++;
 
 	return res;
 }
@@ -103,9 +125,61 @@ int8_t set_thing_type(thing_t *t, at_type_t *at){
 	return res;
 }
 
+// *************************************************************************
+//set description generated at build time (tools/td_gen.py), buffer for
+//the model must also fit thing number and host placed instead of markers
+void thing_set_td(thing_t *t, const char *td, uint16_t td_len){
+	uint16_t marks = 0;
+
+	for (int i = 0; i < td_len; i++){
+		if (td[i] == TD_MARK_THING_NR){
+			marks++;
+		}
+	}
+	t -> td = td;
+	t -> td_len = td_len;
+	t -> model_len = td_len + marks * 2 + TD_HOST_LEN + 3;
+}
+
+
+// *************************************************************************
+//copy generated description into buffer and fill its markers,
+//returns length of the model
+static int thing_td_expand(thing_t *t, char *host, char *domain,
+							uint16_t port, char *buff){
+	char lk[5];
+	int lk_len, len = 0, start = 0;
+
+	lk_len = sprintf(lk, "%i", t -> thing_nr);
+	for (int i = 0; i < t -> td_len; i++){
+		if ((t -> td[i] == TD_MARK_THING_NR) || (t -> td[i] == TD_MARK_HOST)){
+			memcpy(buff + len, t -> td + start, i - start);
+			len += i - start;
+			start = i + 1;
+			if (t -> td[i] == TD_MARK_THING_NR){
+				memcpy(buff + len, lk, lk_len);
+				len += lk_len;
+			}
+			else{
+				len += sprintf(buff + len, "%s.%s:%i", host, domain, port);
+			}
+		}
+	}
+	memcpy(buff + len, t -> td + start, t -> td_len - start);
+	len += t -> td_len - start;
+	buff[len] = 0;
+
+	return len;
+}
+
+
 // *************************************************************************
 //create json model for single thing
 int thing_jsonize(thing_t *t, char *host, char *domain, uint16_t port, char *buff){
+	if (t -> td != NULL){
+		return thing_td_expand(t, host, domain, port, buff);
+	}
+
 	char thing_str[] = "\"name\":\"%s\",\"href\":\"%s\",\"@context\":\"%s\","\
 					"\"@type\":[%s],\"properties\":{%s},\"actions\":{%s},"\
 					"\"events\":{%s},\"links\":[%s],\"description\":\"%s\"";
@@ -123,14 +197,14 @@ int thing_jsonize(thing_t *t, char *host, char *domain, uint16_t port, char *buf
 	memcpy(lk_1, lk, 5);
 
 	//prepare links
-	links_buff = malloc(300);
+	links_buff = req_malloc(300);
 	//TODO: get IP address
 	sprintf(links_buff, links_str, lk_1, lk_1, lk_1, host, domain, port, lk_1);
 
 	//prepare thing's @types array
 	int tq = t -> type_quantity;
 	if (tq > 0){
-		at_types = malloc(tq * 30);
+		at_types = req_malloc(tq * 30);
 		//memset(at_types, 0, tq * 30);
 		at_type_t *at = t -> at_type;
 		if (tq > 1){
@@ -149,7 +223,7 @@ int thing_jsonize(thing_t *t, char *host, char *domain, uint16_t port, char *buf
 		}
 	}
 	else{
-		at_types = malloc(3);
+		at_types = req_malloc(3);
 		at_types[0] = '[';
 		at_types[1] = ']';
 		at_types[2] = 0;
@@ -171,11 +245,11 @@ int thing_jsonize(thing_t *t, char *host, char *domain, uint16_t port, char *buf
 	len = strlen(buff);
 
 	//release used memory
-	free(events);
-	free(actions);
-	free(props);
-	free(at_types);
-	free(links_buff);
+	req_free(events);
+	req_free(actions);
+	req_free(props);
+	req_free(at_types);
+	req_free(links_buff);
 
 	return len;
 }
@@ -201,7 +275,7 @@ char *get_thing(thing_t *t, int16_t thing_index, char *host,
 	if (model_len == 0){
 		model_len = 2000; //default value
 	}
-	buff = malloc(model_len);
+	buff = req_malloc(model_len);
 	buff[0] = '{';
 	buff[1] = 0;
 	thing_jsonize(t, host, domain, port, buff + 1);
@@ -222,12 +296,16 @@ char *get_thing(thing_t *t, int16_t thing_index, char *host,
  * add subscriber to the list of subscribers
  *
  * *************************************************************/
-int8_t add_subscriber(connection_desc_t *_c){
+int8_t add_subscriber(thing_t *_t, connection_desc_t *_c){
 	int8_t res = 0;
 	subscriber_t *s;
-	thing_t *_t = _c -> thing;
 
-	s = malloc(sizeof(subscriber_t));
+	s = slab_alloc(&subscriber_pool);
+	if (s == NULL){
+		printf("thing - no free subscriber\n");
+		return -1;
+	}
+	memset(s, 0, sizeof(subscriber_t));
 	s -> conn_desc = _c;
 	s -> next = NULL;
 	s -> prev = NULL;
@@ -251,10 +329,9 @@ int8_t add_subscriber(connection_desc_t *_c){
  * delete subscriber from the list
  *
  * *************************************************************/
-int8_t delete_subscriber(connection_desc_t *_c){
+int8_t delete_subscriber(thing_t *_t, connection_desc_t *_c){
 	int8_t res = 0;
 	subscriber_t *s;
-	thing_t *_t = _c -> thing;
 
 	if ((_t != NULL) && (_c != NULL)){
 		s = _t -> subscribers;
@@ -289,7 +366,7 @@ int8_t delete_subscriber(connection_desc_t *_c){
 				s -> next -> prev = s -> prev;
 			}
 			//printf("subscriber deleted, %p\n", s);
-			free(s);
+			slab_free(&subscriber_pool, s);
 		}
 		else{
 			res = -1;
@@ -301,3 +378,55 @@ int8_t delete_subscriber(connection_desc_t *_c){
 
 	return res;
 }
+
+
+/*************************************************************
+ *
+ * find subscriber of the connection
+ *
+ * *************************************************************/
+subscriber_t *get_subscriber(thing_t *_t, connection_desc_t *_c){
+	subscriber_t *s = NULL;
+
+	if (_t != NULL){
+		s = _t -> subscribers;
+		while (s != NULL){
+			if (s -> conn_desc == _c){
+				break;
+			}
+			s = s -> next;
+		}
+	}
+
+	return s;
+}
+
+
+/*************************************************************
+ *
+ * check if subscriber wants notifications of the property
+ *
+ * *************************************************************/
+bool subscriber_property_on(subscriber_t *s, property_t *p){
+
+	if ((s -> prop_filter == false) || (p -> index >= 32)){
+		return true;
+	}
+
+	return (s -> prop_mask & SUBSCR_BIT(p -> index)) != 0;
+}
+
+
+/*************************************************************
+ *
+ * check if subscriber wants notifications of the event
+ *
+ * *************************************************************/
+bool subscriber_event_on(subscriber_t *s, event_t *e){
+
+	if ((s -> event_filter == false) || (e -> index >= 32)){
+		return true;
+	}
+
+	return (s -> event_mask & SUBSCR_BIT(e -> index)) != 0;
+}
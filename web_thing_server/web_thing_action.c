@@ -8,24 +8,274 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
 
 #include "common.h"
 #include "simple_web_thing_server.h"
 #include "web_thing.h"
 #include "web_thing_action.h"
+#include "web_thing_arena.h"
 
 char *action_model_jsonize(action_t *p, int16_t thing_index);
 char *input_prop_jsonize(action_input_prop_t *aip);
 char *request_inputs_jsonize(action_t *a, action_request_t *ar);
 action_request_t *get_request_ptr(action_t *a, int request_index);
+static void action_dispatch(action_t *a);
+
+//request sent to worker task
+typedef struct{
+	action_t *a;
+	int index;
+} action_job_t;
+
+static xQueueHandle action_queue = NULL;
+static xSemaphoreHandle action_mux = NULL;
+static bool dispatch_missed = false; //job not sent, queue of workers was full
+#define ACTION_TASK_STACK (1024*4)
+#ifdef CONFIG_STATIC_ALLOC
+//action workers, their queue and lock of requests lists
+static StackType_t action_stack[ACTION_WORKERS][ACTION_TASK_STACK];
+static StaticTask_t action_tcb[ACTION_WORKERS];
+static StaticQueue_t action_queue_buff;
+static uint8_t action_queue_storage[ACTION_JOBS_LEN * sizeof(action_job_t)];
+static StaticSemaphore_t action_mux_buff;
+#endif
+extern root_node_t root_node;
+
+
+/************************************************
+ *
+ * lock of action requests lists (recursive)
+ *
+ * **********************************************/
+void action_list_lock(void){
+
+	if (action_mux != NULL){
+		xSemaphoreTakeRecursive(action_mux, portMAX_DELAY);
+	}
+}
+
+
+void action_list_unlock(void){
+
+	if (action_mux != NULL){
+		xSemaphoreGiveRecursive(action_mux);
+	}
+}
 
 
 /************************************************
  *
+ * status of the request is changed, inform subscribers
  *
+ * **********************************************/
+static void action_request_changed(action_t *a, action_request_t *ar){
+	char *buff;
+
+	ar -> seq = change_log_add(ACTION, a -> t, a, ar -> index);
+	buff = action_request_jsonize(a -> t -> thing_nr, a -> id, ar -> index);
+	if (buff != NULL){
+		inform_all_subscribers_action(a, buff, strlen(buff), ar -> seq);
+		req_free(buff);
+	}
+}
+
+
+/************************************************
+ *
+ * request is finished (completed or failed), next one can be run
+ *
+ * **********************************************/
+static void action_request_finish(action_t *a, action_request_t *ar, ACTION_STATUS status){
+
+	ar -> status = status;
+	ar -> time_completed = time(NULL);
+	if (a -> running_request_index == ar -> index){
+		a -> running_request_index = -1;
+	}
+	action_request_changed(a, ar);
+	action_dispatch(a);
+}
+
+
+/************************************************
+ *
+ * send the oldest pending request to workers if action is idle,
+ * only one request of the action is run at a time
+ *
+ * **********************************************/
+static void action_dispatch(action_t *a){
+	action_request_t *ar;
+	action_job_t job;
+
+	if ((a -> running_request_index != -1) || (action_queue == NULL)){
+		return;
+	}
+	ar = get_first_request(a);
+	while ((ar != NULL) && (ar -> status != ACT_PENDING)){
+		ar = get_next_request(a, ar);
+	}
+	if (ar != NULL){
+		job.a = a;
+		job.index = ar -> index;
+		a -> running_request_index = ar -> index;
+		if (xQueueSend(action_queue, &job, 0) != pdTRUE){
+			//worker tries again when it takes the next job
+			a -> running_request_index = -1;
+			dispatch_missed = true;
+		}
+	}
+}
+
+
+/************************************************
+ *
+ * send requests which weren't sent because the queue of workers
+ * was full, called by worker after it took a job (queue has room)
+ *
+ * **********************************************/
+static void action_dispatch_missed(void){
+	thing_t *t;
+	action_t *a;
+
+	action_list_lock();
+	if (dispatch_missed == true){
+		dispatch_missed = false;
+		for (t = root_node.things; t != NULL; t = t -> next){
+			for (a = t -> actions; a != NULL; a = a -> next){
+				action_dispatch(a);
+			}
+		}
+	}
+	action_list_unlock();
+}
+
+
+/************************************************
+ *
+ * worker task, runs action requests
+ *
+ * **********************************************/
+static void action_worker_task(void *arg){
+	action_job_t job;
+	action_request_t *ar;
+	char inputs[ACTION_INPUTS_LEN];
+	action_inputs_t in;
+
+	while (1){
+		if (xQueueReceive(action_queue, &job, portMAX_DELAY) != pdTRUE){
+			continue;
+		}
+		action_dispatch_missed();
+		action_list_lock();
+		ar = get_request_ptr(job.a, job.index);
+		if ((ar == NULL) || (ar -> status != ACT_PENDING)){
+			//request doesn't wait any more
+			if (job.a -> running_request_index == job.index){
+				job.a -> running_request_index = -1;
+			}
+			action_dispatch(job.a);
+			action_list_unlock();
+			continue;
+		}
+		ar -> status = ACT_EXECUTED;
+		job.a -> run_index = job.index;
+		strcpy(inputs, ar -> inputs);
+		in.a = job.a;
+		in.request_index = job.index;
+		in.values_qua = ar -> values_qua;
+		memcpy(in.values, ar -> values, sizeof(in.values));
+		action_request_changed(job.a, ar);
+		action_list_unlock();
+
+		//thing calls complete_action() when the action is done,
+		//it can be done inside run function
+		int8_t res;
+		if (job.a -> run_typed != NULL){
+			res = job.a -> run_typed(&in);
+		}
+		else{
+			res = job.a -> run(inputs);
+		}
+
+		action_list_lock();
+		job.a -> run_index = 0;
+		ar = get_request_ptr(job.a, job.index);
+		if ((res < 0) && (ar != NULL) && (ar -> status == ACT_EXECUTED)){
+			action_request_finish(job.a, ar, ACT_FAILED);
+		}
+		else if ((job.a -> running_request_index == job.index) &&
+				((ar == NULL) || (ar -> status != ACT_EXECUTED))){
+			//request was cancelled while run was executing
+			job.a -> running_request_index = -1;
+			action_dispatch(job.a);
+		}
+		action_list_unlock();
+	}
+}
+
+
+/************************************************
+ *
+ * start action workers
+ *
+ * **********************************************/
+int8_t action_executor_init(void){
+	char name[20];
+
+	if (action_queue != NULL){
+		return 0;
+	}
+#ifdef CONFIG_STATIC_ALLOC
+	action_mux = xSemaphoreCreateRecursiveMutexStatic(&action_mux_buff);
+	action_queue = xQueueCreateStatic(ACTION_JOBS_LEN, sizeof(action_job_t),
+									action_queue_storage, &action_queue_buff);
+#else
+	action_mux = xSemaphoreCreateRecursiveMutex();
+	action_queue = xQueueCreate(ACTION_JOBS_LEN, sizeof(action_job_t));
+#endif
+	if ((action_mux == NULL) || (action_queue == NULL)){
+		return -1;
+	}
+	for (int i = 0; i < ACTION_WORKERS; i++){
+		sprintf(name, "action_worker_%i", i);
+#ifdef CONFIG_STATIC_ALLOC
+		xTaskCreateStatic(action_worker_task, name, ACTION_TASK_STACK, NULL, 1,
+						action_stack[i], &action_tcb[i]);
+#else
+		xTaskCreate(action_worker_task, name, ACTION_TASK_STACK, NULL, 1, NULL);
+#endif
+	}
+
+	return 0;
+}
+
+
+/************************************************
+ *
+ * the running request of the action is finished (called by the thing),
+ * the next queued request is started
  *
  * **********************************************/
 int8_t complete_action(int thing_nr, char *action_id, ACTION_STATUS status){
+
+	return complete_action_request(thing_nr, action_id, 0, status);
+}
+
+
+/************************************************
+ *
+ * request "request_index" of the action is finished (called by the thing),
+ * completion of any other request (e.g. the cancelled one, when the next
+ * request is already running) is ignored; 0 - the running request
+ *
+ * **********************************************/
+int8_t complete_action_request(int thing_nr, char *action_id,
+								int request_index, ACTION_STATUS status){
 	int8_t res = -1;
 	thing_t *t = NULL;
 	action_t *a;
@@ -37,19 +287,19 @@ int8_t complete_action(int thing_nr, char *action_id, ACTION_STATUS status){
 		a = get_action_ptr(t, action_id);
 
 		if (a != NULL){
+			action_list_lock();
 			//find request on the list
 			i = a -> running_request_index;
-			if (i > 0){
+			if ((i > 0) && ((request_index == 0) || (request_index == i))){
 				action_request_t *ar = get_request_ptr(a, i);
 
-				ar -> status = status;
-				ar -> time_completed = time(NULL);
-				a -> running_request_index = -1;
-				res = 0;
-				char *buff = action_request_jsonize(thing_nr, action_id, i);
-				inform_all_subscribers_action(a, buff, strlen(buff));
-				free(buff);
+				//cancelled request is not completed
+				if ((ar != NULL) && (ar -> status == ACT_EXECUTED)){
+					action_request_finish(a, ar, status);
+					res = 0;
+				}
 			}
+			action_list_unlock();
 		}
 	}
 
@@ -86,6 +336,7 @@ char *action_request_jsonize(int thing_nr, char *action_id, int request_index){
 	a = get_action_ptr(t, action_id);
 
 	//find action request
+	action_list_lock();
 	if (a != NULL){
 		action_request_t *ar = get_request_ptr(a, request_index);
 
@@ -97,17 +348,17 @@ char *action_request_jsonize(int thing_nr, char *action_id, int request_index){
 			inputs_buff = request_inputs_jsonize(a, ar);
 
 			//create href address
-			href_buff = malloc(50);
+			href_buff = req_malloc(50);
 			sprintf(href_buff, "/%i/actions/%s/%i", t ->thing_nr, action_id, request_index);
 
 			//request time
 			localtime_r(&(ar -> time_requested), &ti);
-			t_req = malloc(50);
+			t_req = req_malloc(50);
 			memset(t_req, 0, 50);
 			sprintf(t_req, "%04i-%02i-%02iT%02i:%02i:%02i+00:00", ti.tm_year + 1900,
 					ti.tm_mon + 1, ti.tm_mday, ti.tm_hour, ti.tm_min, ti.tm_sec);
 			//complete time
-			t_com = malloc(70);
+			t_com = req_malloc(70);
 			memset(t_com, 0, 70);
 			if (ar -> time_completed > 0){
 				localtime_r(&(ar -> time_completed), &ti);
@@ -122,17 +373,18 @@ char *action_request_jsonize(int thing_nr, char *action_id, int request_index){
 
 			int len = strlen(a -> id) + strlen(rq_str) + strlen(inputs_buff) +
 					strlen(href_buff) +	strlen(t_req) + strlen(t_com) + 10;
-			out_buff = malloc(len);
+			out_buff = req_malloc(len);
 
 			sprintf(out_buff, rq_str, a -> id, inputs_buff, href_buff, t_req,
 								t_com, status[ar -> status]);
 
-			free(t_com);
-			free(t_req);
-			free(href_buff);
-			free(inputs_buff);
+			req_free(t_com);
+			req_free(t_req);
+			req_free(href_buff);
+			req_free(inputs_buff);
 		}
 	}
+	action_list_unlock();
 
 	return out_buff;
 }
@@ -147,17 +399,10 @@ char *request_inputs_jsonize(action_t *a, action_request_t *ar){
 	char prop_int_str[] = "\"%s\":%i";
 	char prop_num_str[] = "\"%s\":%5.3f";
 	char prop_str_str[] = "\"%s\":\"%s\"";
-	int ipi;
+	char *bool_str[] = {"false", "true"};
 	action_input_prop_t *ip;
+	request_value_t *rv;
 
-	//prepare inputs list
-	request_value_t *rv = ar -> values;
-	//count how many values is saved in action_request
-	int prop_qua = 0;
-	while (rv != NULL){
-		prop_qua++;
-		rv = rv -> next;
-	}
 	//count how long are input names
 	int id_len = 0;
 	action_input_prop_t *ipt = a -> input_properties;
@@ -165,44 +410,39 @@ char *request_inputs_jsonize(action_t *a, action_request_t *ar){
 		id_len += strlen(ipt -> id);
 		ipt = ipt -> next;
 	}
-	int inputs_len = prop_qua * 50 + id_len + prop_qua * 5 + 10;
-	char *inputs = malloc(inputs_len);
+	int inputs_len = ar -> values_qua * (40 + ACTION_STR_LEN) + id_len + ar -> values_qua * 5 + 10;
+	char *inputs = req_malloc(inputs_len);
 	memset(inputs, 0, inputs_len);
 
-	rv = ar -> values;
-	while (rv != NULL){
-		ipi = rv -> input_prop_index;
-		//find input property name (id)
+	for (int i = 0; i < ar -> values_qua; i++){
+		rv = &(ar -> values[i]);
+		//find input property
 		ip = a -> input_properties;
-		char *prop_id = NULL;
 		while (ip != NULL){
-			if (ip -> input_prop_index == ipi){
-				prop_id = ip -> id;
+			if (ip -> input_prop_index == rv -> input_prop_index){
 				break;
 			}
 			ip = ip -> next;
 		}
-		if (prop_id != NULL){
-			if (rv -> value != NULL){
-				char *buff = malloc(strlen(ip -> id) + 10);
-				memset(buff, 0, strlen(ip -> id) + 10);
-				if (ip -> type == VAL_INTEGER){
-					sprintf(buff, prop_int_str, ip -> id, *(int *)(rv -> value));
-				}
-				else if (ip -> type == VAL_NUMBER){
-					sprintf(buff, prop_num_str, ip -> id, *(double *)(rv -> value));
-				}
-				else if (ip -> type == VAL_STRING){
-					sprintf(buff, prop_str_str, ip -> id, (char *)(rv -> value));
-				}
-				strcat(inputs, buff);
-				free(buff);
-			}
+		if (ip == NULL){
+			continue;
 		}
-		rv = rv -> next;
-		if (rv != NULL){
+		if (inputs[0] != 0){
 			strcat(inputs, ",");
 		}
+		if (ip -> type == VAL_INTEGER){
+			sprintf(inputs + strlen(inputs), prop_int_str, ip -> id, rv -> value.int_val);
+		}
+		else if (ip -> type == VAL_NUMBER){
+			sprintf(inputs + strlen(inputs), prop_num_str, ip -> id, rv -> value.num_val);
+		}
+		else if (ip -> type == VAL_BOOLEAN){
+			sprintf(inputs + strlen(inputs), "\"%s\":%s", ip -> id,
+					bool_str[rv -> value.bool_val]);
+		}
+		else if (ip -> type == VAL_STRING){
+			sprintf(inputs + strlen(inputs), prop_str_str, ip -> id, rv -> value.str_val);
+		}
 	}
 
 	return inputs;
@@ -210,137 +450,296 @@ char *request_inputs_jsonize(action_t *a, action_request_t *ar){
 
 /*************************************************
  *
- * while action is requested add it to the list of action's requests
+ * skip white chars
  *
  * ************************************************/
-int add_request_to_list(action_t *a, char *inputs){
-	action_request_t *ar, *ar_last;
-	time_t t;
-	bool end_of_inputs = false;
-	char *p_start, *p1, *p2, name[15], value[15];
-	request_value_t *rv = NULL, *prev_rv = NULL, *first_rv = NULL;
-	int next_index = -1;
-
-	p_start = inputs;
-	while (end_of_inputs == false){
-		memset(name, 0, 15);
-		memset(value, 0, 15);
-		//name
-		p1 = strchr(p_start, '"');
-		p2 = strchr(p1 + 1, '"');
-		int name_len = p2 - p1 - 1;
-		memcpy(name, p1 + 1, name_len);
+static char *skip_spaces(char *p){
+
+	while ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n')){
+		p++;
+	}
+
+	return p;
+}
+
+
+/*************************************************
+ *
+ * json string (after the opening '"') copied into buffer,
+ * returns pointer after the closing '"' or NULL (error, too long)
+ *
+ * ************************************************/
+static char *parse_input_string(char *p, char *buff, int size){
+	int len = 0;
+
+	while ((*p != '"') && (*p != 0)){
+		if ((*p == '\\') && (p[1] != 0)){
+			p++;
+			switch (*p){
+			case 'n': buff[len] = '\n'; break;
+			case 't': buff[len] = '\t'; break;
+			case 'r': buff[len] = '\r'; break;
+			default: buff[len] = *p;
+			}
+		}
+		else{
+			buff[len] = *p;
+		}
+		p++;
+		if (++len >= size){
+			return NULL;
+		}
+	}
+	buff[len] = 0;
+
+	return (*p == '"') ? p + 1 : NULL;
+}
+
+
+/*************************************************
+ *
+ * parse inputs ("name":value,...) and validate them against the action
+ * model: input names, types, minimum, maximum and required inputs
+ * output: 0 - OK, -1 - bad request
+ *
+ * ************************************************/
+static int8_t request_values_parse(action_t *a, action_inputs_t *in, char *inputs){
+	char name[30], *p = inputs, *end;
+	action_input_prop_t *ap;
+	request_value_t *rv;
+	double num;
+
+	memset(in, 0, sizeof(action_inputs_t));
+	in -> a = a;
+	p = skip_spaces(p);
+	while (*p != 0){
+		//"name"
+		if (*p != '"'){
+			return -1;
+		}
+		p = parse_input_string(p + 1, name, sizeof(name));
+		if (p == NULL){
+			return -1;
+		}
+		p = skip_spaces(p);
+		if (*p != ':'){
+			return -1;
+		}
+		p = skip_spaces(p + 1);
+
+		//find input property of this name
+		ap = a -> input_properties;
+		while ((ap != NULL) && (strcmp(name, ap -> id) != 0)){
+			ap = ap -> next;
+		}
+		if ((ap == NULL) || (get_action_input(in, name) != NULL) ||
+			(in -> values_qua >= ACTION_MAX_INPUTS)){
+			//unknown or repeated input
+			return -1;
+		}
+		rv = &(in -> values[in -> values_qua]);
+		rv -> input_prop_index = ap -> input_prop_index;
+
 		//value
-		p1 = strchr(p2, ':');
-		p2 = strchr(p1 + 1, ',');
-		if (p2 == NULL){
-			p2 = inputs + strlen(inputs);
-			end_of_inputs = true;
+		if (strncmp(p, "null", 4) == 0){
+			//the same as not given
+			p += 4;
+			rv = NULL;
+		}
+		else if (ap -> type == VAL_BOOLEAN){
+			if (strncmp(p, "true", 4) == 0){
+				rv -> value.bool_val = true;
+				p += 4;
+			}
+			else if (strncmp(p, "false", 5) == 0){
+				rv -> value.bool_val = false;
+				p += 5;
+			}
+			else{
+				return -1;
+			}
+		}
+		else if (ap -> type == VAL_STRING){
+			if (*p != '"'){
+				return -1;
+			}
+			p = parse_input_string(p + 1, rv -> value.str_val, ACTION_STR_LEN);
+			if (p == NULL){
+				return -1;
+			}
+		}
+		else if ((ap -> type == VAL_INTEGER) || (ap -> type == VAL_NUMBER)){
+			num = strtod(p, &end);
+			if ((end == p) ||
+				//range is checked before the cast (NaN fails it too)
+				((ap -> type == VAL_INTEGER) && (!(fabs(num) <= INT32_MAX) || (num != (int)num))) ||
+				((ap -> min_value != NULL) && (num < *(ap -> min_value))) ||
+				((ap -> max_value != NULL) && (num > *(ap -> max_value)))){
+				return -1;
+			}
+			if (ap -> type == VAL_INTEGER){
+				rv -> value.int_val = (int)num;
+			}
+			else{
+				rv -> value.num_val = num;
+			}
+			p = end;
 		}
 		else{
-			p_start = p2;
-		}
-		int val_len = p2 - p1 - 1;
-		memcpy(value, p1 + 1, val_len);
-			if (name_len > 0){
-			action_input_prop_t *ap;
-			//find input property of this name
-			ap = a -> input_properties;
-			while (ap != NULL){
-				if (strcmp(name, ap -> id) == 0){
-					break;
-				}
-				ap = ap -> next;
+			//objects and arrays are not supported
+			return -1;
+		}
+		if (rv != NULL){
+			in -> values_qua++;
+		}
+
+		p = skip_spaces(p);
+		if (*p == ','){
+			p = skip_spaces(p + 1);
+			if (*p == 0){
+				return -1;
 			}
-				if (ap != NULL){
-				rv = malloc(sizeof(request_value_t));
-				if (prev_rv != NULL){
-					prev_rv -> next = rv;
-				}
-				else{
-					first_rv = rv;
-				}
-				rv -> input_prop_index = ap -> input_prop_index;
-				rv -> next = NULL;
-				if (val_len > 0){
-					if (ap -> type == VAL_INTEGER){
-						int *int_value;
-						int_value = malloc(sizeof(int));
-						*int_value = atoi(value);
-						rv -> value = int_value;
-					}
-					else if (ap -> type == VAL_NUMBER){
-						double *num_value;
-						num_value = malloc(sizeof(double));
-						*num_value = (double)atof(value);
-						rv -> value = num_value;
-					}
-					else if (ap -> type == VAL_STRING){
-						//TODO
-					}
-					else{
-						//TODO
-					}
-				}
-				else{
-					rv -> value = NULL;
-				}
+		}
+		else if (*p != 0){
+			return -1;
+		}
+	}
+
+	//all required inputs must be given
+	for (ap = a -> input_properties; ap != NULL; ap = ap -> next){
+		if ((ap -> required == true) && (get_action_input(in, ap -> id) == NULL)){
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*************************************************
+ *
+ * find input value by input id, NULL if value was not given
+ *
+ * ************************************************/
+request_value_t *get_action_input(action_inputs_t *inputs, char *input_id){
+	action_input_prop_t *ap;
+
+	for (int i = 0; i < inputs -> values_qua; i++){
+		ap = inputs -> a -> input_properties;
+		while (ap != NULL){
+			if (ap -> input_prop_index == inputs -> values[i].input_prop_index){
+				break;
 			}
+			ap = ap -> next;
+		}
+		if ((ap != NULL) && (strcmp(ap -> id, input_id) == 0)){
+			return &(inputs -> values[i]);
 		}
-		prev_rv = rv;
 	}
 
-	t = time(NULL);
-	ar = a -> requests_list;
-	ar_last = a -> requests_list;
-	int i = 0;
-	while (ar != NULL){
-		ar_last = ar;
-		i++;
-		ar = ar -> next;
-	}
-	//add request into requests list
-	if (i == MAX_ACTION_REQUESTS){
-		//request list is full, delete the oldest one to make place for new one
-		action_request_t *ar_temp = a -> requests_list; //to be deleted
-		a -> requests_list = a -> requests_list -> next;
-
-		//delete values from the oldest request
-		request_value_t *rv_temp = ar_temp -> values;
-		request_value_t *rv_temp_prev = NULL;
-		while (rv_temp != NULL){
-			free(rv_temp -> value);
-			rv_temp_prev = rv_temp -> next;
-			free(rv_temp);
-			rv_temp = rv_temp_prev;
-		}
-		//delete the oldest request
-		free(ar_temp);
-	}
-	//add new request at the end of the list
-	next_index = a -> last_request_index + 1;
-	action_request_t *ar_new = malloc(sizeof(action_request_t));
-	memset(ar_new, 0, sizeof(action_request_t));
-	if (ar_last == NULL){
-		a -> requests_list = ar_new;
+	return NULL;
+}
+
+
+/*************************************************
+ *
+ * while action is requested add it to the ring of action's requests,
+ * request waits in the queue (status "pending") until a worker runs it
+ * output: request index, -1 (bad inputs) or ACTION_QUEUE_FULL
+ *
+ * ************************************************/
+int add_request_to_list(action_t *a, char *inputs){
+	action_request_t *ar;
+	action_inputs_t in;
+	int pending = 0, next_index;
+
+	if ((strlen(inputs) >= ACTION_INPUTS_LEN) || (request_values_parse(a, &in, inputs) < 0)){
+		//bad inputs
+		return -1;
 	}
-	else{
-		ar_last -> next = ar_new;
+	action_list_lock();
+	for (ar = get_first_request(a); ar != NULL; ar = get_next_request(a, ar)){
+		if ((ar -> status == ACT_PENDING) && (ar -> index != a -> running_request_index)){
+			pending++;
+		}
 	}
-	ar_new -> time_requested = t;
-	ar_new -> status = ACT_CREATED;
-	ar_new -> time_completed = 0;
-	if (first_rv != NULL){
-		ar_new -> values = first_rv;
+	//the oldest request is overwritten if it is finished
+	next_index = a -> last_request_index + 1;
+	ar = &(a -> requests[next_index % ACTION_RING_SIZE]);
+	if ((pending >= ACTION_QUEUE_SIZE) || ((ar -> index != 0) &&
+		((ar -> status == ACT_PENDING) || (ar -> status == ACT_EXECUTED)))){
+		//queue of this action is full
+		action_list_unlock();
+		return ACTION_QUEUE_FULL;
 	}
-	ar_new -> index = next_index;
+	memset(ar, 0, sizeof(action_request_t));
+	ar -> values_qua = in.values_qua;
+	memcpy(ar -> values, in.values, sizeof(ar -> values));
+	strcpy(ar -> inputs, inputs);
+	ar -> time_requested = time(NULL);
+	ar -> status = ACT_PENDING;
+	ar -> index = next_index;
+	ar -> seq = change_log_add(ACTION, a -> t, a, next_index);
 	a -> last_request_index = next_index;
-	a -> running_request_index = next_index;
+
+	//run it now if action is idle
+	action_dispatch(a);
+	action_list_unlock();
 
 	return next_index;
 }
 
 
+/*************************************************
+ *
+ * delete action request (DELETE /N/actions/name/index), running
+ * request is stopped by action's cancel function, the next one
+ * is not started before run of the cancelled request returns
+ * output: 204 or 400
+ *
+ * ************************************************/
+int16_t delete_action_request(int thing_nr, char *action_id, int request_index){
+	thing_t *t;
+	action_t *a = NULL;
+	action_request_t *ar;
+	int16_t res = 400;
+
+	t = get_thing_ptr(thing_nr);
+	if (t != NULL){
+		a = get_action_ptr(t, action_id);
+	}
+	if (a == NULL){
+		return res;
+	}
+
+	action_list_lock();
+	ar = get_request_ptr(a, request_index);
+	if (ar != NULL){
+		if ((ar -> status == ACT_EXECUTED) &&
+			((a -> cancel == NULL) || (a -> cancel(request_index) < 0))){
+			//running request can't be stopped
+			action_list_unlock();
+			return res;
+		}
+		if ((a -> running_request_index == request_index) &&
+			(a -> run_index != request_index)){
+			//if run of cancelled request is still executing, the next
+			//request is started by worker when it returns
+			a -> running_request_index = -1;
+		}
+		ar -> status = ACT_DELETED;
+		ar -> time_completed = time(NULL);
+		action_request_changed(a, ar);
+		ar -> index = 0; //slot is free
+		action_dispatch(a);
+		res = 204;
+	}
+	action_list_unlock();
+
+	return res;
+}
+
+
 /**************************************************
  *
  *
@@ -361,12 +760,12 @@ char *get_actions_model(thing_t *t){
 	if (i > 0){
 		a = t -> actions;
 		if (i > 1){
-			act = malloc(i * 500);
+			act = req_malloc(i * 500);
 			memset(act, 0, i * 500);
 			for (int j = i; j > 0; j--){
 				buff_temp = action_model_jsonize(a, t -> thing_nr);
 				strcat(act, buff_temp);
-				free(buff_temp);
+				req_free(buff_temp);
 				if (j != 1){
 					strcat(act, ",");
 				}
@@ -378,7 +777,7 @@ char *get_actions_model(thing_t *t){
 		}
 	}
 	else{
-		act = malloc(3);
+		act = req_malloc(3);
 		strcpy(act, "");
 	}
 
@@ -418,10 +817,10 @@ char *action_model_jsonize(action_t *a, int16_t thing_index){
 
 	uint16_t req_len = ap_len + i * 2 + 5;
 	uint16_t buff_len = i * ACTION_PROP_LEN + strlen(a -> description) + req_len;
-	all_prop_buff = malloc(buff_len);
+	all_prop_buff = req_malloc(buff_len);
 	memset(all_prop_buff, 0, buff_len);
 
-	req_buff = malloc(req_len);
+	req_buff = req_malloc(req_len);
 	memset(req_buff, 0, req_len);
 
 	aip = a -> input_properties;
@@ -429,7 +828,7 @@ char *action_model_jsonize(action_t *a, int16_t thing_index){
 	while (aip  != NULL){
 		prop_buff = input_prop_jsonize(aip);
 		strcat(all_prop_buff, prop_buff);
-		free(prop_buff);
+		req_free(prop_buff);
 		if (aip -> required == true){
 			if (req_cnt != 0){
 				strcat(req_buff, ",");
@@ -447,12 +846,12 @@ char *action_model_jsonize(action_t *a, int16_t thing_index){
 	}
 
 
-	buff = malloc(400 + strlen(all_prop_buff));
+	buff = req_malloc(400 + strlen(all_prop_buff));
 	sprintf(buff, action_str, a -> id, a -> title, a -> description,
 			a -> input_at_type -> at_type, req_buff, all_prop_buff, th_lk, a -> id);
 
-	free(req_buff);
-	free(all_prop_buff);
+	req_free(req_buff);
+	req_free(all_prop_buff);
 
 	return buff;
 }
@@ -471,7 +870,7 @@ char *input_prop_jsonize(action_input_prop_t *aip){
 	char str_int[] = "\"%s\":{\"type\":\"%s\",\"minimum\":%i,\"maximum\":%i,\"unit\":\"%s\"}";
 	char str_num[] = "\"%s\":{\"type\":\"%s\",\"minimum\":%4.2f,\"maximum\":%4.2f,\"unit\":\"%s\"}";
 
-	buff = malloc(ACTION_PROP_LEN);
+	buff = req_malloc(ACTION_PROP_LEN);
 	memset(buff, 0, ACTION_PROP_LEN);
 
 	if (aip -> type == VAL_INTEGER){
@@ -483,7 +882,7 @@ char *input_prop_jsonize(action_input_prop_t *aip){
 				*(aip -> max_value), aip -> unit);
 	}
 	else{
-		printf("input property type is not a number!\n");
+		sprintf(buff, "\"%s\":{\"type\":\"%s\"}", aip -> id, type[aip -> type]);
 	}
 
 
@@ -550,6 +949,7 @@ action_t *action_init(void){
 
 	a = malloc(sizeof(action_t));
 	memset(a, 0, sizeof(action_t));
+	a -> requests = calloc(ACTION_RING_SIZE, sizeof(action_request_t));
 	a -> last_request_index = 0;
 	a -> running_request_index = -1;
 
@@ -577,19 +977,46 @@ action_t *get_action_ptr(thing_t *t, char *action_id){
 
 /*****************************************************
  *
- *
+ * find request in the ring
  *
  * ***************************************************/
 action_request_t *get_request_ptr(action_t *a, int request_index){
-	action_request_t *ar = a -> requests_list;
+	action_request_t *ar;
 
-	while (ar != NULL){
-		if (ar -> index == request_index){
-			break;
+	if ((request_index < 1) || (request_index > a -> last_request_index) ||
+		(a -> requests == NULL)){
+		return NULL;
+	}
+	ar = &(a -> requests[request_index % ACTION_RING_SIZE]);
+
+	return (ar -> index == request_index) ? ar : NULL;
+}
+
+
+/*****************************************************
+ *
+ * requests of the action from the oldest one:
+ * for (ar = get_first_request(a); ar != NULL; ar = get_next_request(a, ar))
+ *
+ * ***************************************************/
+action_request_t *get_next_request(action_t *a, action_request_t *ar){
+	int i;
+
+	i = (ar == NULL) ? a -> last_request_index - ACTION_RING_SIZE : ar -> index;
+	while (++i <= a -> last_request_index){
+		ar = get_request_ptr(a, i);
+		if (ar != NULL){
+			return ar;
 		}
-		ar = ar -> next;
 	}
-	return ar;
+
+	return NULL;
+}
+
+
+action_request_t *get_first_request(action_t *a){
+
+	return get_next_request(a, NULL);
 }
 
 
@@ -601,17 +1028,19 @@ action_request_t *get_request_ptr(action_t *a, int request_index){
 uint16_t get_action_request_queue(action_t *a, char *buff){
 	uint16_t res = 0;
 	char *buff_1;
-	action_request_t *ar = a -> requests_list;
+	action_request_t *ar;
 
+	action_list_lock();
+	ar = get_first_request(a);
 	if (ar != NULL){
 		while (ar != NULL){
 			buff_1 = action_request_jsonize(a -> t -> thing_nr, a -> id, ar -> index);
 			if (buff_1 != NULL){
 				strcat(buff, buff_1);
 				res += strlen(buff_1);
-				free(buff_1);
+				req_free(buff_1);
 			}
-			ar = ar -> next;
+			ar = get_next_request(a, ar);
 			if (ar != NULL){
 				strcat(buff, ",");
 			}
@@ -624,6 +1053,7 @@ uint16_t get_action_request_queue(action_t *a, char *buff){
 		//buff[2] = 0;
 		//res = 2;
 	//}
+	action_list_unlock();
 
 	return res;
 }
@@ -0,0 +1,256 @@
+/*
+ * web_thing_arena.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  Request arena: buffers living during one HTTP request or one
+ *  websocket message are taken from the connection's arena (bump
+ *  allocator) and released all at once when the request is done.
+ *  Outside of a request (other tasks) req_malloc uses heap, with
+ *  STATIC_ALLOC a pool of spare buffers.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "common.h"
+#include "web_thing_arena.h"
+#include "web_thing_pool.h"
+
+//arenas of connection slots, registered at the first request
+static req_arena_t *arenas[MAX_OPEN_CONN];
+static portMUX_TYPE arenas_lock = portMUX_INITIALIZER_UNLOCKED;
+#ifdef CONFIG_STATIC_ALLOC
+static uint8_t arena_storage[MAX_OPEN_CONN][REQ_ARENA_SIZE]
+				__attribute__((aligned(REQ_ARENA_ALIGN)));
+//json texts built outside of requests (thing tasks, notify task,
+//action workers) and requests which don't fit into the arena
+static uint8_t spare_storage[REQ_SPARE_COUNT][REQ_SPARE_LEN]
+				__attribute__((aligned(REQ_ARENA_ALIGN)));
+static slab_pool_t spare_pool;
+#endif
+
+static req_arena_t *get_current_arena(void);
+
+
+/****************************************************************
+ *
+ * pool of spare buffers (STATIC_ALLOC), called before things are
+ * created
+ *
+ * **************************************************************/
+void req_arena_init(void){
+
+#ifdef CONFIG_STATIC_ALLOC
+	slab_pool_init(&spare_pool, "req_spare", spare_storage,
+					REQ_SPARE_LEN, REQ_SPARE_COUNT);
+#endif
+}
+
+
+/****************************************************************
+ *
+ * start request, allocations of the calling task are taken
+ * from the arena until req_arena_end()
+ *
+ * **************************************************************/
+void req_arena_begin(req_arena_t *a){
+	int i, free_slot = -1;
+
+	if (REQ_ARENA_SIZE == 0){
+		return;
+	}
+	if (a -> buff == NULL){
+		//the first request in this connection slot, workers of many
+		//slots can register their arenas at the same time
+		portENTER_CRITICAL_SAFE(&arenas_lock);
+		for (i = 0; i < MAX_OPEN_CONN; i++){
+			if (arenas[i] == a){
+				break;
+			}
+			if ((arenas[i] == NULL) && (free_slot < 0)){
+				free_slot = i;
+			}
+		}
+		if (i < MAX_OPEN_CONN){
+			free_slot = i;
+		}
+		else if (free_slot >= 0){
+			arenas[free_slot] = a;
+		}
+		portEXIT_CRITICAL_SAFE(&arenas_lock);
+		if (free_slot < 0){
+			return;
+		}
+#ifdef CONFIG_STATIC_ALLOC
+		a -> buff = arena_storage[free_slot];
+#else
+		a -> buff = malloc(REQ_ARENA_SIZE);
+		if (a -> buff == NULL){
+			return;
+		}
+#endif
+		a -> size = REQ_ARENA_SIZE;
+	}
+	a -> used = 0;
+	a -> last = 0;
+	a -> task = xTaskGetCurrentTaskHandle();
+}
+
+
+/****************************************************************
+ *
+ * request is done, the whole arena is free again
+ *
+ * **************************************************************/
+void req_arena_end(req_arena_t *a){
+
+	a -> task = NULL;
+	a -> used = 0;
+	a -> last = 0;
+}
+
+
+/****************************************************************
+ *
+ * arena of the request served by the calling task, NULL if none
+ *
+ * **************************************************************/
+static req_arena_t *get_current_arena(void){
+	xTaskHandle task = xTaskGetCurrentTaskHandle();
+
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+		if ((arenas[i] != NULL) && (arenas[i] -> task == task)){
+			return arenas[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+/****************************************************************
+ *
+ * allocate memory for the current request, heap is used when there
+ * is no request or the arena is full (with STATIC_ALLOC spare buffer
+ * if the size fits)
+ *
+ * **************************************************************/
+void *req_malloc(size_t size){
+	req_arena_t *a = get_current_arena();
+	uint32_t start;
+#ifdef CONFIG_STATIC_ALLOC
+	void *spare;
+#endif
+
+	if (a != NULL){
+		start = (a -> used + REQ_ARENA_ALIGN - 1) & ~(REQ_ARENA_ALIGN - 1);
+		if (start + size <= a -> size){
+			a -> last = start;
+			a -> used = start + size;
+			if (a -> used > a -> peak){
+				a -> peak = a -> used;
+			}
+			return a -> buff + start;
+		}
+		a -> fallbacks++;
+	}
+#ifdef CONFIG_STATIC_ALLOC
+	if (size <= REQ_SPARE_LEN){
+		spare = slab_alloc(&spare_pool);
+		if (spare != NULL){
+			return spare;
+		}
+	}
+#endif
+
+	return malloc(size);
+}
+
+
+/****************************************************************
+ *
+ * enlarge buffer taken by req_malloc, old_size bytes are kept;
+ * the last allocation in the arena grows in place
+ *
+ * **************************************************************/
+void *req_realloc(void *ptr, size_t old_size, size_t size){
+	req_arena_t *a = get_current_arena();
+	uint8_t *p = ptr;
+
+	if ((a != NULL) && (p != NULL) && (p == a -> buff + a -> last) &&
+		(a -> last + size <= a -> size)){
+		a -> used = a -> last + size;
+		if (a -> used > a -> peak){
+			a -> peak = a -> used;
+		}
+		return ptr;
+	}
+	p = req_malloc(size);
+	if ((p != NULL) && (ptr != NULL)){
+		memcpy(p, ptr, (old_size < size) ? old_size : size);
+		req_free(ptr);
+	}
+
+	return p;
+}
+
+
+/****************************************************************
+ *
+ * free memory taken by req_malloc (or malloc), memory from arena
+ * is released with the whole request, only the last allocation
+ * is given back at once
+ *
+ * **************************************************************/
+void req_free(void *ptr){
+	uint8_t *p = ptr;
+
+	if (p == NULL){
+		return;
+	}
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+		req_arena_t *a = arenas[i];
+
+		if ((a != NULL) && (p >= a -> buff) && (p < a -> buff + a -> size)){
+			if ((a -> task == xTaskGetCurrentTaskHandle()) &&
+				(p == a -> buff + a -> last)){
+				a -> used = a -> last;
+			}
+			return;
+		}
+	}
+#ifdef CONFIG_STATIC_ALLOC
+	if (slab_owns(&spare_pool, ptr) == true){
+		slab_free(&spare_pool, ptr);
+		return;
+	}
+#endif
+	free(ptr);
+}
+
+
+/****************************************************************
+ *
+ * statistics of all arenas (for GET /metrics)
+ *
+ * **************************************************************/
+void req_arena_stats(uint32_t *peak, uint32_t *fallbacks){
+
+	*peak = 0;
+	*fallbacks = 0;
+	for (int i = 0; i < MAX_OPEN_CONN; i++){
+		if (arenas[i] != NULL){
+			if (arenas[i] -> peak > *peak){
+				*peak = arenas[i] -> peak;
+			}
+			*fallbacks += arenas[i] -> fallbacks;
+		}
+	}
+}
@@ -0,0 +1,1057 @@
+/*
+ * web_thing_cbor.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  CBOR (RFC 8949) representation of property, action and event
+ *  resources, used when HTTP client sends "Accept: application/cbor"
+ *  or "Content-Type: application/cbor". Numbers and booleans are
+ *  encoded directly from property values, other types are converted
+ *  from their json representation.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "common.h"
+#include "simple_web_thing_server.h"
+#include "web_thing_cbor.h"
+#include "web_thing_arena.h"
+
+#define CBOR_BUFF_STEP	128
+#define CBOR_MAX_DEPTH	8
+
+//major types
+#define CBOR_UINT		0
+#define CBOR_NINT		1
+#define CBOR_BYTES		2
+#define CBOR_TEXT		3
+#define CBOR_ARRAY		4
+#define CBOR_MAP		5
+#define CBOR_TAG		6
+#define CBOR_SIMPLE		7
+
+#define CBOR_FALSE		0xF4
+#define CBOR_TRUE		0xF5
+#define CBOR_NULL		0xF6
+#define CBOR_FLOAT32	0xFA
+#define CBOR_FLOAT64	0xFB
+#define CBOR_ARRAY_INDEF 0x9F
+#define CBOR_MAP_INDEF	0xBF
+#define CBOR_BREAK		0xFF
+#define CBOR_INDEF		31		//additional info: indefinite length
+#define CBOR_TAG_EPOCH	1		//date and time in seconds since 1970
+
+//output buffer, enlarged when needed
+typedef struct{
+	uint8_t *buff;
+	int len;
+	int size;
+	bool error;
+} cbor_out_t;
+
+//input message
+typedef struct{
+	const uint8_t *buff;
+	int len;
+	int pos;
+} cbor_in_t;
+
+static const char *cbor_put_json(cbor_out_t *o, const char *json, int depth);
+static int8_t cbor_item_json(cbor_in_t *in, cbor_out_t *o, int depth);
+
+static const char *action_status[] = {"pending", "completed", "executed", "failed",
+										"created", "deleted"};
+
+
+/****************************************************************
+ *
+ * reserve n bytes at the end of the output buffer
+ *
+ * **************************************************************/
+static uint8_t *cbor_reserve(cbor_out_t *o, int n){
+	uint8_t *b;
+
+	if (o -> error == true){
+		return NULL;
+	}
+	if (o -> len + n > o -> size){
+		b = req_realloc(o -> buff, o -> len, o -> len + n + CBOR_BUFF_STEP);
+		if (b == NULL){
+			o -> error = true;
+			return NULL;
+		}
+		o -> buff = b;
+		o -> size = o -> len + n + CBOR_BUFF_STEP;
+	}
+	b = o -> buff + o -> len;
+	o -> len += n;
+
+	return b;
+}
+
+
+static void cbor_put_byte(cbor_out_t *o, uint8_t v){
+	uint8_t *b = cbor_reserve(o, 1);
+
+	if (b != NULL){
+		b[0] = v;
+	}
+}
+
+
+static void cbor_put_bytes(cbor_out_t *o, const void *data, int n){
+	uint8_t *b = cbor_reserve(o, n);
+
+	if (b != NULL){
+		memcpy(b, data, n);
+	}
+}
+
+
+/****************************************************************
+ *
+ * item head: major type and argument in the shortest form
+ *
+ * **************************************************************/
+static void cbor_put_head(cbor_out_t *o, uint8_t major, uint64_t val){
+	uint8_t *b;
+	int n;
+
+	if (val < 24){
+		cbor_put_byte(o, (major << 5) | val);
+		return;
+	}
+	else if (val <= 0xFF){
+		n = 1;
+	}
+	else if (val <= 0xFFFF){
+		n = 2;
+	}
+	else if (val <= 0xFFFFFFFF){
+		n = 4;
+	}
+	else{
+		n = 8;
+	}
+	b = cbor_reserve(o, n + 1);
+	if (b == NULL){
+		return;
+	}
+	b[0] = (major << 5) | ((n == 1) ? 24 : (n == 2) ? 25 : (n == 4) ? 26 : 27);
+	for (int i = n; i > 0; i--){
+		b[i] = val;
+		val >>= 8;
+	}
+}
+
+
+static void cbor_put_int(cbor_out_t *o, int64_t v){
+
+	if (v >= 0){
+		cbor_put_head(o, CBOR_UINT, v);
+	}
+	else{
+		cbor_put_head(o, CBOR_NINT, -1 - v);
+	}
+}
+
+
+static void cbor_put_text(cbor_out_t *o, const char *s, int n){
+
+	cbor_put_head(o, CBOR_TEXT, n);
+	cbor_put_bytes(o, s, n);
+}
+
+
+static void cbor_put_str(cbor_out_t *o, const char *s){
+
+	cbor_put_text(o, s, strlen(s));
+}
+
+
+/****************************************************************
+ *
+ * float number, 4 bytes if value is not changed by the conversion
+ *
+ * **************************************************************/
+static void cbor_put_double(cbor_out_t *o, double v){
+	uint8_t b[8];
+	uint64_t u64;
+	uint32_t u32;
+	float f = v;
+
+	if (((double)f == v) || isnan(v)){
+		memcpy(&u32, &f, sizeof(u32));
+		cbor_put_byte(o, CBOR_FLOAT32);
+		for (int i = 3; i >= 0; i--){
+			b[i] = u32;
+			u32 >>= 8;
+		}
+		cbor_put_bytes(o, b, 4);
+	}
+	else{
+		memcpy(&u64, &v, sizeof(u64));
+		cbor_put_byte(o, CBOR_FLOAT64);
+		for (int i = 7; i >= 0; i--){
+			b[i] = u64;
+			u64 >>= 8;
+		}
+		cbor_put_bytes(o, b, 8);
+	}
+}
+
+
+static void cbor_put_time(cbor_out_t *o, time_t t){
+
+	cbor_put_head(o, CBOR_TAG, CBOR_TAG_EPOCH);
+	cbor_put_int(o, t);
+}
+
+
+/****************************************************************
+ *
+ * unescape json string from json to end into out (UTF-8),
+ * out = NULL - only length is counted; output: length or -1
+ *
+ * **************************************************************/
+static int json_unescape(const char *json, const char *end, uint8_t *out){
+	int n = 0;
+	uint8_t b[3];
+	int b_len;
+
+	while (json < end){
+		b_len = 1;
+		if (*json != '\\'){
+			b[0] = *json;
+		}
+		else{
+			json++;
+			switch (*json){
+			case 'b': b[0] = '\b'; break;
+			case 'f': b[0] = '\f'; break;
+			case 'n': b[0] = '\n'; break;
+			case 'r': b[0] = '\r'; break;
+			case 't': b[0] = '\t'; break;
+			case 'u':{
+				unsigned int c = 0;
+
+				if ((end - json < 5) || (sscanf(json + 1, "%4x", &c) != 1)){
+					return -1;
+				}
+				//UTF-8, surrogate pairs are not joined
+				if (c < 0x80){
+					b[0] = c;
+				}
+				else if (c < 0x800){
+					b[0] = 0xC0 | (c >> 6);
+					b[1] = 0x80 | (c & 0x3F);
+					b_len = 2;
+				}
+				else{
+					b[0] = 0xE0 | (c >> 12);
+					b[1] = 0x80 | ((c >> 6) & 0x3F);
+					b[2] = 0x80 | (c & 0x3F);
+					b_len = 3;
+				}
+				json += 4;
+				break;
+			}
+			default:
+				b[0] = *json;
+			}
+		}
+		if (out != NULL){
+			memcpy(out + n, b, b_len);
+		}
+		n += b_len;
+		json++;
+	}
+
+	return n;
+}
+
+
+/****************************************************************
+ *
+ * json string (after the opening '"') converted into CBOR text,
+ * written directly into the output buffer,
+ * returns pointer after the closing '"'
+ *
+ * **************************************************************/
+static const char *cbor_put_json_string(cbor_out_t *o, const char *json){
+	const char *end = json;
+	uint8_t *text;
+	int len;
+
+	//find end of the string
+	while ((*end != '"') && (*end != 0)){
+		if ((*end == '\\') && (end[1] != 0)){
+			end++;
+		}
+		end++;
+	}
+	if (*end != '"'){
+		return NULL;
+	}
+
+	len = json_unescape(json, end, NULL);
+	if (len < 0){
+		return NULL;
+	}
+	cbor_put_head(o, CBOR_TEXT, len);
+	text = cbor_reserve(o, len);
+	if (text != NULL){
+		json_unescape(json, end, text);
+	}
+
+	return end + 1;
+}
+
+
+/****************************************************************
+ *
+ * json value converted into CBOR item, used for strings, objects
+ * and arrays, returns pointer after the value or NULL (error)
+ *
+ * **************************************************************/
+static const char *cbor_put_json(cbor_out_t *o, const char *json, int depth){
+	char *end;
+
+	while ((*json == ' ') || (*json == '\t') || (*json == '\r') || (*json == '\n')){
+		json++;
+	}
+	if (depth > CBOR_MAX_DEPTH){
+		return NULL;
+	}
+
+	switch (*json){
+	case '{':
+	case '[':{
+		bool obj = (*json == '{');
+		bool first = true;
+
+		cbor_put_byte(o, (obj == true) ? CBOR_MAP_INDEF : CBOR_ARRAY_INDEF);
+		json++;
+		while (true){
+			while ((*json == ' ') || (*json == '\t') || (*json == '\r') || (*json == '\n')){
+				json++;
+			}
+			if (*json == ((obj == true) ? '}' : ']')){
+				json++;
+				break;
+			}
+			if (first == false){
+				if (*json != ','){
+					return NULL;
+				}
+				json++;
+			}
+			first = false;
+			if (obj == true){
+				while (*json == ' '){
+					json++;
+				}
+				if (*json != '"'){
+					return NULL;
+				}
+				json = cbor_put_json_string(o, json + 1);
+				if (json == NULL){
+					return NULL;
+				}
+				while (*json == ' '){
+					json++;
+				}
+				if (*json != ':'){
+					return NULL;
+				}
+				json++;
+			}
+			json = cbor_put_json(o, json, depth + 1);
+			if (json == NULL){
+				return NULL;
+			}
+		}
+		cbor_put_byte(o, CBOR_BREAK);
+		return json;
+	}
+
+	case '"':
+		return cbor_put_json_string(o, json + 1);
+
+	case 't':
+		cbor_put_byte(o, CBOR_TRUE);
+		return (strncmp(json, "true", 4) == 0) ? json + 4 : NULL;
+
+	case 'f':
+		cbor_put_byte(o, CBOR_FALSE);
+		return (strncmp(json, "false", 5) == 0) ? json + 5 : NULL;
+
+	case 'n':
+		cbor_put_byte(o, CBOR_NULL);
+		return (strncmp(json, "null", 4) == 0) ? json + 4 : NULL;
+
+	default:{
+		//number
+		double d = strtod(json, &end);
+
+		if (end == json){
+			return NULL;
+		}
+		if ((memchr(json, '.', end - json) == NULL) &&
+			(memchr(json, 'e', end - json) == NULL) &&
+			(memchr(json, 'E', end - json) == NULL) &&
+			(fabs(d) < 9.2e18)){
+			cbor_put_int(o, strtoll(json, NULL, 10));
+		}
+		else{
+			cbor_put_double(o, d);
+		}
+		return end;
+	}
+	}
+}
+
+
+/****************************************************************
+ *
+ * property name and value, numbers and booleans are taken directly
+ * from the property value
+ *
+ * **************************************************************/
+static void cbor_put_property(cbor_out_t *o, property_t *p){
+	double val;
+	char *json, *value = NULL;
+
+	cbor_put_str(o, p -> desc -> id);
+	if (((p -> desc -> type == VAL_BOOLEAN) || (p -> desc -> type == VAL_INTEGER) ||
+		(p -> desc -> type == VAL_NUMBER)) && (property_value_num(p, &val) == true)){
+		if (p -> desc -> type == VAL_BOOLEAN){
+			cbor_put_byte(o, (val != 0) ? CBOR_TRUE : CBOR_FALSE);
+		}
+		else if (p -> desc -> type == VAL_INTEGER){
+			cbor_put_int(o, (int64_t)val);
+		}
+		else{
+			cbor_put_double(o, val);
+		}
+		return;
+	}
+
+	//"name":value
+	json = property_value_jsonize(p);
+	if (json != NULL){
+		value = strchr(json, ':');
+	}
+	if ((value == NULL) || (cbor_put_json(o, value + 1, 0) == NULL)){
+		o -> error = true;
+	}
+	req_free(json);
+}
+
+
+/****************************************************************
+ *
+ * find action input property by its index
+ *
+ * **************************************************************/
+static action_input_prop_t *get_input_prop(action_t *a, int index){
+	action_input_prop_t *ip = a -> input_properties;
+
+	while (ip != NULL){
+		if (ip -> input_prop_index == index){
+			break;
+		}
+		ip = ip -> next;
+	}
+
+	return ip;
+}
+
+
+/****************************************************************
+ *
+ * one action request: {"id":{"input":{},"href":"","timeRequested":1(t),
+ * "timeCompleted":1(t),"status":""}}, times are epoch tags
+ *
+ * **************************************************************/
+static void cbor_put_action_request(cbor_out_t *o, action_t *a, action_request_t *ar){
+	request_value_t *rv;
+	action_input_prop_t *ip;
+	char *href;
+	int n = 0;
+	uint8_t i;
+
+	cbor_put_head(o, CBOR_MAP, 1);
+	cbor_put_str(o, a -> id);
+	cbor_put_head(o, CBOR_MAP, (ar -> time_completed > 0) ? 5 : 4);
+
+	//inputs
+	for (i = 0; i < ar -> values_qua; i++){
+		if (get_input_prop(a, ar -> values[i].input_prop_index) != NULL){
+			n++;
+		}
+	}
+	cbor_put_str(o, "input");
+	cbor_put_head(o, CBOR_MAP, n);
+	for (i = 0; i < ar -> values_qua; i++){
+		rv = &(ar -> values[i]);
+		ip = get_input_prop(a, rv -> input_prop_index);
+		if (ip == NULL){
+			continue;
+		}
+		cbor_put_str(o, ip -> id);
+		if (ip -> type == VAL_INTEGER){
+			cbor_put_int(o, rv -> value.int_val);
+		}
+		else if (ip -> type == VAL_BOOLEAN){
+			cbor_put_byte(o, (rv -> value.bool_val == true) ? CBOR_TRUE : CBOR_FALSE);
+		}
+		else if (ip -> type == VAL_STRING){
+			cbor_put_str(o, rv -> value.str_val);
+		}
+		else{
+			cbor_put_double(o, rv -> value.num_val);
+		}
+	}
+
+	href = req_malloc(strlen(a -> id) + 30);
+	if (href == NULL){
+		o -> error = true;
+		return;
+	}
+	sprintf(href, "/%i/actions/%s/%i", a -> t -> thing_nr, a -> id, ar -> index);
+	cbor_put_str(o, "href");
+	cbor_put_str(o, href);
+	req_free(href);
+
+	cbor_put_str(o, "timeRequested");
+	cbor_put_time(o, ar -> time_requested);
+	if (ar -> time_completed > 0){
+		cbor_put_str(o, "timeCompleted");
+		cbor_put_time(o, ar -> time_completed);
+	}
+	cbor_put_str(o, "status");
+	cbor_put_str(o, action_status[ar -> status]);
+}
+
+
+/****************************************************************
+ *
+ * one emitted event: {"id":{"data":value,"timestamp":1(t)}}
+ *
+ * **************************************************************/
+static void cbor_put_event_item(cbor_out_t *o, event_t *e, event_item_t *ei){
+
+	cbor_put_head(o, CBOR_MAP, 1);
+	cbor_put_str(o, e -> id);
+	cbor_put_head(o, CBOR_MAP, 2);
+	cbor_put_str(o, "data");
+	if (e -> type == VAL_INTEGER){
+		cbor_put_int(o, ei -> value.int_val);
+	}
+	else if (e -> type == VAL_NUMBER){
+		cbor_put_double(o, ei -> value.num_val);
+	}
+	else if (e -> type == VAL_BOOLEAN){
+		cbor_put_byte(o, (ei -> value.bool_val == true) ? CBOR_TRUE : CBOR_FALSE);
+	}
+	else if (e -> type == VAL_STRING){
+		cbor_put_str(o, ei -> value.str_val);
+	}
+	else{
+		cbor_put_byte(o, CBOR_NULL);
+	}
+	cbor_put_str(o, "timestamp");
+	cbor_put_time(o, ei -> timestamp);
+}
+
+
+/*************************************************************************
+*
+* CBOR version of get_resource_value(), if name = NULL values of all
+* resources of given type are encoded
+*
+* ************************************************************************/
+uint8_t *get_resource_cbor(int8_t thing_nr, RESOURCE_TYPE resource, char *name, int index,
+							int *len){
+	cbor_out_t o;
+	thing_t *t;
+	int n = 0;
+
+	memset(&o, 0, sizeof(cbor_out_t));
+	t = get_thing_ptr(thing_nr);
+	if (t == NULL){
+		return NULL;
+	}
+
+	switch (resource){
+	// -----------------------------------------------------------
+	case PROPERTY:
+		if (name == NULL){
+			cbor_put_head(&o, CBOR_MAP, t -> prop_quant);
+			for (int i = 0; i < t -> prop_quant; i++){
+				cbor_put_property(&o, t -> properties[i]);
+			}
+		}
+		else{
+			property_t *p = get_property_ptr(t, name);
+
+			if (p == NULL){
+				return NULL;
+			}
+			cbor_put_head(&o, CBOR_MAP, 1);
+			cbor_put_property(&o, p);
+		}
+		break;
+
+	//-------------------------------------------------------------
+	case ACTION:
+		action_list_lock();
+		if (name == NULL){
+			//all requests of all actions
+			for (action_t *a = t -> actions; a != NULL; a = a -> next){
+				for (action_request_t *ar = get_first_request(a); ar != NULL;
+						ar = get_next_request(a, ar)){
+					n++;
+				}
+			}
+			cbor_put_head(&o, CBOR_ARRAY, n);
+			for (action_t *a = t -> actions; a != NULL; a = a -> next){
+				for (action_request_t *ar = get_first_request(a); ar != NULL;
+						ar = get_next_request(a, ar)){
+					cbor_put_action_request(&o, a, ar);
+				}
+			}
+		}
+		else{
+			action_t *a = get_action_ptr(t, name);
+
+			if (a == NULL){
+				action_list_unlock();
+				return NULL;
+			}
+			if (index < 0){
+				//all requests of the action
+				for (action_request_t *ar = get_first_request(a); ar != NULL;
+						ar = get_next_request(a, ar)){
+					n++;
+				}
+				cbor_put_head(&o, CBOR_ARRAY, n);
+				for (action_request_t *ar = get_first_request(a); ar != NULL;
+						ar = get_next_request(a, ar)){
+					cbor_put_action_request(&o, a, ar);
+				}
+			}
+			else{
+				action_request_t *ar = get_request_ptr(a, index);
+
+				if (ar == NULL){
+					action_list_unlock();
+					return NULL;
+				}
+				cbor_put_action_request(&o, a, ar);
+			}
+		}
+		action_list_unlock();
+		break;
+
+	//-------------------------------------------------------------
+	case EVENT:{
+		event_t *e = t -> events;
+
+		if (name != NULL){
+			e = get_event_ptr(t, name);
+			if (e == NULL){
+				return NULL;
+			}
+		}
+		event_item_t items[MAX_EVENTS];
+
+		//rings can be changed meanwhile, array of unknown length
+		cbor_put_byte(&o, CBOR_ARRAY_INDEF);
+		for (event_t *e1 = e; e1 != NULL; e1 = (name == NULL) ? e1 -> next : NULL){
+			n = get_event_items(e1, items);
+			for (int i = 0; i < n; i++){
+				cbor_put_event_item(&o, e1, &items[i]);
+			}
+		}
+		cbor_put_byte(&o, CBOR_BREAK);
+		break;
+	}
+
+	//-------------------------------------------------------------
+	default:
+		return NULL;
+	}
+
+	if (o.error == true){
+		req_free(o.buff);
+		return NULL;
+	}
+	*len = o.len;
+
+	return o.buff;
+}
+
+
+/****************************************************************
+ *
+ * read head of the next item, val is the argument (length, value)
+ *
+ * **************************************************************/
+static int8_t cbor_get_head(cbor_in_t *in, uint8_t *major, uint8_t *info, uint64_t *val){
+	uint8_t b;
+	int n;
+
+	if (in -> pos >= in -> len){
+		return -1;
+	}
+	b = in -> buff[in -> pos++];
+	*major = b >> 5;
+	*info = b & 0x1F;
+	*val = *info;
+	if ((*info < 24) || (*info == CBOR_INDEF)){
+		return 0;
+	}
+	if (*info > 27){
+		return -1;
+	}
+	n = 1 << (*info - 24);
+	if (in -> pos + n > in -> len){
+		return -1;
+	}
+	*val = 0;
+	while (n-- > 0){
+		*val = (*val << 8) | in -> buff[in -> pos++];
+	}
+
+	return 0;
+}
+
+
+static void json_put(cbor_out_t *o, const char *s){
+
+	cbor_put_bytes(o, s, strlen(s));
+}
+
+
+/****************************************************************
+ *
+ * CBOR text written as json string
+ *
+ * **************************************************************/
+static void json_put_string(cbor_out_t *o, const uint8_t *s, int n){
+	char esc[8];
+
+	cbor_put_byte(o, '"');
+	for (int i = 0; i < n; i++){
+		if ((s[i] == '"') || (s[i] == '\\')){
+			cbor_put_byte(o, '\\');
+			cbor_put_byte(o, s[i]);
+		}
+		else if (s[i] < 0x20){
+			sprintf(esc, "\\u%04x", s[i]);
+			json_put(o, esc);
+		}
+		else{
+			cbor_put_byte(o, s[i]);
+		}
+	}
+	cbor_put_byte(o, '"');
+}
+
+
+static double half_to_double(uint16_t h){
+	int exp = (h >> 10) & 0x1F;
+	int mant = h & 0x3FF;
+	double d;
+
+	if (exp == 0){
+		d = ldexp(mant, -24);
+	}
+	else if (exp == 31){
+		d = (mant == 0) ? INFINITY : NAN;
+	}
+	else{
+		d = ldexp(mant + 1024, exp - 25);
+	}
+
+	return (h & 0x8000) ? -d : d;
+}
+
+
+/****************************************************************
+ *
+ * convert one CBOR item into json text, set functions of properties
+ * and actions get values as text
+ *
+ * **************************************************************/
+static int8_t cbor_item_json(cbor_in_t *in, cbor_out_t *o, int depth){
+	uint8_t major, info;
+	uint64_t val;
+	char num[32];
+
+	if ((depth > CBOR_MAX_DEPTH) || (cbor_get_head(in, &major, &info, &val) < 0)){
+		return -1;
+	}
+	if ((info == CBOR_INDEF) && (major != CBOR_ARRAY) && (major != CBOR_MAP)){
+		//indefinite length strings are not supported
+		return -1;
+	}
+
+	switch (major){
+	case CBOR_UINT:
+		sprintf(num, "%llu", (unsigned long long)val);
+		json_put(o, num);
+		break;
+
+	case CBOR_NINT:
+		if (val > INT64_MAX){
+			return -1;
+		}
+		sprintf(num, "%lld", (long long)(-1 - (int64_t)val));
+		json_put(o, num);
+		break;
+
+	case CBOR_TEXT:
+		if (val > (uint64_t)(in -> len - in -> pos)){
+			return -1;
+		}
+		json_put_string(o, in -> buff + in -> pos, val);
+		in -> pos += val;
+		break;
+
+	case CBOR_ARRAY:
+	case CBOR_MAP:
+		json_put(o, (major == CBOR_MAP) ? "{" : "[");
+		for (uint64_t i = 0; (info == CBOR_INDEF) || (i < val); i++){
+			if (info == CBOR_INDEF){
+				if (in -> pos >= in -> len){
+					return -1;
+				}
+				if (in -> buff[in -> pos] == CBOR_BREAK){
+					in -> pos++;
+					break;
+				}
+			}
+			if (i > 0){
+				json_put(o, ",");
+			}
+			if (major == CBOR_MAP){
+				//only text keys
+				if ((in -> pos >= in -> len) || ((in -> buff[in -> pos] >> 5) != CBOR_TEXT)){
+					return -1;
+				}
+				if (cbor_item_json(in, o, depth + 1) < 0){
+					return -1;
+				}
+				json_put(o, ":");
+			}
+			if (cbor_item_json(in, o, depth + 1) < 0){
+				return -1;
+			}
+		}
+		json_put(o, (major == CBOR_MAP) ? "}" : "]");
+		break;
+
+	case CBOR_TAG:
+		//tag is skipped, e.g. epoch time becomes a number
+		return cbor_item_json(in, o, depth + 1);
+
+	case CBOR_SIMPLE:{
+		double d;
+
+		if (info == 20){
+			json_put(o, "false");
+			break;
+		}
+		else if (info == 21){
+			json_put(o, "true");
+			break;
+		}
+		else if ((info == 22) || (info == 23)){
+			json_put(o, "null");
+			break;
+		}
+		else if (info == 25){
+			d = half_to_double(val);
+		}
+		else if (info == 26){
+			uint32_t u = val;
+			float f;
+
+			memcpy(&f, &u, sizeof(f));
+			d = f;
+		}
+		else if (info == 27){
+			memcpy(&d, &val, sizeof(d));
+		}
+		else{
+			return -1;
+		}
+		if (isfinite(d) == 0){
+			json_put(o, "null");
+		}
+		else{
+			sprintf(num, "%.15g", d);
+			if (strtod(num, NULL) != d){
+				sprintf(num, "%.17g", d);
+			}
+			json_put(o, num);
+		}
+		break;
+	}
+
+	default:
+		//byte strings
+		return -1;
+	}
+
+	return (o -> error == true) ? -1 : 0;
+}
+
+
+/****************************************************************
+ *
+ * read text item and compare it with given string
+ *
+ * **************************************************************/
+static int8_t cbor_text_is(cbor_in_t *in, const char *s, bool *equal){
+	uint8_t major, info;
+	uint64_t val;
+
+	if ((cbor_get_head(in, &major, &info, &val) < 0) || (major != CBOR_TEXT) ||
+		(info == CBOR_INDEF) || (val > (uint64_t)(in -> len - in -> pos))){
+		return -1;
+	}
+	*equal = (strlen(s) == val) && (memcmp(in -> buff + in -> pos, s, val) == 0);
+	in -> pos += val;
+
+	return 0;
+}
+
+
+/****************************************************************
+ *
+ * skip one item
+ *
+ * **************************************************************/
+static int8_t cbor_skip(cbor_in_t *in){
+	cbor_out_t o;
+	int8_t res;
+
+	memset(&o, 0, sizeof(cbor_out_t));
+	res = cbor_item_json(in, &o, 0);
+	req_free(o.buff);
+
+	return res;
+}
+
+
+/****************************************************************
+ *
+ * find given key in the map, on success (0) the value is the next
+ * item to read
+ *
+ * **************************************************************/
+static int8_t cbor_map_find(cbor_in_t *in, const char *key){
+	uint8_t major, info;
+	uint64_t val;
+	bool equal;
+
+	if ((cbor_get_head(in, &major, &info, &val) < 0) || (major != CBOR_MAP)){
+		return -1;
+	}
+	for (uint64_t i = 0; (info == CBOR_INDEF) || (i < val); i++){
+		if ((info == CBOR_INDEF) && (in -> pos < in -> len) &&
+			(in -> buff[in -> pos] == CBOR_BREAK)){
+			break;
+		}
+		if (cbor_text_is(in, key, &equal) < 0){
+			return -1;
+		}
+		if (equal == true){
+			return 0;
+		}
+		if (cbor_skip(in) < 0){
+			return -1;
+		}
+	}
+
+	return -1;
+}
+
+
+/*************************************************************************
+*
+* set property value from CBOR message {"name":value}
+*
+* ************************************************************************/
+int16_t set_resource_cbor(int8_t thing_nr, char *name, uint8_t *body, int len){
+	cbor_in_t in = {body, len, 0};
+	cbor_out_t o;
+	int16_t result = 400;
+
+	memset(&o, 0, sizeof(cbor_out_t));
+	if ((cbor_map_find(&in, name) == 0) && (cbor_item_json(&in, &o, 0) == 0)){
+		cbor_put_byte(&o, 0);
+		if (o.error == false){
+			result = set_resource_value(thing_nr, name, (char *)o.buff);
+		}
+	}
+	req_free(o.buff);
+
+	return result;
+}
+
+
+/*************************************************************************
+*
+* request action from CBOR message {"action id":{"input":{...}}}
+* output: request index, -1 or ACTION_QUEUE_FULL, action id is allocated
+*
+* ************************************************************************/
+int request_action_cbor(int8_t thing_nr, uint8_t *body, int len, char **action_id){
+	cbor_in_t in = {body, len, 0};
+	cbor_out_t o;
+	uint8_t major, info;
+	uint64_t val;
+	int res = -1;
+
+	*action_id = NULL;
+	memset(&o, 0, sizeof(cbor_out_t));
+
+	//action id, the first key of the map
+	if ((cbor_get_head(&in, &major, &info, &val) < 0) || (major != CBOR_MAP) ||
+		(val == 0)){
+		return -1;
+	}
+	if ((cbor_get_head(&in, &major, &info, &val) < 0) || (major != CBOR_TEXT) ||
+		(info == CBOR_INDEF) || (val > (uint64_t)(in.len - in.pos))){
+		return -1;
+	}
+	*action_id = req_malloc(val + 1);
+	if (*action_id == NULL){
+		return -1;
+	}
+	memcpy(*action_id, in.buff + in.pos, val);
+	(*action_id)[val] = 0;
+	in.pos += val;
+
+	//inputs as json without braces, "name":value,... (empty for {})
+	if ((cbor_map_find(&in, "input") == 0) && (cbor_item_json(&in, &o, 0) == 0)){
+		cbor_put_byte(&o, 0);
+		if ((o.error == false) && (o.buff[0] == '{') && (o.len >= 3)){
+			o.buff[o.len - 2] = 0;
+			res = request_action(thing_nr, *action_id, (char *)o.buff + 1);
+		}
+	}
+	req_free(o.buff);
+
+	return res;
+}
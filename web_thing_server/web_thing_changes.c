@@ -0,0 +1,295 @@
+/*
+ * web_thing_changes.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  Change log: every property change, action status change and event
+ *  gets global, monotonically increasing sequence number. The last
+ *  CHANGE_LOG_SIZE changes are kept, so clients can ask only for changes
+ *  they missed (GET /changes?since=N or ws://host/N?since=N).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "common.h"
+#include "http_parser.h"
+#include "websocket.h"
+#include "simple_web_thing_server.h"
+#include "web_thing_changes.h"
+#include "web_thing_arena.h"
+
+static change_item_t change_log[CHANGE_LOG_SIZE];
+static uint32_t last_seq = 0;
+static xSemaphoreHandle change_mux = NULL;
+
+static bool change_log_too_old(uint32_t since);
+static bool change_log_get(uint32_t seq, change_item_t *ci);
+
+
+/****************************************************************
+ *
+ * initialize change log, called by root_node_init
+ *
+ * **************************************************************/
+void change_log_init(void){
+
+	memset(change_log, 0, sizeof(change_log));
+	last_seq = 0;
+	if (change_mux == NULL){
+		change_mux = xSemaphoreCreateMutex();
+	}
+}
+
+
+/****************************************************************
+ *
+ * add change to the log
+ * output: sequence number of the change
+ *
+ * **************************************************************/
+uint32_t change_log_add(RESOURCE_TYPE type, thing_t *t, void *resource, int index){
+	change_item_t *ci;
+	uint32_t seq;
+
+	xSemaphoreTake(change_mux, portMAX_DELAY);
+	seq = ++last_seq;
+	ci = &change_log[seq % CHANGE_LOG_SIZE];
+	ci -> seq = seq;
+	ci -> type = type;
+	ci -> t = t;
+	ci -> resource = resource;
+	ci -> index = index;
+	xSemaphoreGive(change_mux);
+
+	return seq;
+}
+
+
+/****************************************************************
+ *
+ * current (the last) sequence number
+ *
+ * **************************************************************/
+uint32_t change_log_seq(void){
+
+	return last_seq;
+}
+
+
+/****************************************************************
+ *
+ * check if changes after "since" are no longer in the log
+ * (or "since" is from before server restart)
+ *
+ * **************************************************************/
+static bool change_log_too_old(uint32_t since){
+	uint32_t oldest;
+
+	oldest = (last_seq >= CHANGE_LOG_SIZE) ? last_seq - CHANGE_LOG_SIZE + 1 : 1;
+	if ((since > last_seq) || (since + 1 < oldest)){
+		return true;
+	}
+
+	return false;
+}
+
+
+/****************************************************************
+ *
+ * copy change of given sequence number
+ * output: false if change is already overwritten
+ *
+ * **************************************************************/
+static bool change_log_get(uint32_t seq, change_item_t *ci){
+	bool res = false;
+
+	xSemaphoreTake(change_mux, portMAX_DELAY);
+	if (change_log[seq % CHANGE_LOG_SIZE].seq == seq){
+		*ci = change_log[seq % CHANGE_LOG_SIZE];
+		res = true;
+	}
+	xSemaphoreGive(change_mux);
+
+	return res;
+}
+
+
+/****************************************************************
+ *
+ * prepare websocket message for the change
+ * inputs:
+ * 		ci - change
+ * 		with_thing - add thing number to the message
+ * output:
+ * 		message (websocket payload, released by ws_payload_free) or NULL
+ * 		if the change was overwritten by the newer one (e.g. next change
+ * 		of the same property)
+ *
+ * **************************************************************/
+char *change_msg_jsonize(change_item_t *ci, bool with_thing){
+	char msg_str[] = "{\"messageType\":\"%s\",%s\"seq\":%u,\"data\":%s%s%s}";
+	char thing_str[16];
+	char *data = NULL, *buff = NULL, *type = NULL;
+	bool curly = false;
+
+	thing_str[0] = 0;
+	if (with_thing == true){
+		sprintf(thing_str, "\"thing\":%i,", ci -> t -> thing_nr);
+	}
+
+	switch (ci -> type){
+	case PROPERTY:{
+		property_t *p = (property_t *)ci -> resource;
+
+		if (p -> change_seq == ci -> seq){
+			data = property_value_jsonize(p);
+			type = "propertyStatus";
+			curly = true;
+		}
+		break;
+	}
+	case ACTION:{
+		action_t *a = (action_t *)ci -> resource;
+		action_request_t *ar = get_request_ptr(a, ci -> index);
+
+		if ((ar != NULL) && (ar -> seq == ci -> seq)){
+			data = action_request_jsonize(ci -> t -> thing_nr, a -> id, ci -> index);
+			type = "actionStatus";
+		}
+		break;
+	}
+	case EVENT:{
+		event_t *e = (event_t *)ci -> resource;
+		event_item_t items[MAX_EVENTS];
+		int n = get_event_items(e, items);
+
+		for (int i = 0; i < n; i++){
+			if (items[i].seq == ci -> seq){
+				data = event_item_jsonize(e, &items[i]);
+				type = "event";
+				curly = true;
+				break;
+			}
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	if (data != NULL){
+		buff = ws_payload_alloc(strlen(msg_str) + strlen(type) + strlen(thing_str) +
+								strlen(data) + 15);
+		if (buff != NULL){
+			sprintf(buff, msg_str, type, thing_str, (unsigned int)ci -> seq,
+					curly ? "{" : "", data, curly ? "}" : "");
+		}
+		req_free(data);
+	}
+
+	return buff;
+}
+
+
+/****************************************************************
+ *
+ * send changes after "since" as chunked HTTP response (GET /changes)
+ * 		{"seq":N,"resync":false,"changes":[...]}
+ * 	or, if changes are no longer in the log:
+ * 		{"seq":N,"resync":true}
+ *
+ * **************************************************************/
+int16_t change_log_stream(connection_desc_t *conn_desc, uint32_t since){
+	char head[60];
+	char *msg;
+	uint32_t seq_now;
+	bool first = true;
+	change_item_t ci;
+
+	if (http_stream_begin(conn_desc) < 0){
+		return HTTP_STREAMED;
+	}
+
+	seq_now = last_seq;
+	if (change_log_too_old(since) == true){
+		sprintf(head, "{\"seq\":%u,\"resync\":true}", (unsigned int)seq_now);
+		if (http_stream_write(conn_desc, head, strlen(head)) == 0){
+			http_stream_end(conn_desc);
+		}
+		return HTTP_STREAMED;
+	}
+
+	sprintf(head, "{\"seq\":%u,\"resync\":false,\"changes\":[", (unsigned int)seq_now);
+	if (http_stream_write(conn_desc, head, strlen(head)) < 0){
+		return HTTP_STREAMED;
+	}
+	for (uint32_t s = since + 1; s <= seq_now; s++){
+		if (change_log_get(s, &ci) == false){
+			continue;
+		}
+		msg = change_msg_jsonize(&ci, true);
+		if (msg != NULL){
+			if (first == false){
+				http_stream_write(conn_desc, ",", 1);
+			}
+			first = false;
+			if (http_stream_write(conn_desc, msg, strlen(msg)) < 0){
+				ws_payload_free(msg);
+				return HTTP_STREAMED;
+			}
+			ws_payload_free(msg);
+		}
+	}
+	if (http_stream_write(conn_desc, "]}", 2) == 0){
+		http_stream_end(conn_desc);
+	}
+
+	return HTTP_STREAMED;
+}
+
+
+/****************************************************************
+ *
+ * send to the websocket client all changes of it's thing (all things for
+ * node websocket) after "since",
+ * message {"messageType":"resync","seq":N} is sent if changes are
+ * no longer in the log
+ *
+ * **************************************************************/
+int8_t change_log_replay(connection_desc_t *conn_desc, uint32_t since){
+	char *msg;
+	uint32_t seq_now;
+	change_item_t ci;
+
+	seq_now = last_seq;
+	if (change_log_too_old(since) == true){
+		msg = ws_payload_alloc(50);
+		if (msg != NULL){
+			sprintf(msg, "{\"messageType\":\"resync\",\"seq\":%u}", (unsigned int)seq_now);
+			ws_queue_text(conn_desc, msg);
+		}
+		return -1;
+	}
+
+	for (uint32_t s = since + 1; s <= seq_now; s++){
+		if (change_log_get(s, &ci) == false){
+			continue;
+		}
+		if ((conn_desc -> ws_node == false) && (ci.t != conn_desc -> thing)){
+			continue;
+		}
+		msg = change_msg_jsonize(&ci, conn_desc -> ws_node);
+		if (msg != NULL){
+			ws_queue_text(conn_desc, msg);
+		}
+	}
+
+	return 0;
+}
@@ -11,24 +11,56 @@
 #include "common.h"
 #include "simple_web_thing_server.h"
 #include "web_thing_event.h"
+#include "web_thing_event_log.h"
 #include "web_thing.h"
+#include "web_thing_arena.h"
 
 char *event_model_jsonize(event_t *a, int16_t thing_index);
-event_t *get_event_ptr(thing_t *t, char *event_id);
-int add_event_to_list(event_t *e, event_item_t *ei);
+static void add_event_to_ring(event_t *e, void *value, time_t timestamp);
 char *event_item_jsonize(event_t *e, event_item_t *ei);
 
+//rings are written also from interrupts
+static portMUX_TYPE event_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static xSemaphoreHandle event_mux = NULL;
 
-/**/
-int8_t add_event_subscriber(event_t *_t, connection_desc_t *_c){
+
+/*****************************************************
+ *
+ * subscribe connection to the event, after the first subscription
+ * only subscribed events are sent to this connection
+ *
+ * ***************************************************/
+int8_t add_event_subscriber(event_t *_e, connection_desc_t *_c){
 	int8_t res = -1;
+	subscriber_t *s = get_subscriber(_e -> t, _c);
+
+	if (s != NULL){
+		s -> event_filter = true;
+		s -> event_mask |= SUBSCR_BIT(_e -> index);
+		res = 0;
+	}
 
 	return res;
 }
 
-/**/
-int8_t delete_event_subscriber(event_t *_t, connection_desc_t *_c){
+/*****************************************************
+ *
+ * unsubscribe connection from the event
+ *
+ * ***************************************************/
+int8_t delete_event_subscriber(event_t *_e, connection_desc_t *_c){
 	int8_t res = -1;
+	subscriber_t *s = get_subscriber(_e -> t, _c);
+
+	if (s != NULL){
+		if (s -> event_filter == false){
+			//so far all were sent, keep the others
+			s -> event_filter = true;
+			s -> event_mask = 0xFFFFFFFF;
+		}
+		s -> event_mask &= ~SUBSCR_BIT(_e -> index);
+		res = 0;
+	}
 
 	return res;
 }
@@ -36,88 +68,224 @@ int8_t delete_event_subscriber(event_t *_t, connection_desc_t *_c){
 
 /****************************************************
  *
- * emit event
+ * emit event, value is copied into the event's ring (int *, double *,
+ * bool * or char * according to event type, NULL - no value),
+ * the caller keeps ownership of the value
  *
  * **************************************************/
 int8_t emit_event(int thing_nr, char *event_id, void *value){
 	int8_t res = -1;
 	thing_t *t = NULL;
 	event_t *e = NULL;
-	char *msg;
 
 	//find thing
 	t = get_thing_ptr(thing_nr);
 	if (t != NULL){
 		e = get_event_ptr(t, event_id);
 		if (e != NULL){
-			//add event to the event list
-			event_item_t *ei;
-			ei = malloc(sizeof(event_item_t));
-			ei -> timestamp = time(NULL);
-			ei -> next = NULL;
-			ei -> value = value;
+			add_event_to_ring(e, value, time(NULL));
+			//send event to subscribers
+			send_events(t);
+			res = 0;
+		}
+	}
 
-			add_event_to_list(e, ei);
+	return res;
+}
 
-			//send event to subscribers
-			if (t -> subscribers != NULL){
-				msg = event_item_jsonize(e, ei);
-				inform_all_subscribers_event(e, msg, strlen(msg));
-				free(msg);
+
+/****************************************************
+ *
+ * emit event from interrupt or other high priority context,
+ * the event is only written into the ring (no heap, no mutexes),
+ * it gets time stamp and is sent to subscribers by notify task
+ * within NOTIFY_PERIOD_MS
+ *
+ * **************************************************/
+int8_t emit_event_from_isr(event_t *e, void *value){
+
+	if (e == NULL){
+		return -1;
+	}
+	add_event_to_ring(e, value, 0);
+
+	return 0;
+}
+
+
+/****************************************************
+ *
+ * write event into the ring, the oldest one is overwritten
+ *
+ * **************************************************/
+static void add_event_to_ring(event_t *e, void *value, time_t timestamp){
+	event_item_t *ei;
+
+	portENTER_CRITICAL_SAFE(&event_spinlock);
+	ei = &(e -> items[e -> emitted % MAX_EVENTS]);
+	memset(ei, 0, sizeof(event_item_t));
+	ei -> timestamp = timestamp;
+	if (value != NULL){
+		switch (e -> type){
+		case VAL_INTEGER:
+			ei -> value.int_val = *(int *)value;
+			break;
+		case VAL_NUMBER:
+			ei -> value.num_val = *(double *)value;
+			break;
+		case VAL_BOOLEAN:
+			ei -> value.bool_val = *(bool *)value;
+			break;
+		case VAL_STRING:
+			strncpy(ei -> value.str_val, (char *)value, EVENT_STR_LEN - 1);
+			break;
+		default:
+			break;
+		}
+	}
+	e -> emitted++;
+	portEXIT_CRITICAL_SAFE(&event_spinlock);
+}
+
+
+/****************************************************
+ *
+ * send events not sent yet to subscribers, every event gets
+ * sequence number in the change log
+ *
+ * **************************************************/
+void send_events(thing_t *t){
+	event_t *e;
+	event_item_t *ei, item;
+	uint32_t n;
+	bool valid;
+	char *msg;
+
+	if (event_mux == NULL){
+		return;
+	}
+	xSemaphoreTake(event_mux, portMAX_DELAY);
+	for (e = t -> events; e != NULL; e = e -> next){
+		for (;;){
+			//next event to be sent, skip overwritten ones
+			portENTER_CRITICAL(&event_spinlock);
+			if (e -> emitted - e -> sent > MAX_EVENTS){
+				e -> sent = e -> emitted - MAX_EVENTS;
+			}
+			n = e -> sent;
+			valid = (n != e -> emitted);
+			portEXIT_CRITICAL(&event_spinlock);
+			if (valid == false){
+				break;
+			}
+
+			uint32_t seq = change_log_add(EVENT, t, e, 0);
+
+			portENTER_CRITICAL(&event_spinlock);
+			valid = (e -> emitted - n <= MAX_EVENTS);
+			if (valid == true){
+				ei = &(e -> items[n % MAX_EVENTS]);
+				ei -> seq = seq;
+				if (ei -> timestamp == 0){
+					ei -> timestamp = time(NULL);
+				}
+				item = *ei;
+			}
+			e -> sent = n + 1;
+			portEXIT_CRITICAL(&event_spinlock);
+
+			if (valid == true){
+				//persistent log, doesn't wait
+				event_log_add(e, &item);
+			}
+			if ((valid == true) && (t -> subscribers != NULL)){
+				msg = event_item_jsonize(e, &item);
+				if (msg != NULL){
+					inform_all_subscribers_event(e, msg, strlen(msg), seq);
+					req_free(msg);
+				}
 			}
 		}
 	}
+	xSemaphoreGive(event_mux);
+}
 
-	return res;
+
+/****************************************************
+ *
+ * copy emitted and already sent events (the oldest first) into items,
+ * items must have place for MAX_EVENTS events
+ * output: number of events
+ *
+ * **************************************************/
+int get_event_items(event_t *e, event_item_t *items){
+	uint32_t first;
+	int n = 0;
+
+	portENTER_CRITICAL(&event_spinlock);
+	first = (e -> emitted > MAX_EVENTS) ? e -> emitted - MAX_EVENTS : 0;
+	for (uint32_t i = first; (int32_t)(e -> sent - i) > 0; i++){
+		items[n++] = e -> items[i % MAX_EVENTS];
+	}
+	portEXIT_CRITICAL(&event_spinlock);
+
+	return n;
 }
 
 
 /******************************************************
  *
- * jsonize one event emit item
+ * print one event emit item into buffer (like snprintf)
+ * output: length of the whole item
  *
  * ***************************************************/
-char *event_item_jsonize(event_t *e, event_item_t *ei){
-	char *out_buff = NULL, *buff = NULL;
-	void *value;
-	char msg_str[] = "\"%s\":{\"data\":%s,\"timestamp\":\"%s\"}";
-
-	value = ei -> value;
+int event_item_print(event_t *e, event_item_t *ei, char *buff, int size){
+	char msg_str[] = "\"%s\":{\"data\":%s%s%s,\"timestamp\":\"%04i-%02i-%02iT%02i:%02i:%02i+00:00\"}";
+	char value[EVENT_STR_LEN + 2];
+	char *quote = "";
+	struct tm ti;
 
-	//prepare event message
 	switch(e -> type){
 	case VAL_INTEGER:
-		buff = malloc(10);
-		memset(buff, 0, 10);
-		sprintf(buff, "%i", *((int *)value));
+		sprintf(value, "%i", ei -> value.int_val);
 		break;
 	case VAL_NUMBER:
-		buff = malloc(10);
-		memset(buff, 0, 10);
-		sprintf(buff, "%3.2f", *((double *)value));
+		snprintf(value, sizeof(value), "%3.2f", ei -> value.num_val);
+		break;
+	case VAL_BOOLEAN:
+		strcpy(value, (ei -> value.bool_val == true) ? "true" : "false");
 		break;
 	case VAL_STRING:
-		buff = malloc(strlen(value) + 3);
-		sprintf(buff, "\"%s\"", (char *)value);
+		strcpy(value, ei -> value.str_val);
+		quote = "\"";
 		break;
 	default:
-		buff = malloc(3);
-		strcpy(buff, "");
+		strcpy(value, "null");
 	}
-	//request time
-	struct tm ti;
 
+	//event time
 	localtime_r(&(ei -> timestamp), &ti);
-	char *t_event = malloc(50);
-	memset(t_event, 0, 50);
-	sprintf(t_event, "%04i-%02i-%02iT%02i:%02i:%02i+00:00", ti.tm_year + 1900,
-			ti.tm_mon + 1, ti.tm_mday, ti.tm_hour, ti.tm_min, ti.tm_sec);
 
-	out_buff = malloc(strlen(msg_str) + strlen(t_event) + strlen(buff)
-			+ strlen(e -> id) + 1);
-	sprintf(out_buff, msg_str, e -> id, buff, t_event);
-	free(t_event);
-	free(buff);
+	return snprintf(buff, size, msg_str, e -> id, quote, value, quote,
+			ti.tm_year + 1900, ti.tm_mon + 1, ti.tm_mday,
+			ti.tm_hour, ti.tm_min, ti.tm_sec);
+}
+
+
+/******************************************************
+ *
+ * jsonize one event emit item
+ *
+ * ***************************************************/
+char *event_item_jsonize(event_t *e, event_item_t *ei){
+	char *out_buff;
+	int len;
+
+	len = event_item_print(e, ei, NULL, 0);
+	out_buff = req_malloc(len + 1);
+	if (out_buff != NULL){
+		event_item_print(e, ei, out_buff, len + 1);
+	}
 
 	return out_buff;
 }
@@ -133,6 +301,9 @@ event_t *event_init(void){
 
 	e = malloc(sizeof(event_t));
 	memset(e, 0, sizeof(event_t));
+	if (event_mux == NULL){
+		event_mux = xSemaphoreCreateMutex();
+	}
 
 	return e;
 }
@@ -152,7 +323,7 @@ char *get_events_model(thing_t *t){
 	}
 	//printf("events: %i\n", i);
 	if (i > 0){
-		events = malloc(i * 500);
+		events = req_malloc(i * 500);
 		memset(events, 0, i * 500);
 
 		e = t -> events;
@@ -160,7 +331,7 @@ char *get_events_model(thing_t *t){
 			for (int j = i; j > 0; j--){
 				buff_temp = event_model_jsonize(e, t -> thing_nr);
 				strcat(events, buff_temp);
-				free(buff_temp);
+				req_free(buff_temp);
 				if (j != 1){
 					strcat(events, ",");
 				}
@@ -172,7 +343,7 @@ char *get_events_model(thing_t *t){
 		}
 	}
 	else{
-		events = malloc(3);
+		events = req_malloc(3);
 		strcpy(events, "");
 	}
 
@@ -203,7 +374,7 @@ char *event_model_jsonize(event_t *e, int16_t thing_index){
 	uint16_t model_len = strlen(event_str) + strlen(e -> description) +
 						2 * strlen(e -> id) + 40;
 
-	buff = malloc(model_len);
+	buff = req_malloc(model_len);
 	sprintf(buff, event_str, e -> id, e -> title, e -> description,
 			e -> at_type, type[e -> type], e -> unit, th_lk, e -> id);
 
@@ -211,46 +382,6 @@ char *event_model_jsonize(event_t *e, int16_t thing_index){
 }
 
 
-/**************************************************************
- *
- *
- *
- * ************************************************************/
-int add_event_to_list(event_t *e, event_item_t *ei){
-	int res = -1;
-
-	//count events in the list
-	event_item_t *event_item = e -> event_list;
-	event_item_t *last_event_item = e -> event_list;
-	int i = 0;
-	while (event_item != NULL){
-		last_event_item = event_item;
-		event_item = event_item -> next;
-		i++;
-	}
-
-	//add event into list
-	if (i == MAX_EVENTS){
-		//list is full, delete the oldest item to make place for new one
-		event_item_t *ei_temp = e -> event_list; //to be deleted
-		e -> event_list = e -> event_list -> next;
-
-		//delete value from the oldest item
-		free(ei_temp -> value);
-		free(ei_temp);
-	}
-
-	if (last_event_item == NULL){
-		e -> event_list = ei;
-	}
-	else{
-		last_event_item -> next = ei;
-	}
-
-	return res;
-}
-
-
 /**/
 event_t *get_event_ptr(thing_t *t, char *event_id){
 	event_t *e = NULL;
@@ -272,101 +403,64 @@ event_t *get_event_ptr(thing_t *t, char *event_id){
 
 /**********************************************************
  *
- *
+ * list of emitted events of the thing (event_id == NULL)
+ * or of one event, buffer has the exact size
  *
  * ********************************************************/
 char *event_list_jsonize(int thing_nr, char *event_id){
 	char *buff = NULL;
 	thing_t *t;
-	int i = 0;
+	event_t *e, **ev;
+	event_item_t *items;
+	int i, n = 0, e_qua = 0, len = 2, pos;
 
 	t = get_thing_ptr(thing_nr);
-
-	if (event_id == NULL){
-		//all events for this thing
-		//count the number of all events
-		event_t *e = t -> events;
-		while (e != NULL){
-			event_item_t *ei = e -> event_list;
-			while (ei != NULL){
-				i++;
-				ei = ei -> next;
-			}
-			e = e -> next;
+	if (t == NULL){
+		return NULL;
+	}
+	if (event_id != NULL){
+		e = get_event_ptr(t, event_id);
+		if (e == NULL){
+			return NULL;
 		}
-
-		if (i > 0){
-			buff = malloc(i * 100);
-			memset(buff, 0, i * 100);
-			strcat(buff, "[");
-			e = t -> events;
-			while (e != NULL){
-				event_item_t *ei = e -> event_list;
-				while (ei != NULL){
-					char *temp_buff = event_item_jsonize(e, ei);
-					strcat(buff, "{");
-					strcat(buff, temp_buff);
-					strcat(buff, "}");
-					free(temp_buff);
-					ei = ei -> next;
-					if (ei != NULL){
-						strcat(buff, ",");
-					}
-				}
-				e = e -> next;
-				if (e != NULL){
-					if (e -> event_list != NULL){
-						strcat(buff, ",");
-					}
-				}
-			}
-			strcat(buff, "]");
+		e_qua = 1;
+	}
+	else{
+		e = t -> events;
+		for (event_t *e1 = e; e1 != NULL; e1 = e1 -> next){
+			e_qua++;
 		}
-		else{
-			//no events emitted yet
-			buff = malloc(3);
-			buff[0] = '[';
-			buff[1] = ']';
-			buff[2] = 0;
+	}
+
+	//copy of all rings, they can be changed meanwhile
+	items = req_malloc(e_qua * MAX_EVENTS * (sizeof(event_item_t) + sizeof(event_t *)) + 1);
+	if (items == NULL){
+		return NULL;
+	}
+	ev = (event_t **)(items + e_qua * MAX_EVENTS);
+	for (i = 0; i < e_qua; i++, e = e -> next){
+		int k = get_event_items(e, items + n);
+
+		while (k-- > 0){
+			ev[n++] = e;
 		}
 	}
-	else{
-		//only particular event
-		event_t *e = get_event_ptr(t, event_id);
-		if (e != NULL){
-			event_item_t *ei = e -> event_list;
-			while (ei != NULL){
-				i++;
-				ei = ei -> next;
-			}
-			if (i > 0){
-				buff = malloc(i * 100);
-				memset(buff, 0, i * 100);
-				strcat(buff, "[");
-
-				event_item_t *ei = e -> event_list;
-				while (ei != NULL){
-					char *temp_buff = event_item_jsonize(e, ei);
-					strcat(buff, "{");
-					strcat(buff, temp_buff);
-					strcat(buff, "}");
-					free(temp_buff);
-					ei = ei -> next;
-					if (ei != NULL){
-						strcat(buff, ",");
-					}
-				}
-				strcat(buff, "]");
-			}
-			else{
-				//no events emitted yet
-				buff = malloc(3);
-				buff[0] = '[';
-				buff[1] = ']';
-				buff[2] = 0;
-			}
+
+	//[{item},{item}]
+	for (i = 0; i < n; i++){
+		len += event_item_print(ev[i], &items[i], NULL, 0) + 3;
+	}
+	buff = req_malloc(len + 1);
+	if (buff != NULL){
+		pos = sprintf(buff, "[");
+		for (i = 0; i < n; i++){
+			pos += sprintf(buff + pos, (i == 0) ? "{" : ",{");
+			pos += event_item_print(ev[i], &items[i], buff + pos, len + 1 - pos);
+			pos += sprintf(buff + pos, "}");
 		}
+		sprintf(buff + pos, "]");
 	}
+	req_free(items);
 
 	return buff;
 }
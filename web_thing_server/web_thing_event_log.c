@@ -0,0 +1,456 @@
+/*
+ * web_thing_event_log.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  Persistent event log: emitted events are appended as 32 bytes
+ *  records to a flash partition used as a circular log (sectors are
+ *  erased in turn, so wear is spread evenly), read by
+ *  GET /N/events?log_seq=&from= (log_seq is the sequence number of
+ *  the log, not seq of the change log used by /changes?since=)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+
+#include "common.h"
+#include "http_parser.h"
+#include "simple_web_thing_server.h"
+#include "web_thing_event_log.h"
+
+#define LOG_REC_LEN		sizeof(event_log_rec_t)
+#define LOG_BATCH		8		//records written at once (one flash page)
+#define LOG_QUEUE_LEN	16		//records waiting for writing
+#define LOG_OUT_BUFF	512		//size of one output chunk
+
+#define LOG_TASK_STACK	(1024*3)
+
+static const esp_partition_t *log_part = NULL;
+static uint16_t log_sectors = 0;
+#ifdef CONFIG_STATIC_ALLOC
+static uint32_t sector_seq[EVENT_LOG_MAX_SECTORS];
+static uint32_t sector_time[EVENT_LOG_MAX_SECTORS];
+static StackType_t log_stack[LOG_TASK_STACK];
+static StaticTask_t log_tcb;
+static StaticQueue_t log_queue_buff;
+static uint8_t log_queue_storage[LOG_QUEUE_LEN * LOG_REC_LEN];
+static StaticSemaphore_t log_mux_buff;
+#else
+static uint32_t *sector_seq = NULL;		//seq of the first record in sector
+static uint32_t *sector_time = NULL;	//timestamp of the first record in sector
+#endif
+static uint32_t log_head = 0;			//offset of the next record
+static uint32_t log_seq = 0;			//seq of the last written record
+static uint32_t log_dropped = 0;		//records lost, queue was full
+static xQueueHandle log_queue = NULL;
+static xSemaphoreHandle log_mux = NULL;
+
+static void event_log_task(void *arg);
+static void log_write(event_log_rec_t *recs, int n);
+static uint8_t log_crc(event_log_rec_t *r);
+
+
+/****************************************************************
+ *
+ * open event log partition, find the last written record
+ * a record torn by power cut (crc doesn't match) is skipped, its place
+ * stays used until the sector is erased
+ * output: 0 - OK, -1 - no partition or not enough memory
+ *
+ * **************************************************************/
+int8_t event_log_init(void){
+	event_log_rec_t recs[LOG_BATCH];
+	uint32_t head_sec = 0, max_seq = 0;
+	bool found = false;
+
+	log_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+									ESP_PARTITION_SUBTYPE_ANY, EVENT_LOG_PARTITION);
+	if (log_part == NULL){
+		printf("event log: no \"%s\" partition\n", EVENT_LOG_PARTITION);
+		return -1;
+	}
+	log_sectors = log_part -> size / SPI_FLASH_SEC_SIZE;
+	if (log_sectors < 2){
+		printf("event log: partition too small\n");
+		log_part = NULL;
+		return -1;
+	}
+#ifdef CONFIG_STATIC_ALLOC
+	if (log_sectors > EVENT_LOG_MAX_SECTORS){
+		log_sectors = EVENT_LOG_MAX_SECTORS;
+	}
+#else
+	sector_seq = malloc(log_sectors * sizeof(uint32_t));
+	sector_time = malloc(log_sectors * sizeof(uint32_t));
+	if ((sector_seq == NULL) || (sector_time == NULL)){
+		free(sector_seq);
+		free(sector_time);
+		log_part = NULL;
+		return -1;
+	}
+#endif
+
+	//index: the first valid record of every sector, the newest is the head
+	for (int i = 0; i < log_sectors; i++){
+		esp_partition_read(log_part, i * SPI_FLASH_SEC_SIZE, recs, sizeof(recs));
+		sector_seq[i] = recs[0].seq;
+		sector_time[i] = recs[0].timestamp;
+		for (int n = 0; (n < LOG_BATCH) && (recs[n].seq != EVENT_LOG_EMPTY); n++){
+			if (recs[n].crc == log_crc(&recs[n])){
+				sector_seq[i] = recs[n].seq;
+				sector_time[i] = recs[n].timestamp;
+				break;
+			}
+			//torn record only, the sector is older than all others
+			sector_seq[i] = 0;
+			sector_time[i] = 0;
+		}
+		if ((sector_seq[i] != EVENT_LOG_EMPTY) && (sector_seq[i] >= max_seq)){
+			max_seq = sector_seq[i];
+			head_sec = i;
+			found = true;
+		}
+	}
+
+	//find the first free place in the head sector
+	log_head = head_sec * SPI_FLASH_SEC_SIZE;
+	log_seq = 0;
+	if (found == true){
+		uint32_t end = log_head + SPI_FLASH_SEC_SIZE;
+
+		while (log_head < end){
+			int n = 0;
+
+			esp_partition_read(log_part, log_head, recs, sizeof(recs));
+			while ((n < LOG_BATCH) && (recs[n].seq != EVENT_LOG_EMPTY)){
+				if (recs[n].crc == log_crc(&recs[n])){
+					log_seq = recs[n].seq;
+				}
+				n++;
+			}
+			log_head += n * LOG_REC_LEN;
+			if (n < LOG_BATCH){
+				break;
+			}
+		}
+		log_head %= log_sectors * SPI_FLASH_SEC_SIZE;
+	}
+
+#ifdef CONFIG_STATIC_ALLOC
+	log_mux = xSemaphoreCreateMutexStatic(&log_mux_buff);
+	log_queue = xQueueCreateStatic(LOG_QUEUE_LEN, LOG_REC_LEN, log_queue_storage, &log_queue_buff);
+	xTaskCreateStatic(event_log_task, "event_log_task", LOG_TASK_STACK, NULL, 1,
+					log_stack, &log_tcb);
+#else
+	log_mux = xSemaphoreCreateMutex();
+	log_queue = xQueueCreate(LOG_QUEUE_LEN, LOG_REC_LEN);
+	xTaskCreate(event_log_task, "event_log_task", LOG_TASK_STACK, NULL, 1, NULL);
+#endif
+	printf("event log: %i sectors, last seq %u\n", log_sectors, (unsigned int)log_seq);
+
+	return 0;
+}
+
+
+/****************************************************************
+ *
+ * put emitted event into writing queue, never waits
+ * (the record is lost if the queue is full)
+ *
+ * **************************************************************/
+void event_log_add(event_t *e, event_item_t *ei){
+	event_log_rec_t r;
+	int32_t i32;
+
+	if (log_queue == NULL){
+		return;
+	}
+
+	memset(&r, 0, sizeof(r));
+	r.timestamp = (uint32_t)ei -> timestamp;
+	r.thing_nr = e -> t -> thing_nr;
+	r.event_index = e -> index;
+	r.type = e -> type;
+	switch (e -> type){
+	case VAL_INTEGER:
+		i32 = ei -> value.int_val;
+		memcpy(r.value, &i32, sizeof(i32));
+		break;
+	case VAL_NUMBER:
+		memcpy(r.value, &(ei -> value.num_val), sizeof(double));
+		break;
+	case VAL_BOOLEAN:
+		r.value[0] = (ei -> value.bool_val == true) ? 1 : 0;
+		break;
+	case VAL_STRING:
+		strncpy((char *)r.value, ei -> value.str_val, EVENT_LOG_VALUE_LEN);
+		break;
+	default:
+		break;
+	}
+
+	if (xQueueSend(log_queue, &r, 0) != pdTRUE){
+		log_dropped++;
+	}
+}
+
+
+/****************************************************************
+ *
+ * log writing task, records are written in batches, a shorter batch
+ * is written EVENT_LOG_FLUSH_MS after the last record
+ *
+ * **************************************************************/
+static void event_log_task(void *arg){
+	event_log_rec_t batch[LOG_BATCH];
+	int n = 0;
+
+	for (;;){
+		TickType_t wait = (n == 0) ? portMAX_DELAY : pdMS_TO_TICKS(EVENT_LOG_FLUSH_MS);
+
+		if (xQueueReceive(log_queue, &batch[n], wait) == pdTRUE){
+			n++;
+			if (n < LOG_BATCH){
+				continue;
+			}
+		}
+		if (n > 0){
+			xSemaphoreTake(log_mux, portMAX_DELAY);
+			log_write(batch, n);
+			xSemaphoreGive(log_mux);
+			n = 0;
+		}
+	}
+}
+
+
+/****************************************************************
+ *
+ * write records at the head of the log, the next sector is erased
+ * when the head enters it (the oldest records are lost)
+ *
+ * **************************************************************/
+static void log_write(event_log_rec_t *recs, int n){
+	uint32_t sec, k;
+
+	for (int i = 0; i < n; i++){
+		recs[i].seq = ++log_seq;
+		recs[i].crc = log_crc(&recs[i]);
+	}
+
+	while (n > 0){
+		sec = log_head / SPI_FLASH_SEC_SIZE;
+		if (log_head % SPI_FLASH_SEC_SIZE == 0){
+			esp_partition_erase_range(log_part, log_head, SPI_FLASH_SEC_SIZE);
+			sector_seq[sec] = recs[0].seq;
+			sector_time[sec] = recs[0].timestamp;
+		}
+		k = (SPI_FLASH_SEC_SIZE - log_head % SPI_FLASH_SEC_SIZE) / LOG_REC_LEN;
+		if (k > n){
+			k = n;
+		}
+		esp_partition_write(log_part, log_head, recs, k * LOG_REC_LEN);
+		log_head = (log_head + k * LOG_REC_LEN) % (log_sectors * SPI_FLASH_SEC_SIZE);
+		recs += k;
+		n -= k;
+	}
+}
+
+
+/****************************************************************
+ *
+ * crc8 (polynomial 0x07) of the record, crc field is taken as 0
+ *
+ * **************************************************************/
+static uint8_t log_crc(event_log_rec_t *r){
+	uint8_t crc = 0, saved = r -> crc, *b = (uint8_t *)r;
+
+	r -> crc = 0;
+	for (int i = 0; i < LOG_REC_LEN; i++){
+		crc ^= b[i];
+		for (int j = 0; j < 8; j++){
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+		}
+	}
+	r -> crc = saved;
+
+	return crc;
+}
+
+
+/****************************************************************
+ *
+ * print one record as json, e.g. {"overheated":{"data":1,
+ * "timestamp":"2026-10-18T10:00:00+00:00"},"seq":12}
+ * output: length of printed text
+ *
+ * **************************************************************/
+static int log_rec_print(event_t *e, event_log_rec_t *r, char *buff, int size){
+	event_item_t item;
+	int32_t i32;
+	int len;
+
+	memset(&item, 0, sizeof(item));
+	item.timestamp = r -> timestamp;
+	switch (r -> type){
+	case VAL_INTEGER:
+		memcpy(&i32, r -> value, sizeof(i32));
+		item.value.int_val = i32;
+		break;
+	case VAL_NUMBER:
+		memcpy(&item.value.num_val, r -> value, sizeof(double));
+		break;
+	case VAL_BOOLEAN:
+		item.value.bool_val = (r -> value[0] != 0);
+		break;
+	case VAL_STRING:
+		memcpy(item.value.str_val, r -> value, EVENT_LOG_VALUE_LEN);
+		break;
+	default:
+		break;
+	}
+
+	len = snprintf(buff, size, "{");
+	len += event_item_print(e, &item, buff + len, size - len);
+	len += snprintf(buff + len, size - len, ",\"log_seq\":%u}", (unsigned int)r -> seq);
+
+	return len;
+}
+
+
+/****************************************************************
+ *
+ * send logged events of the thing (or only of event e) as chunked
+ * HTTP response, records are read from flash in small batches
+ * inputs:
+ * 		after_seq - only records with log seq greater than after_seq
+ * 		from - only records not older than from (unix time)
+ * output:
+ * 		HTTP_STREAMED or 400 (event log is not available)
+ *
+ * **************************************************************/
+int16_t event_log_stream(connection_desc_t *conn_desc, thing_t *t, event_t *e,
+						uint32_t after_seq, uint32_t from){
+	event_log_rec_t recs[LOG_BATCH];
+	char buff[LOG_OUT_BUFF];
+	uint32_t pos = 0, last = after_seq, avail = 0, log_size;
+	uint16_t sec, next, newest;
+	int len = 0, n;
+	bool first = true, stream_ok = true;
+
+	if (log_part == NULL){
+		return 400;
+	}
+	log_size = log_sectors * SPI_FLASH_SEC_SIZE;
+
+	xSemaphoreTake(log_mux, portMAX_DELAY);
+	if (log_seq > 0){
+		//the oldest sector: the one to be erased next or the first one
+		sec = log_head / SPI_FLASH_SEC_SIZE;
+		if (log_head % SPI_FLASH_SEC_SIZE != 0){
+			sec = (sec + 1) % log_sectors;
+		}
+		if (sector_seq[sec] == EVENT_LOG_EMPTY){
+			//log not wrapped yet
+			sec = 0;
+		}
+		//skip sectors with older records only
+		newest = ((log_head + log_size - LOG_REC_LEN) % log_size) / SPI_FLASH_SEC_SIZE;
+		while (sec != newest){
+			next = (sec + 1) % log_sectors;
+			if ((sector_seq[next] > after_seq + 1) && (sector_time[next] >= from)){
+				break;
+			}
+			sec = next;
+		}
+		pos = sec * SPI_FLASH_SEC_SIZE;
+		//records from pos to the head
+		avail = (log_head + log_size - pos) % log_size;
+		if (avail == 0){
+			avail = log_size;
+		}
+	}
+	xSemaphoreGive(log_mux);
+
+	if (http_stream_begin(conn_desc) < 0){
+		return HTTP_STREAMED;
+	}
+	buff[len++] = '[';
+
+	while ((stream_ok == true) && (avail > 0)){
+		//read next batch
+		n = avail / LOG_REC_LEN;
+		if (n > LOG_BATCH){
+			n = LOG_BATCH;
+		}
+		xSemaphoreTake(log_mux, portMAX_DELAY);
+		esp_partition_read(log_part, pos, recs, n * LOG_REC_LEN);
+		xSemaphoreGive(log_mux);
+		pos = (pos + n * LOG_REC_LEN) % log_size;
+		avail -= n * LOG_REC_LEN;
+
+		for (int i = 0; i < n; i++){
+			event_log_rec_t *r = &recs[i];
+			event_t *e1;
+
+			//records erased or overwritten meanwhile are skipped
+			if ((r -> seq == EVENT_LOG_EMPTY) || (r -> seq <= last) || (r -> timestamp < from) ||
+				(r -> crc != log_crc(r)) || (r -> thing_nr != t -> thing_nr)){
+				continue;
+			}
+			last = r -> seq;
+
+			//event of this record
+			e1 = t -> events;
+			while ((e1 != NULL) && (e1 -> index != r -> event_index)){
+				e1 = e1 -> next;
+			}
+			if ((e1 == NULL) || ((e != NULL) && (e1 != e))){
+				continue;
+			}
+
+			if (first == false){
+				buff[len++] = ',';
+			}
+			first = false;
+			len += log_rec_print(e1, r, buff + len, LOG_OUT_BUFF - len);
+			if (len > LOG_OUT_BUFF / 2){
+				if (http_stream_write(conn_desc, buff, len) < 0){
+					stream_ok = false;
+					break;
+				}
+				len = 0;
+			}
+		}
+	}
+
+	if (stream_ok == true){
+		buff[len++] = ']';
+		if (http_stream_write(conn_desc, buff, len) == 0){
+			http_stream_end(conn_desc);
+		}
+	}
+
+	return HTTP_STREAMED;
+}
+
+
+/****************************************************************
+ *
+ * records lost because writing queue was full (GET /metrics)
+ *
+ * **************************************************************/
+uint32_t event_log_dropped(void){
+
+	return log_dropped;
+}
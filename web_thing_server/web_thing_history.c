@@ -0,0 +1,289 @@
+/*
+ * web_thing_history.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  Property history: preallocated ring buffer of (timestamp, value)
+ *  records per property, fed from the property change path and read
+ *  by GET /N/properties/{name}/history?since=&until=&step=
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "common.h"
+#include "http_parser.h"
+#include "web_thing_history.h"
+
+#define HISTORY_READ_BATCH	16	//records copied from ring at once
+#define HISTORY_OUT_BUFF	256	//size of one output chunk
+#define HISTORY_ITEM_LEN	200	//one item, 3 floats with all digits fit
+
+static xSemaphoreHandle history_mux = NULL;
+
+static int history_read(prop_history_t *h, uint32_t *pos, history_item_t *out);
+
+
+/****************************************************************
+ *
+ * allocate history ring for the property
+ * inputs:
+ * 		p - property (VAL_NUMBER, VAL_INTEGER or VAL_BOOLEAN)
+ * 		size - number of records, 0 - default (PROP_HISTORY_SIZE)
+ *
+ * **************************************************************/
+int8_t property_history_init(property_t *p, uint16_t size){
+	prop_history_t *h;
+
+	if ((p -> desc -> type != VAL_NUMBER) && (p -> desc -> type != VAL_INTEGER) &&
+		(p -> desc -> type != VAL_BOOLEAN)){
+		printf("history: property \"%s\" is not numeric\n", p -> desc -> id);
+		return -1;
+	}
+	if (size == 0){
+		size = PROP_HISTORY_SIZE;
+	}
+	if (history_mux == NULL){
+		history_mux = xSemaphoreCreateMutex();
+	}
+
+	h = malloc(sizeof(prop_history_t));
+	if (h == NULL){
+		return -1;
+	}
+	h -> items = malloc(size * sizeof(history_item_t));
+	if (h -> items == NULL){
+		free(h);
+		return -1;
+	}
+	h -> size = size;
+	h -> total = 0;
+	p -> history = h;
+
+	return 0;
+}
+
+
+/****************************************************************
+ *
+ * add current property value to the history
+ *
+ * **************************************************************/
+void property_history_add(property_t *p){
+	prop_history_t *h = p -> history;
+	history_item_t *hi;
+	double val;
+
+	if (h == NULL){
+		return;
+	}
+	if (property_value_num(p, &val) == false){
+		return;
+	}
+
+	xSemaphoreTake(history_mux, portMAX_DELAY);
+	hi = &h -> items[h -> total % h -> size];
+	hi -> timestamp = (uint32_t)time(NULL);
+	hi -> value = (float)val;
+	h -> total++;
+	xSemaphoreGive(history_mux);
+}
+
+
+/****************************************************************
+ *
+ * copy next batch of records, starting from absolute position pos
+ * (records overwritten meanwhile are skipped)
+ * output: number of records copied
+ *
+ * **************************************************************/
+static int history_read(prop_history_t *h, uint32_t *pos, history_item_t *out){
+	int n = 0;
+	uint32_t oldest;
+
+	xSemaphoreTake(history_mux, portMAX_DELAY);
+	oldest = (h -> total > h -> size) ? h -> total - h -> size : 0;
+	if (*pos < oldest){
+		*pos = oldest;
+	}
+	while ((*pos < h -> total) && (n < HISTORY_READ_BATCH)){
+		out[n++] = h -> items[*pos % h -> size];
+		(*pos)++;
+	}
+	xSemaphoreGive(history_mux);
+
+	return n;
+}
+
+
+/****************************************************************
+ *
+ * number in json, null for NaN and infinity
+ *
+ * **************************************************************/
+static int history_num(char *buff, int size, double v){
+
+	if (isfinite(v) == 0){
+		return snprintf(buff, size, "null");
+	}
+	return snprintf(buff, size, "%.3f", v);
+}
+
+
+/****************************************************************
+ *
+ * one item: {"t":...,"v":...} (cnt = 0) or aggregated period
+ * {"t":...,"min":...,"max":...,"avg":...}
+ *
+ * **************************************************************/
+static int history_item_print(char *buff, uint32_t t, double v_min,
+							double v_max, double v_avg, uint32_t cnt){
+	int len;
+
+	len = snprintf(buff, HISTORY_ITEM_LEN, "{\"t\":%u,\"%s\":", (unsigned int)t,
+					(cnt == 0) ? "v" : "min");
+	len += history_num(buff + len, HISTORY_ITEM_LEN - len, v_min);
+	if (cnt > 0){
+		len += snprintf(buff + len, HISTORY_ITEM_LEN - len, ",\"max\":");
+		len += history_num(buff + len, HISTORY_ITEM_LEN - len, v_max);
+		len += snprintf(buff + len, HISTORY_ITEM_LEN - len, ",\"avg\":");
+		len += history_num(buff + len, HISTORY_ITEM_LEN - len, v_avg);
+	}
+	len += snprintf(buff + len, HISTORY_ITEM_LEN - len, "}");
+
+	return (len < HISTORY_ITEM_LEN) ? len : HISTORY_ITEM_LEN - 1;
+}
+
+
+/****************************************************************
+ *
+ * add item to the output chunk, the chunk is sent before
+ * if the item doesn't fit into it
+ * output: 0 - OK, -1 - stream error
+ *
+ * **************************************************************/
+static int8_t history_out(connection_desc_t *conn_desc, char *buff, int *len,
+							char *item, int item_len, bool *first){
+
+	if (*len + item_len + 2 > HISTORY_OUT_BUFF){
+		if (http_stream_write(conn_desc, buff, *len) < 0){
+			return -1;
+		}
+		*len = 0;
+	}
+	if (*first == false){
+		buff[(*len)++] = ',';
+	}
+	*first = false;
+	memcpy(buff + *len, item, item_len);
+	*len += item_len;
+
+	return 0;
+}
+
+
+/****************************************************************
+ *
+ * send history of the property as chunked HTTP response
+ * inputs:
+ * 		since, until - time range (unix time)
+ * 		step - 0: raw records [{"t":...,"v":...}]
+ * 			  >0: aggregated in step seconds long periods
+ * 			  	[{"t":...,"min":...,"max":...,"avg":...}]
+ * output:
+ * 		HTTP_STREAMED or 400 (no history for this property)
+ *
+ * **************************************************************/
+int16_t property_history_stream(property_t *p, connection_desc_t *conn_desc,
+								uint32_t since, uint32_t until, uint32_t step){
+	prop_history_t *h = p -> history;
+	history_item_t items[HISTORY_READ_BATCH];
+	char buff[HISTORY_OUT_BUFF], item[HISTORY_ITEM_LEN];
+	int len = 0, n, item_len;
+	uint32_t pos = 0, bucket = 0, cnt = 0;
+	float v_min = 0, v_max = 0;
+	double v_sum = 0;
+	bool first = true, stream_ok = true;
+
+	if (h == NULL){
+		return 400;
+	}
+
+	if (http_stream_begin(conn_desc) < 0){
+		return HTTP_STREAMED;
+	}
+	buff[len++] = '[';
+
+	while (stream_ok == true){
+		n = history_read(h, &pos, items);
+		if (n == 0){
+			break;
+		}
+		for (int i = 0; i < n; i++){
+			history_item_t *hi = &items[i];
+
+			if ((hi -> timestamp < since) || (hi -> timestamp > until)){
+				continue;
+			}
+			if (step == 0){
+				item_len = history_item_print(item, hi -> timestamp, hi -> value,
+											0, 0, 0);
+				if (history_out(conn_desc, buff, &len, item, item_len, &first) < 0){
+					stream_ok = false;
+					break;
+				}
+			}
+			else{
+				uint32_t b = since + ((hi -> timestamp - since) / step) * step;
+
+				if ((cnt > 0) && (b != bucket)){
+					//period finished, send it
+					item_len = history_item_print(item, bucket, v_min, v_max,
+												v_sum / cnt, cnt);
+					cnt = 0;
+					if (history_out(conn_desc, buff, &len, item, item_len, &first) < 0){
+						stream_ok = false;
+						break;
+					}
+				}
+				if (cnt == 0){
+					bucket = b;
+					v_min = hi -> value;
+					v_max = hi -> value;
+					v_sum = 0;
+				}
+				if (hi -> value < v_min){
+					v_min = hi -> value;
+				}
+				if (hi -> value > v_max){
+					v_max = hi -> value;
+				}
+				v_sum += hi -> value;
+				cnt++;
+			}
+		}
+	}
+
+	if (stream_ok == true){
+		if (cnt > 0){
+			item_len = history_item_print(item, bucket, v_min, v_max, v_sum / cnt, cnt);
+			stream_ok = (history_out(conn_desc, buff, &len, item, item_len, &first) == 0);
+		}
+		if (stream_ok == true){
+			buff[len++] = ']';
+			if (http_stream_write(conn_desc, buff, len) == 0){
+				http_stream_end(conn_desc);
+			}
+		}
+	}
+
+	return HTTP_STREAMED;
+}
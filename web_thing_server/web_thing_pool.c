@@ -0,0 +1,148 @@
+/*
+ * web_thing_pool.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  Slab pools: items allocated and released all the time (websocket
+ *  queue items, subscribers) are taken from static arrays instead of
+ *  heap, so days of notification traffic don't fragment the heap.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "web_thing_pool.h"
+
+static slab_pool_t *pools[SLAB_MAX_POOLS];
+static uint8_t pools_quant = 0;
+
+
+/****************************************************************
+ *
+ * initialize pool in storage of count items (item_size bytes each,
+ * at least the size of pointer)
+ *
+ * **************************************************************/
+void slab_pool_init(slab_pool_t *p, const char *name, void *storage,
+					uint16_t item_size, uint16_t count){
+	portMUX_TYPE unlocked = portMUX_INITIALIZER_UNLOCKED;
+
+	memset(p, 0, sizeof(slab_pool_t));
+	p -> name = name;
+	p -> buff = storage;
+	p -> item_size = item_size;
+	p -> count = count;
+	p -> unused = count;
+	p -> lock = unlocked;
+	if (pools_quant < SLAB_MAX_POOLS){
+		pools[pools_quant++] = p;
+	}
+}
+
+
+/****************************************************************
+ *
+ * take item from the pool, O(1)
+ * when the pool is empty item is taken from heap (if allowed)
+ *
+ * **************************************************************/
+void *slab_alloc(slab_pool_t *p){
+	uint8_t *item = NULL;
+
+	portENTER_CRITICAL_SAFE(&p -> lock);
+	if (p -> free_list != NULL){
+		item = p -> free_list;
+		p -> free_list = *(void **)item;
+	}
+	else if (p -> unused > 0){
+		item = p -> buff + (p -> count - p -> unused) * p -> item_size;
+		p -> unused--;
+	}
+	if (item != NULL){
+		p -> used++;
+		if (p -> used > p -> peak){
+			p -> peak = p -> used;
+		}
+	}
+	else{
+		p -> exhausted++;
+	}
+	portEXIT_CRITICAL_SAFE(&p -> lock);
+
+#ifdef CONFIG_POOL_HEAP_FALLBACK
+	if (item == NULL){
+		item = malloc(p -> item_size);
+		if (item != NULL){
+			portENTER_CRITICAL_SAFE(&p -> lock);
+			p -> fallbacks++;
+			portEXIT_CRITICAL_SAFE(&p -> lock);
+		}
+	}
+#endif
+
+	return item;
+}
+
+
+/****************************************************************
+ *
+ * give item back to the pool (or to heap if it was taken from heap)
+ *
+ * **************************************************************/
+void slab_free(slab_pool_t *p, void *item){
+
+	if (item == NULL){
+		return;
+	}
+	if (slab_owns(p, item) == false){
+		free(item);
+		return;
+	}
+	portENTER_CRITICAL_SAFE(&p -> lock);
+	*(void **)item = p -> free_list;
+	p -> free_list = item;
+	p -> used--;
+	portEXIT_CRITICAL_SAFE(&p -> lock);
+}
+
+
+/****************************************************************
+ *
+ * true if item is in the pool's storage (not taken from heap)
+ *
+ * **************************************************************/
+bool slab_owns(slab_pool_t *p, void *item){
+	uint8_t *i = item;
+
+	return (i >= p -> buff) && (i < p -> buff + p -> count * p -> item_size);
+}
+
+
+/****************************************************************
+ *
+ * statistics of all pools (for GET /metrics), returns length
+ * of json array, at most 128 bytes per pool
+ *
+ * **************************************************************/
+int slab_pools_jsonize(char *buff){
+	int len;
+
+	len = sprintf(buff, "[");
+	for (int i = 0; i < pools_quant; i++){
+		slab_pool_t *p = pools[i];
+
+		len += sprintf(buff + len, "%s{\"name\":\"%s\",\"size\":%u,\"used\":%u,"\
+						"\"peak\":%u,\"exhausted\":%u,\"fallbacks\":%u}",
+						(i == 0) ? "" : ",", p -> name, p -> count, p -> used,
+						p -> peak, (unsigned int)p -> exhausted,
+						(unsigned int)p -> fallbacks);
+	}
+	len += sprintf(buff + len, "]");
+
+	return len;
+}
@@ -7,63 +7,130 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+
+#include "freertos/task.h"
 
 #include "web_thing_property.h"
 #include "common.h"
+#include "web_thing_arena.h"
 
 #define PROP_MODEL_LEN 600
 
 void prop_value_str(property_t *p, char *b);
 char *get_property_json(property_t *p);
+static uint32_t prop_value_hash(char *json_value);
 
 //**********************************************************************
-//initialize empty property structure
-property_t *property_init(jsonize_t *vj, jsonize_t *mj){
+//create property described by d (can be const, kept in flash),
+//value and mux are owned by the thing
+property_t *property_init(const property_desc_t *d, void *value, xSemaphoreHandle mux){
 	property_t * p;
 
 	p = malloc(sizeof(property_t));
+	if (p == NULL){
+		return NULL;
+	}
 	memset(p, 0, sizeof(property_t));
-	//set function for value jsonization, e.g. "speed":125
-	if (vj != NULL){
-		p -> value_jsonize = vj;
+	p -> desc = d;
+	p -> value = value;
+	p -> mux = mux;
+
+	return p;
+}
+
+//**********************************************************************
+//find property by id
+property_t *get_property_ptr(thing_t *t, const char *property_id){
+
+	if ((t != NULL) && (property_id != NULL)){
+		for (int i = 0; i < t -> prop_quant; i++){
+			if (strcmp(property_id, t -> properties[i] -> desc -> id) == 0){
+				return t -> properties[i];
+			}
+		}
 	}
-	else{
-		p -> value_jsonize = get_property_json;
+
+	return NULL;
+}
+
+//**********************************************************************
+//find property by registration index
+property_t *get_property_by_index(thing_t *t, uint8_t index){
+
+	if ((t != NULL) && (index < t -> prop_quant)){
+		return t -> properties[index];
 	}
-	//set function for model jsonization
-	if (mj != NULL){
-		p -> model_jsonize = mj;
+
+	return NULL;
+}
+
+//**********************************************************************
+//json representation of the value, "name":value
+char *property_value_jsonize(property_t *p){
+
+	if (p -> desc -> value_jsonize != NULL){
+		return p -> desc -> value_jsonize(p);
 	}
-	else{
-		p -> model_jsonize = NULL;
+
+	return get_property_json(p);
+}
+
+//**********************************************************************
+//subscribe connection to the property, after the first subscription
+//only subscribed properties are sent to this connection
+int8_t add_property_subscriber(property_t *p, connection_desc_t *_c){
+	int8_t res = -1;
+	subscriber_t *s = get_subscriber(p -> t, _c);
+
+	if (s != NULL){
+		s -> prop_filter = true;
+		s -> prop_mask |= SUBSCR_BIT(p -> index);
+		res = 0;
 	}
 
-	return p;
+	return res;
+}
+
+//**********************************************************************
+//unsubscribe connection from the property
+int8_t delete_property_subscriber(property_t *p, connection_desc_t *_c){
+	int8_t res = -1;
+	subscriber_t *s = get_subscriber(p -> t, _c);
+
+	if (s != NULL){
+		if (s -> prop_filter == false){
+			//so far all were sent, keep the others
+			s -> prop_filter = true;
+			s -> prop_mask = 0xFFFFFFFF;
+		}
+		s -> prop_mask &= ~SUBSCR_BIT(p -> index);
+		res = 0;
+	}
+
+	return res;
 }
 
 //***************************************************************************
 char *get_properties_model(thing_t *t){
 	char *prop, *buff_temp;
-	property_t *p;
 
 	int pq = t -> prop_quant;
-	prop = malloc(pq * (PROP_MODEL_LEN + 5));
+	prop = req_malloc(pq * (PROP_MODEL_LEN + 5));
 	memset(prop, 0, pq * (PROP_MODEL_LEN + 5));
 
-	p = t -> properties;
 	if (pq > 1){
-		for (int i = pq; i > 0; i--){
-			buff_temp = property_model_jsonize(p, t -> thing_nr);
+		for (int i = 0; i < pq; i++){
+			buff_temp = property_model_jsonize(t -> properties[i], t -> thing_nr);
 			strcat(prop, buff_temp);
-			free(buff_temp);
-			if (i != 1){
+			req_free(buff_temp);
+			if (i != pq - 1){
 				strcat(prop, ",");
 			}
-			p = p -> next;
 		}
 	}
 	else{
-		prop = property_model_jsonize(p, t -> thing_nr);
+		prop = property_model_jsonize(t -> properties[0], t -> thing_nr);
 	}
 
 	return prop;
@@ -87,61 +154,62 @@ char *property_model_jsonize(property_t *p, int16_t thing_index){
 	char *buff = NULL, *buff1, *buff_enum = NULL;
 	char buff_min[15], buff_max[15], th_lk[10];
 	bool build_json = false;
+	const property_desc_t *d = p -> desc;
 
-	if (p -> type == VAL_NULL){
+	if (d -> type == VAL_NULL){
 		return NULL;
 	}
 
 	sprintf(th_lk, "/%i/", thing_index);
 
 	//clear buffers
-	buff1 = malloc(200);
+	buff1 = req_malloc(200);
 	memset(buff1, 0, 200);
 	memset(buff_min, 0, 15);
 	memset(buff_max, 0, 15);
 
-	if (p -> type == VAL_INTEGER){
-		if (p -> min_value.int_val != p -> max_value.int_val){
-			sprintf(buff_min, "%i", (int32_t)(p -> min_value.int_val));
-			sprintf(buff_max, "%i", (int32_t)(p -> max_value.int_val));
-			sprintf(buff1, num_str, buff_min, buff_max, p -> unit);
+	if (d -> type == VAL_INTEGER){
+		if (d -> min_value.int_val != d -> max_value.int_val){
+			sprintf(buff_min, "%i", (int32_t)(d -> min_value.int_val));
+			sprintf(buff_max, "%i", (int32_t)(d -> max_value.int_val));
+			sprintf(buff1, num_str, buff_min, buff_max, d -> unit);
 		}
 		else{
-			if (p -> unit != NULL){
-				sprintf(buff1, num_str_unit, p -> unit);
+			if (d -> unit != NULL){
+				sprintf(buff1, num_str_unit, d -> unit);
 			}
 		}
 		build_json = true;
 	}
-	else if (p -> type == VAL_NUMBER){
-		if (p -> min_value.float_val != p -> max_value.float_val){
-			sprintf(buff_min, "%5.3f", p -> min_value.float_val);
-			sprintf(buff_max, "%5.3f", p -> max_value.float_val);
-			sprintf(buff1, num_str, buff_min, buff_max, p -> unit);
+	else if (d -> type == VAL_NUMBER){
+		if (d -> min_value.float_val != d -> max_value.float_val){
+			sprintf(buff_min, "%5.3f", d -> min_value.float_val);
+			sprintf(buff_max, "%5.3f", d -> max_value.float_val);
+			sprintf(buff1, num_str, buff_min, buff_max, d -> unit);
 		}
 		else{
-			if (p -> unit != NULL){
-				sprintf(buff1, num_str_unit, p -> unit);
+			if (d -> unit != NULL){
+				sprintf(buff1, num_str_unit, d -> unit);
 			}
 		}
 		build_json = true;
 	}
-	else if (p -> type == VAL_BOOLEAN){
+	else if (d -> type == VAL_BOOLEAN){
 		build_json = true;
 	}
-	else if (p -> type == VAL_OBJECT){
-		if (p -> model_jsonize != NULL){
-			buff1 = p -> model_jsonize(p);
+	else if (d -> type == VAL_OBJECT){
+		if (d -> model_jsonize != NULL){
+			buff1 = d -> model_jsonize(p);
 			build_json = true;
 		}
 		else{
 			printf("VAL_OBJECT: jsonization failed\n");
 		}
 	}
-	else if (p -> type == VAL_STRING){
-		if (p -> enum_prop == false){
-			if (p -> model_jsonize != NULL){
-				buff1 = p -> model_jsonize(p);
+	else if (d -> type == VAL_STRING){
+		if (d -> enum_list == NULL){
+			if (d -> model_jsonize != NULL){
+				buff1 = d -> model_jsonize(p);
 				build_json = true;
 			}
 			else{
@@ -150,30 +218,24 @@ char *property_model_jsonize(property_t *p, int16_t thing_index){
 		}
 		else{
 			//enum value
-			buff_enum = malloc(200); //TODO: calculate needed place
+			buff_enum = req_malloc(200); //TODO: calculate needed place
 			strcpy(buff_enum, "\"enum\":[");
-			enum_item_t *enum_item;
-			int enum_i = 0;
-
-			enum_item  = p -> enum_list;
-			while (enum_item){
+			for (int enum_i = 0; d -> enum_list[enum_i] != NULL; enum_i++){
 				if (enum_i > 0){
 					strcat(buff_enum, ",");
 				}
 				strcat(buff_enum, "\"");
-				strcat(buff_enum, enum_item -> value.str_addr);
+				strcat(buff_enum, d -> enum_list[enum_i]);
 				strcat(buff_enum, "\"");
-				enum_i++;
-				enum_item = enum_item -> next;
 			}
 			strcat(buff_enum, "],");
 			build_json = true;
 		}
 		//build_json = true;
 	}
-	else if (p -> type == VAL_ARRAY){
-		if (p -> model_jsonize != NULL){
-			buff1 = p -> model_jsonize(p);
+	else if (d -> type == VAL_ARRAY){
+		if (d -> model_jsonize != NULL){
+			buff1 = d -> model_jsonize(p);
 			build_json = true;
 		}
 		else{
@@ -182,21 +244,21 @@ char *property_model_jsonize(property_t *p, int16_t thing_index){
 	}
 
 	if (build_json == true){
-		buff = malloc(PROP_MODEL_LEN);
+		buff = req_malloc(PROP_MODEL_LEN);
 		if (buff_enum != NULL){
-			sprintf(buff, prop_str, p -> id, p -> at_type -> at_type, p -> title,
-					type[p -> type], buff_enum, p -> description, buff1,
-					bool_str[p -> read_only], th_lk, p -> id);
+			sprintf(buff, prop_str, d -> id, d -> at_type, d -> title,
+					type[d -> type], buff_enum, d -> description, buff1,
+					bool_str[d -> read_only], th_lk, d -> id);
 		}
 		else{
-			sprintf(buff, prop_str, p -> id, p -> at_type -> at_type, p -> title,
-					type[p -> type], "", p -> description, buff1,
-					bool_str[p -> read_only], th_lk, p -> id);
+			sprintf(buff, prop_str, d -> id, d -> at_type, d -> title,
+					type[d -> type], "", d -> description, buff1,
+					bool_str[d -> read_only], th_lk, d -> id);
 		}
 	}
 	
-	free(buff_enum);
-	free(buff1);
+	req_free(buff_enum);
+	req_free(buff1);
 	
 	return buff;
 }
@@ -211,17 +273,17 @@ char *get_property_json(property_t *p){
 	char *buff;
 	int32_t len;
 
-	if (p -> type != VAL_STRING){
-		len = strlen (p -> id) + 20;
+	if (p -> desc -> type != VAL_STRING){
+		len = strlen (p -> desc -> id) + 20;
 	}
 	else{
-		len = strlen (p -> id) + 20;
+		len = strlen (p -> desc -> id) + 20;
 	}
-	buff = malloc(len);
+	buff = req_malloc(len);
 
 	memset(buff, 0, len);
 	buff[0] = '"';
-	strcat(buff, p -> id);
+	strcat(buff, p -> desc -> id);
 	strcat(buff, "\":");
 	prop_value_str(p, buff + strlen(buff));
 
@@ -239,7 +301,7 @@ void prop_value_str(property_t *p, char *buff){
 	if (xSemaphoreTake(p -> mux, 10) == pdTRUE ){
 		char *buff1 = NULL;
 		
-		switch (p -> type){
+		switch (p -> desc -> type){
 		case VAL_NULL:
 			break;
 		case VAL_BOOLEAN:
@@ -263,9 +325,11 @@ void prop_value_str(property_t *p, char *buff){
 			break;
 		case VAL_ARRAY:
 		case VAL_OBJECT:
-			buff1 = p -> value_jsonize(p);
-			strcpy(buff, buff1);
-			free(buff1);
+			if (p -> desc -> value_jsonize != NULL){
+				buff1 = p -> desc -> value_jsonize(p);
+				strcpy(buff, buff1);
+				req_free(buff1);
+			}
 			break;
 		default:
 			buff = NULL;
@@ -274,3 +338,165 @@ void prop_value_str(property_t *p, char *buff){
 		xSemaphoreGive(p -> mux);
 	}
 }
+
+
+/************************************************************************
+ *
+ * read numeric value of the property (number, integer, boolean)
+ * out: false if property is not numeric
+ *
+ ************************************************************************/
+bool property_value_num(property_t *p, double *val){
+	bool res = true;
+
+	if (xSemaphoreTake(p -> mux, 10) != pdTRUE){
+		return false;
+	}
+	switch (p -> desc -> type){
+	case VAL_NUMBER:
+		*val = *(double *)(p -> value);
+		break;
+	case VAL_INTEGER:
+		*val = (double)(*(int *)(p -> value));
+		break;
+	case VAL_BOOLEAN:
+		*val = (*(bool *)(p -> value) == true) ? 1.0 : 0.0;
+		break;
+	default:
+		res = false;
+	}
+	xSemaphoreGive(p -> mux);
+
+	return res;
+}
+
+
+/************************************************************************
+ *
+ * FNV-1a hash of the json value, used to detect "no change"
+ *
+ ************************************************************************/
+static uint32_t prop_value_hash(char *json_value){
+	uint32_t h = 2166136261u;
+
+	while (*json_value != 0){
+		h ^= (uint8_t)(*json_value++);
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+
+/************************************************************************
+ *
+ * check notification policy of the property
+ * inputs:
+ * 		p - property
+ * 		json_value - value in format "name":value
+ * 		flush - heartbeat or held back notification, only the time
+ * 				since the last notification is checked
+ * output:
+ * 		true - notification should be sent now
+ *
+ ************************************************************************/
+bool property_notify_check(property_t *p, char *json_value, bool flush){
+	const notify_policy_t *np = &p -> desc -> notify;
+	notify_state_t *ns = &p -> notify_state;
+	double val, band;
+
+	if (ns -> sent == false){
+		//the first notification is always sent
+		return true;
+	}
+
+	if (flush == true){
+		return property_notify_due(p);
+	}
+
+	//dead-band, only for numbers
+	if (((np -> dead_band > 0) || (np -> dead_band_rel > 0)) &&
+		((p -> desc -> type == VAL_NUMBER) || (p -> desc -> type == VAL_INTEGER))){
+		if (property_value_num(p, &val) == true){
+			band = np -> dead_band;
+			if (np -> dead_band_rel * fabs(ns -> last_value) > band){
+				band = np -> dead_band_rel * fabs(ns -> last_value);
+			}
+			if (fabs(val - ns -> last_value) < band){
+				return false;
+			}
+		}
+	}
+	if (np -> on_change_only == true){
+		if (prop_value_hash(json_value) == ns -> last_hash){
+			return false;
+		}
+	}
+
+	//minimum interval, the value is sent later by the notification task
+	if ((np -> min_interval_ms > 0) &&
+		((xTaskGetTickCount() - ns -> last_tick) < pdMS_TO_TICKS(np -> min_interval_ms))){
+		ns -> pending = true;
+		return false;
+	}
+
+	return true;
+}
+
+
+/************************************************************************
+ *
+ * save the state of the sent notification
+ *
+ ************************************************************************/
+void property_notify_sent(property_t *p, char *json_value){
+	notify_state_t *ns = &p -> notify_state;
+	double val;
+
+	ns -> last_tick = xTaskGetTickCount();
+	ns -> last_hash = prop_value_hash(json_value);
+	if (property_value_num(p, &val) == true){
+		ns -> last_value = val;
+	}
+	ns -> sent = true;
+	ns -> pending = false;
+}
+
+
+/************************************************************************
+ *
+ * check if value differs from the last sent one (held back
+ * notification), heartbeat of the same value is not a change
+ *
+ ************************************************************************/
+bool property_notify_changed(property_t *p, char *json_value){
+	notify_state_t *ns = &p -> notify_state;
+
+	return (ns -> sent == false) || (ns -> pending == true) ||
+			(prop_value_hash(json_value) != ns -> last_hash);
+}
+
+
+/************************************************************************
+ *
+ * check if property needs heartbeat or has held back notification
+ *
+ ************************************************************************/
+bool property_notify_due(property_t *p){
+	const notify_policy_t *np = &p -> desc -> notify;
+	notify_state_t *ns = &p -> notify_state;
+	TickType_t dt;
+
+	if (ns -> sent == false){
+		return false;
+	}
+	dt = xTaskGetTickCount() - ns -> last_tick;
+	if ((ns -> pending == true) && (dt >= pdMS_TO_TICKS(np -> min_interval_ms))){
+		return true;
+	}
+	if ((np -> max_silence_ms > 0) && (dt >= pdMS_TO_TICKS(np -> max_silence_ms))){
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,288 @@
+/*
+ * web_thing_timer.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  Timer wheel: close handshake and heartbeat timers of all
+ *  connections are kept in one two level wheel, arm and cancel are O(1)
+ *  and don't allocate memory. Expired timers are run by the server's
+ *  timer task, not by the FreeRTOS timer service task.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "web_thing_timer.h"
+
+//first level: one slot per tick, second level: one slot per TW_L0_SIZE ticks
+#define TW_L0_BITS	6
+#define TW_L0_SIZE	(1 << TW_L0_BITS)
+#define TW_L0_MASK	(TW_L0_SIZE - 1)
+#define TW_L1_BITS	6
+#define TW_L1_SIZE	(1 << TW_L1_BITS)
+#define TW_L1_MASK	(TW_L1_SIZE - 1)
+#define TW_TICKS	((pdMS_TO_TICKS(TIMER_WHEEL_TICK_MS) > 0) ? \
+					pdMS_TO_TICKS(TIMER_WHEEL_TICK_MS) : 1) //RTOS ticks of one tick
+#define TIMER_TASK_STACK (1024*3)
+
+static struct{
+	wheel_timer_t *l0[TW_L0_SIZE];
+	wheel_timer_t *l1[TW_L1_SIZE];
+	uint32_t now;			//the last processed tick
+	uint32_t armed;
+	uint32_t expired;
+	uint32_t lag_max;		//ticks processed late (task was busy)
+	wheel_timer_t *running;	//timer which function is running now
+	wheel_timer_t *cancelled;	//running timer cancelled by other task
+	xTaskHandle task;
+	portMUX_TYPE lock;
+} wheel = {.lock = portMUX_INITIALIZER_UNLOCKED};
+#ifdef CONFIG_STATIC_ALLOC
+static StackType_t timer_stack[TIMER_TASK_STACK];
+static StaticTask_t timer_tcb;
+#endif
+
+static void timer_wheel_task(void *arg);
+
+
+/****************************************************************
+ *
+ * list operations, lock must be taken
+ *
+ * **************************************************************/
+static void tw_link(wheel_timer_t **head, wheel_timer_t *t){
+
+	t -> next = *head;
+	if (*head != NULL){
+		(*head) -> pprev = &t -> next;
+	}
+	*head = t;
+	t -> pprev = head;
+}
+
+
+static void tw_unlink(wheel_timer_t *t){
+
+	*t -> pprev = t -> next;
+	if (t -> next != NULL){
+		t -> next -> pprev = t -> pprev;
+	}
+	t -> next = NULL;
+	t -> pprev = NULL;
+}
+
+
+/****************************************************************
+ *
+ * put timer into the slot of its expiration tick, timers beyond
+ * the second level are put into its farthest slot and moved again
+ * when the slot is reached
+ *
+ * **************************************************************/
+static void tw_insert(wheel_timer_t *t){
+	uint32_t delta = t -> expires - wheel.now;
+	uint32_t blocks = (delta + (wheel.now & TW_L0_MASK)) >> TW_L0_BITS;
+
+	if (delta < TW_L0_SIZE){
+		tw_link(&wheel.l0[t -> expires & TW_L0_MASK], t);
+	}
+	else if (blocks < TW_L1_SIZE){
+		tw_link(&wheel.l1[(t -> expires >> TW_L0_BITS) & TW_L1_MASK], t);
+	}
+	else{
+		tw_link(&wheel.l1[((wheel.now >> TW_L0_BITS) - 1) & TW_L1_MASK], t);
+	}
+}
+
+
+/****************************************************************
+ *
+ * next tick, at the beginning of a block timers of this block
+ * are moved from the second level to the first one
+ *
+ * **************************************************************/
+static void tw_advance(void){
+	wheel_timer_t *t, *list, **slot;
+
+	wheel.now++;
+	if ((wheel.now & TW_L0_MASK) == 0){
+		slot = &wheel.l1[(wheel.now >> TW_L0_BITS) & TW_L1_MASK];
+		list = *slot;
+		*slot = NULL;
+		while (list != NULL){
+			t = list;
+			list = t -> next;
+			tw_insert(t);
+		}
+	}
+}
+
+
+/****************************************************************
+ *
+ * start timer task
+ *
+ * **************************************************************/
+void timer_wheel_init(void){
+
+#ifdef CONFIG_STATIC_ALLOC
+	wheel.task = xTaskCreateStatic(timer_wheel_task, "timer_wheel", TIMER_TASK_STACK, NULL, 1,
+								timer_stack, &timer_tcb);
+#else
+	xTaskCreate(timer_wheel_task, "timer_wheel", TIMER_TASK_STACK, NULL, 1, &wheel.task);
+#endif
+}
+
+
+/****************************************************************
+ *
+ * (re)start one shot timer, fun(arg) is called after ms,
+ * never earlier, at most one tick later
+ *
+ * **************************************************************/
+void timer_wheel_arm(wheel_timer_t *t, uint32_t ms, wheel_fun_t *fun, void *arg){
+	uint32_t ticks = (ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS + 1;
+
+	portENTER_CRITICAL_SAFE(&wheel.lock);
+	if (t -> pprev != NULL){
+		tw_unlink(t);
+		wheel.armed--;
+	}
+	t -> fun = fun;
+	t -> arg = arg;
+	t -> expires = wheel.now + ticks;
+	tw_insert(t);
+	wheel.armed++;
+	portEXIT_CRITICAL_SAFE(&wheel.lock);
+}
+
+
+/****************************************************************
+ *
+ * stop timer, nothing happens if timer is not armed;
+ * function of the timer which has just expired can be running
+ * in the timer task, then cancel waits until it returns (the timer
+ * task stops the timer again if the function armed it, so it isn't
+ * run again before cancel sees it finished), the function doesn't
+ * run after cancel returns; called in a timer function it doesn't
+ * wait, caller mustn't hold locks taken by timer functions
+ *
+ * **************************************************************/
+void timer_wheel_cancel(wheel_timer_t *t){
+	bool running;
+
+	do{
+		portENTER_CRITICAL_SAFE(&wheel.lock);
+		if (t -> pprev != NULL){
+			tw_unlink(t);
+			wheel.armed--;
+		}
+		running = (wheel.running == t) &&
+					(xTaskGetCurrentTaskHandle() != wheel.task);
+		if (running == true){
+			wheel.cancelled = t;
+		}
+		portEXIT_CRITICAL_SAFE(&wheel.lock);
+		if (running == true){
+			vTaskDelay(1);
+		}
+	}while (running == true);
+}
+
+
+/****************************************************************/
+bool timer_wheel_armed(wheel_timer_t *t){
+
+	return (t -> pprev != NULL);
+}
+
+
+/****************************************************************
+ *
+ * run functions of timers expired at the current tick one by one,
+ * functions can arm or cancel timers
+ *
+ * **************************************************************/
+static void tw_run_expired(void){
+	wheel_timer_t *t;
+	wheel_fun_t *fun;
+	void *fun_arg;
+
+	for (;;){
+		portENTER_CRITICAL_SAFE(&wheel.lock);
+		t = wheel.l0[wheel.now & TW_L0_MASK];
+		if (t == NULL){
+			portEXIT_CRITICAL_SAFE(&wheel.lock);
+			break;
+		}
+		tw_unlink(t);
+		wheel.armed--;
+		wheel.expired++;
+		wheel.running = t;
+		fun = t -> fun;
+		fun_arg = t -> arg;
+		portEXIT_CRITICAL_SAFE(&wheel.lock);
+
+		if (fun != NULL){
+			fun(fun_arg);
+		}
+		portENTER_CRITICAL_SAFE(&wheel.lock);
+		if ((wheel.cancelled == t) && (t -> pprev != NULL)){
+			//armed again by its function
+			tw_unlink(t);
+			wheel.armed--;
+		}
+		wheel.cancelled = NULL;
+		wheel.running = NULL;
+		portEXIT_CRITICAL_SAFE(&wheel.lock);
+	}
+}
+
+
+/****************************************************************
+ *
+ * timer task, the wheel is advanced by all ticks passed since
+ * the last wake up
+ *
+ * **************************************************************/
+static void timer_wheel_task(void *arg){
+	TickType_t last_wake = xTaskGetTickCount();
+	TickType_t processed = last_wake;
+	uint32_t steps;
+
+	for (;;){
+		vTaskDelayUntil(&last_wake, TW_TICKS);
+
+		steps = (xTaskGetTickCount() - processed) / TW_TICKS;
+		processed += steps * TW_TICKS;
+		if ((steps > 1) && (steps - 1 > wheel.lag_max)){
+			wheel.lag_max = steps - 1;
+		}
+
+		while (steps-- > 0){
+			portENTER_CRITICAL_SAFE(&wheel.lock);
+			tw_advance();
+			portEXIT_CRITICAL_SAFE(&wheel.lock);
+			tw_run_expired();
+		}
+	}
+}
+
+
+/****************************************************************
+ *
+ * statistics of timers for GET /metrics
+ *
+ * **************************************************************/
+int timer_wheel_jsonize(char *buff){
+
+	return sprintf(buff, "{\"armed\":%u,\"expired\":%u,\"lag_max_ms\":%u}",
+				(unsigned int)wheel.armed, (unsigned int)wheel.expired,
+				(unsigned int)(wheel.lag_max * TIMER_WHEEL_TICK_MS));
+}
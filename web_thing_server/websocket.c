@@ -18,6 +18,7 @@
 #include "freertos/timers.h"
 #include "mbedtls/sha1.h"
 #include "mbedtls/base64.h"
+#include "esp_timer.h"
 
 //for mdns announcement triggering
 #include "mdns.h"
@@ -25,32 +26,89 @@
 
 #include "websocket.h"
 #include "simple_web_thing_server.h"
+#include "http_parser.h"
+#include "ws_deflate.h"
+#include "ws_decoder.h"
+#include "ws_binary.h"
 #include "common.h"
+#include "web_thing_arena.h"
+#include "web_thing_pool.h"
 
-#define MAX_PAYLOAD_LEN			1024
+#define MAX_PAYLOAD_LEN			WS_PAYLOAD_LEN
 #define SHA1_RES_LEN			20	//sha1 result length
 #define CLOSE_TIMEOUT_MS		5000 //ms
 #define CLOSE_TIMEOUT_MS_SHORT	2000 //ms
 #define WS_MAX_ERRORS			5
+#define WS_MAX_MESSAGE_LEN		CONFIG_WS_MAX_MESSAGE_LEN //max received message
+#define WS_PING_PERIOD_MS		CONFIG_WS_PING_PERIOD_MS //0 - server doesn't send pings
+#define WS_PING_MAX_MISSED		CONFIG_WS_PING_MAX_MISSED
+#define WS_PING_PAYLOAD_LEN		8	//send time of the ping (us)
+#define WS_ITEM_POOL_SIZE		CONFIG_WS_ITEM_POOL_SIZE
+#define WS_SEND_TASK_STACK		2048
+#define WS_SMALL_PAYLOAD_LEN	128	//ping, pong, close and short notifications
+#define WS_SMALL_POOL_SIZE		(2 * MAX_OPEN_CONN)
+#define WS_PAYLOAD_POOL_SIZE	CONFIG_WS_PAYLOAD_POOL_SIZE
+#define WS_OUTPUT_QUEUE_LEN		10
 
 //global server variables
 static int8_t ws_server_is_running = 0;
 static uint16_t ws_port = 0;
 xQueueHandle ws_output_queue;
 
+static uint32_t ws_evictions = 0; //connections closed due to missing pongs
+
 //websocket task functions
 static void ws_send_task(void* arg);
+static void ws_ping_timer_fun(void *arg);
+static void ws_send_ping(connection_desc_t *conn_desc);
+static void ws_pong_received(connection_desc_t *conn_desc, uint8_t *payload);
 static uint8_t head_buff[MAX_PAYLOAD_LEN + 4]; //sending buffer
+//items of the sending queue
+static ws_queue_item_t ws_item_storage[WS_ITEM_POOL_SIZE];
+static slab_pool_t ws_item_pool;
+//payloads of the sent frames
+static uint8_t ws_small_storage[WS_SMALL_POOL_SIZE][WS_SMALL_PAYLOAD_LEN]
+				__attribute__((aligned(sizeof(void *))));
+static slab_pool_t ws_small_pool;
+static uint8_t ws_payload_storage[WS_PAYLOAD_POOL_SIZE][MAX_PAYLOAD_LEN]
+				__attribute__((aligned(sizeof(void *))));
+static slab_pool_t ws_payload_pool;
+#ifdef CONFIG_STATIC_ALLOC
+static StaticQueue_t ws_output_queue_buff;
+static uint8_t ws_output_queue_storage[WS_OUTPUT_QUEUE_LEN * sizeof(ws_queue_item_t *)];
+static ws_decoder_t ws_dec_storage[MAX_OPEN_CONN]; //decoder of every connection slot
+//decompressed message and work area of decompressor, shared by connections
+static uint8_t inflate_buff[WS_MAX_MESSAGE_LEN + 1];
+static uint8_t inflate_work[WS_INFLATE_WORK_LEN] __attribute__((aligned(sizeof(void *))));
+static xSemaphoreHandle inflate_mux = NULL;
+static StaticSemaphore_t inflate_mux_buff;
+static StackType_t ws_send_stack[WS_SEND_TASK_STACK];
+static StaticTask_t ws_send_tcb;
+#endif
+#ifdef CONFIG_WS_DEFLATE
+//the last compressed message, reused for the same message sent to next client
+static uint8_t deflate_in[MAX_PAYLOAD_LEN];
+static uint8_t deflate_out[MAX_PAYLOAD_LEN];
+static int deflate_in_len = -1, deflate_out_len = -1;
+static uint8_t deflate_bits = 0;
+static void ws_compress_item(ws_queue_item_t *q);
+static bool ws_deflate_offer(char *rq, connection_desc_t *conn_desc, char *ext_str);
+#endif
 
 //functions prototypes
 void add_ws_header(ws_queue_item_t *q, ws_send_data *ws_data);
 int8_t ws_close(connection_desc_t *conn_desc);
 int8_t ws_handshake(char *rq, connection_desc_t *conn_desc, ws_queue_item_t *ws_item);
-void vCloseTimeoutCallback(TimerHandle_t xTimer);
+static void ws_close_timer_fun(void *arg);
 int8_t set_property(char *rq, thing_t *t, uint16_t tcp_len);
-int8_t run_action(char *rq, thing_t *t, uint16_t tcp_len);
-int8_t event_subscribe(char *rq, thing_t *t, uint16_t tcp_len);
+int8_t run_action(char *rq, connection_desc_t *conn, thing_t *t, uint16_t tcp_len);
+int8_t resource_subscribe(char *rq, connection_desc_t *conn, thing_t *t,
+							RESOURCE_TYPE type, bool add);
 int8_t parse_ws_request(char *rq, uint16_t len, connection_desc_t *conn);
+static bool ws_header_has_token(char *rq, const char *header, const char *token);
+static char *json_top_key(char *json, char *key);
+static void ws_send_error(connection_desc_t *conn, thing_t *t, const char *status,
+							const char *message);
 
 // This is the data from the busy server
 //static char error_busy_page[] =
@@ -60,7 +118,7 @@ const char ws_sec_key[] = "Sec-WebSocket-Key";
 const char ws_upgrade[] = "Upgrade: websocket";
 const char ws_conn_1[] = "Connection: Upgrade";
 const char ws_conn_2[] = "Connection: keep-alive, Upgrade";
-const char ws_conn_3[] = "Sec-WebSocket-Protocol: webthing";
+const char ws_protocol[] = "Sec-WebSocket-Protocol:";
 const char ws_ver[] = "Sec-WebSocket-Version: 13";
 const char ws_sec_conKey[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 const char ws_server_hs[] = "HTTP/1.1 101 Switching Protocols\r\n"\
@@ -68,8 +126,11 @@ const char ws_server_hs[] = "HTTP/1.1 101 Switching Protocols\r\n"\
 							"Connection: Upgrade\r\n"\
 							"Sec-WebSocket-Accept: %s\r\n"\
 							"%s"\
-							"Sec-WebSocket-Extensions: permessage-deflate\r\n\r\n";
+							"%s\r\n";
 const char ws_hs_subpro[] = "Sec-WebSocket-Protocol: webthing\r\n";
+const char ws_hs_subpro_bin[] = "Sec-WebSocket-Protocol: "WS_BIN_PROTOCOL"\r\n";
+const char ws_ext[] = "Sec-WebSocket-Extensions:";
+const char ws_ext_deflate[] = "permessage-deflate";
 
 extern connection_desc_t connection_tab[];
 
@@ -81,15 +142,39 @@ extern connection_desc_t connection_tab[];
  * ***********************************************************************/
 int8_t parse_ws_request(char *rq, uint16_t len, connection_desc_t *conn){
 	int8_t res = 0;
+	thing_t *t = conn -> thing;
+
+	if (conn -> ws_node == true){
+		//node websocket, thing number is in the message: "thing":N
+		char *ptr = json_top_key(rq, "thing");
+
+		if (ptr == NULL){
+			printf("websocket: no thing number in message\n");
+			return -1;
+		}
+		t = get_thing_ptr(atoi(ptr));
+	}
+	if (t == NULL){
+		return -1;
+	}
 
 	if (strstr((char *)rq, "setProperty")){
-		res = set_property(rq, conn -> thing, len);
+		res = set_property(rq, t, len);
 	}
 	else if (strstr((char *)rq, "requestAction")){
-		res = run_action(rq, conn -> thing, len);
+		res = run_action(rq, conn, t, len);
 	}
 	else if (strstr((char *)rq, "addEventSubscription")){
-		res = event_subscribe(rq, conn -> thing, len);
+		res = resource_subscribe(rq, conn, t, EVENT, true);
+	}
+	else if (strstr((char *)rq, "removeEventSubscription")){
+		res = resource_subscribe(rq, conn, t, EVENT, false);
+	}
+	else if (strstr((char *)rq, "addPropertySubscription")){
+		res = resource_subscribe(rq, conn, t, PROPERTY, true);
+	}
+	else if (strstr((char *)rq, "removePropertySubscription")){
+		res = resource_subscribe(rq, conn, t, PROPERTY, false);
 	}
 
 	return res;
@@ -98,30 +183,135 @@ int8_t parse_ws_request(char *rq, uint16_t len, connection_desc_t *conn){
 
 /*******************************************************************
  *
- * run action requested by websocket API
+ * find key on the first level of json object
+ * output: pointer to the key's value or NULL
  *
  ****************************************************************** */
-int8_t event_subscribe(char *rq, thing_t *t, uint16_t tcp_len){
-	int8_t res = 0;
-	
-	//ignore this message, event info is send to all thing's subscribers
-	printf("event subscribe:\n%s\n", rq);
-	
+static char *json_top_key(char *json, char *key){
+	char *ptr, *name_start = NULL;
+	int depth = 0, key_len = strlen(key);
+	bool in_str = false;
+
+	for (ptr = json; *ptr != 0; ptr++){
+		if (in_str == true){
+			if (*ptr == '"'){
+				in_str = false;
+				if ((depth == 1) && (ptr[1] == ':') &&
+					(ptr - name_start == key_len) &&
+					(memcmp(name_start, key, key_len) == 0)){
+					return ptr + 2;
+				}
+			}
+			continue;
+		}
+		switch (*ptr){
+		case '"':
+			in_str = true;
+			name_start = ptr + 1;
+			break;
+		case '{':
+		case '[':
+			depth++;
+			break;
+		case '}':
+		case ']':
+			depth--;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+
+/*******************************************************************
+ *
+ * subscribe (add = true) or unsubscribe properties or events listed
+ * in "data" object, e.g.:
+ * {"messageType":"addEventSubscription","data":{"10times":{}}}
+ * {"messageType":"addPropertySubscription","data":{"temperature":{}}}
+ *
+ ****************************************************************** */
+int8_t resource_subscribe(char *rq, connection_desc_t *conn, thing_t *t,
+							RESOURCE_TYPE type, bool add){
+	int8_t res = -1;
+	char *ptr, *name_start = NULL, name[32];
+	int depth = 0, len;
+	bool in_str = false;
+
+	ptr = json_top_key(rq, "data");
+	if ((ptr == NULL) || (t == NULL)){
+		return -1;
+	}
+	ptr = strchr(ptr, '{');
+	if (ptr == NULL){
+		return -1;
+	}
+
+	for (; (*ptr != 0) && (depth >= 0); ptr++){
+		if (in_str == true){
+			if (*ptr == '"'){
+				in_str = false;
+				//object key on the first level is resource name
+				len = ptr - name_start;
+				if ((depth == 1) && (ptr[1] == ':') && (len < sizeof(name))){
+					memcpy(name, name_start, len);
+					name[len] = 0;
+					if (type == EVENT){
+						event_t *e = get_event_ptr(t, name);
+						if (e != NULL){
+							res = add ? add_event_subscriber(e, conn) :
+										delete_event_subscriber(e, conn);
+						}
+					}
+					else{
+						property_t *p = get_property_ptr(t, name);
+						if (p != NULL){
+							res = add ? add_property_subscriber(p, conn) :
+										delete_property_subscriber(p, conn);
+						}
+					}
+				}
+			}
+			continue;
+		}
+		switch (*ptr){
+		case '"':
+			in_str = true;
+			name_start = ptr + 1;
+			break;
+		case '{':
+		case '[':
+			depth++;
+			break;
+		case '}':
+		case ']':
+			depth--;
+			if (depth == 0){
+				depth = -1; //end of data object
+			}
+			break;
+		}
+	}
+
 	return res;
 }
 
 
 /*******************************************************************
  *
- * run action requested by websocket API
+ * run action requested by websocket API, e.g.:
+ * {"messageType":"requestAction","data":{"constant_on":{"input":{"duration":5}}}}
+ * client gets error message if the request is refused
  *
  ****************************************************************** */
-int8_t run_action(char *rq, thing_t *t, uint16_t tcp_len){
-	int8_t res = 0;
+int8_t run_action(char *rq, connection_desc_t *conn, thing_t *t, uint16_t tcp_len){
+	int8_t res = -1;
+	int index = -1;
 	char *action_id = NULL, *inputs = NULL, *ptr_1, *ptr_2;
 
 	//get action name
-	ptr_1 = strstr(rq, "\"data\":");
+	ptr_1 = json_top_key(rq, "data");
 	if (ptr_1 == NULL){
 		goto run_action_end;
 	}
@@ -139,38 +329,74 @@ int8_t run_action(char *rq, thing_t *t, uint16_t tcp_len){
 	}
 	int len = ptr_2 - ptr_1;
 	if (len > 0){
-		action_id = malloc(len);
+		action_id = req_malloc(len);
 		memset(action_id, 0, len);
 		memcpy(action_id, ptr_1 + 1, len - 1);
 	}
-	//get inputs
-	ptr_1 = strchr(ptr_2, '{');
+	//get inputs, the whole "input" object (as HTTP POST parser)
+	ptr_1 = strstr(ptr_2, "\"input\":");
 	if (ptr_1 == NULL){
 		goto run_action_end;
 	}
-	ptr_2 = strchr(ptr_1, '}');
+	ptr_1 = strchr(ptr_1, '{');
+	if (ptr_1 == NULL){
+		goto run_action_end;
+	}
+	ptr_2 = json_object_end(ptr_1);
 	if (ptr_2 == NULL){
 		goto run_action_end;
 	}
 	len = ptr_2 - ptr_1;
-	if (len > 0){
-		inputs = malloc(len);
-		memset(inputs, 0, len);
-		memcpy(inputs, ptr_1 + 1, len - 1);
-	}
-
-	if ((action_id != NULL) && (inputs != NULL)){
-		request_action(t -> thing_nr, action_id, inputs);
+	inputs = req_malloc(len);
+	memset(inputs, 0, len);
+	memcpy(inputs, ptr_1 + 1, len - 1);
+
+	if (action_id != NULL){
+		index = request_action(t -> thing_nr, action_id, inputs);
+		if (index >= 0){
+			res = 0;
+		}
 	}
 
 	run_action_end:
-	free(action_id);
-	free(inputs);
+	if (res < 0){
+		ws_send_error(conn, t, (index == ACTION_QUEUE_FULL) ?
+					"503 Service Unavailable" : "400 Bad Request",
+					"action request refused");
+	}
+	req_free(inputs);
+	req_free(action_id);
 
 	return res;
 }
 
 
+/*******************************************************************
+ *
+ * send error message to the client, e.g.:
+ * {"messageType":"error","data":{"status":"400 Bad Request",
+ * "message":"action request refused"}}
+ *
+ ****************************************************************** */
+static void ws_send_error(connection_desc_t *conn, thing_t *t, const char *status,
+							const char *message){
+	char msg[] = "{\"messageType\":\"error\",%s\"data\":{\"status\":\"%s\","\
+				"\"message\":\"%s\"}}";
+	char thing_str[16] = "";
+	char *buff;
+
+	if (conn -> ws_node == true){
+		sprintf(thing_str, "\"thing\":%i,", t -> thing_nr);
+	}
+	buff = ws_payload_alloc(strlen(msg) + strlen(thing_str) + strlen(status) +
+							strlen(message) + 1);
+	if (buff != NULL){
+		sprintf(buff, msg, thing_str, status, message);
+		ws_queue_text(conn, buff);
+	}
+}
+
+
 /*******************************************************************
  *
  *set property value by websocket API
@@ -244,17 +470,17 @@ int8_t set_property(char *rq, thing_t *t, uint16_t tcp_len){
 			counter++;
 			//copy name into buffer
 			len = name_end - name_start;
-			name_str = malloc(len + 1);
+			name_str = req_malloc(len + 1);
 			memset(name_str, 0, len + 1);
 			memcpy(name_str, name_start, len);
 			//copy value into buffer
 			len = ptr_end - ptr_start - 1;
-			value_str = malloc(len + 1);
+			value_str = req_malloc(len + 1);
 			memset(value_str, 0, len + 1);
 			memcpy(value_str, ptr_start,len);
 			set_resource_value(t -> thing_nr, name_str, value_str);
-			free(value_str);
-			free(name_str);
+			req_free(value_str);
+			req_free(name_str);
 			name_start = NULL;
 			name_end = NULL;
 		}
@@ -264,182 +490,188 @@ int8_t set_property(char *rq, thing_t *t, uint16_t tcp_len){
 
 /*************************************************************************
  *
- * websocket receive function
- * includes: handshake, open, close, receive data
+ * decoder found incorrect frame, close connection with status code
  *
  * ***********************************************************************/
-int8_t ws_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc){
-	int msg_ok = 0, msg_start = 0;
-	uint16_t ws_len = 0;
-	uint8_t *msg = NULL;
-	ws_frame_header_t *ws_header;
-	uint8_t masking_key[4];
-	uint8_t offset = 2, mask = 0, finish;
-	WS_OPCODES opcode;
-	ws_queue_item_t *ws_item;
-	int8_t res = 0;
-	bool free_msg = true;
+static void ws_decoder_error(void *ctx, uint16_t code, const char *info){
+	connection_desc_t *conn_desc = ctx;
+
+	printf("websocket: %s\n", info);
+	conn_desc -> ws_close_initiator = WS_CLOSE_BY_SERVER;
+	conn_desc -> ws_status_code = code;
+	ws_close(conn_desc);
+}
+
 
-	opcode = 0;
-	msg_ok = 0;
+/*************************************************************************
+ *
+ * control frame received
+ *
+ * ***********************************************************************/
+static void ws_control_frame(void *ctx, uint8_t opcode, uint8_t *payload, uint8_t len){
+	connection_desc_t *conn_desc = ctx;
+	ws_queue_item_t *ws_item;
 
 	if (conn_desc -> ws_state == WS_CLOSING){
-		//ignore received messages in CLOSING state
-		goto ws_receive_end;
-	}
-
-	//read data from input buffer
-	if (conn_desc -> ws_state != WS_CLOSED){
-		//receive websocket data from client
-		offset = 0;
-		if (msg_start == 0){
-			//start of the message
-			ws_header = (ws_frame_header_t *)rq;
-			ws_len = ws_header -> payload_len;
-			opcode = ws_header -> opcode;
-			
-			//TEST
-			//printf("ws opcode: %i, ID: %i, ping: %i\n", 
-			//		opcode, conn_desc -> index, conn_desc -> ws_pongs); //test
-			//TEST
-			
-			finish = ws_header -> fin;
-			if (finish == 0x0){
-				//fragmentation not supported
-				printf("websocket: fragmentation not supported\n");
-				conn_desc -> ws_close_initiator = WS_CLOSE_BY_SERVER;
-				conn_desc -> ws_status_code = DATA_INCONSIST;
-				ws_close(conn_desc);
-				return -1;
-			}
-			offset = 2;
-			if (ws_len == 126){
-				//message length are bytes 2 and 3
-				ws_len = (rq[offset] << 8) + rq[offset + 1];
-				offset = 4;
-				if (ws_len > MAX_PAYLOAD_LEN){
-					printf("websocket: message too long\n");
-					conn_desc -> ws_close_initiator = WS_CLOSE_BY_SERVER;
-					conn_desc -> ws_status_code = DATA_TO_BIG;
-					ws_close(conn_desc);
-					return -1;
-				}
-			}
-			else if (ws_len == 127){
-				//64bit addresses are not supported
-				printf("websocket: 64bit addresses are not supported\n");
-				conn_desc -> ws_close_initiator = WS_CLOSE_BY_SERVER;
-				conn_desc -> ws_status_code = DATA_TO_BIG;
-				ws_close(conn_desc);
-				return -1;
-			}
-			mask = ws_header -> mask;
-			if (mask == 0x1){
-				masking_key[0] = rq[offset];
-				masking_key[1] = rq[offset + 1];
-				masking_key[2] = rq[offset + 2];
-				masking_key[3] = rq[offset + 3];
-				offset += 4;
-			}
-			//allocate memory for message
-			if (ws_len > 0){
-				msg = malloc(ws_len + 1);
-			}
+		if (opcode == WS_OP_CLS){
+			//client answer on close frame
+			conn_desc -> connection = CONN_WS_CLOSE;
 		}
-		if (msg != NULL){
-			//copy data to buffer
-			int msg_start_temp = msg_start + tcp_len - offset;
-			
-			if (msg_start_temp <= ws_len){
-				memcpy(msg + msg_start, rq + offset, tcp_len - offset);
-				msg_start += tcp_len - offset;
-				if (msg_start == ws_len){
-					//all data received, unmask data
-					if ((mask == 1) && (ws_len > 0)){
-						//unmask data
-						for (int i = 0; i < ws_len; i++){
-							msg[i] = msg[i] ^ masking_key[i%4];
-						}
-					}
-					msg_ok = 1;
-					msg[ws_len] = 0;
-					msg_start = 0;
-				}
-			}
-			else {
-				//message length error, close connection
-				printf("msg length error, %i, %i\nmsg:\n%s\n", msg_start, ws_len, msg);
-				conn_desc -> ws_close_initiator = WS_CLOSE_BY_SERVER;
-				conn_desc -> ws_status_code = SERVER_ERR;
-				ws_close(conn_desc);
-				free(msg);
-				return -1;
-			}
+		//ignore other opcodes
+		return;
+	}
+
+	switch (opcode){
+	case WS_OP_CLS:
+		//close connection
+		unsubscribe_connection(conn_desc);
+		conn_desc -> ws_close_initiator = WS_CLOSE_BY_CLIENT;
+		if (len >= 2){
+			conn_desc -> ws_status_code = (payload[0] << 8) + payload[1];
 		}
 		else{
-			if ((ws_len == 0) && (opcode == WS_OP_PIN || opcode == WS_OP_CLS)){
-				//ping messages
-				msg_ok = 1;
+			conn_desc -> ws_status_code = 0;
+		}
+		ws_close(conn_desc);
+		break;
+	case WS_OP_PIN:
+		//ping control frame, answer with "pong"
+		ws_item = ws_item_alloc();
+		if (ws_item == NULL){
+			break;
+		}
+		ws_item -> payload = NULL;
+		if (len > 0){
+			ws_item -> payload = ws_payload_alloc(len);
+			if (ws_item -> payload == NULL){
+				ws_item_free(ws_item);
+				break;
 			}
+			memcpy(ws_item -> payload, payload, len);
+		}
+		ws_item -> len = len;
+		ws_item -> conn_desc = conn_desc;
+		ws_item -> opcode = WS_OP_PON;
+		ws_item -> ws_frame = 0x1;
+		ws_item -> text = 0x0;
+
+		xSemaphoreTake(conn_desc -> mutex, portMAX_DELAY);
+		conn_desc -> msg_to_send++;
+		xSemaphoreGive(conn_desc -> mutex);
+		xQueueSend(ws_output_queue, &ws_item, portMAX_DELAY);
+		break;
+	case WS_OP_PON:
+		conn_desc -> ws_pongs++;
+		if (len == WS_PING_PAYLOAD_LEN){
+			ws_pong_received(conn_desc, payload);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+
+/*************************************************************************
+ *
+ * release buffer of decompressed message (with STATIC_ALLOC the shared
+ * buffer is given to the next connection)
+ *
+ * ***********************************************************************/
+static void ws_inflate_done(uint8_t *plain){
+
+#ifdef CONFIG_STATIC_ALLOC
+	xSemaphoreGive(inflate_mux);
+#else
+	free(plain);
+#endif
+}
+
+
+/*************************************************************************
+ *
+ * whole data message received (all fragments)
+ *
+ * ***********************************************************************/
+static void ws_data_message(void *ctx, uint8_t opcode, uint8_t rsv,
+							uint8_t *msg, uint32_t len){
+	connection_desc_t *conn_desc = ctx;
+	uint8_t *plain = NULL;
+
+	if (conn_desc -> ws_state != WS_OPEN){
+		//ignore data in CLOSING state
+		return;
+	}
+	if (rsv == WS_RSV1){
+		//compressed message (permessage-deflate)
+		int plain_len = -1;
+
+#ifdef CONFIG_STATIC_ALLOC
+		xSemaphoreTake(inflate_mux, portMAX_DELAY);
+		plain = inflate_buff;
+		plain_len = ws_inflate(msg, len, plain, WS_MAX_MESSAGE_LEN, inflate_work);
+#else
+		plain = malloc(WS_MAX_MESSAGE_LEN + 1);
+		if (plain != NULL){
+			plain_len = ws_inflate(msg, len, plain, WS_MAX_MESSAGE_LEN, NULL);
 		}
+#endif
+		if (plain_len < 0){
+			ws_inflate_done(plain);
+			ws_decoder_fail(conn_desc -> ws_dec, DATA_INCONSIST, "decompression error");
+			return;
+		}
+		msg = plain;
+		len = plain_len;
+		msg[len] = 0;
+	}
+	if ((opcode == WS_OP_BIN) && (conn_desc -> ws_binary == true)){
+		ws_bin_receive(conn_desc, msg, len);
 	}
+	else{
+		parse_ws_request((char *)msg, len, conn_desc);
+	}
+	if (plain != NULL){
+		ws_inflate_done(plain);
+	}
+}
+
+
+/*************************************************************************
+ *
+ * release decoder of the connection
+ *
+ * ***********************************************************************/
+void ws_decoder_free(connection_desc_t *conn_desc){
+
+	if (conn_desc -> ws_dec != NULL){
+		ws_decoder_release(conn_desc -> ws_dec);
+#ifndef CONFIG_STATIC_ALLOC
+		free(conn_desc -> ws_dec);
+#endif
+		conn_desc -> ws_dec = NULL;
+	}
+}
+
+
+/*************************************************************************
+ *
+ * websocket receive function
+ * includes: handshake, open, close, receive data
+ *
+ * ***********************************************************************/
+int8_t ws_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc){
+	ws_queue_item_t *ws_item;
+	int8_t res = 0;
 
-	//collect message, check it
 	switch (conn_desc -> ws_state){
 	case WS_OPEN:
-		if (msg_ok == 1){
-			switch(opcode){
-			case WS_OP_TXT:
-			case WS_OP_BIN:
-				//client data received
-				parse_ws_request((char *)msg, tcp_len, conn_desc);
-				break;
-			case WS_OP_CLS:
-				//close connection
-				delete_subscriber(conn_desc);
-				conn_desc -> ws_close_initiator = WS_CLOSE_BY_CLIENT;
-				if (ws_len > 0){
-					conn_desc -> ws_status_code = (msg[0] << 8) + msg[1];
-					ws_close(conn_desc);
-				}
-				else{
-					conn_desc -> ws_status_code = 0;
-					ws_close(conn_desc);
-				}
-				break;
-			case WS_OP_PIN:
-				//ping control frame, answer with "pong"
-				ws_item = malloc(sizeof(ws_queue_item_t));
-				if (ws_len == 0){
-					ws_item -> payload = NULL;
-				}
-				else{
-					ws_item -> payload = msg;
-				}
-				ws_item -> len = ws_len;
-				ws_item -> conn_desc = conn_desc;
-				ws_item -> opcode = WS_OP_PON;
-				ws_item -> ws_frame = 0x1;
-				ws_item -> text = 0x0;
-				free_msg = false;
-
-				xSemaphoreTake(conn_desc -> mutex, portMAX_DELAY);
-				conn_desc -> msg_to_send++;
-				xSemaphoreGive(conn_desc -> mutex);
-				xQueueSend(ws_output_queue, &ws_item, portMAX_DELAY);
-				break;
-			case WS_OP_PON:
-				//conn_desc -> ws_pongs++;
-				break;
-			case WS_OP_CON:
-			default:
-				//TODO: what to do if happen?
-				printf("incorrect opcode received: %X\n", opcode);
-				conn_desc -> ws_close_initiator = WS_CLOSE_BY_SERVER;
-				conn_desc -> ws_status_code = POLICY_ERR;
-				ws_close(conn_desc);
-				break;
-			}
+	case WS_OPENING:
+	case WS_CLOSING:
+		//websocket frames
+		res = -1;
+		if (conn_desc -> ws_dec != NULL){
+			res = ws_decode(conn_desc -> ws_dec, (uint8_t *)rq, tcp_len);
 		}
 		break;
 
@@ -447,11 +679,27 @@ int8_t ws_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc){
 		//check if request was 'GET /\r\n'
 		if(rq[0] == 'G' && rq[1] == 'E' && rq[2] == 'T'
 				&& rq[3] == ' ' && rq[4] == '/') {
-			ws_item = malloc(sizeof(ws_queue_item_t));
+			ws_item = ws_item_alloc();
 
 			if (ws_item != NULL){
-				uint8_t res = ws_handshake(rq, conn_desc, ws_item);
-				if (res == 1){
+#ifdef CONFIG_STATIC_ALLOC
+				conn_desc -> ws_dec = &ws_dec_storage[conn_desc -> index];
+				memset(conn_desc -> ws_dec, 0, sizeof(ws_decoder_t));
+#else
+				conn_desc -> ws_dec = calloc(1, sizeof(ws_decoder_t));
+#endif
+				if ((conn_desc -> ws_dec != NULL) &&
+					(ws_handshake(rq, conn_desc, ws_item) == 1)){
+					ws_decoder_init(conn_desc -> ws_dec, WS_MAX_MESSAGE_LEN, conn_desc -> ws_deflate,
+									conn_desc, ws_control_frame, ws_data_message,
+									ws_decoder_error);
+#ifdef CONFIG_STATIC_ALLOC
+					//messages are collected in receive buffer of the slot,
+					//it is not used by HTTP after upgrade
+					ws_decoder_set_buffer(conn_desc -> ws_dec,
+										(uint8_t *)http_rx_storage(conn_desc),
+										HTTP_RX_STORAGE_LEN);
+#endif
 					xSemaphoreTake(conn_desc -> mutex, portMAX_DELAY);
 					conn_desc -> msg_to_send++;
 					xSemaphoreGive(conn_desc -> mutex);
@@ -472,13 +720,40 @@ int8_t ws_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc){
 						b1 = rq;
 					}
 					c1 = strchr(b1, '/');
+					//optional query, e.g. GET /0?since=120
+					char *c3 = strchr(c1, '?');
+					uint32_t since = UINT32_MAX;
+					if ((c3 != NULL) && (c3 < c2)){
+						since = http_query_param(c1, "since", UINT32_MAX);
+						c2 = c3 + 1;
+					}
 					len = c2 - c1 - 1;
-					if (len <= 4){
+					bool node_ws = (strncmp(c1, "/things", 7) == 0) &&
+									((c1[7] == ' ') || (c1[7] == '?'));
+					if (node_ws == true){
+						//one websocket for all things of the node
+						conn_desc -> ws_node = true;
+						conn_desc -> thing = NULL;
+					}
+					else if (len <= 4){
 						memset(buff_nr, 0, 3);
 						memcpy(buff_nr, c1 + 1, len - 1);
 						thing_nr = atoi(buff_nr);
 						conn_desc -> thing = get_thing_ptr(thing_nr);
-						add_subscriber(conn_desc);
+					}
+					if ((conn_desc -> ws_node == true) || (conn_desc -> thing != NULL)){
+						subscribe_connection(conn_desc);
+						int8_t replay_res = -1;
+						if (since != UINT32_MAX){
+							//send changes missed by the client
+							replay_res = change_log_replay(conn_desc, since);
+						}
+#ifdef CONFIG_WS_SNAPSHOT_ON_SUBSCRIBE
+						if (replay_res < 0){
+							//send current state of the thing
+							send_thing_snapshot(conn_desc);
+						}
+#endif
 					}
 					else{
 						conn_desc -> connection = CONN_WS_CLOSE;
@@ -486,6 +761,9 @@ int8_t ws_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc){
 					}
 				}
 				else{
+					ws_item_free(ws_item);
+					ws_decoder_free(conn_desc);
+					conn_desc -> connection = CONN_WS_CLOSE;
 					printf("ws_handshake returned error\n");
 				}
 			}
@@ -499,32 +777,44 @@ int8_t ws_receive(char *rq, uint16_t tcp_len, connection_desc_t *conn_desc){
 			printf("ERROR: bad http request at handshake\n%s\n", rq);
 		}
 		break;
-	case WS_OPENING:
-		//should not happen
-		printf("ws state is OPENING, received opcode = %X, msg = %s\n", opcode, msg);
-		break;
-	case WS_CLOSING:
-		if (opcode == WS_OP_CLS){
-			printf("client answer on close frame, close code = %i", (msg[0] << 8) + msg[1]);
-			conn_desc -> connection = CONN_WS_CLOSE;
-			//TODO: if this is not answer for server's CLOSE, but client's first
-			//CLOSE frame, then client is waiting for server's CLOSE
-		}
-		else{
-			printf("state CLOSING, incorrect ws frame, opcode = %X\n", opcode);
-		}
-		//ignore other opcodes
-		break;
 	default:
 		conn_desc -> connection = CONN_WS_CLOSE;
 	}//switch(ws_state)
 
-ws_receive_end:	
-	if (free_msg == true){
-		free(msg);
+	return res;
+}
+
+
+/*************************************************************************
+ *
+ * check if comma separated list in request header contains the token,
+ * e.g. "Sec-WebSocket-Protocol: webthing-bin, webthing"
+ *
+ * ***********************************************************************/
+static bool ws_header_has_token(char *rq, const char *header, const char *token){
+	char *ptr, *end;
+	int len = strlen(token);
+
+	ptr = strstr(rq, header);
+	if (ptr == NULL){
+		return false;
+	}
+	end = strstr(ptr, "\r\n");
+	ptr += strlen(header);
+	while ((end != NULL) && (ptr < end)){
+		while ((ptr < end) && ((*ptr == ' ') || (*ptr == ','))){
+			ptr++;
+		}
+		if ((end - ptr >= len) && (strncmp(ptr, token, len) == 0) &&
+			((ptr + len == end) || (ptr[len] == ',') || (ptr[len] == ' '))){
+			return true;
+		}
+		while ((ptr < end) && (*ptr != ',')){
+			ptr++;
+		}
 	}
 
-	return res;
+	return false;
 }
 
 
@@ -534,9 +824,15 @@ int8_t ws_handshake(char *rq, connection_desc_t *conn_desc, ws_queue_item_t *ws_
 	int8_t ret;
 	char *server_ans;
 	char *res1, *res2;
-	bool sub_pro = false;
+	char ext_str[120];
+	const char *sub_pro = "";
 
 	server_ans = NULL;
+	ext_str[0] = 0;
+	conn_desc -> ws_deflate = false;
+#ifdef CONFIG_WS_DEFLATE
+	conn_desc -> ws_deflate = ws_deflate_offer(rq, conn_desc, ext_str);
+#endif
 
 	//upgrade
 	if (strstr((char *)rq, ws_upgrade)){
@@ -554,8 +850,14 @@ int8_t ws_handshake(char *rq, connection_desc_t *conn_desc, ws_queue_item_t *ws_
 		msg_flags |= 0x04;
 	}
 	//subprotocol
-	if (strstr((char *)rq, ws_conn_3)){
-		sub_pro = true;
+	conn_desc -> ws_binary = false;
+	if (ws_header_has_token(rq, ws_protocol, WS_BIN_PROTOCOL) == true){
+		//binary property updates
+		sub_pro = ws_hs_subpro_bin;
+		conn_desc -> ws_binary = true;
+	}
+	else if (ws_header_has_token(rq, ws_protocol, "webthing") == true){
+		sub_pro = ws_hs_subpro;
 	}
 	if (msg_flags == 0x07){
 		size_t  out_len;
@@ -566,7 +868,7 @@ int8_t ws_handshake(char *rq, connection_desc_t *conn_desc, ws_queue_item_t *ws_
 
 			res2 = strstr(res1, ": ");
 			res1 = strstr(res2, "\r\n");
-			char *buff_1 = malloc(80);
+			char *buff_1 = req_malloc(80);
 			memset(buff_1, 0, 80);
 			memcpy(buff_1, res2 + 2, res1 - res2 - 2);
 
@@ -575,31 +877,29 @@ int8_t ws_handshake(char *rq, connection_desc_t *conn_desc, ws_queue_item_t *ws_
 			int buff_1_len = res1 - res2 - 2 + strlen(ws_sec_conKey);
 			buff_1[buff_1_len] = 0;
 
-			char *buff_2 = malloc(20);
+			char *buff_2 = req_malloc(20);
 			mbedtls_sha1_ret((unsigned char*)buff_1,
 							  buff_1_len,
 							 (unsigned char*)buff_2);
-			free(buff_1);
+			req_free(buff_1);
 
 			out_len = 4 + SHA1_RES_LEN*4/3 + 1;
-			char *buff_3 = malloc(out_len);
+			char *buff_3 = req_malloc(out_len);
 			size_t olen;
 			mbedtls_base64_encode((unsigned char *)buff_3,
 								   out_len, &olen,
 								  (unsigned char *)buff_2,
 								   SHA1_RES_LEN);
-			free(buff_2);
+			req_free(buff_2);
 
-			//prepare server answer
-			server_ans = malloc(olen + strlen(ws_server_hs) + 10);
-			if (sub_pro == false){
-				sprintf(server_ans, ws_server_hs, buff_3, "");
-			}
-			else{
-				sprintf(server_ans, ws_server_hs, buff_3, ws_conn_3);
+			//prepare server answer, released by the sending task
+			server_ans = ws_payload_alloc(olen + strlen(ws_server_hs) + strlen(sub_pro) +
+										strlen(ext_str) + 10);
+			if (server_ans != NULL){
+				sprintf(server_ans, ws_server_hs, buff_3, sub_pro, ext_str);
 			}
 			
-			free(buff_3);
+			req_free(buff_3);
 		}
 	}
 
@@ -607,6 +907,10 @@ int8_t ws_handshake(char *rq, connection_desc_t *conn_desc, ws_queue_item_t *ws_
 	if ((msg_flags == 0x0F) && (server_ans != NULL)){
 
 		conn_desc -> ws_state = WS_OPENING;
+#if WS_PING_PERIOD_MS > 0
+		timer_wheel_arm(&conn_desc -> ping_timer, WS_PING_PERIOD_MS,
+						ws_ping_timer_fun, conn_desc);
+#endif
 
 		ws_item -> payload = (uint8_t *)server_ans;
 		ws_item -> len = strlen(server_ans);
@@ -627,10 +931,9 @@ int8_t ws_handshake(char *rq, connection_desc_t *conn_desc, ws_queue_item_t *ws_
 
 //create and start time-out timer for ending connection 
 int8_t create_connection_timeout(connection_desc_t *conn_desc){
-	TimerHandle_t timeout_timer;
 	int32_t timeout;
 	
-	if (conn_desc -> timer == NULL){
+	if (timer_wheel_armed(&conn_desc -> timer) == false){
 
 		if (conn_desc -> ws_close_initiator == WS_CLOSE_BY_CLIENT){
 			//close initiated by client, only 1 CLS frame must be sent
@@ -646,23 +949,9 @@ int8_t create_connection_timeout(connection_desc_t *conn_desc){
 			return -1;
 		}
 	
-		timeout_timer = xTimerCreate("timeout", 
-									pdMS_TO_TICKS(timeout),
-									pdFALSE, 
-									(void *)&(conn_desc -> index),
-									vCloseTimeoutCallback);
-	
 		//start timer
-		BaseType_t res = xTimerStart(timeout_timer, 5);
-		if (res == pdPASS) {
-			conn_desc -> timer = timeout_timer;
-			return 1;
-		}
-		else {
-			conn_desc -> timer = NULL;
-			xTimerDelete(timeout_timer, 10);
-			return -1;
-		}
+		timer_wheel_arm(&conn_desc -> timer, timeout, ws_close_timer_fun, conn_desc);
+		return 1;
 	}
 	else {
 		return -1;
@@ -691,12 +980,23 @@ int8_t ws_close(connection_desc_t *conn_desc){
 	}
 	else{
 		len = 2;
-		payload = malloc(2);
-		payload[0] = cls_status >> 8; //network byte order
-		payload[1] = cls_status;
+		payload = ws_payload_alloc(2);
+		if (payload == NULL){
+			len = 0;
+		}
+		else{
+			payload[0] = cls_status >> 8; //network byte order
+			payload[1] = cls_status;
+		}
 	}
 
-	ws_item = malloc(sizeof(ws_queue_item_t));
+	ws_item = ws_item_alloc();
+	if (ws_item == NULL){
+		//no free queue item, close without close frame
+		ws_payload_free(payload);
+		create_connection_timeout(conn_desc);
+		return -1;
+	}
 	ws_item -> payload = (uint8_t *)payload;
 	ws_item -> len = len;
 	ws_item -> opcode = WS_OP_CLS; //close
@@ -715,28 +1015,25 @@ int8_t ws_close(connection_desc_t *conn_desc){
 
 /*************************************************
 *
-* timer callback for closing websocket
+* timer function for closing websocket
 *
 **************************************************/
 
-void vCloseTimeoutCallback( TimerHandle_t xTimer ){
-	uint8_t index;
-	connection_desc_t *conn_desc = NULL;
-
-	index = *(uint8_t *)pvTimerGetTimerID(xTimer);
+static void ws_close_timer_fun(void *arg){
+	connection_desc_t *conn_desc = (connection_desc_t *)arg;
 
-	conn_desc = &connection_tab[index];
-	
-	if (conn_desc != NULL){
+	if (conn_desc -> netconn_ptr != NULL){
 		//clear connection resources
 		if (conn_desc -> msg_to_send > 0){
 			//wait until all messages are sent
-			xTimerReset(xTimer, 5);
+			timer_wheel_arm(&conn_desc -> timer, CLOSE_TIMEOUT_MS_SHORT,
+							ws_close_timer_fun, conn_desc);
 			printf("ws reset timer\n"); //TEST
 			return;
 		}
 	
-		close_thing_connection(conn_desc, "WS TIME OUT");
+		//worker of connection closes it
+		conn_close_request(conn_desc);
 	}
 }
 
@@ -752,7 +1049,14 @@ static void ws_send_task(void* arg){
 	for(;;){
 		xQueueReceive(ws_output_queue, &q_item, portMAX_DELAY);
 
-		memset(head_buff, 0, q_item -> len + 4);
+		q_item -> compressed = 0;
+#ifdef CONFIG_WS_DEFLATE
+		if ((q_item -> ws_frame == 0x1) && (q_item -> conn_desc -> ws_deflate == true) &&
+			((q_item -> opcode == WS_OP_TXT) || (q_item -> opcode == WS_OP_BIN))){
+			ws_compress_item(q_item);
+		}
+#endif
+		memset(head_buff, 0, MIN(q_item -> len, MAX_PAYLOAD_LEN) + 4);
 		if (q_item -> ws_frame == 0x1){
 			add_ws_header(q_item, &ws_data);
 		}
@@ -762,7 +1066,7 @@ static void ws_send_task(void* arg){
 			ws_data.len = q_item -> len;
 		}
 		conn_desc = q_item -> conn_desc;
-		free(q_item -> payload);
+		ws_payload_free(q_item -> payload);
 
 		//check if connection is not deleted
 		if (conn_desc -> netconn_ptr == NULL){
@@ -782,11 +1086,14 @@ static void ws_send_task(void* arg){
 				printf("msg to send ERROR: %i\n", conn_desc -> msg_to_send);
 			}
 			
-			err_t err = netconn_write(conn_desc -> netconn_ptr,
-										ws_data.payload,
-										ws_data.len,
-										NETCONN_COPY);
-			
+			err_t err = ERR_OK;
+			if (ws_data.len > 0){
+				err = netconn_write(conn_desc -> netconn_ptr,
+									ws_data.payload,
+									ws_data.len,
+									NETCONN_COPY);
+			}
+
 			if (err != ERR_OK){
 				//data not sent, TCP error occured
 				conn_desc -> send_errors++;
@@ -823,9 +1130,6 @@ static void ws_send_task(void* arg){
 				if (opcode == WS_OP_CLS){
 					create_connection_timeout(conn_desc);
 				}
-				else if (opcode == WS_OP_PON){
-					conn_desc -> ws_pongs++;
-				}
 				else if (opcode == WS_OP_PIN){
 					conn_desc -> ws_pings++;
 				}
@@ -838,7 +1142,7 @@ static void ws_send_task(void* arg){
 			printf("ERROR by sending data: websocket incorrect state\n");
 		}
 ws_send_connection_deleted:
-		free(q_item);
+		ws_item_free(q_item);
 	}
 }
 
@@ -850,6 +1154,7 @@ void add_ws_header(ws_queue_item_t *q, ws_send_data *out){
 	out -> payload = head_buff;
 	//add websocket header
 	header.h.opcode = q -> opcode;
+	header.h.reserved = (q -> compressed == 1) ? WS_RSV1 : 0;
 	header.h.fin = 0x1;
 	header.h.mask = 0x0;	//only client masks data
 	if (q -> len <= 125){
@@ -871,7 +1176,8 @@ void add_ws_header(ws_queue_item_t *q, ws_send_data *out){
 		out -> len = q -> len + 4;
 	}
 	else{
-		//too long message
+		//too long message, sender should split it
+		printf("ws send: message of %u bytes too long, dropped\n", (unsigned int)q -> len);
 		out -> len = 0;
 		out -> payload = NULL;
 	}
@@ -890,7 +1196,19 @@ int8_t ws_server_init(uint16_t port){
 
 	if (ws_server_is_running == 0){
 		vTaskDelay(1000 / portTICK_PERIOD_MS);
-		ws_output_queue = xQueueCreate(10, sizeof(ws_queue_item_t *));
+		slab_pool_init(&ws_item_pool, "ws_items", ws_item_storage,
+						sizeof(ws_queue_item_t), WS_ITEM_POOL_SIZE);
+		slab_pool_init(&ws_small_pool, "ws_small", ws_small_storage,
+						WS_SMALL_PAYLOAD_LEN, WS_SMALL_POOL_SIZE);
+		slab_pool_init(&ws_payload_pool, "ws_payloads", ws_payload_storage,
+						MAX_PAYLOAD_LEN, WS_PAYLOAD_POOL_SIZE);
+#ifdef CONFIG_STATIC_ALLOC
+		inflate_mux = xSemaphoreCreateMutexStatic(&inflate_mux_buff);
+		ws_output_queue = xQueueCreateStatic(WS_OUTPUT_QUEUE_LEN, sizeof(ws_queue_item_t *),
+									ws_output_queue_storage, &ws_output_queue_buff);
+#else
+		ws_output_queue = xQueueCreate(WS_OUTPUT_QUEUE_LEN, sizeof(ws_queue_item_t *));
+#endif
 		if (ws_output_queue != NULL){
 		}
 		else{
@@ -904,7 +1222,12 @@ int8_t ws_server_init(uint16_t port){
 			printf("ws server not created\n");
 		}
 		//open output (sending) queue
-		xTaskCreate(ws_send_task, "ws_send_task", 2048, NULL, 1, NULL);
+#ifdef CONFIG_STATIC_ALLOC
+		xTaskCreateStatic(ws_send_task, "ws_send_task", WS_SEND_TASK_STACK, NULL, 1,
+						ws_send_stack, &ws_send_tcb);
+#else
+		xTaskCreate(ws_send_task, "ws_send_task", WS_SEND_TASK_STACK, NULL, 1, NULL);
+#endif
 		ret = 1;
 	}
 	else{
@@ -931,9 +1254,241 @@ int8_t ws_send(ws_queue_item_t *item, int32_t wait_ms){
 	item -> conn_desc -> msg_to_send++;
 	xSemaphoreGive(item -> conn_desc -> mutex);
 	
-	return xQueueSend(ws_output_queue, &item, wait_ms / portTICK_RATE_MS);
+	if (xQueueSend(ws_output_queue, &item, wait_ms / portTICK_RATE_MS) != pdTRUE){
+		xSemaphoreTake(item -> conn_desc -> mutex, portMAX_DELAY);
+		item -> conn_desc -> msg_to_send--;
+		xSemaphoreGive(item -> conn_desc -> mutex);
+		return -1;
+	}
+
+	return 1;
 }
 
+// ***************************************************************
+//
+// take item of the sending queue from the pool, NULL if the pool
+// is empty (and heap fallback is off or heap is exhausted)
+//
+// ***********************************************************
+ws_queue_item_t *ws_item_alloc(void){
+
+	return slab_alloc(&ws_item_pool);
+}
+
+
+// ***************************************************************
+//
+// give item of the sending queue back to the pool
+//
+// ***********************************************************
+void ws_item_free(ws_queue_item_t *item){
+
+	slab_free(&ws_item_pool, item);
+}
+
+
+// ***************************************************************
+//
+// payload of frame sent by the server, released by the sending task
+// (ws_payload_free), short payloads and payloads up to MAX_PAYLOAD_LEN
+// are taken from pools, longer from heap (not with STATIC_ALLOC,
+// they couldn't be sent anyway)
+//
+// ***********************************************************
+void *ws_payload_alloc(uint16_t size){
+	void *payload;
+
+	if (size <= WS_SMALL_PAYLOAD_LEN){
+		payload = slab_alloc(&ws_small_pool);
+		if (payload != NULL){
+			return payload;
+		}
+	}
+	if (size <= MAX_PAYLOAD_LEN){
+		return slab_alloc(&ws_payload_pool);
+	}
+#ifdef CONFIG_STATIC_ALLOC
+	return NULL;
+#else
+	return malloc(size);
+#endif
+}
+
+
+// ***************************************************************
+//
+// give payload back to its pool (or to heap)
+//
+// ***********************************************************
+void ws_payload_free(void *payload){
+
+	if (slab_owns(&ws_small_pool, payload) == true){
+		slab_free(&ws_small_pool, payload);
+	}
+	else{
+		slab_free(&ws_payload_pool, payload);
+	}
+}
+
+
+// ***************************************************************
+//
+// queue text frame also during opening handshake (state WS_OPENING),
+// payload is released after sending
+//
+// ***********************************************************
+int8_t ws_queue_text(connection_desc_t *conn_desc, char *payload){
+
+	return ws_queue_frame(conn_desc, (uint8_t *)payload, strlen(payload), WS_OP_TXT);
+}
+
+
+// ***************************************************************
+//
+// queue text or binary frame, see ws_queue_text
+//
+// ***********************************************************
+int8_t ws_queue_frame(connection_desc_t *conn_desc, uint8_t *payload, uint16_t len,
+					WS_OPCODES opcode){
+	ws_queue_item_t *ws_item;
+
+	if ((conn_desc -> ws_state != WS_OPEN) && (conn_desc -> ws_state != WS_OPENING)){
+		ws_payload_free(payload);
+		return -1;
+	}
+
+	ws_item = ws_item_alloc();
+	if (ws_item == NULL){
+		ws_payload_free(payload);
+		return -1;
+	}
+	ws_item -> payload = payload;
+	ws_item -> len = len;
+	ws_item -> conn_desc = conn_desc;
+	ws_item -> opcode = opcode;
+	ws_item -> ws_frame = 0x1;
+	ws_item -> text = (opcode == WS_OP_TXT) ? 0x1 : 0x0;
+
+	xSemaphoreTake(conn_desc -> mutex, portMAX_DELAY);
+	conn_desc -> msg_to_send++;
+	xSemaphoreGive(conn_desc -> mutex);
+
+	return xQueueSend(ws_output_queue, &ws_item, portMAX_DELAY);
+}
+
+
+/*************************************************************************
+ *
+ * heartbeat timer of websocket: send ping, close connection which
+ * didn't answer the last WS_PING_MAX_MISSED pings (client lost
+ * without closing TCP connection keeps its slot for minutes otherwise)
+ *
+ * ***********************************************************************/
+static void ws_ping_timer_fun(void *arg){
+	connection_desc_t *conn_desc = (connection_desc_t *)arg;
+
+	if ((conn_desc -> netconn_ptr == NULL) || (conn_desc -> type != CONN_WS)){
+		return;
+	}
+	if (conn_desc -> ws_state == WS_OPEN){
+		if (conn_desc -> ws_missed_pongs >= WS_PING_MAX_MISSED){
+			printf("websocket: no pong, connection %i evicted\n", conn_desc -> index);
+			ws_evictions++;
+			//worker of connection closes it
+			conn_close_request(conn_desc);
+			return;
+		}
+		ws_send_ping(conn_desc);
+	}
+	else if (conn_desc -> ws_state != WS_OPENING){
+		//websocket is closing
+		return;
+	}
+	timer_wheel_arm(&conn_desc -> ping_timer, WS_PING_PERIOD_MS,
+					ws_ping_timer_fun, conn_desc);
+}
+
+
+/*************************************************************************
+ *
+ * send ping with current time (big endian, us) as payload
+ *
+ * ***********************************************************************/
+static void ws_send_ping(connection_desc_t *conn_desc){
+	ws_queue_item_t *ws_item;
+	uint64_t now = esp_timer_get_time();
+	uint8_t *payload;
+
+	ws_item = ws_item_alloc();
+	payload = ws_payload_alloc(WS_PING_PAYLOAD_LEN);
+	if ((ws_item == NULL) || (payload == NULL)){
+		ws_item_free(ws_item);
+		ws_payload_free(payload);
+		return;
+	}
+	for (int i = 0; i < WS_PING_PAYLOAD_LEN; i++){
+		payload[i] = now >> (56 - 8 * i);
+	}
+	ws_item -> payload = payload;
+	ws_item -> len = WS_PING_PAYLOAD_LEN;
+	ws_item -> conn_desc = conn_desc;
+	ws_item -> opcode = WS_OP_PIN;
+	ws_item -> ws_frame = 0x1;
+	ws_item -> text = 0x0;
+
+	conn_desc -> ws_missed_pongs++;
+	if (ws_send(ws_item, 0) < 0){
+		//sending queue is full, try next time
+		ws_payload_free(payload);
+		ws_item_free(ws_item);
+	}
+}
+
+
+/*************************************************************************
+ *
+ * answer on server's ping, update round trip time statistics
+ * (smoothed like TCP's SRTT and RTTVAR, RFC 6298)
+ *
+ * ***********************************************************************/
+static void ws_pong_received(connection_desc_t *conn_desc, uint8_t *payload){
+	uint64_t sent = 0, now = esp_timer_get_time();
+	int32_t rtt, diff;
+
+	for (int i = 0; i < WS_PING_PAYLOAD_LEN; i++){
+		sent = (sent << 8) | payload[i];
+	}
+	if ((sent > now) || (now - sent > 60000000)){
+		//not an answer for our ping
+		return;
+	}
+	rtt = now - sent;
+	conn_desc -> ws_missed_pongs = 0;
+	conn_desc -> ws_rtt_us = rtt;
+	if (conn_desc -> ws_rtt_avg_us == 0){
+		conn_desc -> ws_rtt_avg_us = rtt;
+		conn_desc -> ws_jitter_us = rtt / 2;
+	}
+	else{
+		diff = rtt - (int32_t)conn_desc -> ws_rtt_avg_us;
+		conn_desc -> ws_jitter_us += ((diff < 0 ? -diff : diff) -
+									(int32_t)conn_desc -> ws_jitter_us) / 4;
+		conn_desc -> ws_rtt_avg_us += diff / 8;
+	}
+}
+
+
+/*************************************************************************
+ *
+ * number of connections closed because of missing pongs
+ *
+ * ***********************************************************************/
+uint32_t ws_get_evictions(void){
+
+	return ws_evictions;
+}
+
+
 // ****************************************************************************
 int8_t ws_server_stop(){
 	ws_server_is_running = 0;
@@ -941,3 +1496,129 @@ int8_t ws_server_stop(){
 
 	return 1;
 }
+
+
+#ifdef CONFIG_WS_DEFLATE
+/*************************************************************************
+ *
+ * check permessage-deflate offer of the client (RFC 7692)
+ * the first offer is accepted if its parameters are known, server always
+ * answers with no_context_takeover on both sides, so every message is
+ * compressed independently (fixed memory, the same compressed message
+ * can be sent to many clients)
+ * output:
+ * 		true - extension accepted, ext_str contains response header
+ *
+ * ***********************************************************************/
+static bool ws_deflate_offer(char *rq, connection_desc_t *conn_desc, char *ext_str){
+	char *ptr, *end, param[40];
+	int len, bits;
+	bool max_bits = false;
+
+	conn_desc -> ws_window_bits = 15;
+	ptr = strstr(rq, ws_ext);
+	if (ptr == NULL){
+		return false;
+	}
+	end = strstr(ptr, "\r\n");
+	ptr = strstr(ptr, ws_ext_deflate);
+	if ((end == NULL) || (ptr == NULL) || (ptr > end)){
+		return false;
+	}
+	ptr += strlen(ws_ext_deflate);
+
+	//parameters of the offer, up to ',' (next offer) or end of line
+	for (;;){
+		while ((ptr < end) && (*ptr == ' ')){
+			ptr++;
+		}
+		if ((ptr >= end) || (*ptr == ',')){
+			break;
+		}
+		if (*ptr != ';'){
+			return false;
+		}
+		ptr++;
+		while ((ptr < end) && (*ptr == ' ')){
+			ptr++;
+		}
+		len = 0;
+		while ((ptr < end) && (*ptr != ';') && (*ptr != ',') && (*ptr != ' ') &&
+				(len < sizeof(param) - 1)){
+			if (*ptr != '"'){
+				param[len++] = *ptr;
+			}
+			ptr++;
+		}
+		param[len] = 0;
+
+		if (strncmp(param, "server_max_window_bits=", 23) == 0){
+			bits = atoi(param + 23);
+			if ((bits < 8) || (bits > 15)){
+				return false;
+			}
+			conn_desc -> ws_window_bits = bits;
+			max_bits = true;
+		}
+		else if ((strcmp(param, "server_no_context_takeover") != 0) &&
+				(strcmp(param, "client_no_context_takeover") != 0) &&
+				(strcmp(param, "client_max_window_bits") != 0) &&
+				(strncmp(param, "client_max_window_bits=", 23) != 0)){
+			//unknown parameter, decline the offer
+			return false;
+		}
+	}
+
+	len = sprintf(ext_str, "%s %s; server_no_context_takeover; client_no_context_takeover",
+					ws_ext, ws_ext_deflate);
+	if (max_bits == true){
+		len += sprintf(ext_str + len, "; server_max_window_bits=%i",
+						conn_desc -> ws_window_bits);
+	}
+	sprintf(ext_str + len, "\r\n");
+
+	return true;
+}
+
+
+/*************************************************************************
+ *
+ * compress data frame in place, it is left unchanged if compressed data
+ * would not be shorter; when the same message is sent to many clients
+ * (notifications) it is compressed only once
+ *
+ * ***********************************************************************/
+static void ws_compress_item(ws_queue_item_t *q){
+	uint8_t bits = q -> conn_desc -> ws_window_bits;
+	int len;
+
+	if ((q -> payload == NULL) || (q -> len < WS_DEFLATE_MIN_LEN)){
+		return;
+	}
+
+	if ((q -> len == deflate_in_len) && (bits == deflate_bits) &&
+		(memcmp(q -> payload, deflate_in, q -> len) == 0)){
+		//the same as previous message
+		len = deflate_out_len;
+	}
+	else{
+		len = ws_deflate(q -> payload, q -> len, deflate_out,
+						MIN(q -> len - 1, sizeof(deflate_out)), bits);
+		if (q -> len <= sizeof(deflate_in)){
+			memcpy(deflate_in, q -> payload, q -> len);
+			deflate_in_len = q -> len;
+			deflate_out_len = len;
+			deflate_bits = bits;
+		}
+		else{
+			deflate_in_len = -1;
+		}
+	}
+
+	if (len > 0){
+		memcpy(q -> payload, deflate_out, len);
+		q -> len = len;
+		q -> compressed = 1;
+	}
+}
+#endif
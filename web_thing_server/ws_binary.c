@@ -0,0 +1,280 @@
+/*
+ * ws_binary.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  "webthing-bin" websocket subprotocol: property values are sent
+ *  in binary frames as typed scalars addressed by property index
+ *  (order of add_property calls), several properties in one frame.
+ *  Actions and events are still sent as json text frames.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "simple_web_thing_server.h"
+#include "ws_binary.h"
+#include "websocket.h"
+#include "web_thing_arena.h"
+
+static int8_t bin_add_property(uint8_t *buff, int size, int *len, property_t *p);
+
+
+static void put_u16(uint8_t *b, uint16_t v){
+
+	b[0] = v;
+	b[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *b, uint32_t v){
+
+	b[0] = v;
+	b[1] = v >> 8;
+	b[2] = v >> 16;
+	b[3] = v >> 24;
+}
+
+static uint32_t get_u32(uint8_t *b){
+
+	return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+
+/****************************************************************
+ *
+ * add property record to the message
+ * output: 0 - OK, -1 - error or record doesn't fit in the buffer
+ *
+ * **************************************************************/
+static int8_t bin_add_property(uint8_t *buff, int size, int *len, property_t *p){
+	char *json = NULL, *value = NULL;
+	int need, value_len = 0;
+	double val = 0;
+	uint8_t *b;
+
+	switch (p -> desc -> type){
+	case VAL_BOOLEAN:
+		need = 3;
+		break;
+	case VAL_INTEGER:
+	case VAL_NUMBER:
+		need = 6;
+		break;
+	default:
+		//"name":value, value is sent as json text
+		json = property_value_jsonize(p);
+		if (json == NULL){
+			return -1;
+		}
+		value = strchr(json, ':');
+		if (value == NULL){
+			req_free(json);
+			return -1;
+		}
+		value++;
+		value_len = strlen(value);
+		need = 4 + value_len;
+	}
+
+	if (*len + need > size){
+		req_free(json);
+		return -1;
+	}
+
+	b = buff + *len;
+	b[0] = p -> index;
+	if (json == NULL){
+		if (property_value_num(p, &val) == false){
+			return -1;
+		}
+		if (p -> desc -> type == VAL_BOOLEAN){
+			b[1] = WS_BIN_BOOL;
+			b[2] = (val != 0) ? 1 : 0;
+		}
+		else if (p -> desc -> type == VAL_INTEGER){
+			b[1] = WS_BIN_INT32;
+			put_u32(b + 2, (uint32_t)(int32_t)val);
+		}
+		else{
+			float f = val;
+			uint32_t u;
+
+			memcpy(&u, &f, sizeof(u));
+			b[1] = WS_BIN_FLOAT32;
+			put_u32(b + 2, u);
+		}
+	}
+	else{
+		b[1] = WS_BIN_JSON;
+		put_u16(b + 2, value_len);
+		memcpy(b + 4, value, value_len);
+		req_free(json);
+	}
+	*len += need;
+
+	return 0;
+}
+
+
+/****************************************************************
+ *
+ * binary propertyStatus message with one property, buffer is
+ * released by ws_payload_free
+ *
+ * **************************************************************/
+uint8_t *ws_bin_prop_msg(property_t *p, uint32_t seq, int *len){
+	uint8_t *buff;
+	int size = WS_PAYLOAD_LEN;
+
+	buff = ws_payload_alloc(size);
+	if (buff == NULL){
+		return NULL;
+	}
+	buff[0] = WS_BIN_PROP_STATUS;
+	buff[1] = p -> t -> thing_nr;
+	put_u32(buff + 2, seq);
+	*len = WS_BIN_HEADER_LEN;
+	if (bin_add_property(buff, size, len, p) < 0){
+		ws_payload_free(buff);
+		return NULL;
+	}
+
+	return buff;
+}
+
+
+/****************************************************************
+ *
+ * binary propertyStatus message with properties of the thing from
+ * *first on, as many as fit in one payload, *first is set to the
+ * next property; property longer than payload is skipped
+ * output: message (released by ws_payload_free) or NULL
+ *
+ * **************************************************************/
+uint8_t *ws_bin_props_msg(thing_t *t, uint32_t seq, int *first, int *len){
+	uint8_t *buff;
+
+	buff = ws_payload_alloc(WS_PAYLOAD_LEN);
+	if (buff == NULL){
+		return NULL;
+	}
+	buff[0] = WS_BIN_PROP_STATUS;
+	buff[1] = t -> thing_nr;
+	put_u32(buff + 2, seq);
+	*len = WS_BIN_HEADER_LEN;
+
+	for (; *first < t -> prop_quant; (*first)++){
+		if (bin_add_property(buff, WS_PAYLOAD_LEN, len, t -> properties[*first]) < 0){
+			if (*len > WS_BIN_HEADER_LEN){
+				//the rest goes in the next message
+				break;
+			}
+			printf("ws binary: property %s not sent, too long\n",
+					t -> properties[*first] -> desc -> id);
+		}
+	}
+	if (*len == WS_BIN_HEADER_LEN){
+		ws_payload_free(buff);
+		return NULL;
+	}
+
+	return buff;
+}
+
+
+/****************************************************************
+ *
+ * binary message received from client (setProperty)
+ *
+ * **************************************************************/
+int8_t ws_bin_receive(connection_desc_t *conn_desc, uint8_t *msg, uint32_t len){
+	thing_t *t;
+	property_t *p;
+	uint32_t pos = WS_BIN_HEADER_LEN;
+	char num_str[20], *value;
+	int8_t res = 0;
+
+	if ((len < WS_BIN_HEADER_LEN) || (msg[0] != WS_BIN_SET_PROP)){
+		return -1;
+	}
+	t = (conn_desc -> ws_node == true) ? get_thing_ptr(msg[1]) : conn_desc -> thing;
+	if (t == NULL){
+		return -1;
+	}
+
+	while (pos + 2 <= len){
+		uint8_t index = msg[pos];
+		uint8_t type = msg[pos + 1];
+
+		pos += 2;
+		value = num_str;
+		switch (type){
+		case WS_BIN_BOOL:
+			if (pos + 1 > len){
+				return -1;
+			}
+			strcpy(num_str, (msg[pos] != 0) ? "true" : "false");
+			pos += 1;
+			break;
+		case WS_BIN_INT32:
+			if (pos + 4 > len){
+				return -1;
+			}
+			sprintf(num_str, "%i", (int)(int32_t)get_u32(msg + pos));
+			pos += 4;
+			break;
+		case WS_BIN_FLOAT32:{
+			uint32_t u;
+			float f;
+
+			if (pos + 4 > len){
+				return -1;
+			}
+			u = get_u32(msg + pos);
+			memcpy(&f, &u, sizeof(f));
+			sprintf(num_str, "%.7g", f);
+			pos += 4;
+			break;
+		}
+		case WS_BIN_JSON:{
+			uint16_t n;
+
+			if (pos + 2 > len){
+				return -1;
+			}
+			n = msg[pos] | (msg[pos + 1] << 8);
+			pos += 2;
+			if (pos + n > len){
+				return -1;
+			}
+			value = req_malloc(n + 1);
+			if (value == NULL){
+				return -1;
+			}
+			memcpy(value, msg + pos, n);
+			value[n] = 0;
+			pos += n;
+			break;
+		}
+		default:
+			return -1;
+		}
+
+		p = get_property_by_index(t, index);
+		if (p != NULL){
+			set_resource_value(t -> thing_nr, p -> desc -> id, value);
+		}
+		else{
+			res = -1;
+		}
+		if (value != num_str){
+			req_free(value);
+		}
+	}
+
+	return res;
+}
@@ -0,0 +1,301 @@
+/*
+ * ws_decoder.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  Streaming websocket frame decoder (RFC 6455). Data received from TCP
+ *  can contain part of the frame or many frames, decoder state is kept
+ *  between calls. Decoder doesn't depend on FreeRTOS or lwIP, so it is
+ *  also built on host by test/Makefile.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "ws_decoder.h"
+
+
+/*************************************************************************
+ *
+ * unmask payload in place, 4 bytes at once
+ * 		pos - position of data in the frame (selects masking key byte)
+ *
+ * ***********************************************************************/
+static void ws_unmask(uint8_t *data, uint32_t len, const uint8_t *mask, uint64_t pos){
+	uint32_t i = 0, mask_word;
+	uint8_t m[4];
+
+	//bytes up to word boundary
+	while ((i < len) && (((uintptr_t)(data + i)) & 0x3)){
+		data[i] ^= mask[(pos + i) & 0x3];
+		i++;
+	}
+	for (int k = 0; k < 4; k++){
+		m[k] = mask[(pos + i + k) & 0x3];
+	}
+	memcpy(&mask_word, m, 4);
+	for (; i + 4 <= len; i += 4){
+		*(uint32_t *)(data + i) ^= mask_word;
+	}
+	for (; i < len; i++){
+		data[i] ^= mask[(pos + i) & 0x3];
+	}
+}
+
+
+/*************************************************************************
+ *
+ * prepare decoder for new connection
+ *
+ * ***********************************************************************/
+void ws_decoder_init(ws_decoder_t *d, uint32_t max_len, bool rsv1_allowed, void *ctx,
+					ws_dec_control_fun *control_fun, ws_dec_message_fun *message_fun,
+					ws_dec_error_fun *error_fun){
+
+	memset(d, 0, sizeof(ws_decoder_t));
+	d -> state = WS_DEC_HEAD;
+	d -> max_len = max_len;
+	d -> rsv1_allowed = rsv1_allowed;
+	d -> ctx = ctx;
+	d -> control_fun = control_fun;
+	d -> message_fun = message_fun;
+	d -> error_fun = error_fun;
+}
+
+
+/*************************************************************************
+ *
+ * messages are collected in fixed buffer instead of heap, longer
+ * messages (size - 1) are rejected
+ *
+ * ***********************************************************************/
+void ws_decoder_set_buffer(ws_decoder_t *d, uint8_t *buff, uint32_t size){
+
+	d -> msg = buff;
+	d -> msg_size = size;
+	if (d -> max_len > size - 1){
+		d -> max_len = size - 1;
+	}
+}
+
+
+/*************************************************************************
+ *
+ * incorrect data, decoder ignores next data
+ *
+ * ***********************************************************************/
+int8_t ws_decoder_fail(ws_decoder_t *d, uint16_t code, const char *info){
+
+	d -> state = WS_DEC_ERROR;
+	if (d -> error_fun != NULL){
+		d -> error_fun(d -> ctx, code, info);
+	}
+
+	return -1;
+}
+
+
+/*************************************************************************
+ *
+ * frame header received, check it and prepare for payload
+ *
+ * ***********************************************************************/
+static int8_t ws_frame_start(ws_decoder_t *d){
+	uint8_t len7, offset = 2;
+	uint64_t frame_len;
+
+	d -> fin = d -> head[0] >> 7;
+	d -> rsv = (d -> head[0] >> 4) & 0x7;
+	d -> opcode = d -> head[0] & 0xF;
+	d -> masked = d -> head[1] >> 7;
+	len7 = d -> head[1] & 0x7F;
+	if (len7 == 126){
+		frame_len = (d -> head[2] << 8) | d -> head[3];
+		offset = 4;
+	}
+	else if (len7 == 127){
+		frame_len = 0;
+		for (int i = 2; i < 10; i++){
+			frame_len = (frame_len << 8) | d -> head[i];
+		}
+		offset = 10;
+	}
+	else{
+		frame_len = len7;
+	}
+	if (d -> masked == 1){
+		memcpy(d -> mask, d -> head + offset, 4);
+	}
+	d -> frame_len = frame_len;
+	d -> frame_pos = 0;
+	d -> head_len = 0;
+	d -> head_need = 0;
+	d -> state = WS_DEC_PAYLOAD;
+
+	if (d -> masked == 0){
+		//client must mask all frames (RFC 6455, 5.1)
+		return ws_decoder_fail(d, PROTOCOL_ERR, "unmasked client frame");
+	}
+	if ((d -> rsv & ~WS_RSV1) || ((d -> rsv == WS_RSV1) && (d -> rsv1_allowed == false))){
+		return ws_decoder_fail(d, PROTOCOL_ERR, "incorrect RSV bits");
+	}
+
+	if (d -> opcode & 0x8){
+		//control frame, can be between fragments of data message
+		if ((d -> fin == 0) || (frame_len > WS_CTRL_MAX_LEN) || (d -> rsv != 0)){
+			return ws_decoder_fail(d, PROTOCOL_ERR, "incorrect control frame");
+		}
+		if ((d -> opcode != WS_OP_CLS) && (d -> opcode != WS_OP_PIN) &&
+			(d -> opcode != WS_OP_PON)){
+			return ws_decoder_fail(d, PROTOCOL_ERR, "incorrect opcode");
+		}
+		d -> ctrl_len = 0;
+		return 0;
+	}
+
+	if (d -> opcode == WS_OP_CON){
+		//next fragment of the message
+		if ((d -> msg_active == false) || (d -> rsv != 0)){
+			return ws_decoder_fail(d, PROTOCOL_ERR, "unexpected continuation frame");
+		}
+	}
+	else if ((d -> opcode == WS_OP_TXT) || (d -> opcode == WS_OP_BIN)){
+		//first (or only) fragment of the message
+		if (d -> msg_active == true){
+			return ws_decoder_fail(d, PROTOCOL_ERR, "fragmented message not finished");
+		}
+		d -> msg_active = true;
+		d -> msg_opcode = d -> opcode;
+		d -> msg_rsv = d -> rsv;
+		d -> msg_len = 0;
+	}
+	else{
+		return ws_decoder_fail(d, PROTOCOL_ERR, "incorrect opcode");
+	}
+
+	if (d -> msg_len + frame_len > d -> max_len){
+		return ws_decoder_fail(d, DATA_TO_BIG, "message too long");
+	}
+	if (d -> msg_size == 0){
+		//buffer for the whole message so far, payload is written directly into it
+		uint8_t *buff = realloc(d -> msg, d -> msg_len + frame_len + 1);
+		if (buff == NULL){
+			return ws_decoder_fail(d, SERVER_ERR, "no memory for message");
+		}
+		d -> msg = buff;
+	}
+
+	return 0;
+}
+
+
+/*************************************************************************
+ *
+ * copy and unmask payload bytes of the current frame
+ *
+ * ***********************************************************************/
+static void ws_frame_data(ws_decoder_t *d, uint8_t *data, uint32_t len){
+	uint8_t *dst;
+
+	if (d -> opcode & 0x8){
+		dst = d -> ctrl + d -> ctrl_len;
+		d -> ctrl_len += len;
+	}
+	else{
+		dst = d -> msg + d -> msg_len;
+		d -> msg_len += len;
+	}
+	memcpy(dst, data, len);
+	ws_unmask(dst, len, d -> mask, d -> frame_pos);
+	d -> frame_pos += len;
+}
+
+
+/*************************************************************************
+ *
+ * current frame finished
+ *
+ * ***********************************************************************/
+static void ws_frame_end(ws_decoder_t *d){
+
+	d -> state = WS_DEC_HEAD;
+	if (d -> opcode & 0x8){
+		d -> control_fun(d -> ctx, d -> opcode, d -> ctrl, d -> ctrl_len);
+	}
+	else if (d -> fin == 1){
+		//the last fragment, message is handed over to the parser
+		d -> msg_active = false;
+		d -> msg[d -> msg_len] = 0;
+		d -> message_fun(d -> ctx, d -> msg_opcode, d -> msg_rsv, d -> msg, d -> msg_len);
+		if (d -> msg_size == 0){
+			free(d -> msg);
+			d -> msg = NULL;
+		}
+		d -> msg_len = 0;
+	}
+}
+
+
+/*************************************************************************
+ *
+ * streaming websocket decoder
+ * returns: 0 - ok, -1 - incorrect data (error callback was called)
+ *
+ * ***********************************************************************/
+int8_t ws_decode(ws_decoder_t *d, uint8_t *data, uint32_t len){
+	uint32_t n;
+
+	while ((len > 0) && (d -> state != WS_DEC_ERROR)){
+		if (d -> state == WS_DEC_HEAD){
+			//collect frame header
+			d -> head[d -> head_len++] = *data++;
+			len--;
+			if (d -> head_len == 2){
+				uint8_t len7 = d -> head[1] & 0x7F;
+
+				d -> head_need = 2 + ((len7 == 126) ? 2 : (len7 == 127) ? 8 : 0) +
+								((d -> head[1] & 0x80) ? 4 : 0);
+			}
+			if ((d -> head_len < 2) || (d -> head_len < d -> head_need)){
+				continue;
+			}
+			if (ws_frame_start(d) < 0){
+				return -1;
+			}
+		}
+		else{
+			//payload
+			n = MIN(len, d -> frame_len - d -> frame_pos);
+			ws_frame_data(d, data, n);
+			data += n;
+			len -= n;
+		}
+		if (d -> frame_pos == d -> frame_len){
+			ws_frame_end(d);
+		}
+	}
+
+	return (d -> state == WS_DEC_ERROR) ? -1 : 0;
+}
+
+
+/*************************************************************************
+ *
+ * release message buffer of the decoder (fixed buffer is only
+ * forgotten)
+ *
+ * ***********************************************************************/
+void ws_decoder_release(ws_decoder_t *d){
+
+	if (d -> msg_size == 0){
+		free(d -> msg);
+	}
+	d -> msg = NULL;
+	d -> msg_size = 0;
+	d -> msg_len = 0;
+	d -> msg_active = false;
+}
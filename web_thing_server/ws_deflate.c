@@ -0,0 +1,529 @@
+/*
+ * ws_deflate.c
+ *
+ *  This file is a part of the "Simple Web Thing Server" project
+ *  Created on: Oct 18, 2026
+ *      Author: Krzysztof Zurek
+ *		e-mail: krzzurek@gmail.com
+ *
+ *  Raw DEFLATE (RFC 1951) for websocket permessage-deflate (RFC 7692).
+ *  Compressor: one block with fixed Huffman codes, LZ77 matches found with
+ *  a small hash table, no context takeover (every message is compressed
+ *  independently), so memory is constant and does not depend on number
+ *  of connections.
+ *  Decompressor: all block types, message is decompressed into linear
+ *  buffer, so no separate window is needed (client_no_context_takeover).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/param.h>
+
+#include "ws_deflate.h"
+
+#define HASH_BITS		9
+#define HASH_SIZE		(1 << HASH_BITS)
+#define MIN_MATCH		3
+#define MAX_MATCH		258
+
+#define MAXBITS			15		//max bits in a code
+#define MAXLCODES		286		//max number of literal/length codes
+#define MAXDCODES		30		//max number of distance codes
+#define FIXLCODES		288		//number of fixed literal/length codes
+
+//bit writer
+typedef struct{
+	uint8_t *out;
+	int size;
+	int pos;
+	uint32_t bitbuf;
+	int bitcnt;
+	bool overflow;
+} bit_writer_t;
+
+//bit reader and output of the decompressor
+typedef struct{
+	const uint8_t *in;
+	int in_len;
+	int in_pos;
+	uint32_t bitbuf;
+	int bitcnt;
+	uint8_t *out;
+	int out_size;
+	int out_pos;
+	bool err;
+} inflate_state_t;
+
+//canonical Huffman decoding table
+typedef struct{
+	int16_t count[MAXBITS + 1];		//number of codes of each length
+	int16_t symbol[FIXLCODES];		//symbols ordered by code
+} huffman_t;
+
+typedef struct{
+	inflate_state_t s;
+	huffman_t lencode;
+	huffman_t distcode;
+	int16_t lengths[MAXLCODES + MAXDCODES];
+} inflate_work_t;
+
+_Static_assert(sizeof(inflate_work_t) <= WS_INFLATE_WORK_LEN, "WS_INFLATE_WORK_LEN too small");
+
+//length and distance codes (RFC 1951, 3.2.5)
+static const int16_t len_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const int16_t len_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const int16_t dist_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577};
+static const int16_t dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+//order of code length codes
+static const uint8_t cl_order[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+//LEN and NLEN of empty stored block, removed by sender (RFC 7692, 7.2.1)
+static const uint8_t sync_tail[4] = {0x00, 0x00, 0xFF, 0xFF};
+
+//compressor hash table (position + 1 of the last 3-byte sequence),
+//only websocket sending task compresses data, so it is not reentrant
+static uint16_t hash_tab[HASH_SIZE];
+
+
+/****************************************************************
+ *
+ * compressor helpers
+ *
+ * **************************************************************/
+static void put_bits(bit_writer_t *w, uint32_t val, int n){
+
+	w -> bitbuf |= val << w -> bitcnt;
+	w -> bitcnt += n;
+	while (w -> bitcnt >= 8){
+		if (w -> pos < w -> size){
+			w -> out[w -> pos++] = w -> bitbuf & 0xFF;
+		}
+		else{
+			w -> overflow = true;
+		}
+		w -> bitbuf >>= 8;
+		w -> bitcnt -= 8;
+	}
+}
+
+//Huffman codes are written starting from the most significant bit
+static void put_code(bit_writer_t *w, uint32_t code, int len){
+	uint32_t rev = 0;
+
+	for (int i = 0; i < len; i++){
+		rev = (rev << 1) | (code & 1);
+		code >>= 1;
+	}
+	put_bits(w, rev, len);
+}
+
+//fixed Huffman code of literal/length symbol
+static void put_symbol(bit_writer_t *w, int sym){
+
+	if (sym < 144){
+		put_code(w, 0x30 + sym, 8);
+	}
+	else if (sym < 256){
+		put_code(w, 0x190 + sym - 144, 9);
+	}
+	else if (sym < 280){
+		put_code(w, sym - 256, 7);
+	}
+	else{
+		put_code(w, 0xC0 + sym - 280, 8);
+	}
+}
+
+static void put_match(bit_writer_t *w, int len, int dist){
+	int i;
+
+	for (i = 28; len_base[i] > len; i--);
+	put_symbol(w, 257 + i);
+	put_bits(w, len - len_base[i], len_extra[i]);
+
+	for (i = 29; dist_base[i] > dist; i--);
+	put_code(w, i, 5);
+	put_bits(w, dist - dist_base[i], dist_extra[i]);
+}
+
+static uint32_t hash3(const uint8_t *p){
+
+	return (((p[0] << 16) | (p[1] << 8) | p[2]) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+
+/****************************************************************
+ *
+ * compress message
+ * inputs:
+ * 		window_bits - max distance of matches (server_max_window_bits)
+ * output:
+ * 		length of compressed data (without 00 00 FF FF tail)
+ * 		or -1 if it does not fit into out buffer
+ *
+ * **************************************************************/
+int ws_deflate(const uint8_t *in, int in_len, uint8_t *out, int out_size,
+				uint8_t window_bits){
+	bit_writer_t w = {out, out_size, 0, 0, 0, false};
+	int pos = 0, max_dist = 1 << window_bits;
+
+	if (in_len > 0xFFFF){
+		return -1;
+	}
+	memset(hash_tab, 0, sizeof(hash_tab));
+
+	//BFINAL = 0, BTYPE = 01 (fixed Huffman codes)
+	put_bits(&w, 0x2, 3);
+	while ((pos < in_len) && (w.overflow == false)){
+		int match_len = 0, cand;
+
+		if (pos + MIN_MATCH <= in_len){
+			uint32_t h = hash3(in + pos);
+
+			cand = hash_tab[h] - 1;
+			hash_tab[h] = pos + 1;
+			if ((cand >= 0) && (pos - cand <= max_dist)){
+				int max_len = MIN(MAX_MATCH, in_len - pos);
+
+				while ((match_len < max_len) && (in[cand + match_len] == in[pos + match_len])){
+					match_len++;
+				}
+			}
+		}
+		if (match_len >= MIN_MATCH){
+			put_match(&w, match_len, pos - cand);
+			//positions inside the match are also remembered
+			for (int i = 1; i < match_len; i++){
+				if (pos + i + MIN_MATCH <= in_len){
+					hash_tab[hash3(in + pos + i)] = pos + i + 1;
+				}
+			}
+			pos += match_len;
+		}
+		else{
+			put_symbol(&w, in[pos]);
+			pos++;
+		}
+	}
+	//end of block
+	put_symbol(&w, 256);
+	//empty stored block (sync flush), byte aligned, its LEN and NLEN are not sent
+	put_bits(&w, 0, 3);
+	if (w.bitcnt > 0){
+		put_bits(&w, 0, 8 - w.bitcnt);
+	}
+
+	return (w.overflow == true) ? -1 : w.pos;
+}
+
+
+/****************************************************************
+ *
+ * decompressor helpers
+ *
+ * **************************************************************/
+static int next_byte(inflate_state_t *s){
+
+	if (s -> in_pos < s -> in_len){
+		return s -> in[s -> in_pos++];
+	}
+	if (s -> in_pos < s -> in_len + sizeof(sync_tail)){
+		return sync_tail[s -> in_pos++ - s -> in_len];
+	}
+	s -> err = true;
+
+	return 0;
+}
+
+static int get_bits(inflate_state_t *s, int need){
+	uint32_t val = s -> bitbuf;
+
+	while (s -> bitcnt < need){
+		val |= (uint32_t)next_byte(s) << s -> bitcnt;
+		s -> bitcnt += 8;
+	}
+	s -> bitbuf = val >> need;
+	s -> bitcnt -= need;
+
+	return val & ((1UL << need) - 1);
+}
+
+static int decode(inflate_state_t *s, const huffman_t *h){
+	int code = 0, first = 0, index = 0, count;
+
+	for (int len = 1; len <= MAXBITS; len++){
+		code |= get_bits(s, 1);
+		count = h -> count[len];
+		if (code - count < first){
+			return h -> symbol[index + (code - first)];
+		}
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+
+	return -1;
+}
+
+//build decoding table from code lengths,
+//output: 0 - complete code, >0 - incomplete code, <0 - over-subscribed
+static int construct(huffman_t *h, const int16_t *length, int n){
+	int16_t offs[MAXBITS + 1];
+	int left = 1;
+
+	memset(h -> count, 0, sizeof(h -> count));
+	for (int sym = 0; sym < n; sym++){
+		h -> count[length[sym]]++;
+	}
+	if (h -> count[0] == n){
+		return 0;
+	}
+	for (int len = 1; len <= MAXBITS; len++){
+		left <<= 1;
+		left -= h -> count[len];
+		if (left < 0){
+			return left;
+		}
+	}
+	offs[1] = 0;
+	for (int len = 1; len < MAXBITS; len++){
+		offs[len + 1] = offs[len] + h -> count[len];
+	}
+	for (int sym = 0; sym < n; sym++){
+		if (length[sym] != 0){
+			h -> symbol[offs[length[sym]]++] = sym;
+		}
+	}
+
+	return left;
+}
+
+static int inflate_stored(inflate_state_t *s){
+	unsigned int len, nlen;
+
+	//skip bits up to byte boundary
+	s -> bitbuf = 0;
+	s -> bitcnt = 0;
+	len = next_byte(s);
+	len |= next_byte(s) << 8;
+	nlen = next_byte(s);
+	nlen |= next_byte(s) << 8;
+	if ((s -> err == true) || (len != (~nlen & 0xFFFF))){
+		return -1;
+	}
+	if (s -> out_pos + len > s -> out_size){
+		return -1;
+	}
+	while (len--){
+		s -> out[s -> out_pos++] = next_byte(s);
+	}
+
+	return (s -> err == true) ? -1 : 0;
+}
+
+static int inflate_codes(inflate_state_t *s, const huffman_t *lencode,
+							const huffman_t *distcode){
+	int sym, len, dist;
+
+	do{
+		sym = decode(s, lencode);
+		if ((sym < 0) || (s -> err == true)){
+			return -1;
+		}
+		if (sym < 256){
+			//literal
+			if (s -> out_pos >= s -> out_size){
+				return -1;
+			}
+			s -> out[s -> out_pos++] = sym;
+		}
+		else if (sym > 256){
+			//length and distance
+			sym -= 257;
+			if (sym >= 29){
+				return -1;
+			}
+			len = len_base[sym] + get_bits(s, len_extra[sym]);
+			sym = decode(s, distcode);
+			if ((sym < 0) || (sym >= MAXDCODES)){
+				return -1;
+			}
+			dist = dist_base[sym] + get_bits(s, dist_extra[sym]);
+			if ((dist > s -> out_pos) || (s -> out_pos + len > s -> out_size)){
+				return -1;
+			}
+			while (len--){
+				s -> out[s -> out_pos] = s -> out[s -> out_pos - dist];
+				s -> out_pos++;
+			}
+		}
+	} while (sym != 256);
+
+	return 0;
+}
+
+static int inflate_fixed(inflate_work_t *w){
+	int sym;
+
+	for (sym = 0; sym < 144; sym++){
+		w -> lengths[sym] = 8;
+	}
+	for (; sym < 256; sym++){
+		w -> lengths[sym] = 9;
+	}
+	for (; sym < 280; sym++){
+		w -> lengths[sym] = 7;
+	}
+	for (; sym < FIXLCODES; sym++){
+		w -> lengths[sym] = 8;
+	}
+	construct(&w -> lencode, w -> lengths, FIXLCODES);
+	for (sym = 0; sym < MAXDCODES; sym++){
+		w -> lengths[sym] = 5;
+	}
+	construct(&w -> distcode, w -> lengths, MAXDCODES);
+
+	return inflate_codes(&w -> s, &w -> lencode, &w -> distcode);
+}
+
+static int inflate_dynamic(inflate_work_t *w){
+	inflate_state_t *s = &w -> s;
+	int nlen, ndist, ncode, index, sym, len, err;
+
+	nlen = get_bits(s, 5) + 257;
+	ndist = get_bits(s, 5) + 1;
+	ncode = get_bits(s, 4) + 4;
+	if ((nlen > MAXLCODES) || (ndist > MAXDCODES)){
+		return -1;
+	}
+	for (index = 0; index < ncode; index++){
+		w -> lengths[cl_order[index]] = get_bits(s, 3);
+	}
+	for (; index < 19; index++){
+		w -> lengths[cl_order[index]] = 0;
+	}
+	if (construct(&w -> lencode, w -> lengths, 19) != 0){
+		return -1;
+	}
+
+	//literal/length and distance code lengths
+	index = 0;
+	while (index < nlen + ndist){
+		sym = decode(s, &w -> lencode);
+		if ((sym < 0) || (s -> err == true)){
+			return -1;
+		}
+		if (sym < 16){
+			w -> lengths[index++] = sym;
+		}
+		else{
+			len = 0;
+			if (sym == 16){
+				if (index == 0){
+					return -1;
+				}
+				len = w -> lengths[index - 1];
+				sym = 3 + get_bits(s, 2);
+			}
+			else if (sym == 17){
+				sym = 3 + get_bits(s, 3);
+			}
+			else{
+				sym = 11 + get_bits(s, 7);
+			}
+			if (index + sym > nlen + ndist){
+				return -1;
+			}
+			while (sym--){
+				w -> lengths[index++] = len;
+			}
+		}
+	}
+	if (w -> lengths[256] == 0){
+		//no end of block code
+		return -1;
+	}
+
+	err = construct(&w -> lencode, w -> lengths, nlen);
+	if ((err < 0) || ((err > 0) && (nlen - w -> lencode.count[0] != 1))){
+		return -1;
+	}
+	err = construct(&w -> distcode, w -> lengths + nlen, ndist);
+	if ((err < 0) || ((err > 0) && (ndist - w -> distcode.count[0] != 1))){
+		return -1;
+	}
+
+	return inflate_codes(s, &w -> lencode, &w -> distcode);
+}
+
+
+/****************************************************************
+ *
+ * decompress message (00 00 FF FF tail is added internally)
+ * 		work - work area of WS_INFLATE_WORK_LEN bytes (aligned),
+ * 				NULL - taken from heap
+ * output:
+ * 		length of decompressed data or -1 (data error or too small
+ * 		out buffer)
+ *
+ * **************************************************************/
+int ws_inflate(const uint8_t *in, int in_len, uint8_t *out, int out_size, void *work){
+	inflate_work_t *w = work;
+	int last, type, res = 0;
+
+	if (work == NULL){
+		w = malloc(sizeof(inflate_work_t));
+		if (w == NULL){
+			return -1;
+		}
+	}
+	memset(&w -> s, 0, sizeof(inflate_state_t));
+	w -> s.in = in;
+	w -> s.in_len = in_len;
+	w -> s.out = out;
+	w -> s.out_size = out_size;
+
+	do{
+		last = get_bits(&w -> s, 1);
+		type = get_bits(&w -> s, 2);
+		if (w -> s.err == true){
+			res = -1;
+			break;
+		}
+		switch (type){
+		case 0:
+			res = inflate_stored(&w -> s);
+			break;
+		case 1:
+			res = inflate_fixed(w);
+			break;
+		case 2:
+			res = inflate_dynamic(w);
+			break;
+		default:
+			res = -1;
+		}
+		//message ends with the empty stored block (sync tail)
+	} while ((res == 0) && (last == 0) &&
+			(w -> s.in_pos < w -> s.in_len + sizeof(sync_tail)));
+
+	if (res == 0){
+		res = w -> s.out_pos;
+	}
+	if (work == NULL){
+		free(w);
+	}
+
+	return res;
+}